@@ -0,0 +1,63 @@
+#ifndef ANTIALIASSHADE_H
+#define ANTIALIASSHADE_H
+
+//FXAA over the scene region of a render graph target, at render resolution; drawn with upscaleVertexShaderSource
+
+
+const char* antialiasFragmentShaderSource = "#version 440 core\n"
+
+"in vec2 screenCoordinate;\n"
+
+"out vec4 fragmentColor;\n"
+
+"uniform sampler2D sceneTexture;\n"
+"uniform vec2 regionScale;\n"			//Part of the target the scene was drawn into
+"uniform vec2 texelSize;\n"
+
+//Every sample stays inside the drawn region
+"vec3 sampleRegion(vec2 coordinate)\n"
+"{\n"
+"	return texture(sceneTexture, clamp(coordinate, 0.5f * texelSize, regionScale - 0.5f * texelSize)).rgb;\n"
+"}\n"
+
+"float luma(vec3 color)\n"
+"{\n"
+"	return dot(color, vec3(0.299f, 0.587f, 0.114f));\n"
+"}\n"
+
+"void main()\n"
+"{\n"
+
+"	vec2 coordinate = screenCoordinate * regionScale;\n"
+"	vec3 center = sampleRegion(coordinate);\n"
+"	float lumaCenter = luma(center);\n"
+"	float lumaNW = luma(sampleRegion(coordinate + vec2(-1.0f, -1.0f) * texelSize));\n"
+"	float lumaNE = luma(sampleRegion(coordinate + vec2(1.0f, -1.0f) * texelSize));\n"
+"	float lumaSW = luma(sampleRegion(coordinate + vec2(-1.0f, 1.0f) * texelSize));\n"
+"	float lumaSE = luma(sampleRegion(coordinate + vec2(1.0f, 1.0f) * texelSize));\n"
+
+"	float lumaMin = min(lumaCenter, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));\n"
+"	float lumaMax = max(lumaCenter, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));\n"
+
+	//Flat areas are left alone
+"	if (lumaMax - lumaMin < max(0.0312f, lumaMax * 0.125f)) {\n"
+"		fragmentColor = vec4(center, 1.0f);\n"
+"		return;\n"
+"	}\n"
+
+	//Blur along the edge, perpendicular to the luma gradient
+"	vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));\n"
+"	float directionReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.03125f, 0.0078125f);\n"
+"	float inverseDirectionMin = 1.0f / (min(abs(direction.x), abs(direction.y)) + directionReduce);\n"
+"	direction = clamp(direction * inverseDirectionMin, -8.0f, 8.0f) * texelSize;\n"
+
+"	vec3 nearBlend = 0.5f * (sampleRegion(coordinate - direction / 6.0f) + sampleRegion(coordinate + direction / 6.0f));\n"
+"	vec3 farBlend = 0.5f * nearBlend + 0.25f * (sampleRegion(coordinate - direction * 0.5f) + sampleRegion(coordinate + direction * 0.5f));\n"
+
+	//The wider blend is used unless it reaches past the local contrast range (it crossed another edge)
+"	float lumaFar = luma(farBlend);\n"
+"	fragmentColor = vec4(lumaFar < lumaMin || lumaFar > lumaMax ? nearBlend : farBlend, 1.0f);\n"
+
+"}\0";
+
+#endif
@@ -0,0 +1,1072 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+/*Single-file asset pack
+* Textures, meshes, and shader sources are packed into one archive that is mapped into memory once at startup.
+* Layout: PackHeader | blobs (each aligned to PACK_ALIGNMENT) | PackEntry table | hash buckets | name table
+* Names are normalized (lower case, forward slashes) before hashing, so "Index_Texture.jpg" and "Index_texture.jpg"
+* resolve to the same entry on every platform.
+*/
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+#include "Logger.h"
+
+//-----------------------------------FORMAT-------------------------------------------
+const uint32_t PACK_VERSION = 1;
+const uint64_t PACK_ALIGNMENT = 64;			//Blob alignment; keeps texel rows and vertex data cache-line aligned
+const uint32_t PACK_EMPTY_BUCKET = 0xFFFFFFFFu;
+
+enum AssetKind : uint16_t {
+	ASSET_RAW = 0,		//Bytes exactly as found on disk (encoded images, unknown files)
+	ASSET_TEXTURE = 1,	//Decoded, vertically flipped texels ready for glTexImage2D
+	ASSET_MESH = 2,		//MeshBlobHeader followed by interleaved vertices and indices
+	ASSET_SHADER = 3	//NUL terminated GLSL source
+};
+
+enum PackCodec : uint16_t {
+	CODEC_NONE = 0,
+	CODEC_LZ4 = 1		//LZ4 block format
+};
+
+struct PackHeader {
+	char magic[4];				//'S','P','A','K'
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t bucketCount;		//Power of two, open addressed with linear probing
+	uint64_t entriesOffset;
+	uint64_t bucketsOffset;
+	uint64_t namesOffset;
+	uint64_t fileSize;
+};
+
+struct PackEntry {
+	uint64_t nameHash;			//FNV-1a of the normalized name
+	uint64_t offset;			//Blob offset from the start of the pack
+	uint64_t storedSize;		//Bytes on disk
+	uint64_t rawSize;			//Bytes after decompression
+	uint32_t nameOffset;		//Offset into the name table
+	uint16_t kind;				//AssetKind
+	uint16_t codec;				//PackCodec
+	uint32_t width;				//Texture dimensions (0 for other kinds)
+	uint32_t height;
+	uint32_t channels;
+	uint32_t reserved;
+};
+
+//Mesh blobs use the same interleaved layout as UCreateMesh: position(3) color(4) normal(3) uv(2)
+struct MeshBlobHeader {
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t floatsPerVertex;
+	uint32_t indexSize;			//2 (GLushort) or 4 (GLuint)
+};
+
+//Read-only view of a resolved asset; valid until the pack is closed or loose assets are released
+struct AssetView {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	AssetKind kind = ASSET_RAW;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 0;
+};
+
+//-----------------------------------HELPERS------------------------------------------
+//Lower case, forward slashes, no leading "./"
+std::string UNormalizeAssetName(const std::string& name) {
+	std::string normalized;
+	normalized.reserve(name.size());
+	for (char c : name) {
+		if (c == '\\')
+			c = '/';
+		normalized.push_back((char)tolower((unsigned char)c));
+	}
+	while (normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+	return normalized;
+}
+
+uint64_t UHashAssetName(const std::string& normalized) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : normalized) {
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool UEndsWith(const std::string& text, const char* suffix) {
+	size_t n = strlen(suffix);
+	return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+//-------------------------------------LZ4--------------------------------------------
+//Minimal LZ4 block codec (greedy matcher, 64KB window) so packs need no extra library
+const int LZ4_HASH_BITS = 16;
+const uint64_t LZ4_MAX_RATIO = 255;		//A block cannot expand more than this: each further length byte adds at most 255
+
+void ULz4WriteLength(std::vector<unsigned char>& dst, size_t length) {
+	for (; length >= 255; length -= 255)
+		dst.push_back(255);
+	dst.push_back((unsigned char)length);
+}
+
+void ULz4Compress(const unsigned char* src, size_t size, std::vector<unsigned char>& dst) {
+	dst.clear();
+	dst.reserve(size + size / 255 + 16);
+
+	std::vector<int64_t> table((size_t)1 << LZ4_HASH_BITS, -1);
+	size_t anchor = 0;
+	size_t i = 0;
+
+	//The last match must start 12 bytes before the end and the last 5 bytes are always literals
+	while (size >= 13 && i + 12 <= size) {
+		uint32_t sequence;
+		memcpy(&sequence, src + i, 4);
+		uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+		int64_t ref = table[hash];
+		table[hash] = (int64_t)i;
+
+		if (ref < 0 || i - (size_t)ref > 65535 || memcmp(src + ref, src + i, 4) != 0) {
+			++i;
+			continue;
+		}
+
+		size_t matchLength = 4;
+		size_t maxLength = size - 5 - i;
+		while (matchLength < maxLength && src[ref + matchLength] == src[i + matchLength])
+			++matchLength;
+
+		size_t literals = i - anchor;
+		size_t extra = matchLength - 4;
+		dst.push_back((unsigned char)((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(extra, 15)));
+		if (literals >= 15)
+			ULz4WriteLength(dst, literals - 15);
+		dst.insert(dst.end(), src + anchor, src + i);
+
+		size_t offset = i - (size_t)ref;
+		dst.push_back((unsigned char)(offset & 0xFF));
+		dst.push_back((unsigned char)(offset >> 8));
+		if (extra >= 15)
+			ULz4WriteLength(dst, extra - 15);
+
+		i += matchLength;
+		anchor = i;
+	}
+
+	//Trailing literals
+	size_t literals = size - anchor;
+	dst.push_back((unsigned char)(std::min<size_t>(literals, 15) << 4));
+	if (literals >= 15)
+		ULz4WriteLength(dst, literals - 15);
+	dst.insert(dst.end(), src + anchor, src + size);
+}
+
+bool ULz4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize) {
+	size_t ip = 0;
+	size_t op = 0;
+
+	while (ip < srcSize) {
+		unsigned char token = src[ip++];
+
+		size_t literals = token >> 4;
+		if (literals == 15) {
+			unsigned char b;
+			do {
+				if (ip >= srcSize)
+					return false;
+				b = src[ip++];
+				literals += b;
+			} while (b == 255);
+		}
+		if (ip + literals > srcSize || op + literals > dstSize)
+			return false;
+		memcpy(dst + op, src + ip, literals);
+		ip += literals;
+		op += literals;
+
+		//The final sequence carries literals only
+		if (ip >= srcSize)
+			break;
+
+		if (ip + 2 > srcSize)
+			return false;
+		size_t offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op)
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15) {
+			unsigned char b;
+			do {
+				if (ip >= srcSize)
+					return false;
+				b = src[ip++];
+				matchLength += b;
+			} while (b == 255);
+		}
+		matchLength += 4;
+		if (op + matchLength > dstSize)
+			return false;
+
+		//Byte copy; matches may overlap their own output
+		for (size_t k = 0; k < matchLength; ++k)
+			dst[op + k] = dst[op - offset + k];
+		op += matchLength;
+	}
+
+	return op == dstSize;
+}
+
+//-------------------------------------MAPPING----------------------------------------
+struct MappedFile {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+};
+
+bool UMapFile(const char* path, MappedFile& mapped) {
+#ifdef _WIN32
+	mapped.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (mapped.file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(mapped.file, &fileSize);
+	mapped.size = (size_t)fileSize.QuadPart;
+
+	mapped.mapping = CreateFileMappingA(mapped.file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapped.mapping == NULL) {
+		CloseHandle(mapped.file);
+		mapped.file = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	mapped.data = (const unsigned char*)MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapped.data == nullptr) {
+		CloseHandle(mapped.mapping);
+		CloseHandle(mapped.file);
+		mapped.mapping = NULL;
+		mapped.file = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	return true;
+#else
+	mapped.fd = open(path, O_RDONLY);
+	if (mapped.fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(mapped.fd, &info) != 0 || info.st_size == 0) {
+		close(mapped.fd);
+		mapped.fd = -1;
+		return false;
+	}
+	mapped.size = (size_t)info.st_size;
+
+	void* address = mmap(nullptr, mapped.size, PROT_READ, MAP_PRIVATE, mapped.fd, 0);
+	if (address == MAP_FAILED) {
+		close(mapped.fd);
+		mapped.fd = -1;
+		return false;
+	}
+	mapped.data = (const unsigned char*)address;
+	return true;
+#endif
+}
+
+void UUnmapFile(MappedFile& mapped) {
+#ifdef _WIN32
+	if (mapped.data)
+		UnmapViewOfFile(mapped.data);
+	if (mapped.mapping)
+		CloseHandle(mapped.mapping);
+	if (mapped.file != INVALID_HANDLE_VALUE)
+		CloseHandle(mapped.file);
+	mapped.mapping = NULL;
+	mapped.file = INVALID_HANDLE_VALUE;
+#else
+	if (mapped.data)
+		munmap((void*)mapped.data, mapped.size);
+	if (mapped.fd >= 0)
+		close(mapped.fd);
+	mapped.fd = -1;
+#endif
+	mapped.data = nullptr;
+	mapped.size = 0;
+}
+
+//-------------------------------------PACK READER------------------------------------
+struct AssetPack {
+	MappedFile file;
+	const PackHeader* header = nullptr;
+	const PackEntry* entries = nullptr;
+	const uint32_t* buckets = nullptr;
+	const char* names = nullptr;
+
+	//Decompressed copies of LZ4 entries, created on first lookup
+	std::unordered_map<uint32_t, std::vector<unsigned char>> inflated;
+	std::mutex inflatedMutex;
+};
+
+bool UOpenAssetPack(const char* path, AssetPack& pack) {
+	if (!UMapFile(path, pack.file))
+		return false;
+
+	const PackHeader* header = (const PackHeader*)pack.file.data;
+	bool valid = pack.file.size >= sizeof(PackHeader)
+		&& memcmp(header->magic, "SPAK", 4) == 0
+		&& header->version == PACK_VERSION
+		&& header->fileSize == pack.file.size
+		&& header->bucketCount != 0
+		&& (header->bucketCount & (header->bucketCount - 1)) == 0
+		&& header->entriesOffset <= pack.file.size
+		&& (uint64_t)header->entryCount * sizeof(PackEntry) <= pack.file.size - header->entriesOffset
+		&& header->bucketsOffset <= pack.file.size
+		&& (uint64_t)header->bucketCount * sizeof(uint32_t) <= pack.file.size - header->bucketsOffset
+		&& header->namesOffset <= pack.file.size;
+
+	//Every entry's blob and name must lie inside the file, so lookups never read past the mapping. Texels are
+	//uploaded straight from the entry, so a texture's size must match its dimensions, and an LZ4 entry cannot claim
+	//more bytes than its blob could decompress to.
+	const PackEntry* entries = (const PackEntry*)(pack.file.data + (valid ? header->entriesOffset : 0));
+	for (uint32_t i = 0; valid && i < header->entryCount; ++i) {
+		const PackEntry& entry = entries[i];
+		uint64_t nameStart = header->namesOffset + entry.nameOffset;
+		valid = entry.offset <= pack.file.size
+			&& entry.storedSize <= pack.file.size - entry.offset
+			&& (entry.codec != CODEC_NONE || entry.rawSize == entry.storedSize)
+			&& (entry.codec != CODEC_LZ4 || entry.rawSize / LZ4_MAX_RATIO <= entry.storedSize)
+			&& (entry.kind != ASSET_TEXTURE || (entry.channels >= 1 && entry.channels <= 4
+				&& (uint64_t)entry.width * entry.height <= entry.rawSize && (uint64_t)entry.width * entry.height * entry.channels == entry.rawSize))
+			&& nameStart < pack.file.size
+			&& memchr(pack.file.data + nameStart, '\0', (size_t)(pack.file.size - nameStart)) != nullptr;
+	}
+
+	if (!valid) {
+		LOG_ERROR("ERROR::ASSETPACK::INVALID %s", path);
+		UUnmapFile(pack.file);
+		return false;
+	}
+
+	pack.header = header;
+	pack.entries = (const PackEntry*)(pack.file.data + header->entriesOffset);
+	pack.buckets = (const uint32_t*)(pack.file.data + header->bucketsOffset);
+	pack.names = (const char*)(pack.file.data + header->namesOffset);
+	return true;
+}
+
+void UCloseAssetPack(AssetPack& pack) {
+	{
+		std::lock_guard<std::mutex> lock(pack.inflatedMutex);
+		pack.inflated.clear();
+	}
+	UUnmapFile(pack.file);
+	pack.header = nullptr;
+	pack.entries = nullptr;
+	pack.buckets = nullptr;
+	pack.names = nullptr;
+}
+
+//Returns the entry index for a name or -1
+int64_t UFindPackEntry(const AssetPack& pack, const std::string& name) {
+	if (!pack.header)
+		return -1;
+
+	std::string normalized = UNormalizeAssetName(name);
+	uint64_t hash = UHashAssetName(normalized);
+	uint32_t mask = pack.header->bucketCount - 1;
+
+	for (uint32_t probe = 0; probe < pack.header->bucketCount; ++probe) {
+		uint32_t index = pack.buckets[(hash + probe) & mask];
+		if (index == PACK_EMPTY_BUCKET || index >= pack.header->entryCount)
+			return -1;
+
+		const PackEntry& entry = pack.entries[index];
+		if (entry.nameHash == hash && normalized == pack.names + entry.nameOffset)
+			return index;
+	}
+	return -1;
+}
+
+bool UGetPackAsset(AssetPack& pack, const std::string& name, AssetView& view) {
+	int64_t index = UFindPackEntry(pack, name);
+	if (index < 0)
+		return false;
+
+	//Offsets, sizes, and names were checked against the file in UOpenAssetPack
+	const PackEntry& entry = pack.entries[index];
+	view.kind = (AssetKind)entry.kind;
+	view.width = entry.width;
+	view.height = entry.height;
+	view.channels = entry.channels;
+
+	if (entry.codec == CODEC_NONE) {
+		view.data = pack.file.data + entry.offset;
+		view.size = (size_t)entry.rawSize;
+		return true;
+	}
+
+	//Loader threads may resolve the same entry concurrently; decompress outside the lock
+	{
+		std::lock_guard<std::mutex> lock(pack.inflatedMutex);
+		auto found = pack.inflated.find((uint32_t)index);
+		if (found != pack.inflated.end()) {
+			view.data = found->second.data();
+			view.size = found->second.size();
+			return true;
+		}
+	}
+
+	std::vector<unsigned char> buffer((size_t)entry.rawSize);
+	if (entry.codec != CODEC_LZ4 || !ULz4Decompress(pack.file.data + entry.offset, (size_t)entry.storedSize, buffer.data(), buffer.size())) {
+		LOG_ERROR("ERROR::ASSETPACK::CORRUPT_ENTRY %s", name.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(pack.inflatedMutex);
+	const std::vector<unsigned char>& stored = pack.inflated.emplace((uint32_t)index, std::move(buffer)).first->second;
+	view.data = stored.data();
+	view.size = stored.size();
+	return true;
+}
+
+//-------------------------------------ASSET LOOKUP-----------------------------------
+//Packed assets win; loose files are searched relative to the executable, then the working directory
+AssetPack gAssetPack;
+std::vector<std::string> gAssetRoots;
+std::unordered_map<std::string, std::vector<unsigned char>> gLooseAssets;
+std::mutex gLooseAssetsMutex;			//UFindAsset is called from loader threads
+
+const char* const ASSET_PACK_NAME = "scene.pak";
+
+std::string UExecutableDir(const char* argv0) {
+	std::string path;
+#ifdef _WIN32
+	char buffer[MAX_PATH];
+	DWORD length = GetModuleFileNameA(NULL, buffer, MAX_PATH);
+	path.assign(buffer, length);
+#else
+	char buffer[4096];
+	ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+	if (length > 0)
+		path.assign(buffer, (size_t)length);
+#endif
+	if (path.empty() && argv0)
+		path = argv0;
+
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+//Reads a whole file into memory; returns false if it cannot be opened
+bool UReadFile(const std::string& path, std::vector<unsigned char>& bytes) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bytes.resize(size > 0 ? (size_t)size : 0);
+	size_t read = bytes.empty() ? 0 : fread(bytes.data(), 1, bytes.size(), file);
+	fclose(file);
+	return read == bytes.size();
+}
+
+bool UFileExists(const std::string& path) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+	fclose(file);
+	return true;
+}
+
+//Finds a loose file under a root, falling back to a case-insensitive directory scan on case-sensitive file systems
+bool UFindLoosePath(const std::string& root, const std::string& name, std::string& path) {
+	path = root + "/" + name;
+	if (UFileExists(path))
+		return true;
+
+#ifndef _WIN32
+	path = root;
+	std::string remaining = name;
+	while (!remaining.empty()) {
+		size_t slash = remaining.find('/');
+		std::string component = remaining.substr(0, slash);
+		remaining = slash == std::string::npos ? std::string() : remaining.substr(slash + 1);
+
+		DIR* dir = opendir(path.c_str());
+		if (!dir)
+			return false;
+
+		std::string lowered = UNormalizeAssetName(component);
+		std::string match;
+		while (dirent* item = readdir(dir)) {
+			if (UNormalizeAssetName(item->d_name) == lowered) {
+				match = item->d_name;
+				break;
+			}
+		}
+		closedir(dir);
+
+		if (match.empty())
+			return false;
+		path += "/" + match;
+	}
+	return UFileExists(path);
+#else
+	return false;
+#endif
+}
+
+bool UReadLooseFile(const std::string& root, const std::string& name, std::vector<unsigned char>& bytes) {
+	std::string path;
+	return UFindLoosePath(root, name, path) && UReadFile(path, bytes);
+}
+
+//Locates and maps the asset pack, and records the loose asset search roots
+void UOpenAssets(const char* argv0) {
+	std::string exeDir = UExecutableDir(argv0);
+	gAssetRoots = { exeDir, exeDir + "/..", exeDir + "/../..", ".", ".." };
+
+	for (const std::string& root : gAssetRoots) {
+		std::string packPath = root + "/" + ASSET_PACK_NAME;
+		if (UOpenAssetPack(packPath.c_str(), gAssetPack)) {
+			LOG_INFO("INFO: Asset pack: %s (%u entries)", packPath.c_str(), (unsigned)gAssetPack.header->entryCount);
+			return;
+		}
+	}
+	LOG_INFO("INFO: No %s found, using loose asset files", ASSET_PACK_NAME);
+}
+
+//One lookup for every asset type: textures, meshes, and shader sources
+bool UFindAsset(const char* name, AssetView& view) {
+	if (UGetPackAsset(gAssetPack, name, view))
+		return true;
+
+	std::string normalized = UNormalizeAssetName(name);
+	std::unique_lock<std::mutex> lock(gLooseAssetsMutex);
+	auto cached = gLooseAssets.find(normalized);
+	if (cached == gLooseAssets.end()) {
+		lock.unlock();
+
+		std::vector<unsigned char> bytes;
+		bool found = false;
+		for (const std::string& root : gAssetRoots) {
+			if (UReadLooseFile(root, name, bytes)) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+
+		//Shader sources are handed to GL as C strings
+		bytes.push_back('\0');
+
+		//Map nodes never move, so views stay valid while other threads insert
+		lock.lock();
+		cached = gLooseAssets.emplace(normalized, std::move(bytes)).first;
+	}
+
+	view = AssetView();
+	view.data = cached->second.data();
+	view.size = cached->second.size() - 1;
+	view.kind = (UEndsWith(normalized, ".vert") || UEndsWith(normalized, ".frag") || UEndsWith(normalized, ".glsl")) ? ASSET_SHADER : ASSET_RAW;
+	return true;
+}
+
+//Returns a shader source from the assets, or the compiled-in fallback
+const char* UFindShaderSource(const char* name, const char* fallback) {
+	AssetView view;
+	if (UFindAsset(name, view) && view.kind == ASSET_SHADER)
+		return (const char*)view.data;
+	return fallback;
+}
+
+//Resolves an asset name to a loose file on disk (used by the hot-reload watcher)
+bool UResolveAssetPath(const char* name, std::string& path) {
+	for (const std::string& root : gAssetRoots) {
+		if (UFindLoosePath(root, name, path))
+			return true;
+	}
+	return false;
+}
+
+//Loose files are only needed until they have been uploaded
+void UReleaseLooseAssets() {
+	std::lock_guard<std::mutex> lock(gLooseAssetsMutex);
+	gLooseAssets.clear();
+}
+
+void UCloseAssets() {
+	UReleaseLooseAssets();
+	UCloseAssetPack(gAssetPack);
+}
+
+//-------------------------------------PACKER-----------------------------------------
+struct PackSource {
+	std::string name;					//Normalized entry name
+	AssetKind kind = ASSET_RAW;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 0;
+	std::vector<unsigned char> bytes;
+};
+
+//Converts a Wavefront OBJ into the interleaved mesh layout used by UCreateMesh
+bool UImportObj(const std::vector<unsigned char>& text, std::vector<unsigned char>& blob) {
+	std::vector<float> positions, uvs, normals;
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	std::unordered_map<std::string, uint32_t> unique;
+
+	std::string source(text.begin(), text.end());
+	size_t lineStart = 0;
+	while (lineStart < source.size()) {
+		size_t lineEnd = source.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = source.size();
+		std::string line = source.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		if (line.compare(0, 2, "v ") == 0 && sscanf(line.c_str() + 2, "%f %f %f", &x, &y, &z) == 3) {
+			positions.insert(positions.end(), { x, y, z });
+		}
+		else if (line.compare(0, 3, "vt ") == 0 && sscanf(line.c_str() + 3, "%f %f", &x, &y) == 2) {
+			uvs.insert(uvs.end(), { x, y });
+		}
+		else if (line.compare(0, 3, "vn ") == 0 && sscanf(line.c_str() + 3, "%f %f %f", &x, &y, &z) == 3) {
+			normals.insert(normals.end(), { x, y, z });
+		}
+		else if (line.compare(0, 2, "f ") == 0) {
+			std::vector<uint32_t> face;
+			size_t cursor = 2;
+			while (cursor < line.size()) {
+				while (cursor < line.size() && isspace((unsigned char)line[cursor]))
+					++cursor;
+				size_t end = cursor;
+				while (end < line.size() && !isspace((unsigned char)line[end]))
+					++end;
+				if (end == cursor)
+					break;
+				std::string corner = line.substr(cursor, end - cursor);
+				cursor = end;
+
+				auto found = unique.find(corner);
+				if (found != unique.end()) {
+					face.push_back(found->second);
+					continue;
+				}
+
+				//v, v/vt, v//vn, v/vt/vn with optional negative (relative) indices
+				long refs[3] = { 0, 0, 0 };
+				size_t field = 0, begin = 0;
+				for (size_t k = 0; k <= corner.size() && field < 3; ++k) {
+					if (k == corner.size() || corner[k] == '/') {
+						if (k > begin)
+							refs[field] = strtol(corner.c_str() + begin, nullptr, 10);
+						++field;
+						begin = k + 1;
+					}
+				}
+				long counts[3] = { (long)positions.size() / 3, (long)uvs.size() / 2, (long)normals.size() / 3 };
+				for (int r = 0; r < 3; ++r)
+					refs[r] = refs[r] < 0 ? counts[r] + refs[r] : refs[r] - 1;
+				if (refs[0] < 0 || refs[0] >= counts[0])
+					return false;
+
+				float vertex[12] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+				memcpy(vertex, &positions[refs[0] * 3], sizeof(float) * 3);
+				if (refs[2] >= 0 && refs[2] < counts[2])
+					memcpy(vertex + 7, &normals[refs[2] * 3], sizeof(float) * 3);
+				if (refs[1] >= 0 && refs[1] < counts[1])
+					memcpy(vertex + 10, &uvs[refs[1] * 2], sizeof(float) * 2);
+
+				uint32_t index = (uint32_t)(vertices.size() / 12);
+				vertices.insert(vertices.end(), vertex, vertex + 12);
+				unique.emplace(corner, index);
+				face.push_back(index);
+			}
+
+			//Fan triangulation for quads and polygons
+			for (size_t k = 2; k < face.size(); ++k)
+				indices.insert(indices.end(), { face[0], face[k - 1], face[k] });
+		}
+	}
+
+	if (indices.empty())
+		return false;
+
+	MeshBlobHeader header;
+	header.vertexCount = (uint32_t)(vertices.size() / 12);
+	header.indexCount = (uint32_t)indices.size();
+	header.floatsPerVertex = 12;
+	header.indexSize = header.vertexCount <= 65535 ? 2 : 4;
+
+	blob.resize(sizeof(header) + vertices.size() * sizeof(float) + indices.size() * header.indexSize);
+	unsigned char* out = blob.data();
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	memcpy(out, vertices.data(), vertices.size() * sizeof(float));
+	out += vertices.size() * sizeof(float);
+	for (uint32_t index : indices) {
+		if (header.indexSize == 2) {
+			uint16_t shortIndex = (uint16_t)index;
+			memcpy(out, &shortIndex, 2);
+		}
+		else {
+			memcpy(out, &index, 4);
+		}
+		out += header.indexSize;
+	}
+	return true;
+}
+
+//Unpacks a mesh blob (packed or just imported) into interleaved vertices and 32 bit indices
+bool UDecodeMeshBlob(const unsigned char* data, size_t size, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+	MeshBlobHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+
+	size_t vertexBytes = (size_t)header.vertexCount * header.floatsPerVertex * sizeof(float);
+	size_t indexBytes = (size_t)header.indexCount * header.indexSize;
+	if (header.floatsPerVertex != 12 || (header.indexSize != 2 && header.indexSize != 4) || sizeof(header) + vertexBytes + indexBytes > size)
+		return false;
+
+	vertices.resize((size_t)header.vertexCount * header.floatsPerVertex);
+	memcpy(vertices.data(), data + sizeof(header), vertexBytes);
+	indices.resize(header.indexCount);
+	const unsigned char* in = data + sizeof(header) + vertexBytes;
+	for (uint32_t i = 0; i < header.indexCount; ++i, in += header.indexSize) {
+		if (header.indexSize == 2) {
+			uint16_t shortIndex;
+			memcpy(&shortIndex, in, 2);
+			indices[i] = shortIndex;
+		}
+		else {
+			memcpy(&indices[i], in, 4);
+		}
+		if (indices[i] >= header.vertexCount)
+			return false;
+	}
+	return true;
+}
+
+//Loads one source file and converts it to its packed form based on the file extension
+bool ULoadPackSource(const std::string& root, const std::string& name, PackSource& source) {
+	std::vector<unsigned char> bytes;
+	if (!UReadLooseFile(root, name, bytes)) {
+		std::cout << "ERROR::PACK::MISSING " << name << std::endl;
+		return false;
+	}
+
+	source.name = UNormalizeAssetName(name);
+	if (UEndsWith(source.name, ".jpg") || UEndsWith(source.name, ".jpeg") || UEndsWith(source.name, ".png") || UEndsWith(source.name, ".tga")) {
+		int width, height, channels;
+		unsigned char* image = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 0);
+		if (!image) {
+			std::cout << "ERROR::PACK::IMAGE_DECODE " << name << std::endl;
+			return false;
+		}
+
+		//Stored bottom row first, the way glTexImage2D expects it
+		size_t rowBytes = (size_t)width * channels;
+		source.bytes.resize(rowBytes * height);
+		for (int row = 0; row < height; ++row)
+			memcpy(&source.bytes[row * rowBytes], image + (size_t)(height - 1 - row) * rowBytes, rowBytes);
+		stbi_image_free(image);
+
+		source.kind = ASSET_TEXTURE;
+		source.width = (uint32_t)width;
+		source.height = (uint32_t)height;
+		source.channels = (uint32_t)channels;
+	}
+	else if (UEndsWith(source.name, ".obj")) {
+		if (!UImportObj(bytes, source.bytes)) {
+			std::cout << "ERROR::PACK::OBJ_IMPORT " << name << std::endl;
+			return false;
+		}
+		source.kind = ASSET_MESH;
+		source.name.replace(source.name.size() - 4, 4, ".mesh");
+	}
+	else if (UEndsWith(source.name, ".mesh")) {
+		source.kind = ASSET_MESH;
+		source.bytes = std::move(bytes);
+	}
+	else if (UEndsWith(source.name, ".vert") || UEndsWith(source.name, ".frag") || UEndsWith(source.name, ".glsl")) {
+		source.kind = ASSET_SHADER;
+		source.bytes = std::move(bytes);
+		source.bytes.push_back('\0');
+	}
+	else {
+		source.kind = ASSET_RAW;
+		source.bytes = std::move(bytes);
+	}
+	return true;
+}
+
+bool UWriteAssetPack(const char* outPath, std::vector<PackSource>& sources, bool compress) {
+	//Bucket table at most half full
+	uint32_t bucketCount = 16;
+	while (bucketCount < sources.size() * 2)
+		bucketCount <<= 1;
+
+	std::vector<PackEntry> entries(sources.size());
+	std::vector<uint32_t> buckets(bucketCount, PACK_EMPTY_BUCKET);
+	std::string names;
+	std::vector<unsigned char> blobs;
+	uint64_t blobStart = (sizeof(PackHeader) + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+	uint64_t rawTotal = 0;
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		PackSource& source = sources[i];
+		PackEntry& entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+
+		entry.nameHash = UHashAssetName(source.name);
+		entry.nameOffset = (uint32_t)names.size();
+		names.append(source.name).push_back('\0');
+		entry.kind = source.kind;
+		entry.width = source.width;
+		entry.height = source.height;
+		entry.channels = source.channels;
+		entry.rawSize = source.bytes.size();
+		rawTotal += entry.rawSize;
+
+		//Compressed only when it saves at least an eighth; shaders stay uncompressed so they map as C strings
+		std::vector<unsigned char> packed;
+		const std::vector<unsigned char>* stored = &source.bytes;
+		if (compress && source.kind != ASSET_SHADER && source.bytes.size() > 256) {
+			ULz4Compress(source.bytes.data(), source.bytes.size(), packed);
+			if (packed.size() < source.bytes.size() - source.bytes.size() / 8) {
+				stored = &packed;
+				entry.codec = CODEC_LZ4;
+			}
+		}
+		entry.storedSize = stored->size();
+
+		size_t aligned = (blobs.size() + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+		blobs.resize(aligned, 0);
+		entry.offset = blobStart + aligned;
+		blobs.insert(blobs.end(), stored->begin(), stored->end());
+
+		uint32_t mask = bucketCount - 1;
+		uint64_t slot = entry.nameHash;
+		while (buckets[slot & mask] != PACK_EMPTY_BUCKET) {
+			const PackSource& other = sources[buckets[slot & mask]];
+			if (other.name == source.name) {
+				std::cout << "ERROR::PACK::DUPLICATE " << source.name << std::endl;
+				return false;
+			}
+			++slot;
+		}
+		buckets[slot & mask] = (uint32_t)i;
+	}
+
+	PackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SPAK", 4);
+	header.version = PACK_VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.bucketCount = bucketCount;
+	header.entriesOffset = (blobStart + blobs.size() + 7) & ~7ull;
+	header.bucketsOffset = header.entriesOffset + entries.size() * sizeof(PackEntry);
+	header.namesOffset = header.bucketsOffset + buckets.size() * sizeof(uint32_t);
+	header.fileSize = header.namesOffset + names.size();
+
+	std::vector<unsigned char> image((size_t)header.fileSize, 0);
+	memcpy(image.data(), &header, sizeof(header));
+	if (!blobs.empty())
+		memcpy(image.data() + blobStart, blobs.data(), blobs.size());
+	if (!entries.empty())
+		memcpy(image.data() + header.entriesOffset, entries.data(), entries.size() * sizeof(PackEntry));
+	memcpy(image.data() + header.bucketsOffset, buckets.data(), buckets.size() * sizeof(uint32_t));
+	memcpy(image.data() + header.namesOffset, names.data(), names.size());
+
+	FILE* file = fopen(outPath, "wb");
+	if (!file || fwrite(image.data(), 1, image.size(), file) != image.size()) {
+		std::cout << "ERROR::PACK::WRITE " << outPath << std::endl;
+		if (file)
+			fclose(file);
+		return false;
+	}
+	fclose(file);
+
+	std::cout << "Packed " << entries.size() << " assets into " << outPath << ": "
+		<< rawTotal << " bytes raw, " << image.size() << " bytes on disk" << std::endl;
+	return true;
+}
+
+//Packer CLI: --pack <out.pak> [--lz4] [--root <dir>] <files...>
+int UPackAssets(int argc, char* argv[]) {
+	if (argc < 4) {
+		std::cout << "Usage: " << argv[0] << " --pack <out.pak> [--lz4] [--root <dir>] <files...>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const char* outPath = argv[2];
+	std::string root = ".";
+	bool compress = false;
+	std::vector<PackSource> sources;
+
+	for (int i = 3; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--lz4") {
+			compress = true;
+		}
+		else if (arg == "--root" && i + 1 < argc) {
+			root = argv[++i];
+		}
+		else {
+			PackSource source;
+			if (!ULoadPackSource(root, arg, source))
+				return EXIT_FAILURE;
+			sources.push_back(std::move(source));
+		}
+	}
+
+	return UWriteAssetPack(outPath, sources, compress) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//-------------------------------------I/O REPORT-------------------------------------
+//Bytes actually read from storage by this process (Linux only; 0 elsewhere)
+uint64_t UProcessReadBytes() {
+#ifdef __linux__
+	FILE* io = fopen("/proc/self/io", "r");
+	if (!io)
+		return 0;
+	char line[128];
+	unsigned long long bytes = 0;
+	while (fgets(line, sizeof(line), io)) {
+		if (sscanf(line, "read_bytes: %llu", &bytes) == 1)
+			break;
+	}
+	fclose(io);
+	return bytes;
+#else
+	return 0;
+#endif
+}
+
+//Asks the kernel to drop a file from the page cache so the next read is cold
+void UEvictFromCache(const std::string& path) {
+#ifdef __linux__
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+#else
+	(void)path;
+#endif
+}
+
+//Compares startup I/O of the pack against the loose files it was built from:
+//--bench-io <scene.pak> <root> <files...>
+int UBenchAssetIO(int argc, char* argv[]) {
+	if (argc < 5) {
+		std::cout << "Usage: " << argv[0] << " --bench-io <scene.pak> <root> <files...>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string packPath = argv[2];
+	std::string root = argv[3];
+	std::vector<std::string> names(argv + 4, argv + argc);
+
+	for (int pass = 0; pass < 2; ++pass) {
+		bool cold = pass == 0;
+		if (cold) {
+			UEvictFromCache(packPath);
+			for (const std::string& name : names)
+				UEvictFromCache(root + "/" + name);
+		}
+
+		//Loose files: one open and read per asset, plus image decode the way CreateTexture did it
+		uint64_t ioBefore = UProcessReadBytes();
+		auto start = std::chrono::steady_clock::now();
+		size_t looseBytes = 0;
+		for (const std::string& name : names) {
+			std::vector<unsigned char> bytes;
+			if (!UReadLooseFile(root, name, bytes))
+				continue;
+			looseBytes += bytes.size();
+			int width, height, channels;
+			unsigned char* image = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 0);
+			if (image)
+				stbi_image_free(image);
+		}
+		double looseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		uint64_t looseIO = UProcessReadBytes() - ioBefore;
+
+		if (cold) {
+			for (const std::string& name : names)
+				UEvictFromCache(root + "/" + name);
+		}
+
+		//Pack: one mapping, then touch every byte each asset resolves to
+		ioBefore = UProcessReadBytes();
+		start = std::chrono::steady_clock::now();
+		AssetPack pack;
+		size_t packBytes = 0;
+		volatile unsigned char sink = 0;
+		if (UOpenAssetPack(packPath.c_str(), pack)) {
+			for (const std::string& name : names) {
+				std::string packedName = UEndsWith(UNormalizeAssetName(name), ".obj") ? name.substr(0, name.size() - 4) + ".mesh" : name;
+				AssetView view;
+				if (!UGetPackAsset(pack, packedName, view))
+					continue;
+				packBytes += view.size;
+				for (size_t k = 0; k < view.size; k += 4096)
+					sink ^= view.data[k];
+			}
+			UCloseAssetPack(pack);
+		}
+		double packMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		uint64_t packIO = UProcessReadBytes() - ioBefore;
+
+		std::cout << (cold ? "cold" : "warm") << " cache:" << std::endl
+			<< "  loose: " << names.size() << " opens, " << looseBytes << " bytes, " << looseIO << " bytes from disk, " << looseMs << " ms" << std::endl
+			<< "  pack:  1 open,  " << packBytes << " bytes, " << packIO << " bytes from disk, " << packMs << " ms" << std::endl;
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif
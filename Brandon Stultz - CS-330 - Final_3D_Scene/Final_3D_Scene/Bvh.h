@@ -0,0 +1,188 @@
+#ifndef BVH_H
+#define BVH_H
+
+/*Bounding volume hierarchy over triangles
+* Built top down with the binned surface area heuristic: a node's triangles are binned by centroid along each axis
+* and split at the bin boundary whose two halves are cheapest to intersect, or kept as a leaf when no split beats
+* testing them all. A node's two children are stored next to each other, so one index reaches both. The lightmapper traces ray packets through one over the whole scene; ray queries keep one per mesh.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//-----------------------------------------BVH---------------------------------------------
+struct BvhTriangle {
+	glm::vec3 v0;
+	glm::vec3 edge1;
+	glm::vec3 edge2;
+	glm::vec3 normal;						//Geometric, on the side the mesh's normals face
+	int id;								//The lightmapper's scene object; a ray query mesh's triangle index
+};
+
+struct BvhNode {
+	glm::vec3 boundsMin;
+	uint32_t leftFirst;						//Left child (the right one follows it), or a leaf's first triangle
+	glm::vec3 boundsMax;
+	uint32_t count;							//Triangles in a leaf; 0 for an interior node
+};
+
+struct Bvh {
+	std::vector<BvhNode> nodes;
+	std::vector<BvhTriangle> triangles;	//In leaf order
+};
+
+const int BVH_BINS = 16;
+const uint32_t BVH_MAX_LEAF = 4;
+const int BVH_MAX_DEPTH = 64;
+
+struct BvhBounds {
+	glm::vec3 minimum = glm::vec3(FLT_MAX);
+	glm::vec3 maximum = glm::vec3(-FLT_MAX);
+};
+
+void UGrowBounds(BvhBounds& bounds, const glm::vec3& point) {
+	bounds.minimum = glm::min(bounds.minimum, point);
+	bounds.maximum = glm::max(bounds.maximum, point);
+}
+
+void UGrowBounds(BvhBounds& bounds, const BvhBounds& other) {
+	bounds.minimum = glm::min(bounds.minimum, other.minimum);
+	bounds.maximum = glm::max(bounds.maximum, other.maximum);
+}
+
+float UBoundsArea(const BvhBounds& bounds) {
+	glm::vec3 extent = bounds.maximum - bounds.minimum;
+	if (extent.x < 0.0f)
+		return 0.0f;
+	return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+BvhBounds UTriangleBounds(const BvhTriangle& triangle) {
+	BvhBounds bounds;
+	UGrowBounds(bounds, triangle.v0);
+	UGrowBounds(bounds, triangle.v0 + triangle.edge1);
+	UGrowBounds(bounds, triangle.v0 + triangle.edge2);
+	return bounds;
+}
+
+glm::vec3 UTriangleCentroid(const BvhTriangle& triangle) {
+	return triangle.v0 + (triangle.edge1 + triangle.edge2) / 3.0f;
+}
+
+//Splits node 'index' (covering triangles [first, first + count)) where the binned surface area heuristic is
+//cheapest, or leaves it a leaf when no split beats intersecting every triangle
+void USubdivideBvh(Bvh& bvh, uint32_t index, int depth) {
+	BvhNode node = bvh.nodes[index];
+	if (node.count <= BVH_MAX_LEAF || depth >= BVH_MAX_DEPTH)
+		return;
+
+	BvhBounds centroidBounds;
+	for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+		UGrowBounds(centroidBounds, UTriangleCentroid(bvh.triangles[i]));
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		float low = centroidBounds.minimum[axis];
+		float extent = centroidBounds.maximum[axis] - low;
+		if (extent <= 0.0f)
+			continue;
+
+		BvhBounds binBounds[BVH_BINS];
+		uint32_t binCounts[BVH_BINS] = {};
+		float binScale = BVH_BINS / extent;
+		for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+			const BvhTriangle& triangle = bvh.triangles[i];
+			int bin = std::min(BVH_BINS - 1, (int)((UTriangleCentroid(triangle)[axis] - low) * binScale));
+			++binCounts[bin];
+			UGrowBounds(binBounds[bin], UTriangleBounds(triangle));
+		}
+
+		//Sweep from both ends so each split plane's two sides are known
+		float leftAreas[BVH_BINS - 1], rightAreas[BVH_BINS - 1];
+		uint32_t leftCounts[BVH_BINS - 1], rightCounts[BVH_BINS - 1];
+		BvhBounds left, right;
+		uint32_t leftCount = 0, rightCount = 0;
+		for (int i = 0; i < BVH_BINS - 1; ++i) {
+			leftCount += binCounts[i];
+			UGrowBounds(left, binBounds[i]);
+			leftCounts[i] = leftCount;
+			leftAreas[i] = UBoundsArea(left);
+
+			rightCount += binCounts[BVH_BINS - 1 - i];
+			UGrowBounds(right, binBounds[BVH_BINS - 1 - i]);
+			rightCounts[BVH_BINS - 2 - i] = rightCount;
+			rightAreas[BVH_BINS - 2 - i] = UBoundsArea(right);
+		}
+
+		for (int i = 0; i < BVH_BINS - 1; ++i) {
+			if (leftCounts[i] == 0 || rightCounts[i] == 0)
+				continue;
+			float cost = leftCounts[i] * leftAreas[i] + rightCounts[i] * rightAreas[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	BvhBounds nodeBounds;
+	nodeBounds.minimum = node.boundsMin;
+	nodeBounds.maximum = node.boundsMax;
+	if (bestAxis < 0 || bestCost >= node.count * UBoundsArea(nodeBounds))
+		return;
+
+	//Partition the triangles around the chosen plane
+	float low = centroidBounds.minimum[bestAxis];
+	float binScale = BVH_BINS / (centroidBounds.maximum[bestAxis] - low);
+	auto middle = std::partition(bvh.triangles.begin() + node.leftFirst, bvh.triangles.begin() + node.leftFirst + node.count,
+		[&](const BvhTriangle& triangle) {
+			return std::min(BVH_BINS - 1, (int)((UTriangleCentroid(triangle)[bestAxis] - low) * binScale)) <= bestSplit;
+		});
+	uint32_t leftCount = (uint32_t)(middle - bvh.triangles.begin()) - node.leftFirst;
+
+	uint32_t leftIndex = (uint32_t)bvh.nodes.size();
+	BvhNode children[2];
+	children[0].leftFirst = node.leftFirst;
+	children[0].count = leftCount;
+	children[1].leftFirst = node.leftFirst + leftCount;
+	children[1].count = node.count - leftCount;
+	for (BvhNode& child : children) {
+		BvhBounds bounds;
+		for (uint32_t i = child.leftFirst; i < child.leftFirst + child.count; ++i)
+			UGrowBounds(bounds, UTriangleBounds(bvh.triangles[i]));
+		child.boundsMin = bounds.minimum;
+		child.boundsMax = bounds.maximum;
+		bvh.nodes.push_back(child);
+	}
+
+	bvh.nodes[index].leftFirst = leftIndex;
+	bvh.nodes[index].count = 0;
+	USubdivideBvh(bvh, leftIndex, depth + 1);
+	USubdivideBvh(bvh, leftIndex + 1, depth + 1);
+}
+
+void UBuildBvh(Bvh& bvh) {
+	bvh.nodes.clear();
+	bvh.nodes.reserve(bvh.triangles.size() * 2);
+
+	BvhBounds bounds;
+	for (const BvhTriangle& triangle : bvh.triangles)
+		UGrowBounds(bounds, UTriangleBounds(triangle));
+
+	BvhNode root;
+	root.boundsMin = bounds.minimum;
+	root.boundsMax = bounds.maximum;
+	root.leftFirst = 0;
+	root.count = (uint32_t)bvh.triangles.size();
+	bvh.nodes.push_back(root);
+	USubdivideBvh(bvh, 0, 0);
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef DRAWLISTS_H
+#define DRAWLISTS_H
+
+/*Parallel draw recording
+* After visibility, workers record the draw list into per-thread command lists: a sort key, the GL state the
+* draw needs, and the slot of its per-draw uniform block. The uniform blocks are written by the same workers
+* straight into the frame's ring buffer allocation (slot = position in the draw list), so the GL thread copies nothing.
+* The GL thread merges the lists, sorts by key (state first, then front-to-back depth), and submits in one pass,
+* rebinding only the state that changed between neighbouring draws.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "SceneUpdate.h"
+
+//std140 'ObjectBlock' (binding 0) in the scene and lamp shaders
+struct ObjectUniforms {
+	glm::mat4 model;
+	glm::mat4 normalMatrix;
+	glm::vec2 uvScale;
+	glm::vec2 padding;
+};
+
+//std140 'FrameBlock' (binding 1); a vec3 is padded to 16 bytes unless a float follows it
+struct FrameUniforms {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 objectColor;
+	float specIntensity;
+	glm::vec3 lightColor;
+	float padding0;
+	glm::vec3 lightPosition;
+	float padding1;
+	glm::vec3 viewPosition;
+	float shadowFarPlane;						//0 when shadows are off
+	glm::vec4 shadowFaceLights[6];				//Light position each shadow cube face was drawn from (w unused)
+};
+
+const GLuint OBJECT_BLOCK_BINDING = 0;
+const GLuint FRAME_BLOCK_BINDING = 1;
+
+//What an instance draws with; GL names are read through pointers at submit time, as loads and reloads replace them
+struct DrawSource {
+	const GLuint* buffers;			//Vertex then index buffer, as in GLMesh::vbos
+	const GLuint* indexCount;
+	const GLuint* texture;
+	const GLuint* lightmap;			//0 (or null) for the neutral ambient
+	const GLuint* lightmapCoordinates;	//Read with a baked lightmap only
+	uint16_t material;				//Sort key state, most significant first
+	uint16_t mesh;
+	glm::vec2 uvScale;
+};
+
+struct DrawRecord {
+	uint64_t sortKey;
+	const GLuint* buffers;
+	const GLuint* indexCount;
+	const GLuint* texture;
+	const GLuint* lightmap;
+	const GLuint* lightmapCoordinates;
+	uint32_t uniformSlot;
+	uint32_t instance;				//Index of the DrawSource
+};
+
+//One per job system participant; aligned so neighbouring lists never share a cache line
+struct alignas(64) CommandList {
+	std::vector<DrawRecord> draws;
+};
+
+//--------------------------------------RECORDING--------------------------------------------
+//Most significant first: 16 bits material, 16 bits mesh, 32 bits view distance (front to back)
+uint64_t UMakeSortKey(uint16_t material, uint16_t mesh, float distance) {
+	//Non-negative floats order the same as their bit patterns
+	float clamped = std::max(distance, 0.0f);
+	uint32_t distanceBits;
+	memcpy(&distanceBits, &clamped, sizeof(distanceBits));
+	return ((uint64_t)material << 48) | ((uint64_t)mesh << 32) | distanceBits;
+}
+
+uint16_t USortKeyMaterial(uint64_t sortKey) {
+	return (uint16_t)(sortKey >> 48);
+}
+
+//Records scene.drawList[begin, end) into the calling thread's list; uniform slot i is written for drawList[i]
+void URecordDraws(const SceneInstances& scene, const DrawSource* sources, glm::vec3 eye, unsigned char* uniforms, size_t stride,
+	std::vector<CommandList>& lists, size_t begin, size_t end) {
+
+	CommandList& list = lists[tJobQueue < lists.size() ? tJobQueue : 0];
+	for (size_t i = begin; i < end; ++i) {
+		int instance = scene.drawList[i];
+		const DrawSource& source = sources[instance];
+		const glm::mat4& model = scene.models[instance];
+
+		ObjectUniforms block;
+		block.model = model;
+		block.normalMatrix = glm::transpose(glm::inverse(model));
+		block.uvScale = source.uvScale;
+		memcpy(uniforms + i * stride, &block, sizeof(block));
+
+		DrawRecord record;
+		record.sortKey = UMakeSortKey(source.material, source.mesh, glm::distance(eye, glm::vec3(scene.bounds[instance])));
+		record.buffers = source.buffers;
+		record.indexCount = source.indexCount;
+		record.texture = source.texture;
+		record.lightmap = source.lightmap;
+		record.lightmapCoordinates = source.lightmapCoordinates;
+		record.uniformSlot = (uint32_t)i;
+		record.instance = (uint32_t)instance;
+		list.draws.push_back(record);
+	}
+}
+
+//Schedules recording of the first drawCount entries of scene.drawList (after the scene update has finished)
+Job* UScheduleDrawRecording(JobSystem& system, const SceneInstances& scene, const DrawSource* sources, glm::vec3 eye,
+	unsigned char* uniforms, size_t stride, size_t drawCount, std::vector<CommandList>& lists) {
+
+	lists.resize(UJobThreadCount(system));
+	for (CommandList& list : lists)
+		list.draws.clear();
+
+	const SceneInstances* instances = &scene;
+	std::vector<CommandList>* commandLists = &lists;
+	return UParallelFor(system, drawCount, SCENE_UPDATE_GRAIN,
+		[instances, sources, eye, uniforms, stride, commandLists](size_t begin, size_t end) {
+			URecordDraws(*instances, sources, eye, uniforms, stride, *commandLists, begin, end);
+		});
+}
+
+//GL thread: concatenates the per-thread lists and sorts them into submission order
+void UMergeCommandLists(const std::vector<CommandList>& lists, std::vector<DrawRecord>& merged) {
+	merged.clear();
+	for (const CommandList& list : lists)
+		merged.insert(merged.end(), list.draws.begin(), list.draws.end());
+
+	std::sort(merged.begin(), merged.end(), [](const DrawRecord& a, const DrawRecord& b) {
+		return a.sortKey < b.sortKey || (a.sortKey == b.sortKey && a.uniformSlot < b.uniformSlot);
+	});
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+/*Dynamic resolution scaling
+* The scene is drawn into an offscreen target and then upscaled over the window. The render graph allocates the
+* targets at the framebuffer size and the scene only uses their lower-left (scale x scale) region, so changing the
+* scale never reallocates anything. The upscale is plain bilinear, optionally preceded by a contrast-adaptive
+* sharpen at render resolution; both draw the region with the same program.
+*
+* Each frame the scene pass is timed with a GL_TIME_ELAPSED query. Results are read RESOLUTION_QUERY_FRAMES frames
+* later, when they are available, so timing never stalls the pipeline. The controller rescales that measurement to
+* the current scale (cost follows pixel count, i.e. scale squared) and moves part of the way towards the scale that
+* would meet the GPU budget, holding steady inside a small band around it.
+*/
+
+#include <cmath>
+#include <cstdint>
+
+#include "Logger.h"
+#include "UpscaleShader.h"
+
+//Defined in Source.cpp
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programID);
+
+enum UpscaleFilter {
+	UPSCALE_BILINEAR,
+	UPSCALE_SHARPEN
+};
+
+const int RESOLUTION_QUERY_FRAMES = 4;
+const double RESOLUTION_DEAD_BAND = 0.05;		//Fraction of the budget the GPU time may be off before the scale moves
+const double RESOLUTION_GAIN = 0.25;			//Fraction of the way to the ideal scale covered per frame
+const float RESOLUTION_SHARPNESS = 0.5f;
+
+struct DynamicResolution {
+	//Size of the render graph's scene targets (the framebuffer size) and the region drawn this frame
+	int targetWidth = 0;
+	int targetHeight = 0;
+	int sceneWidth = 0;
+	int sceneHeight = 0;
+
+	//Region draw, used by the sharpen and upscale passes
+	GLuint program = 0;
+	GLuint vao = 0;
+	GLint regionScaleLocation = -1;
+	GLint texelSizeLocation = -1;
+	GLint sharpnessLocation = -1;
+	UpscaleFilter filter = UPSCALE_SHARPEN;
+
+	//Scene pass timing; each query remembers the scale it measured
+	GLuint queries[RESOLUTION_QUERY_FRAMES] = {};
+	bool queryIssued[RESOLUTION_QUERY_FRAMES] = {};
+	float queryScale[RESOLUTION_QUERY_FRAMES] = {};
+	uint64_t frame = 0;
+	int querySlot = -1;						//Query to use for this frame's scene pass; -1 leaves it untimed
+
+	//Controller
+	bool adaptive = true;					//False with a fixed --render-scale
+	double budgetMilliseconds = 12.0;
+	float scale = 1.0f;
+	float minScale = 0.5f;
+
+	//Measured scene pass time, collected by the frame stats
+	uint64_t gpuNanoseconds = 0;
+	uint64_t gpuSamples = 0;
+};
+
+//Needs the render context current. fixedScale > 0 turns the controller off.
+bool UCreateDynamicResolution(DynamicResolution& resolution, UpscaleFilter filter, double budgetMilliseconds, float fixedScale) {
+	resolution.filter = filter;
+	resolution.budgetMilliseconds = budgetMilliseconds;
+	resolution.adaptive = fixedScale <= 0.0f;
+	if (!resolution.adaptive)
+		resolution.scale = fixedScale < 0.1f ? 0.1f : (fixedScale > 1.0f ? 1.0f : fixedScale);
+
+	if (!UCreateShaderProgram(upscaleVertexShaderSource, upscaleFragmentShaderSource, resolution.program))
+		return false;
+	glUniform1i(glGetUniformLocation(resolution.program, "sceneTexture"), 0);
+	resolution.regionScaleLocation = glGetUniformLocation(resolution.program, "regionScale");
+	resolution.texelSizeLocation = glGetUniformLocation(resolution.program, "texelSize");
+	resolution.sharpnessLocation = glGetUniformLocation(resolution.program, "sharpness");
+
+	//Core profile draws need a VAO bound even without attributes
+	glGenVertexArrays(1, &resolution.vao);
+	glGenQueries(RESOLUTION_QUERY_FRAMES, resolution.queries);
+
+	if (resolution.adaptive)
+		LOG_INFO("INFO: Dynamic resolution: GPU budget %.1f ms, %s upscale", budgetMilliseconds, filter == UPSCALE_SHARPEN ? "sharpened" : "bilinear");
+	else
+		LOG_INFO("INFO: Fixed render scale %.2f, %s upscale", resolution.scale, filter == UPSCALE_SHARPEN ? "sharpened" : "bilinear");
+	return true;
+}
+
+//Feeds one measured scene pass into the controller
+void UUpdateResolutionScale(DynamicResolution& resolution, uint64_t nanoseconds, float measuredScale) {
+	resolution.gpuNanoseconds += nanoseconds;
+	++resolution.gpuSamples;
+	if (!resolution.adaptive || nanoseconds == 0 || measuredScale <= 0.0f)
+		return;
+
+	//What the measured frame would have cost at the current scale
+	double scaleRatio = (double)resolution.scale / measuredScale;
+	double estimate = nanoseconds / 1e6 * scaleRatio * scaleRatio;
+
+	double ratio = resolution.budgetMilliseconds / estimate;
+	if (std::fabs(ratio - 1.0) < RESOLUTION_DEAD_BAND)
+		return;
+
+	double ideal = resolution.scale * std::sqrt(ratio);
+	double scale = resolution.scale + (ideal - resolution.scale) * RESOLUTION_GAIN;
+	resolution.scale = (float)(scale < resolution.minScale ? resolution.minScale : (scale > 1.0 ? 1.0 : scale));
+}
+
+//Collects finished timings and picks this frame's scene size; the scene targets are window sized
+void UChooseSceneSize(DynamicResolution& resolution, int windowWidth, int windowHeight) {
+	int slot = (int)(resolution.frame++ % RESOLUTION_QUERY_FRAMES);
+
+	//The query about to be reused was issued RESOLUTION_QUERY_FRAMES frames ago and has normally finished;
+	//if the GPU is further behind than that, this frame goes untimed rather than waiting
+	resolution.querySlot = slot;
+	if (resolution.queryIssued[slot]) {
+		GLint available = 0;
+		glGetQueryObjectiv(resolution.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(resolution.queries[slot], GL_QUERY_RESULT, &nanoseconds);
+			resolution.queryIssued[slot] = false;
+			UUpdateResolutionScale(resolution, nanoseconds, resolution.queryScale[slot]);
+		}
+		else {
+			resolution.querySlot = -1;
+		}
+	}
+
+	resolution.targetWidth = windowWidth < 1 ? 1 : windowWidth;
+	resolution.targetHeight = windowHeight < 1 ? 1 : windowHeight;
+	resolution.sceneWidth = (int)(resolution.targetWidth * resolution.scale + 0.5f);
+	resolution.sceneHeight = (int)(resolution.targetHeight * resolution.scale + 0.5f);
+	resolution.sceneWidth = resolution.sceneWidth < 1 ? 1 : resolution.sceneWidth;
+	resolution.sceneHeight = resolution.sceneHeight < 1 ? 1 : resolution.sceneHeight;
+}
+
+//Brackets the scene pass with this frame's timer query
+void UBeginSceneTiming(DynamicResolution& resolution) {
+	if (resolution.querySlot < 0)
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, resolution.queries[resolution.querySlot]);
+	resolution.queryIssued[resolution.querySlot] = true;
+	resolution.queryScale[resolution.querySlot] = resolution.scale;
+}
+
+void UEndSceneTiming(DynamicResolution& resolution) {
+	if (resolution.querySlot >= 0)
+		glEndQuery(GL_TIME_ELAPSED);
+	resolution.querySlot = -1;
+}
+
+//Sharpening only helps when the image is about to be enlarged; at full scale the scene is copied unchanged
+float USceneSharpness(const DynamicResolution& resolution) {
+	bool upscaled = resolution.sceneWidth < resolution.targetWidth || resolution.sceneHeight < resolution.targetHeight;
+	return resolution.filter == UPSCALE_SHARPEN && upscaled ? RESOLUTION_SHARPNESS : 0.0f;
+}
+
+//Draws the scene region of a target-sized texture over the current viewport
+void UDrawSceneRegion(const DynamicResolution& resolution, GLuint texture, float sharpness) {
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(resolution.program);
+	glUniform2f(resolution.regionScaleLocation, (float)resolution.sceneWidth / resolution.targetWidth, (float)resolution.sceneHeight / resolution.targetHeight);
+	glUniform2f(resolution.texelSizeLocation, 1.0f / resolution.targetWidth, 1.0f / resolution.targetHeight);
+	glUniform1f(resolution.sharpnessLocation, sharpness);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(resolution.vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
+
+void UDestroyDynamicResolution(DynamicResolution& resolution) {
+	glDeleteQueries(RESOLUTION_QUERY_FRAMES, resolution.queries);
+	glDeleteVertexArrays(1, &resolution.vao);
+	glDeleteProgram(resolution.program);
+	resolution.program = 0;
+}
+
+#endif
@@ -1,29 +1,67 @@
 #ifndef FRAGSHADE_H
 #define FRAGSHADE_H
 
+//Compiled-in fallback for shaders/scene.frag, which is loaded (and hot-reloaded) at runtime when present
+
 const char* fragmentShaderSource = "#version 440 core\n"
 
 "in vec3 vertexNormal;\n"				// For incoming normals
 "in vec3 vertexFragmentPos;\n"			// For incoming fragment position
 "in vec2 vertexTextureCoordinate;\n"
+"in vec2 vertexLightmapCoordinate;\n"
 
 "out vec4 FragColor;\n"
 
-"uniform vec3 objectColor;\n"
-"uniform vec3 lightColor;\n"
-"uniform vec3 lightPos;\n"
-"uniform vec3 viewPosition;\n"
 "uniform sampler2D Texture;\n"
-"uniform vec2 uvScale;\n"
-"uniform float specIntensity;\n"
+"layout (binding = 2) uniform sampler2D lightmap;\n"			//Baked ambient, or the old constant ambient when not baked
+"layout (binding = 1) uniform samplerCube shadowMap;\n"		//Key light distances over shadowFarPlane
+
+//Per-draw data, written by the draw recorders into the ring buffer
+"layout (std140, binding = 0) uniform ObjectBlock\n"
+"{\n"
+"	mat4 model;\n"
+"	mat4 normalMatrix;\n"									//transpose(inverse(model)), computed once per draw
+"	vec2 uvScale;\n"
+"};\n"
+
+//Per-frame camera and light, written once per frame into the ring buffer
+"layout (std140, binding = 1) uniform FrameBlock\n"
+"{\n"
+"	mat4 view;\n"
+"	mat4 projection;\n"
+"	vec3 objectColor;\n"
+"	float specIntensity;\n"
+"	vec3 lightColor;\n"
+"	vec3 lightPos;\n"
+"	vec3 viewPosition;\n"
+"	float shadowFarPlane;\n"								//0 when shadows are off
+"	vec4 shadowFaceLights[6];\n"							//Light position each shadow cube face was drawn from
+"};\n"
+
+//Key light shadow: 0 in shadow, 1 lit. Each cube face may have been drawn from a slightly older light position,
+//so the fragment is measured against the position of the face it falls in.
+"float keyLightShadow(vec3 norm, vec3 lightDirection)\n"
+"{\n"
+"	if (shadowFarPlane <= 0.0f)\n"
+"		return 1.0f;\n"
+"	vec3 fromLight = vertexFragmentPos - lightPos;\n"
+"	vec3 axis = abs(fromLight);\n"
+"	int face = axis.x >= axis.y && axis.x >= axis.z ? (fromLight.x > 0.0f ? 0 : 1) : (axis.y >= axis.z ? (fromLight.y > 0.0f ? 2 : 3) : (fromLight.z > 0.0f ? 4 : 5));\n"
+"	vec3 toFragment = vertexFragmentPos - shadowFaceLights[face].xyz;\n"
+"	float distance = length(toFragment);\n"
+"	if (distance >= shadowFarPlane)\n"
+"		return 1.0f;\n"
+"	float closest = texture(shadowMap, toFragment).r * shadowFarPlane;\n"
+"	float bias = 0.02f + 0.05f * (1.0f - max(dot(norm, lightDirection), 0.0f));\n"	// Grazing surfaces need more
+"	return distance - bias > closest ? 0.0f : 1.0f;\n"
+"}\n"
 
 "void main()\n"
 "{\n"
 /*Phong lighting model calculations to generate ambient, diffuse, and specular components*/
 
-//Calculate Ambient lighting*/
-"float ambientStrength = 0.1f;\n"									// Set ambient or global lighting strength
-"vec3 ambient = ambientStrength * lightColor;\n"					// Generate ambient light color
+//Calculate Ambient lighting: sky light with occlusion and bounce light, baked by --bake-lightmaps
+"vec3 ambient = texture(lightmap, vertexLightmapCoordinate).rgb * lightColor;\n"	// Generate ambient light color
 
 //Calculate Diffuse lighting*/
 "vec3 norm = normalize(vertexNormal);\n"							// Normalize vectors to 1 unit
@@ -44,10 +82,11 @@ const char* fragmentShaderSource = "#version 440 core\n"
 // Texture holds the color to be used for all three components
 "vec4 textureColor = texture(Texture, vertexTextureCoordinate * uvScale);\n"
 
-// Calculate phong result
-"vec3 phong = (ambient + diffuse + specular) * textureColor.xyz;\n"
+// Calculate phong result; the key light's shadow removes its diffuse and specular parts
+"float shadow = keyLightShadow(norm, lightDirection);\n"
+"vec3 phong = (ambient + shadow * (diffuse + specular)) * textureColor.xyz;\n"
 
 "FragColor = vec4(phong, 1.0);\n"								// Send lighting results to GPU
 "}\n\0";
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,326 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+/*Frame-scoped linear allocator
+* Everything that only lives for one iteration of the main loop (jobs, their closures, scratch lists) is bump
+* allocated from one block and released all at once by UResetFrameArena at the top of the next iteration.
+* Allocation is a single atomic add, so job system workers can allocate concurrently; freeing is a no-op.
+* If a frame needs more than the block holds, the excess falls back to the heap and the block is grown at the
+* next reset, so the arena settles at the size the scene actually needs.
+*
+* FRAME_ALLOCATION_CHECK replaces the global operator new/delete and reports heap traffic on threads that are
+* inside a frame (FrameScope), once per distinct callstack: 1 logs, 2 logs and aborts (for CI runs).
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Logger.h"
+
+struct FrameArena {
+	unsigned char* memory = nullptr;
+	size_t capacity = 0;
+	std::atomic<size_t> head{ 0 };
+	size_t peak = 0;						//Largest frame since creation, including overflow
+
+	std::mutex overflowMutex;
+	std::vector<void*> overflow;			//Heap fallbacks, freed at the next reset
+	std::atomic<size_t> overflowBytes{ 0 };
+};
+
+//Blocks are aligned to a cache line, so any alignment up to 64 is honoured
+const size_t FRAME_ARENA_ALIGNMENT = 64;
+
+void UCreateFrameArena(FrameArena& arena, size_t capacity) {
+	arena.memory = (unsigned char*)::operator new(capacity + FRAME_ARENA_ALIGNMENT);
+	arena.capacity = capacity;
+	arena.head = 0;
+}
+
+void* UArenaAllocate(FrameArena& arena, size_t size, size_t alignment = alignof(std::max_align_t)) {
+	uintptr_t base = ((uintptr_t)arena.memory + FRAME_ARENA_ALIGNMENT - 1) & ~(uintptr_t)(FRAME_ARENA_ALIGNMENT - 1);
+	size_t head = arena.head.load(std::memory_order_relaxed);
+	size_t offset;
+	do {
+		offset = (head + alignment - 1) & ~(alignment - 1);
+		if (offset + size > arena.capacity) {
+			//Over budget this frame: correct, but it costs a heap allocation until the next reset grows the block
+			void* fallback = ::operator new(size + alignment);
+			{
+				std::lock_guard<std::mutex> lock(arena.overflowMutex);
+				arena.overflow.push_back(fallback);
+			}
+			arena.overflowBytes += size + alignment;
+			return (void*)(((uintptr_t)fallback + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		}
+	} while (!arena.head.compare_exchange_weak(head, offset + size, std::memory_order_relaxed));
+	return (void*)(base + offset);
+}
+
+//Constructs a T in the arena; the caller runs its destructor if it has one
+template<class T, class... Args>
+T* UArenaNew(FrameArena& arena, Args&&... args) {
+	return new (UArenaAllocate(arena, sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+//Releases the frame's allocations; nothing allocated from the arena may be used afterwards
+void UResetFrameArena(FrameArena& arena) {
+	size_t overflowBytes = arena.overflowBytes.exchange(0);
+	size_t used = arena.head.exchange(0) + overflowBytes;
+	if (used > arena.peak)
+		arena.peak = used;
+	if (overflowBytes == 0)
+		return;
+
+	for (void* fallback : arena.overflow)
+		::operator delete(fallback);
+	arena.overflow.clear();
+
+	size_t capacity = arena.peak * 2;
+	LOG_INFO("INFO: Frame arena grown from %zu KB to %zu KB", arena.capacity / 1024, capacity / 1024);
+	::operator delete(arena.memory);
+	UCreateFrameArena(arena, capacity);
+}
+
+void UDestroyFrameArena(FrameArena& arena) {
+	UResetFrameArena(arena);
+	::operator delete(arena.memory);
+	arena.memory = nullptr;
+	arena.capacity = 0;
+}
+
+//STL allocator over a frame arena; containers using it must not outlive the frame
+template<class T>
+struct FrameAllocator {
+	typedef T value_type;
+
+	FrameArena* arena;
+
+	explicit FrameAllocator(FrameArena& frameArena) : arena(&frameArena) {}
+	template<class U>
+	FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) {
+		return (T*)UArenaAllocate(*arena, count * sizeof(T), alignof(T));
+	}
+
+	//Memory comes back when the arena is reset
+	void deallocate(T*, size_t) {}
+};
+
+template<class T, class U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {
+	return a.arena == b.arena;
+}
+
+template<class T, class U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {
+	return a.arena != b.arena;
+}
+
+template<class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+//--------------------------------ALLOCATION CHECK-------------------------------------------
+#ifndef FRAME_ALLOCATION_CHECK
+#define FRAME_ALLOCATION_CHECK 0
+#endif
+
+//Set once startup loading has settled; allocations before that are expected
+std::atomic<bool> gFrameAllocationCheckArmed{ false };
+std::atomic<uint64_t> gFrameAllocationCount{ 0 };
+
+thread_local int tFrameScope = 0;
+thread_local int tAllowedFrameAllocations = 0;
+
+//Marks the calling thread as doing per-frame work for its lifetime
+struct FrameScope {
+	FrameScope() { ++tFrameScope; }
+	~FrameScope() { --tFrameScope; }
+};
+
+//Exempts intentional, rare in-frame allocations (resource uploads and swaps) from the check
+struct AllowFrameAllocations {
+	AllowFrameAllocations() { ++tAllowedFrameAllocations; }
+	~AllowFrameAllocations() { --tAllowedFrameAllocations; }
+};
+
+#if FRAME_ALLOCATION_CHECK
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#else
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+const int ALLOCATION_STACK_DEPTH = 32;
+const size_t ALLOCATION_SEEN_SLOTS = 1024;
+
+//Hashes of callstacks already reported, so a regression in a per-frame path is logged once, not every frame
+std::atomic<uint64_t> gReportedAllocationStacks[ALLOCATION_SEEN_SLOTS];
+thread_local bool tReportingAllocation = false;
+
+bool UFirstReportOfStack(void* const* frames, int count) {
+	uint64_t hash = 1469598103934665603ull;
+	for (int i = 0; i < count; ++i)
+		hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ull;
+	if (hash == 0)
+		hash = 1;
+
+	for (size_t probe = 0; probe < ALLOCATION_SEEN_SLOTS; ++probe) {
+		std::atomic<uint64_t>& slot = gReportedAllocationStacks[(hash + probe) % ALLOCATION_SEEN_SLOTS];
+		uint64_t seen = slot.load();
+		if (seen == hash)
+			return false;
+		if (seen == 0 && slot.compare_exchange_strong(seen, hash))
+			return true;
+		if (seen == hash)
+			return false;
+	}
+	return false;
+}
+
+//Writes with stdio only; anything that allocates here would recurse into the check
+void UPrintAllocationStack(void* const* frames, int count) {
+#ifdef _WIN32
+	static std::mutex symbolMutex;
+	static bool symbolsReady = false;
+	std::lock_guard<std::mutex> lock(symbolMutex);
+
+	HANDLE process = GetCurrentProcess();
+	if (!symbolsReady) {
+		SymSetOptions(SYMOPT_LOAD_LINES | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+		symbolsReady = SymInitialize(process, NULL, TRUE) == TRUE;
+	}
+
+	alignas(SYMBOL_INFO) char symbolStorage[sizeof(SYMBOL_INFO) + 256];
+	SYMBOL_INFO* symbol = (SYMBOL_INFO*)symbolStorage;
+	for (int i = 0; i < count; ++i) {
+		DWORD64 address = (DWORD64)(uintptr_t)frames[i];
+		symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+		symbol->MaxNameLen = 255;
+		IMAGEHLP_LINE64 line = {};
+		line.SizeOfStruct = sizeof(line);
+		DWORD lineDisplacement = 0;
+
+		if (symbolsReady && SymFromAddr(process, address, NULL, symbol)) {
+			if (SymGetLineFromAddr64(process, address, &lineDisplacement, &line))
+				fprintf(stderr, "    %s (%s:%lu)\n", symbol->Name, line.FileName, (unsigned long)line.LineNumber);
+			else
+				fprintf(stderr, "    %s\n", symbol->Name);
+		}
+		else {
+			fprintf(stderr, "    0x%llx\n", (unsigned long long)address);
+		}
+	}
+#else
+	fflush(stderr);
+	backtrace_symbols_fd(frames, count, STDERR_FILENO);
+#endif
+}
+
+void UCheckFrameAllocation(const char* operation, size_t size) {
+	if (!gFrameAllocationCheckArmed.load(std::memory_order_relaxed) || tFrameScope == 0 || tAllowedFrameAllocations > 0 || tReportingAllocation)
+		return;
+	tReportingAllocation = true;
+	++gFrameAllocationCount;
+
+	void* frames[ALLOCATION_STACK_DEPTH];
+#ifdef _WIN32
+	int count = (int)CaptureStackBackTrace(2, ALLOCATION_STACK_DEPTH, frames, NULL);
+#else
+	int count = backtrace(frames, ALLOCATION_STACK_DEPTH);
+#endif
+
+	if (UFirstReportOfStack(frames, count)) {
+		fprintf(stderr, "ERROR::FRAMEARENA::HEAP_%s_IN_FRAME %zu bytes\n", operation, size);
+		UPrintAllocationStack(frames, count);
+#if FRAME_ALLOCATION_CHECK >= 2
+		abort();
+#endif
+	}
+	tReportingAllocation = false;
+}
+
+void* operator new(size_t size) {
+	UCheckFrameAllocation("ALLOCATION", size);
+	if (size == 0)
+		size = 1;
+	while (true) {
+		if (void* memory = malloc(size))
+			return memory;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* memory) noexcept {
+	if (memory)
+		UCheckFrameAllocation("FREE", 0);
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
+
+#endif
+
+#endif
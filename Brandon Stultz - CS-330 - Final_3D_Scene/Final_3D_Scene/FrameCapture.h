@@ -0,0 +1,615 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+/*Frame capture (--capture)
+* Records the presented frames without making the GL thread wait for them:
+*   1. Read: just before the swap, glReadPixels copies the back buffer into a free slot of a ring of pixel pack
+*      buffers. With a buffer bound to GL_PIXEL_PACK_BUFFER the call only queues the copy; a fence marks its end.
+*   2. Hand off: every frame the GL thread polls the fences of the slots being read, oldest first, without waiting.
+*      A signaled slot (normally two or three frames later) goes to the encoders. The buffers are mapped persistently,
+*      like the uniform ring, so the encoders read the pixels straight from the mapping and nothing is copied.
+*   3. Encode: worker threads compress a slot to a QOI or PNG file per frame, or convert it for one raw Y4M stream
+*      (4:4:4, written in capture order), and then free the slot.
+* Memory is bounded by CAPTURE_SLOTS frames, allocated at the size of the first captured frame. Nothing blocks: a frame
+* is dropped when no slot is free, because the GPU has not finished the reads in flight or the encoders are behind,
+* or when its size differs from the capture's. Drops are counted by reason and reported when capture stops.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+const int CAPTURE_SLOTS = 6;				//Three reads in flight plus as many frames being encoded
+const int CAPTURE_READ_CHANNELS = 4;		//Read as RGBA, the format drivers copy fastest; files are RGB
+
+enum CaptureFormat {
+	CAPTURE_QOI,
+	CAPTURE_PNG,
+	CAPTURE_Y4M
+};
+
+const char* const CAPTURE_FORMAT_NAMES[] = { "qoi", "png", "y4m" };
+
+enum CaptureSlotState {
+	CAPTURE_SLOT_FREE,
+	CAPTURE_SLOT_READING,					//GL thread: waiting for the read's fence
+	CAPTURE_SLOT_ENCODING					//Queued for or held by an encoder
+};
+
+struct CaptureSlot {
+	GLuint buffer = 0;
+	const unsigned char* pixels = nullptr;	//Persistently mapped; rows bottom first, as GL reads them
+	GLsync fence = 0;
+	uint64_t sequence = 0;					//Capture order: the file number, and the Y4M frame order
+	std::atomic<int> state{ CAPTURE_SLOT_FREE };
+};
+
+struct FrameCapture {
+	bool active = false;
+	CaptureFormat format = CAPTURE_QOI;
+	std::string path;						//Output directory, or the stream file for Y4M
+	int fps = 60;							//Y4M header only
+	int width = 0;							//Fixed by the first captured frame
+	int height = 0;
+
+	CaptureSlot slots[CAPTURE_SLOTS];
+	int nextSlot = 0;
+	uint64_t nextSequence = 0;
+
+	//GL thread: slots being read, in read order
+	int reading[CAPTURE_SLOTS];
+	int readingHead = 0;
+	int readingCount = 0;
+
+	//Encoder queue, in capture order
+	std::mutex mutex;
+	std::condition_variable wake;
+	int queue[CAPTURE_SLOTS];
+	int queueHead = 0;
+	int queueCount = 0;
+	bool stopping = false;
+	std::vector<std::thread> encoders;
+
+	//Y4M: encoders write their frames in turn
+	FILE* stream = nullptr;
+	std::mutex streamMutex;
+	std::condition_variable streamTurn;
+	uint64_t nextWrite = 0;
+
+	std::atomic<uint64_t> written{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+	std::atomic<uint64_t> encodeNanoseconds{ 0 };
+	std::atomic<uint64_t> writeFailures{ 0 };
+	uint64_t droppedGpu = 0;				//GL thread: every slot still waiting for its read
+	uint64_t droppedEncoders = 0;			//GL thread: no slot free while some were being encoded
+	uint64_t droppedResized = 0;
+};
+
+//---------------------------------------QOI---------------------------------------------
+void UPutBigEndian32(std::vector<unsigned char>& out, uint32_t value) {
+	unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+	out.insert(out.end(), bytes, bytes + 4);
+}
+
+//"Quite OK Image" operations, 3 channels: runs, a 64 entry index of recent colors, and small deltas from the previous
+//pixel. The state starts over for every image (or frame server tile), so each decodes on its own.
+struct QoiEncoder {
+	uint32_t index[64] = {};
+	unsigned char previous[3] = { 0, 0, 0 };
+	int run = 0;
+};
+
+void UFlushQoiRun(QoiEncoder& encoder, std::vector<unsigned char>& out) {
+	if (encoder.run > 0) {
+		out.push_back((unsigned char)(0xC0 | (encoder.run - 1)));
+		encoder.run = 0;
+	}
+}
+
+void UPutQoiPixel(QoiEncoder& encoder, const unsigned char* pixel, std::vector<unsigned char>& out) {
+	unsigned char* previous = encoder.previous;
+	if (pixel[0] == previous[0] && pixel[1] == previous[1] && pixel[2] == previous[2]) {
+		if (++encoder.run == 62)
+			UFlushQoiRun(encoder, out);
+		return;
+	}
+	UFlushQoiRun(encoder, out);
+
+	uint32_t color = (uint32_t)pixel[0] | (uint32_t)pixel[1] << 8 | (uint32_t)pixel[2] << 16 | 0xFF000000u;
+	int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+	if (encoder.index[hash] == color) {
+		out.push_back((unsigned char)hash);
+	}
+	else {
+		encoder.index[hash] = color;
+		int dr = (signed char)(pixel[0] - previous[0]);
+		int dg = (signed char)(pixel[1] - previous[1]);
+		int db = (signed char)(pixel[2] - previous[2]);
+		int drg = dr - dg;
+		int dbg = db - dg;
+		if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+			out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+		}
+		else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+			out.push_back((unsigned char)(0x80 | (dg + 32)));
+			out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+		}
+		else {
+			unsigned char rgb[4] = { 0xFE, pixel[0], pixel[1], pixel[2] };
+			out.insert(out.end(), rgb, rgb + 4);
+		}
+	}
+	memcpy(previous, pixel, 3);
+}
+
+void UEncodeQoi(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out) {
+	out.clear();
+	out.reserve((size_t)width * height * 4 / 3);
+	const char magic[4] = { 'q', 'o', 'i', 'f' };
+	out.insert(out.end(), magic, magic + 4);
+	UPutBigEndian32(out, (uint32_t)width);
+	UPutBigEndian32(out, (uint32_t)height);
+	out.push_back(3);						//Channels
+	out.push_back(0);						//sRGB with linear alpha
+
+	QoiEncoder encoder;
+	for (int y = height - 1; y >= 0; --y) {
+		const unsigned char* row = pixels + (size_t)y * width * CAPTURE_READ_CHANNELS;
+		for (int x = 0; x < width; ++x)
+			UPutQoiPixel(encoder, row + x * CAPTURE_READ_CHANNELS, out);
+	}
+	UFlushQoiRun(encoder, out);
+
+	const unsigned char end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	out.insert(out.end(), end, end + 8);
+}
+
+//---------------------------------------PNG---------------------------------------------
+//Deflate with the fixed Huffman codes and a one-entry-per-hash LZ77 matcher: much faster than searching hash chains,
+//and filtered frames are mostly long repeats
+const int DEFLATE_HASH_BITS = 15;
+const int DEFLATE_WINDOW = 32768;
+const int DEFLATE_MAX_MATCH = 258;
+
+struct BitWriter {
+	std::vector<unsigned char>* out;
+	uint32_t bits = 0;
+	int count = 0;
+};
+
+void UPutBits(BitWriter& writer, uint32_t value, int count) {
+	writer.bits |= value << writer.count;
+	writer.count += count;
+	while (writer.count >= 8) {
+		writer.out->push_back((unsigned char)writer.bits);
+		writer.bits >>= 8;
+		writer.count -= 8;
+	}
+}
+
+//Huffman codes are stored most significant bit first, unlike every other field
+void UPutHuffman(BitWriter& writer, uint32_t code, int length) {
+	uint32_t reversed = 0;
+	for (int i = 0; i < length; ++i)
+		reversed |= ((code >> i) & 1) << (length - 1 - i);
+	UPutBits(writer, reversed, length);
+}
+
+void UPutFixedSymbol(BitWriter& writer, int symbol) {
+	if (symbol < 144)
+		UPutHuffman(writer, 0x30 + symbol, 8);
+	else if (symbol < 256)
+		UPutHuffman(writer, 0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		UPutHuffman(writer, symbol - 256, 7);
+	else
+		UPutHuffman(writer, 0xC0 + symbol - 280, 8);
+}
+
+void UPutMatch(BitWriter& writer, int length, int distance) {
+	static const int lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const int distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	static const int distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	int code = 28;
+	while (lengthBase[code] > length)
+		--code;
+	UPutFixedSymbol(writer, 257 + code);
+	UPutBits(writer, (uint32_t)(length - lengthBase[code]), lengthExtra[code]);
+
+	code = 29;
+	while (distanceBase[code] > distance)
+		--code;
+	UPutHuffman(writer, (uint32_t)code, 5);
+	UPutBits(writer, (uint32_t)(distance - distanceBase[code]), distanceExtra[code]);
+}
+
+//zlib stream of one fixed Huffman block; 'table' is the matcher's scratch space, kept by the caller between frames
+void UDeflate(const unsigned char* data, size_t size, std::vector<int32_t>& table, std::vector<unsigned char>& out) {
+	out.push_back(0x78);					//32K window, deflate
+	out.push_back(0x01);
+
+	BitWriter writer;
+	writer.out = &out;
+	UPutBits(writer, 1, 1);					//Final block
+	UPutBits(writer, 1, 2);					//Fixed codes
+
+	table.assign((size_t)1 << DEFLATE_HASH_BITS, -1);
+	auto hash = [data](size_t position) {
+		uint32_t bytes = (uint32_t)data[position] | (uint32_t)data[position + 1] << 8 | (uint32_t)data[position + 2] << 16;
+		return (bytes * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+	};
+
+	size_t position = 0;
+	while (position < size) {
+		int length = 0;
+		size_t candidate = 0;
+		if (position + 3 <= size) {
+			uint32_t key = hash(position);
+			int32_t previous = table[key];
+			table[key] = (int32_t)position;
+			if (previous >= 0 && position - (size_t)previous <= (size_t)DEFLATE_WINDOW) {
+				candidate = (size_t)previous;
+				size_t limit = std::min(size - position, (size_t)DEFLATE_MAX_MATCH);
+				while ((size_t)length < limit && data[candidate + length] == data[position + length])
+					++length;
+			}
+		}
+
+		if (length < 3) {
+			UPutFixedSymbol(writer, data[position]);
+			++position;
+			continue;
+		}
+
+		UPutMatch(writer, length, (int)(position - candidate));
+		for (size_t i = position + 1; i < position + length && i + 3 <= size; ++i)
+			table[hash(i)] = (int32_t)i;
+		position += length;
+	}
+	UPutFixedSymbol(writer, 256);
+	if (writer.count > 0)
+		UPutBits(writer, 0, 8 - writer.count);
+
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < size;) {
+		size_t end = std::min(size, i + 5552);		//Largest run before b can overflow
+		for (; i < end; ++i) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	UPutBigEndian32(out, b << 16 | a);
+}
+
+uint32_t UCrc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+	static const std::vector<uint32_t> table = [] {
+		std::vector<uint32_t> entries(256);
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			entries[n] = c;
+		}
+		return entries;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+void UPutPngChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+	UPutBigEndian32(out, (uint32_t)size);
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data, data + size);
+	UPutBigEndian32(out, UCrc32(&out[start], size + 4));
+}
+
+struct PngScratch {
+	std::vector<unsigned char> filtered;
+	std::vector<unsigned char> compressed;
+	std::vector<int32_t> table;
+};
+
+//8 bit RGB. Each row takes the Sub or Up filter, whichever leaves the smaller residuals.
+void UEncodePng(const unsigned char* pixels, int width, int height, PngScratch& scratch, std::vector<unsigned char>& out) {
+	size_t rowBytes = (size_t)width * 3;
+	scratch.filtered.resize((rowBytes + 1) * height);
+	for (int y = 0; y < height; ++y) {
+		const unsigned char* row = pixels + (size_t)(height - 1 - y) * width * CAPTURE_READ_CHANNELS;
+		const unsigned char* above = y > 0 ? row + (size_t)width * CAPTURE_READ_CHANNELS : nullptr;
+		unsigned char* filtered = &scratch.filtered[(rowBytes + 1) * y];
+
+		int subCost = 0, upCost = 0;
+		for (int x = 0; x < width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				int value = row[x * CAPTURE_READ_CHANNELS + c];
+				subCost += std::abs((signed char)(value - (x > 0 ? row[(x - 1) * CAPTURE_READ_CHANNELS + c] : 0)));
+				upCost += std::abs((signed char)(value - (above ? above[x * CAPTURE_READ_CHANNELS + c] : 0)));
+			}
+		}
+
+		bool up = upCost < subCost;
+		filtered[0] = up ? 2 : 1;
+		for (int x = 0; x < width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				int value = row[x * CAPTURE_READ_CHANNELS + c];
+				int predicted = up ? (above ? above[x * CAPTURE_READ_CHANNELS + c] : 0) : (x > 0 ? row[(x - 1) * CAPTURE_READ_CHANNELS + c] : 0);
+				filtered[1 + x * 3 + c] = (unsigned char)(value - predicted);
+			}
+		}
+	}
+
+	scratch.compressed.clear();
+	UDeflate(scratch.filtered.data(), scratch.filtered.size(), scratch.table, scratch.compressed);
+
+	out.clear();
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.insert(out.end(), signature, signature + 8);
+	unsigned char header[13] = {};
+	for (int i = 0; i < 4; ++i) {
+		header[i] = (unsigned char)(width >> (24 - 8 * i));
+		header[4 + i] = (unsigned char)(height >> (24 - 8 * i));
+	}
+	header[8] = 8;							//Bits per channel
+	header[9] = 2;							//RGB
+	UPutPngChunk(out, "IHDR", header, sizeof(header));
+	UPutPngChunk(out, "IDAT", scratch.compressed.data(), scratch.compressed.size());
+	UPutPngChunk(out, "IEND", nullptr, 0);
+}
+
+//---------------------------------------Y4M---------------------------------------------
+//"FRAME" and the Y, Cb, and Cr planes at full resolution (BT.601, studio range), top row first
+void UEncodeY4mFrame(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out) {
+	const char frameTag[] = "FRAME\n";
+	size_t planeSize = (size_t)width * height;
+	out.resize(sizeof(frameTag) - 1 + planeSize * 3);
+	memcpy(out.data(), frameTag, sizeof(frameTag) - 1);
+	unsigned char* luma = out.data() + sizeof(frameTag) - 1;
+	unsigned char* blue = luma + planeSize;
+	unsigned char* red = blue + planeSize;
+	for (int y = 0; y < height; ++y) {
+		const unsigned char* row = pixels + (size_t)(height - 1 - y) * width * CAPTURE_READ_CHANNELS;
+		size_t offset = (size_t)y * width;
+		for (int x = 0; x < width; ++x) {
+			int r = row[x * CAPTURE_READ_CHANNELS], g = row[x * CAPTURE_READ_CHANNELS + 1], b = row[x * CAPTURE_READ_CHANNELS + 2];
+			luma[offset + x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			blue[offset + x] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			red[offset + x] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+}
+
+//-------------------------------------ENCODERS------------------------------------------
+bool UWriteCaptureFile(const char* path, const std::vector<unsigned char>& data) {
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+	return fclose(file) == 0 && written;
+}
+
+void UEncodeCaptureSlot(FrameCapture& capture, CaptureSlot& slot, PngScratch& scratch, std::vector<unsigned char>& out) {
+	bool written = true;
+	if (capture.format == CAPTURE_Y4M) {
+		UEncodeY4mFrame(slot.pixels, capture.width, capture.height, out);
+
+		//Frames leave the queue in capture order, so the one whose turn it is is always being encoded
+		std::unique_lock<std::mutex> lock(capture.streamMutex);
+		capture.streamTurn.wait(lock, [&] { return capture.nextWrite == slot.sequence; });
+		written = capture.stream && fwrite(out.data(), 1, out.size(), capture.stream) == out.size();
+		++capture.nextWrite;
+		capture.streamTurn.notify_all();
+	}
+	else {
+		if (capture.format == CAPTURE_PNG)
+			UEncodePng(slot.pixels, capture.width, capture.height, scratch, out);
+		else
+			UEncodeQoi(slot.pixels, capture.width, capture.height, out);
+
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/frame_%06llu.%s", capture.path.c_str(), (unsigned long long)slot.sequence, CAPTURE_FORMAT_NAMES[capture.format]);
+		written = UWriteCaptureFile(path, out);
+	}
+
+	if (written) {
+		++capture.written;
+		capture.bytes += out.size();
+	}
+	else if (capture.writeFailures++ == 0) {
+		LOG_ERROR("ERROR::CAPTURE::WRITE_FAILED %s", capture.path.c_str());
+	}
+}
+
+void UCaptureEncoder(FrameCapture* capture) {
+	PngScratch scratch;
+	std::vector<unsigned char> out;
+	for (;;) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(capture->mutex);
+			capture->wake.wait(lock, [capture] { return capture->queueCount > 0 || capture->stopping; });
+			if (capture->queueCount == 0)
+				return;
+			index = capture->queue[capture->queueHead];
+			capture->queueHead = (capture->queueHead + 1) % CAPTURE_SLOTS;
+			--capture->queueCount;
+		}
+
+		CaptureSlot& slot = capture->slots[index];
+		auto encodeStart = std::chrono::steady_clock::now();
+		UEncodeCaptureSlot(*capture, slot, scratch, out);
+		capture->encodeNanoseconds += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - encodeStart).count();
+		slot.state.store(CAPTURE_SLOT_FREE, std::memory_order_release);
+	}
+}
+
+//------------------------------------GL THREAD------------------------------------------
+//Starts the encoders; the slots are allocated by the first UCaptureFrame, at the framebuffer's size then
+void UStartFrameCapture(FrameCapture& capture, const std::string& path, CaptureFormat format, int fps, unsigned encoderThreads) {
+	capture.path = path;
+	capture.format = format;
+	capture.fps = fps > 0 ? fps : 60;
+	capture.active = true;
+	if (encoderThreads == 0)
+		encoderThreads = std::max(2u, std::thread::hardware_concurrency() / 2);
+	for (unsigned i = 0; i < encoderThreads; ++i)
+		capture.encoders.emplace_back(UCaptureEncoder, &capture);
+	LOG_INFO("INFO: Capturing %s to %s on %u encoder threads", CAPTURE_FORMAT_NAMES[format], path.c_str(), encoderThreads);
+}
+
+bool UCreateCaptureSlots(FrameCapture& capture, int width, int height) {
+	capture.width = width;
+	capture.height = height;
+	GLsizeiptr size = (GLsizeiptr)width * height * CAPTURE_READ_CHANNELS;
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	for (CaptureSlot& slot : capture.slots) {
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, size, NULL, flags | GL_CLIENT_STORAGE_BIT);
+		slot.pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags);
+		if (!slot.pixels) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			LOG_ERROR("ERROR::CAPTURE::MAP_FAILED");
+			return false;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (capture.format == CAPTURE_Y4M) {
+		capture.stream = fopen(capture.path.c_str(), "wb");
+		if (!capture.stream) {
+			LOG_ERROR("ERROR::CAPTURE::OPEN_FAILED %s", capture.path.c_str());
+			return false;
+		}
+		fprintf(capture.stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, capture.fps);
+	}
+	return true;
+}
+
+//Hands the slots whose reads have finished to the encoders, oldest first; stops at the first read still in flight.
+//'wait' blocks on every fence instead (shutdown).
+void UCollectCaptureReads(FrameCapture& capture, bool wait) {
+	while (capture.readingCount > 0) {
+		int index = capture.reading[capture.readingHead];
+		CaptureSlot& slot = capture.slots[index];
+		if (wait) {
+			while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+			}
+		}
+		else if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			return;
+		}
+
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		slot.state = CAPTURE_SLOT_ENCODING;
+		capture.readingHead = (capture.readingHead + 1) % CAPTURE_SLOTS;
+		--capture.readingCount;
+
+		std::lock_guard<std::mutex> lock(capture.mutex);
+		capture.queue[(capture.queueHead + capture.queueCount) % CAPTURE_SLOTS] = index;
+		++capture.queueCount;
+		capture.wake.notify_one();
+	}
+}
+
+//Queues the read of the finished frame in the back buffer; call just before the swap. Returns false if the frame was dropped.
+bool UCaptureFrame(FrameCapture& capture, int width, int height) {
+	UCollectCaptureReads(capture, false);
+
+	if (capture.width == 0 && !UCreateCaptureSlots(capture, width, height)) {
+		capture.active = false;
+		return false;
+	}
+	if (width != capture.width || height != capture.height) {
+		++capture.droppedResized;
+		return false;
+	}
+
+	int index = -1;
+	for (int i = 0; i < CAPTURE_SLOTS && index < 0; ++i) {
+		int candidate = (capture.nextSlot + i) % CAPTURE_SLOTS;
+		if (capture.slots[candidate].state.load(std::memory_order_acquire) == CAPTURE_SLOT_FREE)
+			index = candidate;
+	}
+	if (index < 0) {
+		if (capture.readingCount == CAPTURE_SLOTS)
+			++capture.droppedGpu;
+		else
+			++capture.droppedEncoders;
+		return false;
+	}
+	capture.nextSlot = (index + 1) % CAPTURE_SLOTS;
+
+	CaptureSlot& slot = capture.slots[index];
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(GL_BACK);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.sequence = capture.nextSequence++;
+	slot.state = CAPTURE_SLOT_READING;
+	capture.reading[(capture.readingHead + capture.readingCount) % CAPTURE_SLOTS] = index;
+	++capture.readingCount;
+	return true;
+}
+
+//Encodes the reads still in flight, joins the encoders, releases the buffers, and reports the totals
+void UStopFrameCapture(FrameCapture& capture) {
+	if (capture.encoders.empty())
+		return;
+
+	if (capture.width > 0)
+		UCollectCaptureReads(capture, true);
+	{
+		std::lock_guard<std::mutex> lock(capture.mutex);
+		capture.stopping = true;
+	}
+	capture.wake.notify_all();
+	for (std::thread& encoder : capture.encoders)
+		encoder.join();
+	capture.encoders.clear();
+
+	if (capture.stream)
+		fclose(capture.stream);
+	capture.stream = nullptr;
+	for (CaptureSlot& slot : capture.slots) {
+		if (slot.buffer) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glDeleteBuffers(1, &slot.buffer);
+		}
+		slot.buffer = 0;
+		slot.pixels = nullptr;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	uint64_t written = capture.written;
+	LOG_INFO("INFO: Capture: %llu frames written (%.1f MB, %.2f ms encode/frame), dropped %llu (GPU behind %llu, encoders behind %llu, resized %llu)",
+		(unsigned long long)written, capture.bytes / (1024.0 * 1024.0), written ? capture.encodeNanoseconds / 1e6 / written : 0.0,
+		(unsigned long long)(capture.droppedGpu + capture.droppedEncoders + capture.droppedResized), (unsigned long long)capture.droppedGpu,
+		(unsigned long long)capture.droppedEncoders, (unsigned long long)capture.droppedResized);
+	capture.active = false;
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef FRAMEPACING_H
+#define FRAMEPACING_H
+
+/*Fixed-step simulation clock and frame pacing
+* The simulation advances in fixed steps no matter how fast frames are produced: each frame adds the elapsed
+* real time to an accumulator and runs as many whole steps as fit. What is left over, as a fraction of a step,
+* is the interpolation factor the render snapshot uses to blend the last two simulated states, so motion stays
+* smooth when the frame rate and step rate differ.
+*
+* How frames are paced is a policy chosen with --pacing:
+*   vsync     - swap interval 1; presentation waits for vertical blank
+*   adaptive  - swap interval -1 (late frames tear instead of waiting a whole interval); vsync if unsupported
+*   limit     - no vsync; the main thread sleeps, then spins, until the next frame deadline (--fps-cap)
+*   uncapped  - no vsync and no limiter
+* --pacing-sweep runs each policy in turn and reports the frame-time spread of each.
+*
+* With --on-demand, a frame is only built when something marked it dirty (input, animation, a resize or expose,
+* a resource arriving). Otherwise the main loop blocks in the event wait, so a static scene costs no CPU or GPU time.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "Logger.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+//------------------------------------SIMULATION CLOCK----------------------------------------
+struct SimulationClock {
+	double step = 1.0 / 120.0;			//Seconds per simulation step
+	double time = 0.0;					//Real time the simulation has been advanced to
+	double accumulator = 0.0;			//Real time not yet simulated
+	int maxSteps = 8;					//Per frame; beyond this the backlog is dropped instead of caught up
+	uint64_t droppedSteps = 0;
+};
+
+void UStartSimulationClock(SimulationClock& clock, double now, double stepsPerSecond) {
+	clock.step = 1.0 / stepsPerSecond;
+	clock.time = now;
+	clock.accumulator = 0.0;
+}
+
+//Returns how many fixed steps to run this frame
+int UAdvanceSimulationClock(SimulationClock& clock, double now) {
+	clock.accumulator += now - clock.time;
+	clock.time = now;
+
+	int steps = (int)(clock.accumulator / clock.step);
+	if (steps > clock.maxSteps) {
+		//A long stall (loading, a breakpoint) would otherwise be replayed as a burst of steps
+		LOG_WARN("WARN: Simulation fell %d steps behind; skipping them", steps - clock.maxSteps);
+		clock.droppedSteps += steps - clock.maxSteps;
+		clock.accumulator -= (steps - clock.maxSteps) * clock.step;
+		steps = clock.maxSteps;
+	}
+	return steps;
+}
+
+//Real time at the end of the step about to run; input is consumed up to here
+double UStepEndTime(const SimulationClock& clock) {
+	return clock.time - clock.accumulator + clock.step;
+}
+
+//Consumes one step from the accumulator
+void UFinishStep(SimulationClock& clock) {
+	clock.accumulator -= clock.step;
+}
+
+//Skips the time the loop spent idle: nothing was animating, so there is nothing to catch up on
+void UResyncSimulationClock(SimulationClock& clock, double now) {
+	clock.time = now;
+}
+
+//Fraction of a step between the last simulated state and now, for interpolation
+float UInterpolationAlpha(const SimulationClock& clock) {
+	float alpha = (float)(clock.accumulator / clock.step);
+	return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+//--------------------------------------PACING-------------------------------------------
+enum PacingPolicy {
+	PACING_VSYNC,
+	PACING_ADAPTIVE,
+	PACING_LIMIT,
+	PACING_UNCAPPED,
+	PACING_POLICY_COUNT
+};
+
+const char* const PACING_NAMES[PACING_POLICY_COUNT] = { "vsync", "adaptive", "limit", "uncapped" };
+
+//Frame intervals at present time, accumulated in microseconds
+struct FrameTimeSpread {
+	std::atomic<uint64_t> frames{ 0 };
+	std::atomic<uint64_t> sum{ 0 };
+	std::atomic<uint64_t> sumOfSquares{ 0 };
+	std::atomic<uint64_t> maximum{ 0 };
+};
+
+struct FramePacer {
+	std::atomic<int> policy{ PACING_VSYNC };		//Requested by the main thread
+	int appliedPolicy = -1;							//GL thread: what the swap interval is set for
+	double targetFps = 60.0;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+	//GL thread: time of the last present
+	bool presented = false;
+	std::chrono::steady_clock::time_point lastPresent;
+
+	FrameTimeSpread window;								//Read and reset by the per-second report
+	FrameTimeSpread totals[PACING_POLICY_COUNT];		//Per policy, for the sweep summary
+
+	//--pacing-sweep
+	bool sweeping = false;
+	double sweepSeconds = 5.0;
+	std::chrono::steady_clock::time_point sweepStart;
+
+	//--on-demand
+	bool onDemand = false;
+	bool dirty = true;						//Main thread: the next frame differs from the last one
+	std::atomic<bool> idled{ false };		//The next present follows an idle wait, so its interval is not a frame time
+};
+
+int UParsePacingPolicy(const char* name) {
+	for (int i = 0; i < PACING_POLICY_COUNT; ++i) {
+		if (name && strcmp(name, PACING_NAMES[i]) == 0)
+			return i;
+	}
+	return -1;
+}
+
+void UStartPacing(FramePacer& pacer, int policy, double targetFps) {
+	pacer.policy = policy;
+	pacer.targetFps = targetFps > 0.0 ? targetFps : 60.0;
+	pacer.deadline = std::chrono::steady_clock::now();
+#ifdef _WIN32
+	//1 ms scheduler granularity for the limiter's sleep
+	timeBeginPeriod(1);
+#endif
+	if (policy == PACING_LIMIT)
+		LOG_INFO("INFO: Frame pacing: %s at %.0f fps", PACING_NAMES[policy], pacer.targetFps);
+	else
+		LOG_INFO("INFO: Frame pacing: %s", PACING_NAMES[policy]);
+}
+
+void UStopPacing(FramePacer&) {
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+//GL thread, before presenting: applies a changed policy's swap interval
+void UApplySwapInterval(FramePacer& pacer) {
+	int policy = pacer.policy.load();
+	if (policy == pacer.appliedPolicy)
+		return;
+
+	int interval = 0;
+	if (policy == PACING_VSYNC) {
+		interval = 1;
+	}
+	else if (policy == PACING_ADAPTIVE) {
+		bool tearControl = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+		if (!tearControl)
+			LOG_WARN("WARN: Adaptive vsync is not supported here; using vsync");
+		interval = tearControl ? -1 : 1;
+	}
+	glfwSwapInterval(interval);
+	pacer.appliedPolicy = policy;
+
+	//The first interval after a switch spans both policies
+	pacer.presented = false;
+}
+
+void URecordFrameTime(FrameTimeSpread& spread, uint64_t microseconds) {
+	++spread.frames;
+	spread.sum += microseconds;
+	spread.sumOfSquares += microseconds * microseconds;
+	uint64_t maximum = spread.maximum.load();
+	while (microseconds > maximum && !spread.maximum.compare_exchange_weak(maximum, microseconds)) {
+	}
+}
+
+//GL thread, right after the swap
+void UNotePresent(FramePacer& pacer) {
+	auto now = std::chrono::steady_clock::now();
+	if (pacer.presented && !pacer.idled.exchange(false)) {
+		uint64_t microseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - pacer.lastPresent).count();
+		URecordFrameTime(pacer.window, microseconds);
+		URecordFrameTime(pacer.totals[pacer.appliedPolicy], microseconds);
+	}
+	pacer.presented = true;
+	pacer.lastPresent = now;
+}
+
+//Mean, standard deviation, and worst frame time in milliseconds; resets the spread when 'reset' is set
+void UFrameTimeSpread(FrameTimeSpread& spread, bool reset, double& mean, double& deviation, double& worst, uint64_t& frames) {
+	frames = reset ? spread.frames.exchange(0) : spread.frames.load();
+	double sum = (double)(reset ? spread.sum.exchange(0) : spread.sum.load());
+	double sumOfSquares = (double)(reset ? spread.sumOfSquares.exchange(0) : spread.sumOfSquares.load());
+	worst = (reset ? spread.maximum.exchange(0) : spread.maximum.load()) / 1000.0;
+
+	mean = frames ? sum / frames / 1000.0 : 0.0;
+	double variance = frames ? sumOfSquares / frames - (sum / frames) * (sum / frames) : 0.0;
+	deviation = std::sqrt(variance > 0.0 ? variance : 0.0) / 1000.0;
+}
+
+//Main thread, end of the loop: under the limiter, waits for the next frame deadline.
+//Sleeps while more than a couple of milliseconds remain (the OS may oversleep by about that), then spins.
+void UPaceFrame(FramePacer& pacer) {
+	if (pacer.policy != PACING_LIMIT)
+		return;
+
+	auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / pacer.targetFps));
+	auto now = std::chrono::steady_clock::now();
+	pacer.deadline += interval;
+
+	//Fell behind by more than a frame: restart the schedule instead of rushing to catch up
+	if (pacer.deadline < now - interval)
+		pacer.deadline = now;
+
+	const auto spinMargin = std::chrono::milliseconds(2);
+	if (pacer.deadline - now > spinMargin)
+		std::this_thread::sleep_for(pacer.deadline - now - spinMargin);
+	while (std::chrono::steady_clock::now() < pacer.deadline) {
+	}
+}
+
+//------------------------------------RENDER ON DEMAND---------------------------------------
+//Longest idle wait; a safety net for changes that do not post a GLFW event
+const double IDLE_WAIT_SECONDS = 0.5;
+
+//Main thread: something visible changed
+void UInvalidateFrame(FramePacer& pacer) {
+	pacer.dirty = true;
+}
+
+//Main thread, in place of glfwPollEvents: with render on demand and nothing to redraw, blocks until an event
+//arrives. Returns true if it waited.
+bool UWaitForFrameWork(FramePacer& pacer) {
+	if (!pacer.onDemand || pacer.dirty) {
+		glfwPollEvents();
+		return false;
+	}
+	glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+	return true;
+}
+
+//Main thread: whether to build and present a frame this iteration; clears the dirty mark
+bool UTakeFrame(FramePacer& pacer) {
+	if (!pacer.onDemand)
+		return true;
+	bool dirty = pacer.dirty;
+	pacer.dirty = false;
+	if (!dirty)
+		pacer.idled = true;
+	return dirty;
+}
+
+void UStartPacingSweep(FramePacer& pacer, double seconds) {
+	pacer.sweeping = true;
+	pacer.sweepSeconds = seconds > 0.0 ? seconds : 5.0;
+	pacer.sweepStart = std::chrono::steady_clock::now();
+	pacer.policy = 0;
+	LOG_INFO("INFO: Pacing sweep, %.0f s per policy: %s", pacer.sweepSeconds, PACING_NAMES[0]);
+}
+
+//Main thread: moves the sweep to the next policy when its time is up; returns false once every policy has run
+bool UAdvancePacingSweep(FramePacer& pacer) {
+	if (!pacer.sweeping)
+		return true;
+	if (std::chrono::duration<double>(std::chrono::steady_clock::now() - pacer.sweepStart).count() < pacer.sweepSeconds)
+		return true;
+
+	pacer.sweepStart = std::chrono::steady_clock::now();
+	pacer.deadline = pacer.sweepStart;
+	if (pacer.policy + 1 < PACING_POLICY_COUNT) {
+		pacer.policy = pacer.policy + 1;
+		LOG_INFO("INFO: Pacing sweep: %s", PACING_NAMES[pacer.policy.load()]);
+		return true;
+	}
+
+	LOG_INFO("INFO: Pacing sweep results (frame time at present)");
+	for (int i = 0; i < PACING_POLICY_COUNT; ++i) {
+		double mean, deviation, worst;
+		uint64_t frames;
+		UFrameTimeSpread(pacer.totals[i], false, mean, deviation, worst, frames);
+		LOG_INFO("INFO:   %-9s %6llu frames, mean %.3f ms (%.1f fps), stddev %.3f ms, worst %.3f ms", PACING_NAMES[i],
+			(unsigned long long)frames, mean, mean > 0.0 ? 1000.0 / mean : 0.0, deviation, worst);
+	}
+	pacer.sweeping = false;
+	return false;
+}
+
+#endif
@@ -0,0 +1,499 @@
+#ifndef FRAMESERVER_H
+#define FRAMESERVER_H
+
+/*Frame server (--serve): sockets, messages, and the tile diff codec
+* A headless renderer for thin clients. Clients connect over TCP ("host:port", or just a port on the loopback
+* address) or, outside Windows, a Unix domain socket ("unix:/path"), and send two kinds of commands:
+*   - View requests: render the scene for this camera at this size. Each is answered with one frame, and a client
+*     keeps one request outstanding, so the server renders on demand at the rate each client takes frames.
+*   - Input events: keys, cursor, and scroll, applied to the server's camera and scene like the window's callbacks.
+*     Requests without a camera pose of their own get that camera.
+* A frame is sent as a diff against the last frame the same client received: the image is cut into FRAME_TILE_SIZE
+* squares and only tiles with a changed pixel are sent, each compressed on its own with the QOI operations of the
+* capture encoder. A still camera on a still scene costs a header per frame.
+* Messages are a type and a payload size followed by the payload, in host byte order; the clients this is for run on
+* the same machine or the same architecture.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET FrameSocket;
+const FrameSocket INVALID_FRAME_SOCKET = INVALID_SOCKET;
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int FrameSocket;
+const FrameSocket INVALID_FRAME_SOCKET = -1;
+#endif
+
+#include "Logger.h"
+#include "FrameCapture.h"
+
+const char* const FRAME_SERVER_ADDRESS = "127.0.0.1:7878";
+const int FRAME_TILE_SIZE = 32;
+const int FRAME_MAX_SIZE = 4096;						//Largest width or height a client may request
+const uint32_t FRAME_MESSAGE_LIMIT = 64u << 20;		//Larger messages are treated as a broken connection
+const double FRAME_STALL_SECONDS = 2.0;				//Server: a partial message or a full send buffer this old drops the client
+
+enum FrameMessageType {
+	MESSAGE_VIEW = 1,			//Client: ViewRequest
+	MESSAGE_INPUT,				//Client: InputCommand
+	MESSAGE_FRAME				//Server: FrameHeader, then the changed tiles
+};
+
+enum ViewFlags {
+	VIEW_POSE = 1,				//Use the request's camera instead of the one input moves
+	VIEW_KEYFRAME = 2			//Send every tile (the client lost its image)
+};
+
+enum FrameFlags {
+	FRAME_SHARED = 1,			//Rendered for an identical request from this or another client
+	FRAME_KEYFRAME = 2			//Every tile is included
+};
+
+struct FrameMessageHeader {
+	uint32_t type;
+	uint32_t size;				//Payload bytes that follow
+};
+
+struct ViewRequest {
+	uint32_t sequence;
+	uint32_t flags;
+	uint32_t width;
+	uint32_t height;
+	float position[3];			//VIEW_POSE: the camera, as the window's camera keeps it
+	float yaw;
+	float pitch;
+	float zoom;
+	uint64_t sentAt;			//Client clock, echoed in the frame so the client can time the round trip
+};
+
+struct InputCommand {
+	int32_t type;				//InputEventType
+	int32_t key;
+	int32_t action;
+	int32_t reserved;
+	double x;
+	double y;
+};
+
+struct FrameHeader {
+	uint32_t sequence;			//Of the request this answers
+	uint32_t flags;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tileSize;
+	uint32_t changedTiles;		//Each: tile index (row-major from the top left), byte count, QOI operations
+	uint64_t sentAt;
+	uint64_t renderNanoseconds;	//0 when shared
+	uint64_t encodeNanoseconds;
+};
+
+//---------------------------------------SOCKETS---------------------------------------------
+bool UStartSockets() {
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+		LOG_ERROR("ERROR::SERVER::WINSOCK_STARTUP_FAILED");
+		return false;
+	}
+#else
+	//A client that disconnects mid-frame fails the send instead of ending the process
+	signal(SIGPIPE, SIG_IGN);
+#endif
+	return true;
+}
+
+void UStopSockets() {
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void UCloseSocket(FrameSocket& socket) {
+	if (socket == INVALID_FRAME_SOCKET)
+		return;
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+	socket = INVALID_FRAME_SOCKET;
+}
+
+//Frames are small and answer a request, so they go out at once rather than waiting to fill a packet
+void USetNoDelay(FrameSocket socket) {
+	int noDelay = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+}
+
+//Server side: reads and sends never wait on one client while others are being served
+bool USetNonBlocking(FrameSocket socket) {
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+#else
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+//Whether the last failed call on a non-blocking socket only had nothing to do yet
+bool USocketWouldBlock() {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+//"unix:/path", "host:port", or "port" on the loopback address. Listening sockets bind the address, others connect.
+FrameSocket UOpenSocket(const char* address, bool listening) {
+	FrameSocket result = INVALID_FRAME_SOCKET;
+	bool opened = false;
+
+	if (strncmp(address, "unix:", 5) == 0) {
+#ifndef _WIN32
+		sockaddr_un local = {};
+		local.sun_family = AF_UNIX;
+		strncpy(local.sun_path, address + 5, sizeof(local.sun_path) - 1);
+		result = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (result != INVALID_FRAME_SOCKET && listening) {
+			unlink(local.sun_path);			//Left behind by an earlier server
+			opened = bind(result, (const sockaddr*)&local, sizeof(local)) == 0 && listen(result, 8) == 0;
+		}
+		else if (result != INVALID_FRAME_SOCKET) {
+			opened = connect(result, (const sockaddr*)&local, sizeof(local)) == 0;
+		}
+#endif
+	}
+	else {
+		std::string host = "127.0.0.1";
+		const char* port = address;
+		if (const char* colon = strrchr(address, ':')) {
+			host.assign(address, colon - address);
+			port = colon + 1;
+		}
+
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* found = nullptr;
+		if (getaddrinfo(host.c_str(), port, &hints, &found) == 0 && found) {
+			result = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+			if (result != INVALID_FRAME_SOCKET && listening) {
+				int reuse = 1;
+				setsockopt(result, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+				opened = bind(result, found->ai_addr, (int)found->ai_addrlen) == 0 && listen(result, 8) == 0;
+			}
+			else if (result != INVALID_FRAME_SOCKET) {
+				opened = connect(result, found->ai_addr, (int)found->ai_addrlen) == 0;
+				USetNoDelay(result);
+			}
+			freeaddrinfo(found);
+		}
+	}
+
+	if (!opened) {
+		LOG_ERROR("ERROR::SERVER::%s_FAILED %s", listening ? "LISTEN" : "CONNECT", address);
+		UCloseSocket(result);
+	}
+	return result;
+}
+
+//A non-blocking socket with a full send buffer is waited on for up to FRAME_STALL_SECONDS, then given up on
+bool USendAll(FrameSocket socket, const void* data, size_t size) {
+	const char* bytes = (const char*)data;
+	while (size > 0) {
+		int sent = send(socket, bytes, (int)std::min(size, (size_t)1 << 30), 0);
+		if (sent < 0 && USocketWouldBlock()) {
+			fd_set writable;
+			FD_ZERO(&writable);
+			FD_SET(socket, &writable);
+			timeval timeout = { (long)FRAME_STALL_SECONDS, 0 };
+			if (select((int)socket + 1, NULL, &writable, NULL, &timeout) <= 0)
+				return false;
+			continue;
+		}
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+bool UReceiveAll(FrameSocket socket, void* data, size_t size) {
+	char* bytes = (char*)data;
+	while (size > 0) {
+		int received = recv(socket, bytes, (int)std::min(size, (size_t)1 << 30), 0);
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= (size_t)received;
+	}
+	return true;
+}
+
+//Messages are built in one buffer, header first, and sent with a single write
+void UBeginMessage(std::vector<unsigned char>& message, FrameMessageType type) {
+	FrameMessageHeader header = { (uint32_t)type, 0 };
+	message.resize(sizeof(header));
+	memcpy(message.data(), &header, sizeof(header));
+}
+
+void UAppendMessage(std::vector<unsigned char>& message, const void* data, size_t size) {
+	message.insert(message.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+}
+
+bool USendMessage(FrameSocket socket, std::vector<unsigned char>& message) {
+	uint32_t size = (uint32_t)(message.size() - sizeof(FrameMessageHeader));
+	memcpy(message.data() + offsetof(FrameMessageHeader, size), &size, sizeof(size));
+	return USendAll(socket, message.data(), message.size());
+}
+
+//Client side: blocks until a whole message has arrived; false when the connection closed or sent something malformed
+bool UReceiveMessage(FrameSocket socket, FrameMessageHeader& header, std::vector<unsigned char>& payload) {
+	if (!UReceiveAll(socket, &header, sizeof(header)) || header.size > FRAME_MESSAGE_LIMIT)
+		return false;
+	payload.resize(header.size);
+	return header.size == 0 || UReceiveAll(socket, payload.data(), header.size);
+}
+
+//Server side: what a non-blocking connection has delivered so far. Messages are taken out whole; the bytes of one
+//that has not fully arrived wait here, and 'partialSince' says how long it has been incomplete.
+struct MessageReader {
+	std::vector<unsigned char> buffer;
+	size_t start = 0;						//First byte not yet taken
+	bool partial = false;
+	std::chrono::steady_clock::time_point partialSince;
+};
+
+//Reads everything the socket has without waiting; false when the connection closed or failed
+bool UFillMessageReader(FrameSocket socket, MessageReader& reader) {
+	reader.buffer.erase(reader.buffer.begin(), reader.buffer.begin() + reader.start);
+	reader.start = 0;
+
+	char chunk[16384];
+	while (true) {
+		int received = recv(socket, chunk, (int)sizeof(chunk), 0);
+		if (received > 0) {
+			reader.buffer.insert(reader.buffer.end(), chunk, chunk + received);
+			continue;
+		}
+		return received < 0 && USocketWouldBlock();
+	}
+}
+
+//Takes the next whole message; false when none has fully arrived, or with 'broken' set for an oversized one
+bool UTakeMessage(MessageReader& reader, FrameMessageHeader& header, std::vector<unsigned char>& payload, bool& broken) {
+	broken = false;
+	size_t available = reader.buffer.size() - reader.start;
+	if (available < sizeof(header))
+		return false;
+
+	memcpy(&header, reader.buffer.data() + reader.start, sizeof(header));
+	if (header.size > FRAME_MESSAGE_LIMIT) {
+		broken = true;
+		return false;
+	}
+	if (available - sizeof(header) < header.size)
+		return false;
+
+	const unsigned char* body = reader.buffer.data() + reader.start + sizeof(header);
+	payload.assign(body, body + header.size);
+	reader.start += sizeof(header) + header.size;
+	reader.partial = false;
+	return true;
+}
+
+//Whether the reader has held the same incomplete message for longer than FRAME_STALL_SECONDS
+bool UMessageStalled(MessageReader& reader, std::chrono::steady_clock::time_point now) {
+	if (reader.start == reader.buffer.size()) {
+		reader.partial = false;
+		return false;
+	}
+	if (!reader.partial) {
+		reader.partial = true;
+		reader.partialSince = now;
+	}
+	return std::chrono::duration<double>(now - reader.partialSince).count() > FRAME_STALL_SECONDS;
+}
+
+//---------------------------------------TILE DIFF---------------------------------------------
+//Server side, one per client: the last frame it was sent, as read back (RGBA, bottom row first)
+struct TileEncoder {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> reference;
+};
+
+//Appends the tiles of 'pixels' that differ from the client's last frame, or all of them for a keyframe or a new size,
+//and makes 'pixels' the new reference. Returns the number of tiles appended.
+uint32_t UEncodeTileDiff(TileEncoder& encoder, const unsigned char* pixels, int width, int height, bool keyframe,
+	std::vector<unsigned char>& out) {
+
+	if (encoder.width != width || encoder.height != height) {
+		encoder.width = width;
+		encoder.height = height;
+		encoder.reference.assign((size_t)width * height * CAPTURE_READ_CHANNELS, 0);
+		keyframe = true;
+	}
+
+	const size_t stride = (size_t)width * CAPTURE_READ_CHANNELS;
+	const int tilesX = (width + FRAME_TILE_SIZE - 1) / FRAME_TILE_SIZE;
+	const int tilesY = (height + FRAME_TILE_SIZE - 1) / FRAME_TILE_SIZE;
+	uint32_t changed = 0;
+	for (int tileY = 0; tileY < tilesY; ++tileY) {
+		int top = tileY * FRAME_TILE_SIZE;
+		int rows = std::min(FRAME_TILE_SIZE, height - top);
+		for (int tileX = 0; tileX < tilesX; ++tileX) {
+			int left = tileX * FRAME_TILE_SIZE;
+			int columns = std::min(FRAME_TILE_SIZE, width - left);
+			size_t rowBytes = (size_t)columns * CAPTURE_READ_CHANNELS;
+
+			//Tiles count from the top left; GL rows start at the bottom
+			bool differs = keyframe;
+			for (int row = 0; row < rows && !differs; ++row) {
+				size_t offset = (size_t)(height - 1 - top - row) * stride + (size_t)left * CAPTURE_READ_CHANNELS;
+				differs = memcmp(pixels + offset, encoder.reference.data() + offset, rowBytes) != 0;
+			}
+			if (!differs)
+				continue;
+
+			size_t start = out.size();
+			out.resize(start + 2 * sizeof(uint32_t));
+			QoiEncoder qoi;
+			for (int row = 0; row < rows; ++row) {
+				size_t offset = (size_t)(height - 1 - top - row) * stride + (size_t)left * CAPTURE_READ_CHANNELS;
+				memcpy(encoder.reference.data() + offset, pixels + offset, rowBytes);
+				for (int column = 0; column < columns; ++column)
+					UPutQoiPixel(qoi, pixels + offset + (size_t)column * CAPTURE_READ_CHANNELS, out);
+			}
+			UFlushQoiRun(qoi, out);
+
+			uint32_t tile[2] = { (uint32_t)(tileY * tilesX + tileX), (uint32_t)(out.size() - start - sizeof(tile)) };
+			memcpy(out.data() + start, tile, sizeof(tile));
+			++changed;
+		}
+	}
+	return changed;
+}
+
+//Client side: the picture so far (RGB, top row first)
+struct TileDecoder {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> image;
+};
+
+//Decodes one tile's QOI operations into a columns x rows region of the image; false if they do not fill it exactly
+bool UDecodeQoiTile(const unsigned char* data, size_t size, unsigned char* region, size_t stride, int columns, int rows) {
+	unsigned char index[64][3] = {};
+	unsigned char pixel[3] = { 0, 0, 0 };
+	const unsigned char* end = data + size;
+	int run = 0;
+	for (int row = 0; row < rows; ++row) {
+		unsigned char* target = region + (size_t)row * stride;
+		for (int column = 0; column < columns; ++column, target += 3) {
+			if (run > 0) {
+				--run;
+				memcpy(target, pixel, 3);
+				continue;
+			}
+			if (data == end)
+				return false;
+
+			unsigned char op = *data++;
+			if (op == 0xFE) {
+				if (end - data < 3)
+					return false;
+				memcpy(pixel, data, 3);
+				data += 3;
+			}
+			else if ((op & 0xC0) == 0x00) {
+				memcpy(pixel, index[op], 3);
+			}
+			else if ((op & 0xC0) == 0x40) {
+				pixel[0] += ((op >> 4) & 3) - 2;
+				pixel[1] += ((op >> 2) & 3) - 2;
+				pixel[2] += (op & 3) - 2;
+			}
+			else if ((op & 0xC0) == 0x80) {
+				if (data == end)
+					return false;
+				int dg = (op & 0x3F) - 32;
+				pixel[0] += dg - 8 + (*data >> 4);
+				pixel[1] += dg;
+				pixel[2] += dg - 8 + (*data & 0x0F);
+				++data;
+			}
+			else {
+				run = op & 0x3F;
+			}
+			memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64], pixel, 3);
+			memcpy(target, pixel, 3);
+		}
+	}
+	return run == 0 && data == end;
+}
+
+//Applies a frame's tiles to the client's picture; false if the message is malformed
+bool UDecodeTileDiff(TileDecoder& decoder, const FrameHeader& frame, const unsigned char* tiles, size_t size) {
+	if (frame.tileSize == 0 || frame.width == 0 || frame.height == 0 || frame.width > FRAME_MAX_SIZE || frame.height > FRAME_MAX_SIZE)
+		return false;
+	if (decoder.width != (int)frame.width || decoder.height != (int)frame.height) {
+		decoder.width = (int)frame.width;
+		decoder.height = (int)frame.height;
+		decoder.image.assign((size_t)frame.width * frame.height * 3, 0);
+	}
+
+	const uint32_t tilesX = (frame.width + frame.tileSize - 1) / frame.tileSize;
+	const uint32_t tilesY = (frame.height + frame.tileSize - 1) / frame.tileSize;
+	const unsigned char* end = tiles + size;
+	for (uint32_t i = 0; i < frame.changedTiles; ++i) {
+		uint32_t tile[2];
+		if ((size_t)(end - tiles) < sizeof(tile))
+			return false;
+		memcpy(tile, tiles, sizeof(tile));
+		tiles += sizeof(tile);
+		if (tile[0] >= tilesX * tilesY || tile[1] > (size_t)(end - tiles))
+			return false;
+
+		uint32_t left = tile[0] % tilesX * frame.tileSize;
+		uint32_t top = tile[0] / tilesX * frame.tileSize;
+		int columns = (int)std::min(frame.tileSize, frame.width - left);
+		int rows = (int)std::min(frame.tileSize, frame.height - top);
+		unsigned char* region = decoder.image.data() + ((size_t)top * frame.width + left) * 3;
+		if (!UDecodeQoiTile(tiles, tile[1], region, (size_t)frame.width * 3, columns, rows))
+			return false;
+		tiles += tile[1];
+	}
+	return tiles == end;
+}
+
+#endif
@@ -0,0 +1,433 @@
+#ifndef HOTRELOAD_H
+#define HOTRELOAD_H
+
+/*Live hot-reload of shaders, textures, and meshes
+* A watcher thread owns a hidden GL context that shares objects with the main window. When a watched file is
+* saved it rebuilds the resource on that context into new GL objects, fences them, and queues the result.
+* The render loop swaps the new object in once its fence has signaled, so it never waits on a compile or upload.
+* Shader programs are only swapped after a successful link; a failed build keeps the current program.
+* Change detection uses inotify on Linux and polls modification times elsewhere.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <limits.h>
+#include <stdlib.h>
+#endif
+
+#include "Logger.h"
+
+//Defined in Source.cpp
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programID);
+bool UUploadTexture(const unsigned char* image, int width, int height, int channels, GLuint& textureId);
+void flipImageVertically(unsigned char* image, int width, int height, int channels);
+
+enum ReloadKind {
+	RELOAD_SHADER,
+	RELOAD_TEXTURE,
+	RELOAD_MESH
+};
+
+struct ReloadTarget {
+	ReloadKind kind;
+	std::string label;
+	std::vector<std::string> files;			//Resolved paths (vertex + fragment for shaders)
+	GLuint* handle = nullptr;				//Program or texture swapped by the render loop
+
+	//Meshes: the buffers are replaced; draws read the names through these pointers
+	GLuint* vertexBuffer = nullptr;
+	GLuint* indexBuffer = nullptr;
+	GLuint* indexCount = nullptr;
+};
+
+//A rebuilt resource waiting for its fence before the render loop swaps it in
+struct ReloadResult {
+	int target;
+	GLuint object = 0;						//Program, texture, or vertex buffer
+	GLuint indexBuffer = 0;
+	GLuint indexCount = 0;
+	GLsync fence = 0;
+	std::chrono::steady_clock::time_point changedAt;
+};
+
+struct HotReloader {
+	GLFWwindow* context = nullptr;			//Hidden window sharing objects with the main context
+	std::thread thread;
+	std::atomic<bool> stopping{ false };
+
+	std::vector<ReloadTarget> targets;
+	std::unordered_map<std::string, std::vector<int>> fileTargets;		//Canonical path -> targets
+
+	std::mutex mutex;
+	std::vector<ReloadResult> completed;
+
+	//Swapped this frame, reported once the next frame is presented
+	std::vector<ReloadResult> presented;
+};
+
+//-----------------------------------REGISTRATION-------------------------------------
+std::string UCanonicalPath(const std::string& path) {
+#ifdef __linux__
+	char resolved[PATH_MAX];
+	if (realpath(path.c_str(), resolved))
+		return resolved;
+#endif
+	return path;
+}
+
+//Returns false if a file cannot be found on disk (packed-only assets are not watched)
+bool UAddReloadTarget(HotReloader& reloader, ReloadTarget target, const std::vector<const char*>& assetNames) {
+	for (const char* name : assetNames) {
+		std::string path;
+		if (!UResolveAssetPath(name, path))
+			return false;
+		target.files.push_back(UCanonicalPath(path));
+	}
+
+	int index = (int)reloader.targets.size();
+	for (const std::string& file : target.files)
+		reloader.fileTargets[file].push_back(index);
+	reloader.targets.push_back(target);
+	return true;
+}
+
+void UWatchShader(HotReloader& reloader, const char* label, const char* vertexName, const char* fragmentName, GLuint& program) {
+	ReloadTarget target;
+	target.kind = RELOAD_SHADER;
+	target.label = label;
+	target.handle = &program;
+	UAddReloadTarget(reloader, target, { vertexName, fragmentName });
+}
+
+void UWatchTexture(HotReloader& reloader, const char* fileName, GLuint& texture) {
+	ReloadTarget target;
+	target.kind = RELOAD_TEXTURE;
+	target.label = fileName;
+	target.handle = &texture;
+	UAddReloadTarget(reloader, target, { fileName });
+}
+
+//Watches "<name>.mesh", or "<name>.obj" converted on load
+void UWatchMesh(HotReloader& reloader, const std::string& name, GLuint& vertexBuffer, GLuint& indexBuffer, GLuint& indexCount) {
+	ReloadTarget target;
+	target.kind = RELOAD_MESH;
+	target.label = name;
+	target.vertexBuffer = &vertexBuffer;
+	target.indexBuffer = &indexBuffer;
+	target.indexCount = &indexCount;
+
+	std::string meshName = name + ".mesh";
+	std::string objName = name + ".obj";
+	if (!UAddReloadTarget(reloader, target, { meshName.c_str() }))
+		UAddReloadTarget(reloader, target, { objName.c_str() });
+}
+
+//-----------------------------------REBUILD (watcher thread)-------------------------
+bool URebuildShader(const ReloadTarget& target, ReloadResult& result) {
+	std::vector<unsigned char> vertexSource, fragmentSource;
+	if (!UReadFile(target.files[0], vertexSource) || !UReadFile(target.files[1], fragmentSource))
+		return false;
+	vertexSource.push_back('\0');
+	fragmentSource.push_back('\0');
+
+	GLuint program = 0;
+	if (!UCreateShaderProgram((const char*)vertexSource.data(), (const char*)fragmentSource.data(), program))
+		return false;
+
+	//Program uniforms are shared state, so the sampler binding carries over to the render context
+	glUniform1i(glGetUniformLocation(program, "Texture"), 0);
+	result.object = program;
+	return true;
+}
+
+bool URebuildTexture(const ReloadTarget& target, ReloadResult& result) {
+	std::vector<unsigned char> bytes;
+	if (!UReadFile(target.files[0], bytes))
+		return false;
+
+	int width, height, channels;
+	unsigned char* image = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 0);
+	if (!image)
+		return false;
+
+	flipImageVertically(image, width, height, channels);
+	GLuint texture = 0;
+	bool uploaded = UUploadTexture(image, width, height, channels, texture);
+	stbi_image_free(image);
+
+	result.object = texture;
+	return uploaded;
+}
+
+bool URebuildMesh(const ReloadTarget& target, ReloadResult& result) {
+	std::vector<unsigned char> blob;
+	if (!UReadFile(target.files[0], blob))
+		return false;
+
+	if (UEndsWith(UNormalizeAssetName(target.files[0]), ".obj")) {
+		std::vector<unsigned char> text;
+		text.swap(blob);
+		if (!UImportObj(text, blob))
+			return false;
+	}
+
+	MeshBlobHeader header;
+	if (blob.size() < sizeof(header))
+		return false;
+	memcpy(&header, blob.data(), sizeof(header));
+
+	size_t vertexBytes = (size_t)header.vertexCount * header.floatsPerVertex * sizeof(float);
+	size_t indexBytes = (size_t)header.indexCount * header.indexSize;
+	if (header.floatsPerVertex != 12 || header.indexSize != sizeof(GLushort) || sizeof(header) + vertexBytes + indexBytes > blob.size()) {
+		LOG_ERROR("ERROR::RELOAD::MESH_LAYOUT_MISMATCH %s", target.label.c_str());
+		return false;
+	}
+
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, blob.data() + sizeof(header), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ARRAY_BUFFER, indexBytes, blob.data() + sizeof(header) + vertexBytes, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	result.object = buffers[0];
+	result.indexBuffer = buffers[1];
+	result.indexCount = header.indexCount;
+	return true;
+}
+
+void URebuildTarget(HotReloader& reloader, int index, std::chrono::steady_clock::time_point changedAt) {
+	const ReloadTarget& target = reloader.targets[index];
+	ReloadResult result;
+	result.target = index;
+	result.changedAt = changedAt;
+
+	bool rebuilt = false;
+	switch (target.kind) {
+	case RELOAD_SHADER: rebuilt = URebuildShader(target, result); break;
+	case RELOAD_TEXTURE: rebuilt = URebuildTexture(target, result); break;
+	case RELOAD_MESH: rebuilt = URebuildMesh(target, result); break;
+	}
+
+	if (!rebuilt) {
+		LOG_ERROR("ERROR::RELOAD::FAILED %s (keeping current version)", target.label.c_str());
+		return;
+	}
+
+	//The render context must not use the objects before this context's commands complete
+	result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	{
+		std::lock_guard<std::mutex> lock(reloader.mutex);
+		reloader.completed.push_back(result);
+	}
+
+	//Wakes a main loop that is idling in the event wait (render on demand)
+	glfwPostEmptyEvent();
+}
+
+//-----------------------------------WATCHER THREAD-----------------------------------
+void URebuildChanged(HotReloader& reloader, const std::set<std::string>& changedFiles, std::chrono::steady_clock::time_point changedAt) {
+	std::set<int> changedTargets;
+	for (const std::string& file : changedFiles) {
+		auto found = reloader.fileTargets.find(file);
+		if (found != reloader.fileTargets.end())
+			changedTargets.insert(found->second.begin(), found->second.end());
+	}
+	for (int index : changedTargets)
+		URebuildTarget(reloader, index, changedAt);
+}
+
+void UHotReloadThread(HotReloader* reloader) {
+	glfwMakeContextCurrent(reloader->context);
+
+#ifdef __linux__
+	//Watch directories rather than files: most editors save by renaming a temporary file over the original
+	int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	std::unordered_map<int, std::string> watchedDirs;
+	std::set<std::string> dirs;
+	for (const auto& entry : reloader->fileTargets)
+		dirs.insert(entry.first.substr(0, entry.first.find_last_of('/')));
+	for (const std::string& dir : dirs) {
+		int watch = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (watch >= 0)
+			watchedDirs[watch] = dir;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while (!reloader->stopping) {
+		pollfd descriptor = { inotifyFd, POLLIN, 0 };
+		if (poll(&descriptor, 1, 100) <= 0)
+			continue;
+
+		auto changedAt = std::chrono::steady_clock::now();
+		std::set<std::string> changedFiles;
+
+		//Coalesce the burst of events a single save produces
+		auto settle = changedAt + std::chrono::milliseconds(30);
+		do {
+			ssize_t length;
+			while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+				for (char* cursor = buffer; cursor < buffer + length;) {
+					inotify_event* event = (inotify_event*)cursor;
+					if (event->len > 0 && watchedDirs.count(event->wd))
+						changedFiles.insert(watchedDirs[event->wd] + "/" + event->name);
+					cursor += sizeof(inotify_event) + event->len;
+				}
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		} while (std::chrono::steady_clock::now() < settle);
+
+		URebuildChanged(*reloader, changedFiles, changedAt);
+	}
+	close(inotifyFd);
+#else
+	//Portable fallback: poll modification times
+	std::unordered_map<std::string, time_t> modified;
+	for (const auto& entry : reloader->fileTargets) {
+		struct stat info;
+		modified[entry.first] = stat(entry.first.c_str(), &info) == 0 ? info.st_mtime : 0;
+	}
+
+	while (!reloader->stopping) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+		std::set<std::string> changedFiles;
+		for (auto& entry : modified) {
+			struct stat info;
+			if (stat(entry.first.c_str(), &info) == 0 && info.st_mtime != entry.second) {
+				entry.second = info.st_mtime;
+				changedFiles.insert(entry.first);
+			}
+		}
+		if (!changedFiles.empty())
+			URebuildChanged(*reloader, changedFiles, std::chrono::steady_clock::now());
+	}
+#endif
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+//-----------------------------------RENDER LOOP SIDE---------------------------------
+//Creates the shared context on the main thread (GLFW requirement) and starts watching
+//Creates the hidden shared context the watcher builds on (GLFW windows must be created on the main thread)
+bool UCreateHotReloadContext(HotReloader& reloader, GLFWwindow* mainWindow) {
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	reloader.context = glfwCreateWindow(1, 1, "reload", NULL, mainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!reloader.context) {
+		LOG_ERROR("ERROR::RELOAD::CONTEXT_CREATION_FAILED");
+		return false;
+	}
+	return true;
+}
+
+//Starts watching the registered targets; callable from any thread once the context exists
+bool UStartHotReload(HotReloader& reloader) {
+	if (reloader.targets.empty() || !reloader.context)
+		return false;
+
+	LOG_INFO("INFO: Hot reload watching %zu files", reloader.fileTargets.size());
+	reloader.thread = std::thread(UHotReloadThread, &reloader);
+	return true;
+}
+
+//True while rebuilt resources are waiting to be swapped in by a frame
+bool UHotReloadPending(HotReloader& reloader) {
+	std::lock_guard<std::mutex> lock(reloader.mutex);
+	return !reloader.completed.empty();
+}
+
+//Swaps in every rebuilt resource whose fence has signaled; never blocks
+void UApplyHotReloads(HotReloader& reloader) {
+	std::vector<ReloadResult> ready;
+	{
+		std::lock_guard<std::mutex> lock(reloader.mutex);
+		for (size_t i = 0; i < reloader.completed.size();) {
+			GLenum status = glClientWaitSync(reloader.completed[i].fence, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+				ready.push_back(reloader.completed[i]);
+				reloader.completed.erase(reloader.completed.begin() + i);
+			}
+			else {
+				++i;
+			}
+		}
+	}
+
+	for (ReloadResult& result : ready) {
+		glDeleteSync(result.fence);
+		const ReloadTarget& target = reloader.targets[result.target];
+
+		switch (target.kind) {
+		case RELOAD_SHADER:
+			glDeleteProgram(*target.handle);
+			*target.handle = result.object;
+			break;
+
+		case RELOAD_TEXTURE:
+			if (*target.handle)
+				glDeleteTextures(1, target.handle);
+			*target.handle = result.object;
+			break;
+
+		case RELOAD_MESH: {
+			//The shared vertex array is pointed at a mesh's buffers on every draw, so swapping the names is enough
+			GLuint old[2] = { *target.vertexBuffer, *target.indexBuffer };
+			glDeleteBuffers(2, old);
+			*target.vertexBuffer = result.object;
+			*target.indexBuffer = result.indexBuffer;
+			*target.indexCount = result.indexCount;
+			break;
+		}
+		}
+
+		reloader.presented.push_back(result);
+	}
+}
+
+//Call after the frame is presented: logs save-to-visible-frame latency of the resources swapped in for it
+void UReportHotReloadLatency(HotReloader& reloader) {
+	auto now = std::chrono::steady_clock::now();
+	for (const ReloadResult& result : reloader.presented) {
+		double latencyMs = std::chrono::duration<double, std::milli>(now - result.changedAt).count();
+		LOG_INFO("INFO: Reloaded %s in %.1f ms (save to visible frame)", reloader.targets[result.target].label.c_str(), latencyMs);
+	}
+	reloader.presented.clear();
+}
+
+//Stops the watcher and drops unapplied results (GL thread)
+void UStopHotReload(HotReloader& reloader) {
+	reloader.stopping = true;
+	if (reloader.thread.joinable())
+		reloader.thread.join();
+
+	std::lock_guard<std::mutex> lock(reloader.mutex);
+	for (ReloadResult& result : reloader.completed)
+		glDeleteSync(result.fence);
+	reloader.completed.clear();
+}
+
+//Main thread, after UStopHotReload
+void UDestroyHotReloadContext(HotReloader& reloader) {
+	if (reloader.context)
+		glfwDestroyWindow(reloader.context);
+	reloader.context = nullptr;
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef INDIRECTSHADE_H
+#define INDIRECTSHADE_H
+
+//The lit shader for the indirect render device: the same lighting as scene.vert/scene.frag, with the per-draw data
+//fetched by draw slot instead of bound per draw
+
+
+const char* indirectVertexShaderSource = "#version 440 core\n"
+
+"layout (location = 0) in vec3 aPos;\n"						//Vertex Position Data
+"layout (location = 2) in vec2 textureCoordinate;\n"		//Texture Position Data
+"layout (location = 3) in vec3 normal;\n"					//Normals Position Data
+"layout (location = 4) in vec2 lightmapCoordinate;\n"		//Baked lightmap position (0 without a bake)
+"layout (location = 5) in uint drawSlot;\n"					//Per instance: the draw command's base instance
+
+"out vec3 vertexNormal;\n"
+"out vec3 vertexFragmentPos;\n"
+"out vec2 vertexTextureCoordinate;\n"						//Already scaled by the object's uvScale
+"out vec2 vertexLightmapCoordinate;\n"
+"flat out uint vertexMaterial;\n"							//Descriptor indices, the same for every vertex of a draw
+"flat out uint vertexLightmap;\n"
+
+//Object blocks as the recorders wrote them into the ring buffer (std140 ObjectBlock), objectStride vec4s apart
+"layout (std430, binding = 3) readonly buffer ObjectBlocks { vec4 objectData[]; };\n"
+"layout (std430, binding = 4) readonly buffer DrawDescriptors { uvec2 descriptors[]; };\n"	//Material, lightmap
+"uniform uint objectBase;\n"
+"uniform uint objectStride;\n"
+
+//Per-frame camera and light, written once per frame into the ring buffer
+"layout (std140, binding = 1) uniform FrameBlock\n"
+"{\n"
+"	mat4 view;\n"
+"	mat4 projection;\n"
+"	vec3 objectColor;\n"
+"	float specIntensity;\n"
+"	vec3 lightColor;\n"
+"	vec3 lightPos;\n"
+"	vec3 viewPosition;\n"
+"	float shadowFarPlane;\n"
+"	vec4 shadowFaceLights[6];\n"
+"};\n"
+
+"void main()\n"
+"{\n"
+
+"	uint base = objectBase + drawSlot * objectStride;\n"
+"	mat4 model = mat4(objectData[base], objectData[base + 1], objectData[base + 2], objectData[base + 3]);\n"
+"	mat3 normalMatrix = mat3(objectData[base + 4].xyz, objectData[base + 5].xyz, objectData[base + 6].xyz);\n"
+"	vec2 uvScale = objectData[base + 8].xy;\n"
+
+"	gl_Position = projection * view * model * vec4(aPos, 1.0f);\n"
+"	vertexFragmentPos = vec3(model * vec4(aPos, 1.0f));\n"
+"	vertexNormal = normalMatrix * normal;\n"
+"	vertexTextureCoordinate = textureCoordinate * uvScale;\n"
+"	vertexLightmapCoordinate = lightmapCoordinate;\n"
+"	vertexMaterial = descriptors[drawSlot].x;\n"
+"	vertexLightmap = descriptors[drawSlot].y;\n"
+"}\0";
+
+
+const char* indirectFragmentShaderSource = "#version 440 core\n"
+
+"in vec3 vertexNormal;\n"
+"in vec3 vertexFragmentPos;\n"
+"in vec2 vertexTextureCoordinate;\n"
+"in vec2 vertexLightmapCoordinate;\n"
+"flat in uint vertexMaterial;\n"
+"flat in uint vertexLightmap;\n"
+
+"out vec4 FragColor;\n"
+
+//Descriptor tables, bound once per frame
+"layout (binding = 1) uniform samplerCube shadowMap;\n"
+"layout (binding = 3) uniform sampler2D materials[4];\n"
+"layout (binding = 7) uniform sampler2D lightmaps[8];\n"
+
+"layout (std140, binding = 1) uniform FrameBlock\n"
+"{\n"
+"	mat4 view;\n"
+"	mat4 projection;\n"
+"	vec3 objectColor;\n"
+"	float specIntensity;\n"
+"	vec3 lightColor;\n"
+"	vec3 lightPos;\n"
+"	vec3 viewPosition;\n"
+"	float shadowFarPlane;\n"
+"	vec4 shadowFaceLights[6];\n"
+"};\n"
+
+//Descriptor lookups. Constant indices select the table entry: a computed index into a sampler array is only
+//defined when it is the same across the invocations of a draw, which compilers cannot see through a varying.
+"vec4 materialColor(uint index, vec2 uv)\n"
+"{\n"
+"	switch (index) {\n"
+"	case 1u: return texture(materials[1], uv);\n"
+"	case 2u: return texture(materials[2], uv);\n"
+"	case 3u: return texture(materials[3], uv);\n"
+"	default: return texture(materials[0], uv);\n"
+"	}\n"
+"}\n"
+
+"vec3 lightmapColor(uint index, vec2 uv)\n"
+"{\n"
+"	switch (index) {\n"
+"	case 1u: return texture(lightmaps[1], uv).rgb;\n"
+"	case 2u: return texture(lightmaps[2], uv).rgb;\n"
+"	case 3u: return texture(lightmaps[3], uv).rgb;\n"
+"	case 4u: return texture(lightmaps[4], uv).rgb;\n"
+"	case 5u: return texture(lightmaps[5], uv).rgb;\n"
+"	case 6u: return texture(lightmaps[6], uv).rgb;\n"
+"	case 7u: return texture(lightmaps[7], uv).rgb;\n"
+"	default: return texture(lightmaps[0], uv).rgb;\n"
+"	}\n"
+"}\n"
+
+//As in scene.frag
+"float keyLightShadow(vec3 norm, vec3 lightDirection)\n"
+"{\n"
+"	if (shadowFarPlane <= 0.0f)\n"
+"		return 1.0f;\n"
+"	vec3 fromLight = vertexFragmentPos - lightPos;\n"
+"	vec3 axis = abs(fromLight);\n"
+"	int face = axis.x >= axis.y && axis.x >= axis.z ? (fromLight.x > 0.0f ? 0 : 1) : (axis.y >= axis.z ? (fromLight.y > 0.0f ? 2 : 3) : (fromLight.z > 0.0f ? 4 : 5));\n"
+"	vec3 toFragment = vertexFragmentPos - shadowFaceLights[face].xyz;\n"
+"	float distance = length(toFragment);\n"
+"	if (distance >= shadowFarPlane)\n"
+"		return 1.0f;\n"
+"	float closest = texture(shadowMap, toFragment).r * shadowFarPlane;\n"
+"	float bias = 0.02f + 0.05f * (1.0f - max(dot(norm, lightDirection), 0.0f));\n"
+"	return distance - bias > closest ? 0.0f : 1.0f;\n"
+"}\n"
+
+"void main()\n"
+"{\n"
+
+"	vec3 ambient = lightmapColor(vertexLightmap, vertexLightmapCoordinate) * lightColor;\n"
+
+"	vec3 norm = normalize(vertexNormal);\n"
+"	vec3 lightDirection = normalize(lightPos - vertexFragmentPos);\n"
+"	float impact = max(dot(norm, lightDirection), 0.0);\n"
+"	vec3 diffuse = impact * lightColor;\n"
+
+"	vec3 viewDir = normalize(viewPosition - vertexFragmentPos);\n"
+"	vec3 reflectDir = reflect(-lightDirection, norm);\n"
+"	float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), 16.0f);\n"
+"	vec3 specular = specIntensity * specularComponent * lightColor;\n"
+
+"	vec4 textureColor = materialColor(vertexMaterial, vertexTextureCoordinate);\n"
+
+"	float shadow = keyLightShadow(norm, lightDirection);\n"
+"	vec3 phong = (ambient + shadow * (diffuse + specular)) * textureColor.xyz;\n"
+
+"	FragColor = vec4(phong, 1.0);\n"
+"}\0";
+
+#endif
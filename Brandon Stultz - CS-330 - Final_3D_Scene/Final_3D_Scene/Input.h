@@ -0,0 +1,289 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+/*Buffered input events and action mapping
+* GLFW callbacks only append a timestamped event to the queue; nothing reacts to input inside glfwPollEvents.
+* Once per simulation step, UConsumeInput drains the events up to the step's end in order, maps keys to actions through a binding
+* table, and integrates for how long each action was held within the step, so movement depends on elapsed
+* time rather than on how often input is sampled. Cursor and scroll motion is accumulated the same way. A left click
+* is kept with the cursor position it happened at, so it can be resolved against the scene (object picking).
+*
+* Consumed events can be written to a file (--record-input) and fed back later in place of the callbacks
+* (--replay-input), which gives benchmarks a repeatable camera path. Times are relative to the recording start.
+*/
+
+#include <cstdio>
+#include <vector>
+
+#include "Logger.h"
+
+enum InputEventType {
+	INPUT_KEY,
+	INPUT_CURSOR,
+	INPUT_SCROLL,
+	INPUT_BUTTON
+};
+
+struct InputEvent {
+	InputEventType type;
+	double time;			//glfwGetTime() when delivered
+	int key;				//INPUT_KEY; INPUT_BUTTON: the mouse button
+	int action;				//INPUT_KEY, INPUT_BUTTON: GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT
+	double x;				//INPUT_CURSOR, INPUT_BUTTON: position; INPUT_SCROLL: offset
+	double y;
+};
+
+enum InputAction {
+	ACTION_MOVE_FORWARD,
+	ACTION_MOVE_BACKWARD,
+	ACTION_MOVE_LEFT,
+	ACTION_MOVE_RIGHT,
+	ACTION_MOVE_UP,
+	ACTION_MOVE_DOWN,
+	ACTION_TOGGLE_LAMP_ORBIT,
+	ACTION_QUIT,
+	ACTION_COUNT
+};
+
+struct ActionBinding {
+	int key;
+	InputAction action;
+};
+
+const ActionBinding DEFAULT_BINDINGS[] = {
+	{ GLFW_KEY_W, ACTION_MOVE_FORWARD },
+	{ GLFW_KEY_S, ACTION_MOVE_BACKWARD },
+	{ GLFW_KEY_A, ACTION_MOVE_LEFT },
+	{ GLFW_KEY_D, ACTION_MOVE_RIGHT },
+	{ GLFW_KEY_Q, ACTION_MOVE_UP },
+	{ GLFW_KEY_E, ACTION_MOVE_DOWN },
+	{ GLFW_KEY_L, ACTION_TOGGLE_LAMP_ORBIT },
+	{ GLFW_KEY_ESCAPE, ACTION_QUIT },
+};
+
+//Events beyond this per step are dropped; the buffer never reallocates
+const size_t INPUT_QUEUE_CAPACITY = 1024;
+
+struct InputSystem {
+	std::vector<InputEvent> queue;
+	size_t dropped = 0;
+
+	const ActionBinding* bindings = DEFAULT_BINDINGS;
+	size_t bindingCount = sizeof(DEFAULT_BINDINGS) / sizeof(DEFAULT_BINDINGS[0]);
+
+	//Action state carried between steps
+	bool held[ACTION_COUNT] = {};
+	double heldSince[ACTION_COUNT] = {};
+	double stepStart = 0.0;
+
+	//Cursor tracking for look deltas
+	bool haveCursor = false;
+	double cursorX = 0.0;
+	double cursorY = 0.0;
+
+	//Results of the last UConsumeInput
+	float heldSeconds[ACTION_COUNT] = {};
+	bool pressed[ACTION_COUNT] = {};
+	float lookX = 0.0f;
+	float lookY = 0.0f;
+	float scroll = 0.0f;
+	bool clicked = false;			//Left button pressed during the step
+	double clickX = 0.0;			//Where the cursor was, in window coordinates
+	double clickY = 0.0;
+
+	//Recording and replay
+	FILE* recording = nullptr;
+	double timeOrigin = 0.0;
+	std::vector<InputEvent> replay;
+	size_t replayNext = 0;
+	bool replaying = false;
+};
+
+void UCreateInput(InputSystem& input, double now) {
+	input.queue.reserve(INPUT_QUEUE_CAPACITY);
+	input.stepStart = now;
+	input.timeOrigin = now;
+}
+
+//Callback side: appends one event. Live events are ignored while a recording is being replayed.
+void UPushInputEvent(InputSystem& input, const InputEvent& event, bool fromReplay = false) {
+	if (input.replaying && !fromReplay)
+		return;
+	if (input.queue.size() == INPUT_QUEUE_CAPACITY) {
+		++input.dropped;
+		return;
+	}
+	input.queue.push_back(event);
+}
+
+void UPushKeyEvent(InputSystem& input, double time, int key, int action) {
+	InputEvent event = { INPUT_KEY, time, key, action, 0.0, 0.0 };
+	UPushInputEvent(input, event);
+}
+
+void UPushCursorEvent(InputSystem& input, double time, double x, double y) {
+	InputEvent event = { INPUT_CURSOR, time, 0, 0, x, y };
+	UPushInputEvent(input, event);
+}
+
+void UPushScrollEvent(InputSystem& input, double time, double xOffset, double yOffset) {
+	InputEvent event = { INPUT_SCROLL, time, 0, 0, xOffset, yOffset };
+	UPushInputEvent(input, event);
+}
+
+void UPushButtonEvent(InputSystem& input, double time, int button, int action, double x, double y) {
+	InputEvent event = { INPUT_BUTTON, time, button, action, x, y };
+	UPushInputEvent(input, event);
+}
+
+//--------------------------------------RECORDING-----------------------------------------
+//One event per line: time type key action x y
+bool UStartInputRecording(InputSystem& input, const char* path) {
+	input.recording = fopen(path, "w");
+	if (!input.recording) {
+		LOG_ERROR("ERROR::INPUT::RECORD_OPEN_FAILED %s", path);
+		return false;
+	}
+	LOG_INFO("INFO: Recording input to %s", path);
+	return true;
+}
+
+void URecordInputEvent(InputSystem& input, const InputEvent& event) {
+	fprintf(input.recording, "%.6f %d %d %d %.3f %.3f\n", event.time - input.timeOrigin, (int)event.type, event.key, event.action, event.x, event.y);
+}
+
+bool ULoadInputReplay(InputSystem& input, const char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		LOG_ERROR("ERROR::INPUT::REPLAY_OPEN_FAILED %s", path);
+		return false;
+	}
+
+	InputEvent event;
+	int type;
+	while (fscanf(file, "%lf %d %d %d %lf %lf", &event.time, &type, &event.key, &event.action, &event.x, &event.y) == 6) {
+		event.type = (InputEventType)type;
+		input.replay.push_back(event);
+	}
+	fclose(file);
+
+	input.replaying = true;
+	input.replayNext = 0;
+	LOG_INFO("INFO: Replaying %zu input events from %s", input.replay.size(), path);
+	return true;
+}
+
+//Queues the recorded events that are due by 'now'; returns false once the recording has run out
+bool UPumpInputReplay(InputSystem& input, double now) {
+	while (input.replayNext < input.replay.size() && input.replay[input.replayNext].time + input.timeOrigin <= now) {
+		InputEvent event = input.replay[input.replayNext++];
+		event.time += input.timeOrigin;
+		UPushInputEvent(input, event, true);
+	}
+	return input.replayNext < input.replay.size();
+}
+
+void UStopInput(InputSystem& input) {
+	if (input.recording)
+		fclose(input.recording);
+	input.recording = nullptr;
+}
+
+//True while events are queued or an action is held, so coming steps may still move something
+bool UInputActive(const InputSystem& input) {
+	if (!input.queue.empty())
+		return true;
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		if (input.held[i])
+			return true;
+	}
+	return false;
+}
+
+//---------------------------------------CONSUME------------------------------------------
+int UFindAction(const InputSystem& input, int key) {
+	for (size_t i = 0; i < input.bindingCount; ++i) {
+		if (input.bindings[i].key == key)
+			return input.bindings[i].action;
+	}
+	return -1;
+}
+
+//Drains the events delivered up to 'now' (the end of this simulation step) and updates the action results.
+//Later events stay queued for the step they fall in.
+void UConsumeInput(InputSystem& input, double now) {
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		input.heldSeconds[i] = 0.0f;
+		input.pressed[i] = false;
+	}
+	input.lookX = 0.0f;
+	input.lookY = 0.0f;
+	input.scroll = 0.0f;
+	input.clicked = false;
+
+	size_t consumed = 0;
+	for (; consumed < input.queue.size() && input.queue[consumed].time <= now; ++consumed) {
+		const InputEvent& event = input.queue[consumed];
+		if (input.recording)
+			URecordInputEvent(input, event);
+
+		double time = event.time < input.stepStart ? input.stepStart : event.time;
+		switch (event.type) {
+		case INPUT_KEY: {
+			int action = UFindAction(input, event.key);
+			if (action < 0 || event.action == GLFW_REPEAT)
+				break;
+
+			if (event.action == GLFW_PRESS && !input.held[action]) {
+				input.held[action] = true;
+				input.heldSince[action] = time;
+				input.pressed[action] = true;
+			}
+			else if (event.action == GLFW_RELEASE && input.held[action]) {
+				input.held[action] = false;
+				input.heldSeconds[action] += (float)(time - input.heldSince[action]);
+			}
+			break;
+		}
+
+		case INPUT_CURSOR:
+			if (input.haveCursor) {
+				input.lookX += (float)(event.x - input.cursorX);
+				input.lookY += (float)(input.cursorY - event.y); // Reversed since y-coordinate goes from bottom to top
+			}
+			input.haveCursor = true;
+			input.cursorX = event.x;
+			input.cursorY = event.y;
+			break;
+
+		case INPUT_SCROLL:
+			input.scroll += (float)event.y;
+			break;
+
+		case INPUT_BUTTON:
+			if (event.key == GLFW_MOUSE_BUTTON_LEFT && event.action == GLFW_PRESS) {
+				input.clicked = true;
+				input.clickX = event.x;
+				input.clickY = event.y;
+			}
+			break;
+		}
+	}
+	input.queue.erase(input.queue.begin(), input.queue.begin() + consumed);
+
+	//Actions still held count up to the end of the step and continue from there
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		if (input.held[i]) {
+			input.heldSeconds[i] += (float)(now - input.heldSince[i]);
+			input.heldSince[i] = now;
+		}
+	}
+	input.stepStart = now;
+
+	if (input.dropped > 0) {
+		LOG_WARN("WARN: %zu input events dropped (queue full)", input.dropped);
+		input.dropped = 0;
+	}
+}
+
+#endif
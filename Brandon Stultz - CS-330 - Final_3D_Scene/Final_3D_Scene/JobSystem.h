@@ -0,0 +1,320 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+/*Work-stealing job system for per-frame CPU work
+* Every participating thread (the thread that started the system plus N workers) owns a deque of runnable jobs.
+* The owner pushes and pops at the back, so it keeps working on what it just spawned while that data is still
+* in cache; idle threads steal from the front of another thread's deque, which holds the oldest (largest) work.
+* A job has finished once its own work and all of its children have finished. A job may also depend on other
+* jobs and is only queued once all of them have finished. Threads waiting on a job run other jobs meanwhile.
+* Jobs, their closures, and dependency links are allocated from a frame arena, so scheduling does not touch the
+* heap. UResetJobs destroys them once the frame's work has been waited on; the memory returns with the arena.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameArena.h"
+
+struct Job;
+
+struct JobLink {
+	Job* job;
+	JobLink* next;
+};
+
+struct Job {
+	//Type-erased closure living in the frame arena
+	void (*run)(void*) = nullptr;
+	void (*destroy)(void*) = nullptr;
+	void* closure = nullptr;
+
+	Job* parent = nullptr;
+	Job* nextCreated = nullptr;				//Every job of the frame, for UResetJobs
+	std::atomic<int> unfinished{ 1 };		//This job plus its unfinished children
+	std::atomic<int> waitingOn{ 1 };		//Unfinished dependencies, plus one released by USubmitJob
+	std::atomic<bool> done{ false };		//Set once finished; the job is not touched again afterwards
+
+	std::mutex dependentsMutex;
+	JobLink* dependents = nullptr;
+	bool finished = false;					//Guarded by dependentsMutex
+};
+
+//Double-ended ring of runnable jobs; storage only grows, so a steady frame never touches the heap
+struct JobQueue {
+	std::mutex mutex;
+	std::vector<Job*> jobs = std::vector<Job*>(256);
+	size_t front = 0;
+	size_t count = 0;
+};
+
+//Caller holds queue.mutex
+void UPushBack(JobQueue& queue, Job* job) {
+	if (queue.count == queue.jobs.size()) {
+		std::vector<Job*> grown(queue.jobs.size() * 2);
+		for (size_t i = 0; i < queue.count; ++i)
+			grown[i] = queue.jobs[(queue.front + i) % queue.jobs.size()];
+		queue.jobs.swap(grown);
+		queue.front = 0;
+	}
+	queue.jobs[(queue.front + queue.count) % queue.jobs.size()] = job;
+	++queue.count;
+}
+
+Job* UPopBack(JobQueue& queue) {
+	--queue.count;
+	return queue.jobs[(queue.front + queue.count) % queue.jobs.size()];
+}
+
+Job* UPopFront(JobQueue& queue) {
+	Job* job = queue.jobs[queue.front];
+	queue.front = (queue.front + 1) % queue.jobs.size();
+	--queue.count;
+	return job;
+}
+
+struct JobSystem {
+	std::vector<std::unique_ptr<JobQueue>> queues;	//[0] belongs to the thread that started the system
+	std::vector<std::thread> workers;
+
+	FrameArena* arena = nullptr;
+	std::atomic<Job*> created{ nullptr };
+
+	std::atomic<int> queued{ 0 };
+	std::atomic<int> running{ 0 };			//Threads inside URunJob; UResetJobs waits for the last ones to leave
+	std::atomic<uint64_t> steals{ 0 };
+	std::atomic<bool> stopping{ false };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+};
+
+//Deque owned by this thread; threads outside the system share queue 0
+thread_local size_t tJobQueue = 0;
+
+//Creates a job without work yet; with a parent, the parent does not finish until this job has
+Job* UAllocateJob(JobSystem& system, Job* parent = nullptr) {
+	Job* job = UArenaNew<Job>(*system.arena);
+	job->parent = parent;
+	if (parent)
+		parent->unfinished.fetch_add(1);
+
+	job->nextCreated = system.created.load(std::memory_order_relaxed);
+	while (!system.created.compare_exchange_weak(job->nextCreated, job)) {
+	}
+	return job;
+}
+
+//Moves 'work' into the arena as the job's closure; call before submitting the job
+template<class Work>
+void USetJobWork(JobSystem& system, Job* job, Work work) {
+	job->closure = UArenaNew<Work>(*system.arena, std::move(work));
+	job->run = [](void* closure) { (*(Work*)closure)(); };
+	job->destroy = [](void* closure) { ((Work*)closure)->~Work(); };
+}
+
+template<class Work>
+Job* UCreateJob(JobSystem& system, Work work, Job* parent = nullptr) {
+	Job* job = UAllocateJob(system, parent);
+	USetJobWork(system, job, std::move(work));
+	return job;
+}
+
+//'job' will not start until 'dependency' has finished; call before submitting 'job'
+void UAddDependency(JobSystem& system, Job* job, Job* dependency) {
+	std::lock_guard<std::mutex> lock(dependency->dependentsMutex);
+	if (dependency->finished)
+		return;
+	job->waitingOn.fetch_add(1);
+	dependency->dependents = UArenaNew<JobLink>(*system.arena, JobLink{ job, dependency->dependents });
+}
+
+void UPushJob(JobSystem& system, Job* job) {
+	JobQueue& queue = *system.queues[tJobQueue < system.queues.size() ? tJobQueue : 0];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		UPushBack(queue, job);
+	}
+	system.queued.fetch_add(1);
+
+	//Taking the sleep lock orders this push against a worker that is about to sleep
+	{
+		std::lock_guard<std::mutex> lock(system.sleepMutex);
+	}
+	system.wake.notify_one();
+}
+
+//Drops one of the job's outstanding dependencies; queues it when none are left
+void UReleaseJob(JobSystem& system, Job* job) {
+	if (job->waitingOn.fetch_sub(1) == 1)
+		UPushJob(system, job);
+}
+
+void USubmitJob(JobSystem& system, Job* job) {
+	UReleaseJob(system, job);
+}
+
+void UFinishJob(JobSystem& system, Job* job) {
+	if (job->unfinished.fetch_sub(1) != 1)
+		return;
+
+	Job* parent = job->parent;
+	JobLink* dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->dependentsMutex);
+		job->finished = true;
+		dependents = job->dependents;
+		job->dependents = nullptr;
+	}
+	//Last write to 'job': a waiter may go on as soon as this is visible
+	job->done.store(true, std::memory_order_release);
+
+	//The links stay valid because UResetJobs waits for this thread to leave URunJob
+	for (JobLink* link = dependents; link; link = link->next)
+		UReleaseJob(system, link->job);
+	if (parent)
+		UFinishJob(system, parent);
+}
+
+//Pops from this thread's deque, otherwise steals from the others; nullptr if there is no work
+Job* UTakeJob(JobSystem& system) {
+	size_t count = system.queues.size();
+	size_t self = tJobQueue < count ? tJobQueue : 0;
+
+	{
+		JobQueue& own = *system.queues[self];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.count > 0) {
+			Job* job = UPopBack(own);
+			system.queued.fetch_sub(1);
+			return job;
+		}
+	}
+
+	for (size_t i = 1; i < count; ++i) {
+		JobQueue& victim = *system.queues[(self + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.count > 0) {
+			Job* job = UPopFront(victim);
+			system.queued.fetch_sub(1);
+			system.steals.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void URunJob(JobSystem& system, Job* job) {
+	system.running.fetch_add(1);
+	if (job->run)
+		job->run(job->closure);
+	UFinishJob(system, job);
+	system.running.fetch_sub(1, std::memory_order_release);
+}
+
+void UJobWorker(JobSystem* system, size_t index) {
+	tJobQueue = index;
+
+	//Workers only ever run frame work
+	FrameScope frameScope;
+	while (true) {
+		if (Job* job = UTakeJob(*system)) {
+			URunJob(*system, job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(system->sleepMutex);
+		system->wake.wait(lock, [system] { return system->queued > 0 || system->stopping; });
+		if (system->stopping)
+			return;
+	}
+}
+
+//Runs other jobs on the calling thread until 'job' has finished
+void UWaitForJob(JobSystem& system, Job* job) {
+	while (!job->done.load(std::memory_order_acquire)) {
+		if (Job* other = UTakeJob(system))
+			URunJob(system, other);
+		else
+			std::this_thread::yield();
+	}
+}
+
+//The calling thread becomes participant 0; workerCount may be 0 (everything runs inside UWaitForJob).
+//Jobs are allocated from 'arena', which must not be reset while any job is alive.
+void UStartJobSystem(JobSystem& system, unsigned workerCount, FrameArena& arena) {
+	system.arena = &arena;
+	for (unsigned i = 0; i <= workerCount; ++i)
+		system.queues.emplace_back(new JobQueue());
+	for (unsigned i = 1; i <= workerCount; ++i)
+		system.workers.emplace_back(UJobWorker, &system, (size_t)i);
+}
+
+//Destroys every job; only valid once all of them have finished. Their memory is released with the arena.
+void UResetJobs(JobSystem& system) {
+	//A thread may still be releasing dependents of a job that finished before the one that was waited on
+	while (system.running.load(std::memory_order_acquire) > 0)
+		std::this_thread::yield();
+
+	Job* job = system.created.exchange(nullptr);
+	while (job) {
+		Job* next = job->nextCreated;
+		if (job->destroy)
+			job->destroy(job->closure);
+		job->~Job();
+		job = next;
+	}
+}
+
+void UStopJobSystem(JobSystem& system) {
+	{
+		std::lock_guard<std::mutex> lock(system.sleepMutex);
+		system.stopping = true;
+	}
+	system.wake.notify_all();
+	for (std::thread& worker : system.workers)
+		worker.join();
+	system.workers.clear();
+	UResetJobs(system);
+}
+
+unsigned UJobThreadCount(const JobSystem& system) {
+	return (unsigned)system.queues.size();
+}
+
+//Runs body(begin, end) over [0, count) in chunks of 'grain' items, once 'dependencies' have finished.
+//The returned job is already submitted; it finishes after the last chunk. Ranges no larger than one
+//chunk run inline, so small inputs cost a single job.
+template<class Body>
+Job* UParallelFor(JobSystem& system, size_t count, size_t grain, Body body, std::initializer_list<Job*> dependencies = {}) {
+	if (grain == 0)
+		grain = 1;
+
+	Job* root = UAllocateJob(system);
+	USetJobWork(system, root, [&system, root, count, grain, body] {
+		if (count <= grain) {
+			body(0, count);
+			return;
+		}
+
+		//The body lives in this job's closure until UResetJobs, so the chunks can share it
+		const Body* sharedBody = &body;
+		for (size_t begin = 0; begin < count; begin += grain) {
+			size_t end = std::min(count, begin + grain);
+			USubmitJob(system, UCreateJob(system, [sharedBody, begin, end] { (*sharedBody)(begin, end); }, root));
+		}
+	});
+
+	for (Job* dependency : dependencies)
+		UAddDependency(system, root, dependency);
+	USubmitJob(system, root);
+	return root;
+}
+
+#endif
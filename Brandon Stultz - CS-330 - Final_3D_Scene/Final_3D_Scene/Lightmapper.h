@@ -0,0 +1,767 @@
+#ifndef LIGHTMAPPER_H
+#define LIGHTMAPPER_H
+
+/*Offline lightmap baker
+* --bake-lightmaps bakes the static lighting of each scene object into its own lightmap file:
+*   1. Charts: triangles that share vertices form a chart (every face of these meshes has its own vertices). Each
+*      chart is projected onto the plane of its normal and shelf packed into the object's lightmap, which gives
+*      every mesh vertex one lightmap coordinate.
+*   2. Texels: the charts are rasterized into the lightmap, giving each covered texel a world position and normal.
+*   3. A binned SAH BVH is built over every triangle of the scene in world space.
+*   4. Texels are path traced in parallel on the job system. Rays are traced four at a time as packets: a texel's
+*      four paths start at the same point and mostly visit the same nodes, so each box and triangle test covers all
+*      four rays with one set of SSE instructions.
+*   5. Uncovered texels next to covered ones are filled in, so bilinear filtering never reads unbaked texels.
+* A lightmap holds the ambient term of the lit shader: a sky of the old constant ambient radiance, occluded and
+* bounced around the desk (tinted by each surface's average texture color), plus the bounce light of any static
+* point lights. Direct light stays in the shader. Paths are seeded per texel, so the result does not depend on the
+* thread count.
+*
+* At runtime each object's lightmap is a texture and its coordinates a vertex buffer of their own, bound beside the
+* mesh's vertices when the object is drawn (attribute LIGHTMAP_COORDINATE_LOCATION). Without a baked file every
+* vertex reads one neutral coordinate and a 1x1 lightmap of the old constant ambient is bound instead, so the scene
+* looks as it did.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetPack.h"
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Simd4.h"
+
+const float LIGHTMAP_NEUTRAL_AMBIENT = 0.1f;		//The lit shader's former constant ambientStrength
+const GLuint LIGHTMAP_COORDINATE_LOCATION = 4;
+const GLuint LIGHTMAP_TEXTURE_UNIT = 2;
+const size_t BAKE_ARENA_SIZE = 4 * 1024 * 1024;		//Jobs for one parallel-for over every texel
+
+//Interleaved mesh layout shared with UCreateMesh: position(3) color(4) normal(3) uv(2)
+const int BAKE_FLOATS_PER_VERTEX = 12;
+const int BAKE_NORMAL_OFFSET = 7;
+
+//-----------------------------------FILE FORMAT-------------------------------------------
+const uint32_t LIGHTMAP_VERSION = 2;			//2: the built-in meshes are generated, in a new vertex order
+
+//Followed by a lightmap coordinate (2 floats) per mesh vertex, then width * height RGB float texels
+struct LightmapFileHeader {
+	char magic[4];				//'L','M','A','P'
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t vertexCount;
+};
+
+//-----------------------------------BAKE INPUT--------------------------------------------
+//One static object: its mesh in the interleaved layout, placed by 'model'
+struct BakeObject {
+	std::string name;
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	glm::mat4 model;
+	glm::vec3 albedo;
+};
+
+//A point light whose bounce light is baked; like the shader's key light it has no distance falloff
+struct BakeLight {
+	glm::vec3 position;
+	glm::vec3 color;
+};
+
+struct BakeSettings {
+	float texelsPerUnit = 16.0f;
+	int samples = 128;							//Paths per texel, rounded up to whole packets
+	int maxBounces = 3;
+	glm::vec3 skyRadiance = glm::vec3(LIGHTMAP_NEUTRAL_AMBIENT);
+	std::vector<BakeLight> lights;
+	unsigned threads = 0;						//0: every hardware thread
+	std::string outputDir = ".";
+};
+
+//An object's lightmap: coordinates per mesh vertex, and per texel what the path tracer needs
+struct Lightmap {
+	int width = 0;
+	int height = 0;
+	std::vector<glm::vec2> coordinates;
+	std::vector<glm::vec3> texels;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned char> covered;
+};
+
+//------------------------------------RAY PACKETS------------------------------------------
+const float RAY_EPSILON = 1e-4f;
+
+struct RayPacket {
+	float originX[4], originY[4], originZ[4];
+	float directionX[4], directionY[4], directionZ[4];
+	float distance[4];						//Closest hit so far; the ray's length for shadow rays
+	int hit[4];								//Triangle index, -1 while nothing has been hit
+	int active;								//Lane bit mask
+};
+
+//Tests one triangle against the lanes in 'lanes' (Moller-Trumbore, four rays at once); returns the lanes it hits
+int UIntersectPacket(const BvhTriangle& triangle, int index, RayPacket& packet, int lanes) {
+	Float4 dirX = ULoad4(packet.directionX), dirY = ULoad4(packet.directionY), dirZ = ULoad4(packet.directionZ);
+	Float4 e1x = USplat(triangle.edge1.x), e1y = USplat(triangle.edge1.y), e1z = USplat(triangle.edge1.z);
+	Float4 e2x = USplat(triangle.edge2.x), e2y = USplat(triangle.edge2.y), e2z = USplat(triangle.edge2.z);
+
+	//p = direction x edge2
+	Float4 px = dirY * e2z - dirZ * e2y;
+	Float4 py = dirZ * e2x - dirX * e2z;
+	Float4 pz = dirX * e2y - dirY * e2x;
+	Float4 determinant = e1x * px + e1y * py + e1z * pz;
+	Float4 inverse = USplat(1.0f) / determinant;
+
+	Float4 tx = ULoad4(packet.originX) - USplat(triangle.v0.x);
+	Float4 ty = ULoad4(packet.originY) - USplat(triangle.v0.y);
+	Float4 tz = ULoad4(packet.originZ) - USplat(triangle.v0.z);
+	Float4 u = (tx * px + ty * py + tz * pz) * inverse;
+
+	//q = t x edge1
+	Float4 qx = ty * e1z - tz * e1y;
+	Float4 qy = tz * e1x - tx * e1z;
+	Float4 qz = tx * e1y - ty * e1x;
+	Float4 v = (dirX * qx + dirY * qy + dirZ * qz) * inverse;
+	Float4 t = (e2x * qx + e2y * qy + e2z * qz) * inverse;
+
+	Float4 zero = USplat(0.0f);
+	Float4 hits = ULess4(USplat(1e-9f), UAbs4(determinant));
+	hits = UAnd4(hits, ULessEqual4(zero, u));
+	hits = UAnd4(hits, ULessEqual4(zero, v));
+	hits = UAnd4(hits, ULessEqual4(u + v, USplat(1.0f)));
+	hits = UAnd4(hits, ULess4(USplat(RAY_EPSILON), t));
+	hits = UAnd4(hits, ULess4(t, ULoad4(packet.distance)));
+	int hitLanes = UMoveMask4(hits) & lanes;
+	if (!hitLanes)
+		return 0;
+
+	float distances[4];
+	UStore4(distances, t);
+	for (int lane = 0; lane < 4; ++lane) {
+		if (hitLanes & (1 << lane)) {
+			packet.distance[lane] = distances[lane];
+			packet.hit[lane] = index;
+		}
+	}
+	return hitLanes;
+}
+
+//Traces the active lanes through the BVH together; a node is visited if any of them reaches its box.
+//anyHit (shadow rays) retires a lane at its first hit instead of looking for the closest one.
+void UTracePacket(const Bvh& bvh, RayPacket& packet, bool anyHit) {
+	Float4 originX = ULoad4(packet.originX), originY = ULoad4(packet.originY), originZ = ULoad4(packet.originZ);
+	Float4 inverseX = USplat(1.0f) / ULoad4(packet.directionX);
+	Float4 inverseY = USplat(1.0f) / ULoad4(packet.directionY);
+	Float4 inverseZ = USplat(1.0f) / ULoad4(packet.directionZ);
+	Float4 zero = USplat(0.0f);
+
+	int lanes = packet.active;
+	uint32_t stack[BVH_MAX_DEPTH * 2 + 2];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0 && lanes) {
+		const BvhNode& node = bvh.nodes[stack[--top]];
+
+		//Slab test of the four rays against the node's box
+		Float4 t1x = (USplat(node.boundsMin.x) - originX) * inverseX, t2x = (USplat(node.boundsMax.x) - originX) * inverseX;
+		Float4 t1y = (USplat(node.boundsMin.y) - originY) * inverseY, t2y = (USplat(node.boundsMax.y) - originY) * inverseY;
+		Float4 t1z = (USplat(node.boundsMin.z) - originZ) * inverseZ, t2z = (USplat(node.boundsMax.z) - originZ) * inverseZ;
+		Float4 entry = UMax4(UMax4(UMin4(t1x, t2x), UMin4(t1y, t2y)), UMin4(t1z, t2z));
+		Float4 exit = UMin4(UMin4(UMax4(t1x, t2x), UMax4(t1y, t2y)), UMax4(t1z, t2z));
+		Float4 entered = UAnd4(UAnd4(ULessEqual4(entry, exit), ULessEqual4(zero, exit)), ULess4(entry, ULoad4(packet.distance)));
+		if (!(UMoveMask4(entered) & lanes))
+			continue;
+
+		if (node.count == 0) {
+			stack[top++] = node.leftFirst + 1;
+			stack[top++] = node.leftFirst;
+			continue;
+		}
+
+		for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count && lanes; ++i) {
+			int hitLanes = UIntersectPacket(bvh.triangles[i], (int)i, packet, lanes);
+			if (anyHit)
+				lanes &= ~hitLanes;
+		}
+	}
+}
+
+//--------------------------------------CHARTS---------------------------------------------
+//Any two unit vectors perpendicular to n and to each other
+void UOrthonormalBasis(const glm::vec3& n, glm::vec3& tangent, glm::vec3& bitangent) {
+	glm::vec3 helper = std::fabs(n.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+	tangent = glm::normalize(glm::cross(helper, n));
+	bitangent = glm::cross(n, tangent);
+}
+
+uint32_t UFindChartRoot(std::vector<uint32_t>& parents, uint32_t vertex) {
+	while (parents[vertex] != vertex) {
+		parents[vertex] = parents[parents[vertex]];
+		vertex = parents[vertex];
+	}
+	return vertex;
+}
+
+struct LightmapChart {
+	std::vector<uint32_t> triangles;
+	glm::vec3 normal = glm::vec3(0.0f);
+	glm::vec2 low = glm::vec2(FLT_MAX);
+	int width = 0;
+	int height = 0;
+	int x = 0;
+	int y = 0;
+};
+
+const int LIGHTMAP_GUTTER = 2;				//Texels kept free around each chart for filtering
+
+//World space position of mesh vertex v
+glm::vec3 UBakeVertexPosition(const BakeObject& object, uint32_t v) {
+	const float* vertex = &object.vertices[(size_t)v * BAKE_FLOATS_PER_VERTEX];
+	return glm::vec3(object.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+}
+
+//Geometric normal of a triangle, flipped to the side its vertex normals face
+glm::vec3 UBakeTriangleNormal(const BakeObject& object, const glm::mat3& normalMatrix, uint32_t triangle) {
+	const uint32_t* index = &object.indices[(size_t)triangle * 3];
+	glm::vec3 a = UBakeVertexPosition(object, index[0]);
+	glm::vec3 normal = glm::cross(UBakeVertexPosition(object, index[1]) - a, UBakeVertexPosition(object, index[2]) - a);
+	float length = glm::length(normal);
+	if (length <= 0.0f)
+		return glm::vec3(0.0f);
+	normal /= length;
+
+	glm::vec3 vertexNormals(0.0f);
+	for (int corner = 0; corner < 3; ++corner) {
+		const float* vertex = &object.vertices[(size_t)index[corner] * BAKE_FLOATS_PER_VERTEX + BAKE_NORMAL_OFFSET];
+		vertexNormals += normalMatrix * glm::vec3(vertex[0], vertex[1], vertex[2]);
+	}
+	return glm::dot(normal, vertexNormals) < 0.0f ? -normal : normal;
+}
+
+//Lays the object's charts out in a lightmap and fills in each covered texel's position and normal
+void UBuildLightmapCharts(const BakeObject& object, float texelsPerUnit, Lightmap& lightmap) {
+	uint32_t vertexCount = (uint32_t)(object.vertices.size() / BAKE_FLOATS_PER_VERTEX);
+	uint32_t triangleCount = (uint32_t)(object.indices.size() / 3);
+	glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(object.model)));
+
+	//Triangles sharing a vertex belong to the same chart
+	std::vector<uint32_t> parents(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		parents[v] = v;
+	for (uint32_t t = 0; t < triangleCount; ++t) {
+		uint32_t a = UFindChartRoot(parents, object.indices[t * 3]);
+		for (int corner = 1; corner < 3; ++corner)
+			parents[UFindChartRoot(parents, object.indices[t * 3 + corner])] = a;
+	}
+
+	std::vector<LightmapChart> charts;
+	std::vector<int> chartOfRoot(vertexCount, -1);
+	std::vector<glm::vec3> triangleNormals(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; ++t) {
+		uint32_t root = UFindChartRoot(parents, object.indices[t * 3]);
+		if (chartOfRoot[root] < 0) {
+			chartOfRoot[root] = (int)charts.size();
+			charts.push_back(LightmapChart());
+		}
+		LightmapChart& chart = charts[chartOfRoot[root]];
+		chart.triangles.push_back(t);
+
+		//Weighted by area, so slivers do not tilt the chart
+		const uint32_t* index = &object.indices[t * 3];
+		glm::vec3 a = UBakeVertexPosition(object, index[0]);
+		float area = glm::length(glm::cross(UBakeVertexPosition(object, index[1]) - a, UBakeVertexPosition(object, index[2]) - a));
+		triangleNormals[t] = UBakeTriangleNormal(object, normalMatrix, t);
+		chart.normal += triangleNormals[t] * area;
+	}
+
+	//Project each chart onto its plane, in texels
+	lightmap.coordinates.assign(vertexCount, glm::vec2(0.0f));
+	std::vector<glm::vec2> projected(vertexCount);
+	std::vector<glm::vec3> tangents(charts.size()), bitangents(charts.size());
+	int totalArea = 0;
+	int widest = 1;
+	for (size_t c = 0; c < charts.size(); ++c) {
+		LightmapChart& chart = charts[c];
+		chart.normal = glm::length(chart.normal) > 0.0f ? glm::normalize(chart.normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+		UOrthonormalBasis(chart.normal, tangents[c], bitangents[c]);
+
+		glm::vec2 high(-FLT_MAX);
+		for (uint32_t t : chart.triangles) {
+			for (int corner = 0; corner < 3; ++corner) {
+				uint32_t v = object.indices[t * 3 + corner];
+				glm::vec3 position = UBakeVertexPosition(object, v);
+				projected[v] = glm::vec2(glm::dot(position, tangents[c]), glm::dot(position, bitangents[c])) * texelsPerUnit;
+				chart.low = glm::min(chart.low, projected[v]);
+				high = glm::max(high, projected[v]);
+			}
+		}
+		chart.width = (int)std::ceil(high.x - chart.low.x) + 1 + 2 * LIGHTMAP_GUTTER;
+		chart.height = (int)std::ceil(high.y - chart.low.y) + 1 + 2 * LIGHTMAP_GUTTER;
+		totalArea += chart.width * chart.height;
+		widest = std::max(widest, chart.width);
+	}
+
+	//Shelf packing, tallest charts first, into a roughly square lightmap
+	std::vector<size_t> packOrder(charts.size());
+	for (size_t c = 0; c < charts.size(); ++c)
+		packOrder[c] = c;
+	std::sort(packOrder.begin(), packOrder.end(), [&charts](size_t a, size_t b) { return charts[a].height > charts[b].height; });
+
+	lightmap.width = std::max(widest, (int)std::ceil(std::sqrt((double)totalArea)));
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	for (size_t c : packOrder) {
+		LightmapChart& chart = charts[c];
+		if (shelfX + chart.width > lightmap.width) {
+			shelfX = 0;
+			shelfY += shelfHeight;
+			shelfHeight = 0;
+		}
+		chart.x = shelfX;
+		chart.y = shelfY;
+		shelfX += chart.width;
+		shelfHeight = std::max(shelfHeight, chart.height);
+	}
+	lightmap.height = std::max(1, shelfY + shelfHeight);
+
+	size_t texelCount = (size_t)lightmap.width * lightmap.height;
+	lightmap.texels.assign(texelCount, glm::vec3(0.0f));
+	lightmap.positions.assign(texelCount, glm::vec3(0.0f));
+	lightmap.normals.assign(texelCount, glm::vec3(0.0f));
+	lightmap.covered.assign(texelCount, 0);
+
+	glm::vec2 size((float)lightmap.width, (float)lightmap.height);
+	for (size_t c = 0; c < charts.size(); ++c) {
+		const LightmapChart& chart = charts[c];
+		glm::vec2 offset = glm::vec2((float)(chart.x + LIGHTMAP_GUTTER), (float)(chart.y + LIGHTMAP_GUTTER)) - chart.low;
+
+		for (uint32_t t : chart.triangles) {
+			const uint32_t* index = &object.indices[t * 3];
+			glm::vec2 a = projected[index[0]] + offset, b = projected[index[1]] + offset, d = projected[index[2]] + offset;
+			for (int corner = 0; corner < 3; ++corner)
+				lightmap.coordinates[index[corner]] = (projected[index[corner]] + offset) / size;
+
+			float area = (b.x - a.x) * (d.y - a.y) - (b.y - a.y) * (d.x - a.x);
+			if (std::fabs(area) < 1e-12f)
+				continue;
+			glm::vec3 pa = UBakeVertexPosition(object, index[0]), pb = UBakeVertexPosition(object, index[1]), pd = UBakeVertexPosition(object, index[2]);
+
+			//Texels whose centers fall inside the triangle
+			int x0 = std::max(0, (int)std::floor(std::min(a.x, std::min(b.x, d.x))));
+			int x1 = std::min(lightmap.width - 1, (int)std::ceil(std::max(a.x, std::max(b.x, d.x))));
+			int y0 = std::max(0, (int)std::floor(std::min(a.y, std::min(b.y, d.y))));
+			int y1 = std::min(lightmap.height - 1, (int)std::ceil(std::max(a.y, std::max(b.y, d.y))));
+			for (int y = y0; y <= y1; ++y) {
+				for (int x = x0; x <= x1; ++x) {
+					glm::vec2 p((float)x + 0.5f, (float)y + 0.5f);
+					float wa = ((b.x - p.x) * (d.y - p.y) - (b.y - p.y) * (d.x - p.x)) / area;
+					float wb = ((d.x - p.x) * (a.y - p.y) - (d.y - p.y) * (a.x - p.x)) / area;
+					float wd = 1.0f - wa - wb;
+					if (wa < -1e-5f || wb < -1e-5f || wd < -1e-5f)
+						continue;
+
+					size_t texel = (size_t)y * lightmap.width + x;
+					lightmap.positions[texel] = pa * wa + pb * wb + pd * wd;
+					lightmap.normals[texel] = triangleNormals[t];
+					lightmap.covered[texel] = 1;
+				}
+			}
+		}
+	}
+}
+
+//Copies covered texels outwards into the gutters, so filtering at chart edges reads baked values
+void UDilateLightmap(Lightmap& lightmap) {
+	for (int pass = 0; pass < LIGHTMAP_GUTTER; ++pass) {
+		std::vector<unsigned char> covered = lightmap.covered;
+		for (int y = 0; y < lightmap.height; ++y) {
+			for (int x = 0; x < lightmap.width; ++x) {
+				size_t texel = (size_t)y * lightmap.width + x;
+				if (lightmap.covered[texel])
+					continue;
+
+				glm::vec3 sum(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; ++dy) {
+					for (int dx = -1; dx <= 1; ++dx) {
+						int nx = x + dx, ny = y + dy;
+						if (nx < 0 || ny < 0 || nx >= lightmap.width || ny >= lightmap.height)
+							continue;
+						size_t neighbour = (size_t)ny * lightmap.width + nx;
+						if (lightmap.covered[neighbour]) {
+							sum += lightmap.texels[neighbour];
+							++count;
+						}
+					}
+				}
+				if (count) {
+					lightmap.texels[texel] = sum / (float)count;
+					covered[texel] = 1;
+				}
+			}
+		}
+		lightmap.covered.swap(covered);
+	}
+
+	//Anything left is never sampled; keep it at the unbaked ambient
+	for (size_t texel = 0; texel < lightmap.texels.size(); ++texel) {
+		if (!lightmap.covered[texel])
+			lightmap.texels[texel] = glm::vec3(LIGHTMAP_NEUTRAL_AMBIENT);
+	}
+}
+
+//-------------------------------------PATH TRACING----------------------------------------
+//Small hash-based generator; seeding it per texel keeps the bake independent of scheduling
+struct BakeRandom {
+	uint32_t state;
+};
+
+uint32_t UHashSeed(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+float URandomFloat(BakeRandom& random) {
+	random.state ^= random.state << 13;
+	random.state ^= random.state >> 17;
+	random.state ^= random.state << 5;
+	return (random.state >> 8) * (1.0f / 16777216.0f);
+}
+
+//Cosine-weighted direction around n; averaging the radiance along such directions gives irradiance over pi
+glm::vec3 UCosineDirection(const glm::vec3& n, BakeRandom& random) {
+	float angle = 6.28318531f * URandomFloat(random);
+	float radius2 = URandomFloat(random);
+	float radius = std::sqrt(radius2);
+	glm::vec3 tangent, bitangent;
+	UOrthonormalBasis(n, tangent, bitangent);
+	return glm::normalize(tangent * (radius * std::cos(angle)) + bitangent * (radius * std::sin(angle)) + n * std::sqrt(std::max(0.0f, 1.0f - radius2)));
+}
+
+void USetPacketRay(RayPacket& packet, int lane, const glm::vec3& origin, const glm::vec3& direction, float distance) {
+	packet.originX[lane] = origin.x;
+	packet.originY[lane] = origin.y;
+	packet.originZ[lane] = origin.z;
+
+	//Axis-parallel directions would give 0 * infinity in the slab test
+	packet.directionX[lane] = std::fabs(direction.x) < 1e-8f ? 1e-8f : direction.x;
+	packet.directionY[lane] = std::fabs(direction.y) < 1e-8f ? 1e-8f : direction.y;
+	packet.directionZ[lane] = std::fabs(direction.z) < 1e-8f ? 1e-8f : direction.z;
+	packet.distance[lane] = distance;
+	packet.hit[lane] = -1;
+}
+
+//Traces 'samples' paths from one texel, four at a time; returns the average radiance and counts the rays traced
+glm::vec3 UBakeTexel(const Bvh& bvh, const std::vector<glm::vec3>& albedos, const BakeSettings& settings,
+	const glm::vec3& position, const glm::vec3& normal, uint32_t seed, uint64_t& rays) {
+
+	BakeRandom random = { UHashSeed(seed) | 1u };
+	glm::vec3 origin = position + normal * 1e-3f;
+	glm::vec3 total(0.0f);
+	int packets = (settings.samples + 3) / 4;
+
+	for (int p = 0; p < packets; ++p) {
+		RayPacket packet;
+		glm::vec3 throughput[4], hitNormal[4], radiance[4];
+		for (int lane = 0; lane < 4; ++lane) {
+			USetPacketRay(packet, lane, origin, UCosineDirection(normal, random), FLT_MAX);
+			throughput[lane] = glm::vec3(1.0f);
+			radiance[lane] = glm::vec3(0.0f);
+		}
+		packet.active = 0xF;
+
+		for (int bounce = 0; bounce <= settings.maxBounces && packet.active; ++bounce) {
+			for (int lane = 0; lane < 4; ++lane) {
+				if (packet.active & (1 << lane)) {
+					packet.distance[lane] = FLT_MAX;
+					packet.hit[lane] = -1;
+					++rays;
+				}
+			}
+			UTracePacket(bvh, packet, false);
+
+			//Escaped paths see the sky; hits on the back of a surface are inside a solid and see nothing
+			glm::vec3 hitPosition[4];
+			for (int lane = 0; lane < 4; ++lane) {
+				int bit = 1 << lane;
+				if (!(packet.active & bit))
+					continue;
+				if (packet.hit[lane] < 0) {
+					radiance[lane] += throughput[lane] * settings.skyRadiance;
+					packet.active &= ~bit;
+					continue;
+				}
+
+				const BvhTriangle& triangle = bvh.triangles[packet.hit[lane]];
+				glm::vec3 direction(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+				if (glm::dot(triangle.normal, direction) > 0.0f) {
+					packet.active &= ~bit;
+					continue;
+				}
+
+				throughput[lane] *= albedos[triangle.id];
+				hitNormal[lane] = triangle.normal;
+				hitPosition[lane] = glm::vec3(packet.originX[lane], packet.originY[lane], packet.originZ[lane]) + direction * packet.distance[lane] + triangle.normal * 1e-3f;
+			}
+
+			//Bounce light of the static point lights, with one shadow packet for all of them per bounce
+			for (const BakeLight& light : settings.lights) {
+				RayPacket shadows;
+				shadows.active = 0;
+				for (int lane = 0; lane < 4; ++lane) {
+					if (!(packet.active & (1 << lane)))
+						continue;
+					glm::vec3 toLight = light.position - hitPosition[lane];
+					float distance = glm::length(toLight);
+					if (distance <= RAY_EPSILON || glm::dot(toLight, hitNormal[lane]) <= 0.0f)
+						continue;
+					USetPacketRay(shadows, lane, hitPosition[lane], toLight / distance, distance);
+					shadows.active |= 1 << lane;
+					++rays;
+				}
+				if (!shadows.active)
+					continue;
+
+				int shadowLanes = shadows.active;
+				UTracePacket(bvh, shadows, true);
+				for (int lane = 0; lane < 4; ++lane) {
+					if ((shadowLanes & (1 << lane)) && shadows.hit[lane] < 0) {
+						glm::vec3 direction(shadows.directionX[lane], shadows.directionY[lane], shadows.directionZ[lane]);
+						radiance[lane] += throughput[lane] * light.color * glm::dot(direction, hitNormal[lane]);
+					}
+				}
+			}
+
+			//Continue the surviving paths
+			for (int lane = 0; lane < 4; ++lane) {
+				if (packet.active & (1 << lane))
+					USetPacketRay(packet, lane, hitPosition[lane], UCosineDirection(hitNormal[lane], random), FLT_MAX);
+			}
+		}
+
+		for (int lane = 0; lane < 4; ++lane)
+			total += radiance[lane];
+	}
+	return total / (float)(packets * 4);
+}
+
+//------------------------------------------BAKE--------------------------------------------
+bool UWriteLightmap(const std::string& path, const Lightmap& lightmap) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file) {
+		LOG_ERROR("ERROR::LIGHTMAP::WRITE_FAILED %s", path.c_str());
+		return false;
+	}
+
+	LightmapFileHeader header;
+	memcpy(header.magic, "LMAP", 4);
+	header.version = LIGHTMAP_VERSION;
+	header.width = (uint32_t)lightmap.width;
+	header.height = (uint32_t)lightmap.height;
+	header.vertexCount = (uint32_t)lightmap.coordinates.size();
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(lightmap.coordinates.data(), sizeof(glm::vec2), lightmap.coordinates.size(), file) == lightmap.coordinates.size() &&
+		fwrite(lightmap.texels.data(), sizeof(glm::vec3), lightmap.texels.size(), file) == lightmap.texels.size();
+	fclose(file);
+	if (!written)
+		LOG_ERROR("ERROR::LIGHTMAP::WRITE_FAILED %s", path.c_str());
+	return written;
+}
+
+//Bakes and writes '<outputDir>/<name>.lmap' for every object; every object both receives and casts
+bool UBakeLightmaps(const std::vector<BakeObject>& objects, const BakeSettings& settings) {
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<Lightmap> lightmaps(objects.size());
+	std::vector<glm::vec3> albedos;
+	Bvh bvh;
+	for (size_t o = 0; o < objects.size(); ++o) {
+		const BakeObject& object = objects[o];
+		UBuildLightmapCharts(object, settings.texelsPerUnit, lightmaps[o]);
+		albedos.push_back(object.albedo);
+
+		glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(object.model)));
+		for (uint32_t t = 0; t < object.indices.size() / 3; ++t) {
+			BvhTriangle triangle;
+			triangle.v0 = UBakeVertexPosition(object, object.indices[t * 3]);
+			triangle.edge1 = UBakeVertexPosition(object, object.indices[t * 3 + 1]) - triangle.v0;
+			triangle.edge2 = UBakeVertexPosition(object, object.indices[t * 3 + 2]) - triangle.v0;
+			triangle.normal = UBakeTriangleNormal(object, normalMatrix, t);
+			triangle.id = (int)o;
+			bvh.triangles.push_back(triangle);
+		}
+	}
+	UBuildBvh(bvh);
+	double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "INFO: BVH over " << bvh.triangles.size() << " triangles, " << bvh.nodes.size() << " nodes; charts and BVH in " << setupMs << " ms" << std::endl;
+
+	//Every covered texel of every object is one work item
+	struct TexelWork {
+		uint32_t object;
+		uint32_t texel;
+	};
+	std::vector<TexelWork> work;
+	for (size_t o = 0; o < lightmaps.size(); ++o) {
+		for (size_t texel = 0; texel < lightmaps[o].covered.size(); ++texel) {
+			if (lightmaps[o].covered[texel])
+				work.push_back(TexelWork{ (uint32_t)o, (uint32_t)texel });
+		}
+		std::cout << "INFO: " << objects[o].name << ": " << lightmaps[o].width << "x" << lightmaps[o].height << " lightmap" << std::endl;
+	}
+
+	unsigned threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+	FrameArena arena;
+	UCreateFrameArena(arena, BAKE_ARENA_SIZE);
+	JobSystem system;
+	UStartJobSystem(system, threads - 1, arena);
+
+	std::atomic<uint64_t> totalRays{ 0 };
+	auto traceStart = std::chrono::steady_clock::now();
+	const size_t grain = 64;
+	UWaitForJob(system, UParallelFor(system, work.size(), grain,
+		[&](size_t begin, size_t end) {
+			uint64_t rays = 0;
+			for (size_t i = begin; i < end; ++i) {
+				Lightmap& lightmap = lightmaps[work[i].object];
+				uint32_t texel = work[i].texel;
+				lightmap.texels[texel] = UBakeTexel(bvh, albedos, settings, lightmap.positions[texel], lightmap.normals[texel],
+					work[i].object * 0x9E3779B9u + texel, rays);
+			}
+			totalRays += rays;
+		}));
+	UResetJobs(system);
+	double traceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - traceStart).count();
+	UStopJobSystem(system);
+	UDestroyFrameArena(arena);
+
+	bool written = true;
+	for (size_t o = 0; o < objects.size(); ++o) {
+		UDilateLightmap(lightmaps[o]);
+		written = UWriteLightmap(settings.outputDir + "/" + objects[o].name + ".lmap", lightmaps[o]) && written;
+	}
+
+	uint64_t rays = totalRays;
+#ifdef SIMD4_SSE
+	const char* packets = "SSE";
+#else
+	const char* packets = "scalar";
+#endif
+	std::cout << "INFO: Baked " << work.size() << " texels x " << ((settings.samples + 3) / 4) * 4 << " paths, " << rays << " rays in " << traceSeconds
+		<< " s with " << threads << " threads (" << packets << " packets): " << (traceSeconds > 0.0 ? rays / traceSeconds / 1e6 : 0.0) << " Mrays/s" << std::endl;
+	return written;
+}
+
+//----------------------------------------RUNTIME-------------------------------------------
+//Lightmap load state handed from a loader thread to the context thread
+struct LightmapLoad {
+	const char* objectName = nullptr;
+	std::string fileName;
+	AssetView asset;
+	LightmapFileHeader header;
+	const float* coordinates = nullptr;
+	const float* texels = nullptr;
+	bool found = false;
+};
+
+//Loader thread: finds and validates '<object>.lmap'; false when there is none or it is unusable
+bool UReadLightmap(LightmapLoad& load) {
+	load.fileName = std::string(load.objectName) + ".lmap";
+	if (!UFindAsset(load.fileName.c_str(), load.asset))
+		return false;
+
+	if (load.asset.size < sizeof(LightmapFileHeader)) {
+		LOG_WARN("WARN: %s is truncated", load.fileName.c_str());
+		return false;
+	}
+	memcpy(&load.header, load.asset.data, sizeof(load.header));
+	size_t expected = sizeof(LightmapFileHeader) + (size_t)load.header.vertexCount * 2 * sizeof(float) +
+		(size_t)load.header.width * load.header.height * 3 * sizeof(float);
+	if (memcmp(load.header.magic, "LMAP", 4) != 0 || load.header.version != LIGHTMAP_VERSION || load.asset.size < expected) {
+		LOG_WARN("WARN: %s is not a version %u lightmap", load.fileName.c_str(), LIGHTMAP_VERSION);
+		return false;
+	}
+
+	load.coordinates = (const float*)(load.asset.data + sizeof(LightmapFileHeader));
+	load.texels = load.coordinates + (size_t)load.header.vertexCount * 2;
+	return true;
+}
+
+//Context thread: uploads the lightmap coordinates and texels for an object drawn from 'vertexBuffer'. A mesh whose
+//vertex count no longer matches the bake keeps the unbaked ambient.
+bool UUploadLightmap(const LightmapLoad& load, GLuint vertexBuffer, GLuint& coordinateBuffer, GLuint& texture) {
+	GLint vertexBytes = 0;
+	glGetNamedBufferParameteriv(vertexBuffer, GL_BUFFER_SIZE, &vertexBytes);
+	if ((uint32_t)vertexBytes / (BAKE_FLOATS_PER_VERTEX * sizeof(float)) != load.header.vertexCount) {
+		LOG_WARN("WARN: %s was baked for a different mesh; rebake with --bake-lightmaps", load.fileName.c_str());
+		return false;
+	}
+
+	glCreateBuffers(1, &coordinateBuffer);
+	glNamedBufferStorage(coordinateBuffer, (GLsizeiptr)load.header.vertexCount * 2 * sizeof(float), load.coordinates, 0);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB16F, (GLsizei)load.header.width, (GLsizei)load.header.height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)load.header.width, (GLsizei)load.header.height, GL_RGB, GL_FLOAT, load.texels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+//1x1 lightmap of the old constant ambient, bound for objects without a baked one
+void UCreateNeutralLightmap(GLuint& texture) {
+	const float ambient[3] = { LIGHTMAP_NEUTRAL_AMBIENT, LIGHTMAP_NEUTRAL_AMBIENT, LIGHTMAP_NEUTRAL_AMBIENT };
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB16F, 1, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGB, GL_FLOAT, ambient);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+//Bake input: reads back the vertices and 16-bit indices UCreateMesh uploaded for a mesh, so the bake sees exactly
+//the geometry that is drawn (including meshes replaced from the asset pack)
+bool UReadBackMesh(GLuint vertexBuffer, GLuint indexBuffer, GLuint indexCount, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+	if (!vertexBuffer || !indexBuffer)
+		return false;
+
+	GLint vertexBytes = 0;
+	glGetNamedBufferParameteriv(vertexBuffer, GL_BUFFER_SIZE, &vertexBytes);
+	vertices.resize((size_t)vertexBytes / sizeof(float));
+	glGetNamedBufferSubData(vertexBuffer, 0, (GLsizeiptr)vertices.size() * sizeof(float), vertices.data());
+
+	std::vector<GLushort> shortIndices(indexCount);
+	glGetNamedBufferSubData(indexBuffer, 0, (GLsizeiptr)indexCount * sizeof(GLushort), shortIndices.data());
+
+	indices.assign(shortIndices.begin(), shortIndices.end());
+	uint32_t vertexCount = (uint32_t)(vertices.size() / BAKE_FLOATS_PER_VERTEX);
+	for (uint32_t index : indices) {
+		if (index >= vertexCount)
+			return false;
+	}
+	return true;
+}
+
+#endif
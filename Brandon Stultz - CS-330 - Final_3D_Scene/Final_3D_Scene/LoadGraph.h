@@ -0,0 +1,211 @@
+#ifndef LOADGRAPH_H
+#define LOADGRAPH_H
+
+/*Startup load graph
+* Each job has an optional 'work' step that runs on a worker thread (file I/O, decoding) and an optional
+* 'upload' step that is marshalled to the GL context thread. A job becomes runnable once all of its
+* dependencies have finished, successfully or not. Failed jobs run their 'fallback' on the context thread
+* so the scene keeps rendering with placeholder resources.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+enum LoadState {
+	LOAD_PENDING,
+	LOAD_RUNNING,
+	LOAD_UPLOADING,
+	LOAD_DONE,
+	LOAD_FAILED
+};
+
+struct LoadJob {
+	std::string name;
+	std::vector<int> dependencies;
+	std::vector<int> dependents;
+	int unfinishedDependencies = 0;
+
+	std::function<bool()> work;			//Worker thread; may be empty
+	std::function<bool()> upload;		//GL context thread; may be empty
+	std::function<void()> fallback;		//GL context thread, after a failed work or upload step
+
+	std::atomic<int> state{ LOAD_PENDING };
+	bool workFailed = false;
+	double finishedMs = 0.0;
+};
+
+struct LoadGraph {
+	std::vector<std::unique_ptr<LoadJob>> jobs;
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<int> runnable;			//Waiting for a worker
+	std::deque<int> uploads;			//Waiting for the context thread
+	int remaining = 0;
+	int failed = 0;
+	bool stopping = false;
+
+	std::chrono::steady_clock::time_point start;
+};
+
+//Adds a job and returns its index for use as a dependency
+int UAddLoadJob(LoadGraph& graph, const std::string& name, std::vector<int> dependencies,
+	std::function<bool()> work, std::function<bool()> upload, std::function<void()> fallback = nullptr) {
+
+	std::unique_ptr<LoadJob> job(new LoadJob());
+	job->name = name;
+	job->dependencies = std::move(dependencies);
+	job->work = std::move(work);
+	job->upload = std::move(upload);
+	job->fallback = std::move(fallback);
+
+	graph.jobs.push_back(std::move(job));
+	return (int)graph.jobs.size() - 1;
+}
+
+double ULoadGraphElapsedMs(const LoadGraph& graph) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - graph.start).count();
+}
+
+//Queues a job for whichever thread handles its next step (caller holds the mutex)
+void UScheduleLoadJob(LoadGraph& graph, int index) {
+	LoadJob& job = *graph.jobs[index];
+	if (job.work) {
+		job.state = LOAD_RUNNING;
+		graph.runnable.push_back(index);
+		graph.wake.notify_one();
+	}
+	else {
+		job.state = LOAD_UPLOADING;
+		graph.uploads.push_back(index);
+	}
+}
+
+//Marks a job finished and releases its dependents (caller holds the mutex)
+void UFinishLoadJob(LoadGraph& graph, int index, bool succeeded) {
+	LoadJob& job = *graph.jobs[index];
+	job.state = succeeded ? LOAD_DONE : LOAD_FAILED;
+	job.finishedMs = ULoadGraphElapsedMs(graph);
+	--graph.remaining;
+	if (!succeeded)
+		++graph.failed;
+
+	LOG_INFO("INFO: Load %s %s at %.1f ms", job.name.c_str(), succeeded ? "ready" : "FAILED", job.finishedMs);
+
+	for (int dependent : job.dependents) {
+		if (--graph.jobs[dependent]->unfinishedDependencies == 0)
+			UScheduleLoadJob(graph, dependent);
+	}
+	if (graph.remaining == 0)
+		graph.wake.notify_all();
+}
+
+void ULoadWorker(LoadGraph* graph) {
+	std::unique_lock<std::mutex> lock(graph->mutex);
+	while (true) {
+		graph->wake.wait(lock, [graph] { return graph->stopping || !graph->runnable.empty(); });
+		if (graph->runnable.empty())
+			return;
+
+		int index = graph->runnable.front();
+		graph->runnable.pop_front();
+		LoadJob& job = *graph->jobs[index];
+
+		lock.unlock();
+		bool succeeded = job.work();
+		lock.lock();
+
+		job.workFailed = !succeeded;
+		if (succeeded && !job.upload && !job.fallback) {
+			UFinishLoadJob(*graph, index, true);
+		}
+		else if (!succeeded && !job.fallback) {
+			UFinishLoadJob(*graph, index, false);
+		}
+		else {
+			job.state = LOAD_UPLOADING;
+			graph->uploads.push_back(index);
+		}
+	}
+}
+
+//Resolves dependencies and starts the worker threads
+//(graph.start may be preset so timings include work done before the graph, e.g. window creation)
+void UStartLoadGraph(LoadGraph& graph, unsigned workerCount) {
+	if (graph.start == std::chrono::steady_clock::time_point())
+		graph.start = std::chrono::steady_clock::now();
+	graph.remaining = (int)graph.jobs.size();
+
+	std::lock_guard<std::mutex> lock(graph.mutex);
+	for (size_t i = 0; i < graph.jobs.size(); ++i) {
+		LoadJob& job = *graph.jobs[i];
+		job.unfinishedDependencies = (int)job.dependencies.size();
+		for (int dependency : job.dependencies)
+			graph.jobs[dependency]->dependents.push_back((int)i);
+	}
+	for (size_t i = 0; i < graph.jobs.size(); ++i) {
+		if (graph.jobs[i]->unfinishedDependencies == 0)
+			UScheduleLoadJob(graph, (int)i);
+	}
+
+	if (workerCount == 0)
+		workerCount = 1;
+	for (unsigned i = 0; i < workerCount; ++i)
+		graph.workers.emplace_back(ULoadWorker, &graph);
+}
+
+//Runs queued context-thread steps until the time budget is spent; returns true once every job has finished
+bool UPumpLoadGraph(LoadGraph& graph, double budgetMs) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(budgetMs);
+
+	std::unique_lock<std::mutex> lock(graph.mutex);
+	while (!graph.uploads.empty()) {
+		int index = graph.uploads.front();
+		graph.uploads.pop_front();
+		LoadJob& job = *graph.jobs[index];
+
+		lock.unlock();
+		bool succeeded = !job.workFailed && (!job.upload || job.upload());
+		if (!succeeded && job.fallback)
+			job.fallback();
+		lock.lock();
+
+		UFinishLoadJob(graph, index, succeeded);
+
+		//Always make progress on at least one upload per call
+		if (std::chrono::steady_clock::now() >= deadline)
+			break;
+	}
+	return graph.remaining == 0;
+}
+
+bool ULoadGraphFinished(LoadGraph& graph) {
+	std::lock_guard<std::mutex> lock(graph.mutex);
+	return graph.remaining == 0;
+}
+
+void UStopLoadGraph(LoadGraph& graph) {
+	{
+		std::lock_guard<std::mutex> lock(graph.mutex);
+		graph.stopping = true;
+		graph.runnable.clear();
+	}
+	graph.wake.notify_all();
+	for (std::thread& worker : graph.workers)
+		worker.join();
+	graph.workers.clear();
+}
+
+#endif
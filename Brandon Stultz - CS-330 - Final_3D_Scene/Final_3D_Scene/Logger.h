@@ -0,0 +1,197 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+/*Asynchronous logger
+* Any thread formats its message straight into a slot of a fixed ring and returns; a background thread writes
+* the slots to the console. Claiming a slot is a single compare-and-swap per message (bounded multi-producer
+* queue, one sequence number per slot), so logging never takes a lock, allocates, or waits on terminal I/O.
+* If the ring is full the message is dropped and counted rather than stalling the caller.
+*
+* Each line is stamped with the main loop frame it was logged in and the time since that frame began.
+* LOG_DEBUG..LOG_ERROR compile to nothing below LOG_LEVEL; Release builds strip debug messages by default.
+* Before UStartLogger and after UStopLogger, messages are written synchronously (tools and benchmarks).
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_LEVEL
+#ifdef NDEBUG
+#define LOG_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+const size_t LOG_SLOTS = 1024;				//Power of two
+const size_t LOG_MESSAGE_SIZE = 512;		//Longer messages are truncated
+
+int64_t ULogClockNanoseconds() {
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LogSlot {
+	std::atomic<size_t> sequence{ 0 };		//== position: free for that producer; == position + 1: ready to write out
+	int level = 0;
+	uint64_t frame = 0;
+	int64_t frameNanoseconds = 0;
+	char text[LOG_MESSAGE_SIZE];
+};
+
+struct Logger {
+	LogSlot slots[LOG_SLOTS];
+	std::atomic<size_t> enqueuePosition{ 0 };
+	size_t dequeuePosition = 0;				//Writer thread only
+	std::atomic<uint64_t> dropped{ 0 };
+
+	std::atomic<uint64_t> frame{ 0 };
+	std::atomic<int64_t> frameStart{ ULogClockNanoseconds() };	//Frame 0 counts from process start
+
+	std::thread writer;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> stopping{ false };
+};
+
+Logger gLogger;
+
+//Main thread, at the top of each loop iteration; later lines are stamped relative to it
+void UBeginLogFrame(uint64_t frame) {
+	gLogger.frameStart = ULogClockNanoseconds();
+	gLogger.frame = frame;
+}
+
+//Errors go to stderr, everything else to stdout
+void UWriteLogLine(int level, uint64_t frame, int64_t frameNanoseconds, const char* text) {
+	char stamp[48];
+	snprintf(stamp, sizeof(stamp), "[frame %llu +%.2f ms] ", (unsigned long long)frame, frameNanoseconds / 1e6);
+	(level >= LOG_LEVEL_ERROR ? std::cerr : std::cout) << stamp << text << '\n';
+}
+
+//Writes out every ready slot in order; returns how many were written
+size_t UDrainLog(Logger& logger) {
+	size_t written = 0;
+	while (true) {
+		LogSlot& slot = logger.slots[logger.dequeuePosition & (LOG_SLOTS - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != logger.dequeuePosition + 1)
+			break;
+
+		UWriteLogLine(slot.level, slot.frame, slot.frameNanoseconds, slot.text);
+		slot.sequence.store(logger.dequeuePosition + LOG_SLOTS, std::memory_order_release);
+		++logger.dequeuePosition;
+		++written;
+	}
+
+	uint64_t dropped = logger.dropped.exchange(0);
+	if (dropped > 0)
+		std::cout << "WARN: " << dropped << " log messages dropped (log ring full)" << '\n';
+	if (written > 0 || dropped > 0) {
+		std::cout.flush();
+		std::cerr.flush();
+	}
+	return written;
+}
+
+void ULogWriterThread(Logger* logger) {
+	while (!logger->stopping) {
+		if (UDrainLog(*logger) == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	UDrainLog(*logger);
+}
+
+void UStartLogger() {
+	for (size_t i = 0; i < LOG_SLOTS; ++i)
+		gLogger.slots[i].sequence.store(i, std::memory_order_relaxed);
+	gLogger.enqueuePosition = 0;
+	gLogger.dequeuePosition = 0;
+	gLogger.stopping = false;
+	gLogger.writer = std::thread(ULogWriterThread, &gLogger);
+	gLogger.running = true;
+}
+
+//Writes out everything still queued; call once no other thread is logging
+void UStopLogger() {
+	if (!gLogger.running)
+		return;
+	gLogger.running = false;
+	gLogger.stopping = true;
+	gLogger.writer.join();
+}
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void ULog(int level, const char* format, ...) {
+	uint64_t frame = gLogger.frame.load(std::memory_order_relaxed);
+	int64_t frameNanoseconds = ULogClockNanoseconds() - gLogger.frameStart.load(std::memory_order_relaxed);
+
+	va_list args;
+	va_start(args, format);
+	if (!gLogger.running) {
+		char text[LOG_MESSAGE_SIZE];
+		vsnprintf(text, sizeof(text), format, args);
+		va_end(args);
+		UWriteLogLine(level, frame, frameNanoseconds, text);
+		(level >= LOG_LEVEL_ERROR ? std::cerr : std::cout).flush();
+		return;
+	}
+
+	//Claim a slot: its sequence equals our position once the writer has freed it
+	LogSlot* slot;
+	size_t position = gLogger.enqueuePosition.load(std::memory_order_relaxed);
+	while (true) {
+		slot = &gLogger.slots[position & (LOG_SLOTS - 1)];
+		intptr_t difference = (intptr_t)slot->sequence.load(std::memory_order_acquire) - (intptr_t)position;
+		if (difference == 0) {
+			if (gLogger.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0) {
+			++gLogger.dropped;
+			va_end(args);
+			return;
+		}
+		else {
+			position = gLogger.enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->level = level;
+	slot->frame = frame;
+	slot->frameNanoseconds = frameNanoseconds;
+	vsnprintf(slot->text, sizeof(slot->text), format, args);
+	va_end(args);
+	slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) ULog(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) ULog(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) ULog(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) ULog(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef MESHGENERATORS_H
+#define MESHGENERATORS_H
+
+/*Procedural meshes in the scene's 12 float vertex layout
+* Boxes, trapezoidal prisms, cylinders, and spheres are generated from their dimensions and tessellation. Every
+* generator writes through plain pointers, so the same code fills a std::array at compile time (UMake*, for shapes
+* fixed in the source) or a mapped GPU buffer at run time (UBuffer*, for shapes picked while the program runs).
+*
+* Faces get their own vertices, so normals are flat per face and each face is mapped to the whole texture. Triangles
+* wind counter-clockwise seen from outside.
+*/
+
+#include <array>
+#include <cstddef>
+#include <GL/glew.h>
+
+#include "Logger.h"
+
+//-----------------------------------CONSTEXPR MATH------------------------------------------
+constexpr double MESH_PI = 3.14159265358979323846;
+
+constexpr double UMeshSqrt(double value) {
+	if (value <= 0.0)
+		return 0.0;
+	double root = value > 1.0 ? value : 1.0;
+	for (int i = 0; i < 64; ++i)
+		root = 0.5 * (root + value / root);
+	return root;
+}
+
+//Taylor series after reducing the angle to [-pi, pi]; exact enough for float vertices
+constexpr double UMeshSin(double angle) {
+	while (angle > MESH_PI)
+		angle -= 2.0 * MESH_PI;
+	while (angle < -MESH_PI)
+		angle += 2.0 * MESH_PI;
+	double term = angle;
+	double sum = angle;
+	for (int n = 1; n < 12; ++n) {
+		term *= -angle * angle / ((2.0 * n) * (2.0 * n + 1.0));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double UMeshCos(double angle) {
+	return UMeshSin(angle + 0.5 * MESH_PI);
+}
+
+struct MeshPoint {
+	float x, y, z;
+};
+
+constexpr MeshPoint operator-(const MeshPoint& a, const MeshPoint& b) {
+	return MeshPoint{ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+constexpr MeshPoint UMeshCross(const MeshPoint& a, const MeshPoint& b) {
+	return MeshPoint{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+constexpr MeshPoint UMeshNormalize(const MeshPoint& a) {
+	double length = UMeshSqrt((double)a.x * a.x + (double)a.y * a.y + (double)a.z * a.z);
+	return length > 0.0 ? MeshPoint{ (float)(a.x / length), (float)(a.y / length), (float)(a.z / length) } : a;
+}
+
+//-----------------------------------VERTEX DATA-------------------------------------------
+//Position, color (RGBA), normal, texture coordinate: binding SCENE_VERTEX_BINDING of SceneVertexLayout (RenderDevice.h)
+struct MeshVertex {
+	float position[3];
+	float color[4];
+	float normal[3];
+	float uv[2];
+};
+static_assert(sizeof(MeshVertex) == 12 * sizeof(float), "MeshVertex must match the 12 float vertex layout");
+
+template <size_t VertexCount, size_t IndexCount>
+struct MeshData {
+	static_assert(VertexCount <= 65536, "Meshes are drawn with GL_UNSIGNED_SHORT indices");
+	std::array<MeshVertex, VertexCount> vertices{};
+	std::array<GLushort, IndexCount> indices{};
+};
+
+constexpr MeshVertex UMeshVertex(const MeshPoint& position, const MeshPoint& normal, float u, float v) {
+	return MeshVertex{ { position.x, position.y, position.z }, { 1.0f, 1.0f, 1.0f, 1.0f }, { normal.x, normal.y, normal.z }, { u, v } };
+}
+
+//One flat face from its corners counter-clockwise seen from outside, starting at the bottom left of its texture
+constexpr void UWriteQuad(MeshVertex* vertices, GLushort* indices, GLushort base, const MeshPoint& a, const MeshPoint& b, const MeshPoint& c, const MeshPoint& d) {
+	MeshPoint normal = UMeshNormalize(UMeshCross(b - a, d - a));
+	vertices[0] = UMeshVertex(a, normal, 0.0f, 0.0f);
+	vertices[1] = UMeshVertex(b, normal, 1.0f, 0.0f);
+	vertices[2] = UMeshVertex(c, normal, 1.0f, 1.0f);
+	vertices[3] = UMeshVertex(d, normal, 0.0f, 1.0f);
+	const GLushort quad[6] = { 0, 1, 2, 2, 3, 0 };
+	for (int i = 0; i < 6; ++i)
+		indices[i] = (GLushort)(base + quad[i]);
+}
+
+//-----------------------------------PRISMS------------------------------------------------
+//A trapezoid across x and y, extruded along z; centered on the origin in y and z. A box has the same top and bottom.
+struct PrismShape {
+	float bottomLeft, bottomRight;		//x extent of the bottom face
+	float topLeft, topRight;			//x extent of the top face
+	float height;
+	float depth;
+};
+
+constexpr PrismShape UBoxShape(float width, float height, float depth) {
+	return PrismShape{ -0.5f * width, 0.5f * width, -0.5f * width, 0.5f * width, height, depth };
+}
+
+const size_t PRISM_VERTEX_COUNT = 24;
+const size_t PRISM_INDEX_COUNT = 36;
+
+//Front, right, back, left, top, bottom
+constexpr void UWritePrism(const PrismShape& shape, MeshVertex* vertices, GLushort* indices) {
+	const float bottom = -0.5f * shape.height;
+	const float top = 0.5f * shape.height;
+	const float back = -0.5f * shape.depth;
+	const float front = 0.5f * shape.depth;
+	const MeshPoint corners[6][4] = {
+		{ { shape.bottomLeft, bottom, front }, { shape.bottomRight, bottom, front }, { shape.topRight, top, front }, { shape.topLeft, top, front } },
+		{ { shape.bottomRight, bottom, front }, { shape.bottomRight, bottom, back }, { shape.topRight, top, back }, { shape.topRight, top, front } },
+		{ { shape.bottomRight, bottom, back }, { shape.bottomLeft, bottom, back }, { shape.topLeft, top, back }, { shape.topRight, top, back } },
+		{ { shape.bottomLeft, bottom, back }, { shape.bottomLeft, bottom, front }, { shape.topLeft, top, front }, { shape.topLeft, top, back } },
+		{ { shape.topLeft, top, front }, { shape.topRight, top, front }, { shape.topRight, top, back }, { shape.topLeft, top, back } },
+		{ { shape.bottomLeft, bottom, back }, { shape.bottomRight, bottom, back }, { shape.bottomRight, bottom, front }, { shape.bottomLeft, bottom, front } },
+	};
+	for (int face = 0; face < 6; ++face)
+		UWriteQuad(vertices + face * 4, indices + face * 6, (GLushort)(face * 4), corners[face][0], corners[face][1], corners[face][2], corners[face][3]);
+}
+
+constexpr MeshData<PRISM_VERTEX_COUNT, PRISM_INDEX_COUNT> UMakePrism(const PrismShape& shape) {
+	MeshData<PRISM_VERTEX_COUNT, PRISM_INDEX_COUNT> mesh;
+	UWritePrism(shape, mesh.vertices.data(), mesh.indices.data());
+	return mesh;
+}
+
+//-----------------------------------CYLINDERS---------------------------------------------
+//Around the y axis, centered on the origin. The side repeats its first column so the texture wraps once around it;
+//each cap is a fan around its center.
+constexpr size_t UCylinderVertexCount(size_t segments) {
+	return 2 * (segments + 1) + 2 * (segments + 2);
+}
+
+constexpr size_t UCylinderIndexCount(size_t segments) {
+	return 12 * segments;
+}
+
+constexpr void UWriteCylinder(float radius, float height, size_t segments, MeshVertex* vertices, GLushort* indices) {
+	const float bottom = -0.5f * height;
+	const float top = 0.5f * height;
+	const GLushort capBase[2] = { (GLushort)(2 * (segments + 1)), (GLushort)(2 * (segments + 1) + segments + 2) };
+	vertices[capBase[0]] = UMeshVertex(MeshPoint{ 0.0f, top, 0.0f }, MeshPoint{ 0.0f, 1.0f, 0.0f }, 0.5f, 0.5f);
+	vertices[capBase[1]] = UMeshVertex(MeshPoint{ 0.0f, bottom, 0.0f }, MeshPoint{ 0.0f, -1.0f, 0.0f }, 0.5f, 0.5f);
+
+	for (size_t i = 0; i <= segments; ++i) {
+		double angle = 2.0 * MESH_PI * (double)i / (double)segments;
+		float s = (float)UMeshSin(angle);
+		float c = (float)UMeshCos(angle);
+		float u = (float)i / (float)segments;
+		MeshPoint side{ s, 0.0f, c };
+		vertices[2 * i] = UMeshVertex(MeshPoint{ radius * s, bottom, radius * c }, side, u, 0.0f);
+		vertices[2 * i + 1] = UMeshVertex(MeshPoint{ radius * s, top, radius * c }, side, u, 1.0f);
+		vertices[capBase[0] + 1 + i] = UMeshVertex(MeshPoint{ radius * s, top, radius * c }, MeshPoint{ 0.0f, 1.0f, 0.0f }, 0.5f + 0.5f * s, 0.5f + 0.5f * c);
+		vertices[capBase[1] + 1 + i] = UMeshVertex(MeshPoint{ radius * s, bottom, radius * c }, MeshPoint{ 0.0f, -1.0f, 0.0f }, 0.5f + 0.5f * s, 0.5f - 0.5f * c);
+	}
+
+	GLushort* index = indices;
+	for (size_t i = 0; i < segments; ++i) {
+		GLushort a = (GLushort)(2 * i);
+		const GLushort side[6] = { a, (GLushort)(a + 2), (GLushort)(a + 3), (GLushort)(a + 3), (GLushort)(a + 1), a };
+		for (GLushort value : side)
+			*index++ = value;
+
+		*index++ = capBase[0];
+		*index++ = (GLushort)(capBase[0] + 1 + i);
+		*index++ = (GLushort)(capBase[0] + 2 + i);
+		*index++ = capBase[1];
+		*index++ = (GLushort)(capBase[1] + 2 + i);
+		*index++ = (GLushort)(capBase[1] + 1 + i);
+	}
+}
+
+template <size_t Segments>
+constexpr MeshData<UCylinderVertexCount(Segments), UCylinderIndexCount(Segments)> UMakeCylinder(float radius, float height) {
+	static_assert(Segments >= 3, "A cylinder needs at least 3 segments");
+	MeshData<UCylinderVertexCount(Segments), UCylinderIndexCount(Segments)> mesh;
+	UWriteCylinder(radius, height, Segments, mesh.vertices.data(), mesh.indices.data());
+	return mesh;
+}
+
+//-----------------------------------SPHERES-----------------------------------------------
+//Latitude rings from the top pole down and longitude segments around the y axis; both poles and the seam are
+//repeated so the texture wraps once around it
+constexpr size_t USphereVertexCount(size_t rings, size_t segments) {
+	return (rings + 1) * (segments + 1);
+}
+
+constexpr size_t USphereIndexCount(size_t rings, size_t segments) {
+	return 6 * rings * segments;
+}
+
+constexpr void UWriteSphere(float radius, size_t rings, size_t segments, MeshVertex* vertices, GLushort* indices) {
+	for (size_t ring = 0; ring <= rings; ++ring) {
+		double latitude = MESH_PI * (double)ring / (double)rings;
+		float ringRadius = (float)UMeshSin(latitude);
+		float y = (float)UMeshCos(latitude);
+		for (size_t i = 0; i <= segments; ++i) {
+			double longitude = 2.0 * MESH_PI * (double)i / (double)segments;
+			MeshPoint normal{ ringRadius * (float)UMeshSin(longitude), y, ringRadius * (float)UMeshCos(longitude) };
+			MeshPoint position{ radius * normal.x, radius * normal.y, radius * normal.z };
+			vertices[ring * (segments + 1) + i] = UMeshVertex(position, normal, (float)i / (float)segments, 1.0f - (float)ring / (float)rings);
+		}
+	}
+
+	GLushort* index = indices;
+	for (size_t ring = 0; ring < rings; ++ring) {
+		for (size_t i = 0; i < segments; ++i) {
+			GLushort upper = (GLushort)(ring * (segments + 1) + i);
+			GLushort lower = (GLushort)(upper + segments + 1);
+			const GLushort quad[6] = { lower, (GLushort)(lower + 1), (GLushort)(upper + 1), (GLushort)(upper + 1), upper, lower };
+			for (GLushort value : quad)
+				*index++ = value;
+		}
+	}
+}
+
+template <size_t Rings, size_t Segments>
+constexpr MeshData<USphereVertexCount(Rings, Segments), USphereIndexCount(Rings, Segments)> UMakeSphere(float radius) {
+	static_assert(Rings >= 2 && Segments >= 3, "A sphere needs at least 2 rings and 3 segments");
+	MeshData<USphereVertexCount(Rings, Segments), USphereIndexCount(Rings, Segments)> mesh;
+	UWriteSphere(radius, Rings, Segments, mesh.vertices.data(), mesh.indices.data());
+	return mesh;
+}
+
+//-----------------------------------CHECKS------------------------------------------------
+//False if triangle 'triangle' winds clockwise seen from the side its first vertex's normal points to. The triangles
+//a sphere collapses at its poles have no area and pass.
+template <size_t VertexCount, size_t IndexCount>
+constexpr bool UMeshFacesOut(const MeshData<VertexCount, IndexCount>& mesh, size_t triangle) {
+	const MeshVertex& a = mesh.vertices[mesh.indices[3 * triangle]];
+	const MeshVertex& b = mesh.vertices[mesh.indices[3 * triangle + 1]];
+	const MeshVertex& c = mesh.vertices[mesh.indices[3 * triangle + 2]];
+	MeshPoint pa{ a.position[0], a.position[1], a.position[2] };
+	MeshPoint face = UMeshCross(MeshPoint{ b.position[0], b.position[1], b.position[2] } - pa, MeshPoint{ c.position[0], c.position[1], c.position[2] } - pa);
+	return face.x * a.normal[0] + face.y * a.normal[1] + face.z * a.normal[2] > -1e-4f;
+}
+
+template <size_t VertexCount, size_t IndexCount>
+constexpr bool UMeshAllFaceOut(const MeshData<VertexCount, IndexCount>& mesh) {
+	for (size_t triangle = 0; triangle < IndexCount / 3; ++triangle) {
+		if (!UMeshFacesOut(mesh, triangle))
+			return false;
+	}
+	return true;
+}
+
+//The generators are checked on small shapes while compiling: no triangle faces in, and the poles and rims land
+//where the dimensions put them
+constexpr auto CHECK_CYLINDER = UMakeCylinder<8>(1.0f, 2.0f);
+constexpr auto CHECK_SPHERE = UMakeSphere<4, 8>(2.0f);
+static_assert(UMeshAllFaceOut(CHECK_CYLINDER) && UMeshAllFaceOut(CHECK_SPHERE), "Generated triangles must wind counter-clockwise seen from outside");
+static_assert(CHECK_CYLINDER.vertices[1].position[1] == 1.0f && CHECK_CYLINDER.vertices[1].position[2] == 1.0f, "The cylinder's rim must sit at its radius and half height");
+static_assert(CHECK_SPHERE.vertices[0].position[1] == 2.0f && CHECK_SPHERE.vertices[USphereVertexCount(4, 8) - 1].position[1] < -1.99f,
+	"The sphere's poles must sit at its radius");
+
+//-----------------------------------GPU UPLOAD--------------------------------------------
+//Fills the bound vertex and index buffers with generated data that is already in memory
+template <size_t VertexCount, size_t IndexCount>
+void UBufferMeshData(const MeshData<VertexCount, IndexCount>& data, GLuint& nIndices) {
+	glBufferData(GL_ARRAY_BUFFER, sizeof(data.vertices), data.vertices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(data.indices), data.indices.data(), GL_STATIC_DRAW);
+	nIndices = (GLuint)IndexCount;
+}
+
+//Sizes the bound vertex and index buffers and lets 'write' generate straight into them while they are mapped,
+//with no copy in between. Returns false, with the buffers left empty, if either cannot be mapped.
+template <typename Writer>
+bool UBufferGenerated(size_t vertexCount, size_t indexCount, Writer write, GLuint& nIndices) {
+	nIndices = 0;
+	if (vertexCount > 65536) {
+		LOG_ERROR("ERROR::MESH::TOO_MANY_VERTICES %zu", vertexCount);
+		return false;
+	}
+
+	const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexCount * sizeof(MeshVertex)), NULL, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indexCount * sizeof(GLushort)), NULL, GL_STATIC_DRAW);
+	MeshVertex* vertices = (MeshVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(vertexCount * sizeof(MeshVertex)), access);
+	GLushort* indices = (GLushort*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, (GLsizeiptr)(indexCount * sizeof(GLushort)), access);
+	if (vertices && indices)
+		write(vertices, indices);
+
+	//Unmapping fails if the driver lost the contents; the buffers are then left empty rather than drawn half written
+	bool written = vertices && indices;
+	if (vertices)
+		written = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE && written;
+	if (indices)
+		written = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE && written;
+	if (!written) {
+		LOG_ERROR("ERROR::MESH::MAP_FAILED");
+		glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+		return false;
+	}
+	nIndices = (GLuint)indexCount;
+	return true;
+}
+
+bool UBufferPrism(const PrismShape& shape, GLuint& nIndices) {
+	return UBufferGenerated(PRISM_VERTEX_COUNT, PRISM_INDEX_COUNT,
+		[&shape](MeshVertex* vertices, GLushort* indices) { UWritePrism(shape, vertices, indices); }, nIndices);
+}
+
+bool UBufferCylinder(float radius, float height, size_t segments, GLuint& nIndices) {
+	segments = segments < 3 ? 3 : segments;
+	return UBufferGenerated(UCylinderVertexCount(segments), UCylinderIndexCount(segments),
+		[=](MeshVertex* vertices, GLushort* indices) { UWriteCylinder(radius, height, segments, vertices, indices); }, nIndices);
+}
+
+bool UBufferSphere(float radius, size_t rings, size_t segments, GLuint& nIndices) {
+	rings = rings < 2 ? 2 : rings;
+	segments = segments < 3 ? 3 : segments;
+	return UBufferGenerated(USphereVertexCount(rings, segments), USphereIndexCount(rings, segments),
+		[=](MeshVertex* vertices, GLushort* indices) { UWriteSphere(radius, rings, segments, vertices, indices); }, nIndices);
+}
+
+#endif
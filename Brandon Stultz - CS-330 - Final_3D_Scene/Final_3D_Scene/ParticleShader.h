@@ -0,0 +1,232 @@
+#ifndef PARTICLESHADE_H
+#define PARTICLESHADE_H
+
+//Dust motes around the key light: compute shaders that age, move, compact, and emit particles in storage buffers,
+//and the billboard program that draws them straight from those buffers
+
+
+//Declarations shared by the compute shaders
+#define PARTICLE_COMPUTE_COMMON \
+"struct Particle\n" \
+"{\n" \
+"	vec4 positionAge;\n"							/* Age in seconds */ \
+"	vec4 velocityLifetime;\n" \
+"};\n" \
+"layout (std430, binding = 0) readonly buffer SourceParticles { Particle source[]; };\n" \
+"layout (std430, binding = 1) writeonly buffer DestinationParticles { Particle destination[]; };\n" \
+"layout (std430, binding = 2) buffer ParticleCounters\n" \
+"{\n" \
+"	uint vertexCount;\n"							/* Indirect draw arguments */ \
+"	uint instanceCount;\n" \
+"	uint firstVertex;\n" \
+"	uint baseInstance;\n" \
+"	uint groupsX;\n"								/* Indirect dispatch arguments for the next simulation */ \
+"	uint groupsY;\n" \
+"	uint groupsZ;\n" \
+"	uint liveCount;\n"								/* Particles in the source buffer */ \
+"	uint writtenCount;\n"							/* Appended to the destination buffer; may pass the capacity */ \
+"};\n" \
+"uniform uint capacity;\n" \
+"uint hash(uint x)\n" \
+"{\n" \
+"	x ^= x >> 16; x *= 0x7feb352dU; x ^= x >> 15; x *= 0x846ca68bU; x ^= x >> 16;\n" \
+"	return x;\n" \
+"}\n" \
+"float random(inout uint state)\n" \
+"{\n" \
+"	state = hash(state);\n" \
+"	return float(state >> 8) / 16777216.0f;\n" \
+"}\n"
+
+
+//Ages and moves last frame's particles; survivors are appended to the destination buffer, so dead ones drop out
+//without leaving holes. Each workgroup reserves its survivors' slots with one atomic on the global count.
+const char* particleSimulateComputeSource = "#version 440 core\n"
+
+"layout (local_size_x = 256) in;\n"
+
+PARTICLE_COMPUTE_COMMON
+
+"uniform float deltaTime;\n"
+"uniform float time;\n"
+"uniform vec3 lightPosition;\n"
+
+"shared uint groupSurvivors;\n"
+"shared uint groupBase;\n"
+
+"void main()\n"
+"{\n"
+
+"	if (gl_LocalInvocationIndex == 0)\n"
+"		groupSurvivors = 0;\n"
+"	barrier();\n"
+
+"	uint index = gl_GlobalInvocationID.x;\n"
+"	bool alive = false;\n"
+"	uint slot = 0;\n"
+"	Particle particle;\n"
+"	if (index < liveCount) {\n"
+"		particle = source[index];\n"
+"		particle.positionAge.w += deltaTime;\n"
+"		alive = particle.positionAge.w < particle.velocityLifetime.w;\n"
+"	}\n"
+
+"	if (alive) {\n"
+"		vec3 position = particle.positionAge.xyz;\n"
+"		vec3 velocity = particle.velocityLifetime.xyz;\n"
+
+		//Turbulence: a smooth random push that changes slowly along the particle's path
+"		uint state = index * 9781U + uint(time * 4.0f) * 6271U;\n"
+"		vec3 push = vec3(sin(position.y * 3.1f + time * 0.7f + random(state) * 0.3f),\n"
+"			sin(position.z * 2.7f + time * 0.5f),\n"
+"			sin(position.x * 2.9f + time * 0.6f));\n"
+"		velocity += push * 0.05f * deltaTime;\n"
+
+		//Warm air rises near the lamp; everything else settles slowly
+"		vec3 toLight = lightPosition - position;\n"
+"		float warmth = exp(-dot(toLight, toLight) * 2.0f);\n"
+"		velocity.y += (0.12f * warmth - 0.01f) * deltaTime;\n"
+"		velocity *= exp(-0.8f * deltaTime);\n"
+
+"		particle.positionAge.xyz = position + velocity * deltaTime;\n"
+"		particle.velocityLifetime.xyz = velocity;\n"
+"		slot = atomicAdd(groupSurvivors, 1U);\n"
+"	}\n"
+"	barrier();\n"
+
+"	if (gl_LocalInvocationIndex == 0)\n"
+"		groupBase = atomicAdd(writtenCount, groupSurvivors);\n"
+"	barrier();\n"
+
+"	if (alive)\n"
+"		destination[groupBase + slot] = particle;\n"
+
+"}\0";
+
+
+//Appends new particles in a shell around the light, after the survivors; the ones past the capacity are dropped.
+//A spread above 0 starts them part way through their lives, which fills the buffer at once without a burst dying together.
+const char* particleEmitComputeSource = "#version 440 core\n"
+
+"layout (local_size_x = 64) in;\n"
+
+PARTICLE_COMPUTE_COMMON
+
+"uniform uint emitCount;\n"
+"uniform uint seed;\n"
+"uniform vec3 lightPosition;\n"
+"uniform float radius;\n"
+"uniform float ageSpread;\n"
+
+"void main()\n"
+"{\n"
+
+"	if (gl_GlobalInvocationID.x >= emitCount)\n"
+"		return;\n"
+"	uint slot = atomicAdd(writtenCount, 1U);\n"
+"	if (slot >= capacity)\n"
+"		return;\n"
+
+"	uint state = hash(gl_GlobalInvocationID.x ^ seed);\n"
+"	vec3 direction = normalize(vec3(random(state), random(state), random(state)) * 2.0f - 1.0f + 1e-4f);\n"
+"	float distance = radius * (0.3f + 0.7f * pow(random(state), 0.5f));\n"
+"	float lifetime = 4.0f + 4.0f * random(state);\n"
+
+"	Particle particle;\n"
+"	particle.positionAge = vec4(lightPosition + direction * distance, lifetime * ageSpread * random(state));\n"
+"	particle.velocityLifetime = vec4((vec3(random(state), random(state), random(state)) - 0.5f) * 0.02f, lifetime);\n"
+"	destination[slot] = particle;\n"
+
+"}\0";
+
+
+//One invocation: clamps the count to the capacity and writes the next draw and simulation dispatch from it
+const char* particleFinalizeComputeSource = "#version 440 core\n"
+
+"layout (local_size_x = 1) in;\n"
+
+PARTICLE_COMPUTE_COMMON
+
+"void main()\n"
+"{\n"
+
+"	uint live = min(writtenCount, capacity);\n"
+"	vertexCount = 4U;\n"
+"	instanceCount = live;\n"
+"	firstVertex = 0U;\n"
+"	baseInstance = 0U;\n"
+"	groupsX = (live + 255U) / 256U;\n"
+"	groupsY = 1U;\n"
+"	groupsZ = 1U;\n"
+"	liveCount = live;\n"
+"	writtenCount = 0U;\n"
+
+"}\0";
+
+
+//One camera-facing quad per particle, as a 4 vertex strip per instance
+const char* particleVertexShaderSource = "#version 440 core\n"
+
+"struct Particle\n"
+"{\n"
+"	vec4 positionAge;\n"
+"	vec4 velocityLifetime;\n"
+"};\n"
+"layout (std430, binding = 0) readonly buffer Particles { Particle particles[]; };\n"
+
+//Per-frame camera and light, as in the scene shaders
+"layout (std140, binding = 1) uniform FrameBlock\n"
+"{\n"
+"	mat4 view;\n"
+"	mat4 projection;\n"
+"	vec3 objectColor;\n"
+"	float specIntensity;\n"
+"	vec3 lightColor;\n"
+"	vec3 lightPos;\n"
+"	vec3 viewPosition;\n"
+"	float shadowFarPlane;\n"
+"	vec4 shadowFaceLights[6];\n"
+"};\n"
+
+"uniform float particleSize;\n"
+
+"out vec2 corner;\n"
+"out vec3 moteColor;\n"
+
+"void main()\n"
+"{\n"
+
+"	Particle particle = particles[gl_InstanceID];\n"
+"	corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0f - 1.0f;\n"
+
+	//Fade in and out over the particle's life, and with distance from the light that shows it
+"	float life = particle.positionAge.w / particle.velocityLifetime.w;\n"
+"	float fade = smoothstep(0.0f, 0.15f, life) * (1.0f - smoothstep(0.7f, 1.0f, life));\n"
+"	vec3 toLight = lightPos - particle.positionAge.xyz;\n"
+"	moteColor = lightColor * specIntensity * fade * 0.6f / (1.0f + 4.0f * dot(toLight, toLight));\n"
+
+"	vec4 center = view * vec4(particle.positionAge.xyz, 1.0f);\n"
+"	gl_Position = projection * vec4(center.xy + corner * particleSize, center.z, 1.0f);\n"
+
+"}\0";
+
+
+const char* particleFragmentShaderSource = "#version 440 core\n"
+
+"in vec2 corner;\n"
+"in vec3 moteColor;\n"
+
+"out vec4 fragmentColor;\n"
+
+"void main()\n"
+"{\n"
+
+	//Soft round mote, added to the scene
+"	float falloff = 1.0f - dot(corner, corner);\n"
+"	if (falloff <= 0.0f)\n"
+"		discard;\n"
+"	fragmentColor = vec4(moteColor * falloff * falloff, 1.0f);\n"
+
+"}\0";
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+/*GPU dust particles around the key light
+* Particles live only in GPU storage buffers. Each update runs three compute passes: the simulation ages and moves last
+* frame's particles and appends the survivors to the other buffer, emission appends new ones after them, and a single
+* invocation turns the count into the arguments for the next draw and the next simulation dispatch. The billboards are
+* then drawn with an indirect instanced draw from the same counter buffer.
+*
+* Nothing about the particles is read back: the CPU only decides how many to emit, from the frame time and the
+* capacity, and flips which buffer is current. Emission past the capacity is dropped on the GPU.
+*/
+
+#include <cstdint>
+
+#include "Logger.h"
+#include "ParticleShader.h"
+
+//Defined in Source.cpp
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programID);
+
+const GLuint PARTICLE_SOURCE_BINDING = 0;
+const GLuint PARTICLE_DESTINATION_BINDING = 1;
+const GLuint PARTICLE_COUNTER_BINDING = 2;
+const GLuint PARTICLE_EMIT_GROUP = 64;
+const float PARTICLE_MEAN_LIFETIME = 6.0f;		//Matches the 4 to 8 seconds the emitter gives out
+const float PARTICLE_MAX_STEP = 0.1f;			//Longer gaps between frames are simulated as this
+const GLuint PARTICLE_MAX_CAPACITY = 1u << 22;	//128 MB per buffer
+
+//std430 layout of one particle; 32 bytes
+struct GpuParticle {
+	float positionAge[4];
+	float velocityLifetime[4];
+};
+
+//std430 'ParticleCounters': the indirect draw arguments, then the indirect dispatch arguments for the next simulation
+struct ParticleCounters {
+	GLuint vertexCount;
+	GLuint instanceCount;
+	GLuint firstVertex;
+	GLuint baseInstance;
+	GLuint groupsX;
+	GLuint groupsY;
+	GLuint groupsZ;
+	GLuint liveCount;					//Particles in the current buffer
+	GLuint writtenCount;				//Appended to the other buffer during an update
+};
+const GLintptr PARTICLE_DISPATCH_OFFSET = 4 * sizeof(GLuint);
+
+struct ParticleSystem {
+	GLuint capacity = 0;				//0 when there is no particle system
+	float emitRadius = 1.5f;			//Around the light
+	float particleSize = 0.008f;		//Half width of a billboard
+
+	GLuint buffers[2] = {};				//Particles; 'current' holds the live ones, the other is written by the next update
+	int current = 0;
+	GLuint counters = 0;
+	GLuint vao = 0;						//Empty; billboards are built from gl_VertexID and gl_InstanceID
+
+	GLuint simulateProgram = 0;
+	GLuint emitProgram = 0;
+	GLuint finalizeProgram = 0;
+	GLuint drawProgram = 0;
+	GLint deltaTimeLocation = -1;
+	GLint timeLocation = -1;
+	GLint simulateLightLocation = -1;
+	GLint emitCountLocation = -1;
+	GLint seedLocation = -1;
+	GLint emitLightLocation = -1;
+	GLint radiusLocation = -1;
+	GLint ageSpreadLocation = -1;
+	GLint particleSizeLocation = -1;
+
+	double emitOwed = 0.0;				//Fraction of a particle carried to the next update
+	float time = 0.0f;
+	uint32_t seed = 0x9E3779B9u;
+	bool filled = false;				//The first update fills the buffer at once
+};
+
+//Compiles and links a single compute shader
+bool UCreateComputeProgram(const char* computeSource, GLuint& programID) {
+	int success = 0;
+	char infoLog[512];
+
+	GLuint shaderID = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shaderID, 1, &computeSource, NULL);
+	glCompileShader(shaderID);
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		LOG_ERROR("ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n%s", infoLog);
+		glDeleteShader(shaderID);
+		programID = 0;
+		return false;
+	}
+
+	programID = glCreateProgram();
+	glAttachShader(programID, shaderID);
+	glLinkProgram(programID);
+	glDeleteShader(shaderID);
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		LOG_ERROR("ERROR::SHADER::PROGRAM::LINKING_FAILED%s", infoLog);
+		glDeleteProgram(programID);
+		programID = 0;
+		return false;
+	}
+	return true;
+}
+
+void UDestroyParticleSystem(ParticleSystem& system) {
+	glDeleteBuffers(2, system.buffers);
+	glDeleteBuffers(1, &system.counters);
+	glDeleteVertexArrays(1, &system.vao);
+	glDeleteProgram(system.simulateProgram);
+	glDeleteProgram(system.emitProgram);
+	glDeleteProgram(system.finalizeProgram);
+	glDeleteProgram(system.drawProgram);
+	system = ParticleSystem();
+}
+
+//Needs a 4.3 context for compute shaders and storage buffers; leaves the capacity at 0 when they are missing
+bool UCreateParticleSystem(ParticleSystem& system, GLuint capacity) {
+	if (capacity == 0)
+		return false;
+
+	if (!UCreateComputeProgram(particleSimulateComputeSource, system.simulateProgram) ||
+		!UCreateComputeProgram(particleEmitComputeSource, system.emitProgram) ||
+		!UCreateComputeProgram(particleFinalizeComputeSource, system.finalizeProgram) ||
+		!UCreateShaderProgram(particleVertexShaderSource, particleFragmentShaderSource, system.drawProgram)) {
+		UDestroyParticleSystem(system);
+		return false;
+	}
+
+	system.deltaTimeLocation = glGetUniformLocation(system.simulateProgram, "deltaTime");
+	system.timeLocation = glGetUniformLocation(system.simulateProgram, "time");
+	system.simulateLightLocation = glGetUniformLocation(system.simulateProgram, "lightPosition");
+	system.emitCountLocation = glGetUniformLocation(system.emitProgram, "emitCount");
+	system.seedLocation = glGetUniformLocation(system.emitProgram, "seed");
+	system.emitLightLocation = glGetUniformLocation(system.emitProgram, "lightPosition");
+	system.radiusLocation = glGetUniformLocation(system.emitProgram, "radius");
+	system.ageSpreadLocation = glGetUniformLocation(system.emitProgram, "ageSpread");
+	system.particleSizeLocation = glGetUniformLocation(system.drawProgram, "particleSize");
+
+	//Every compute program clamps against the same capacity
+	const GLuint programs[3] = { system.simulateProgram, system.emitProgram, system.finalizeProgram };
+	for (GLuint program : programs)
+		glProgramUniform1ui(program, glGetUniformLocation(program, "capacity"), capacity);
+
+	glGenBuffers(2, system.buffers);
+	for (int i = 0; i < 2; ++i) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.buffers[i]);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)capacity * sizeof(GpuParticle), NULL, 0);
+	}
+
+	//Starts empty: no instances to draw and no groups to simulate
+	ParticleCounters counters = {};
+	glGenBuffers(1, &system.counters);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.counters);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(counters), &counters, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenVertexArrays(1, &system.vao);
+	system.capacity = capacity;
+
+	LOG_INFO("INFO: Particles: %u dust motes, %.1f MB on the GPU", capacity, 2.0 * capacity * sizeof(GpuParticle) / (1024.0 * 1024.0));
+	return true;
+}
+
+//Advances the particles by 'seconds' around the light and emits their replacements; all on the GPU
+void UUpdateParticles(ParticleSystem& system, float seconds, const glm::vec3& lightPosition) {
+	if (!system.capacity)
+		return;
+	seconds = seconds < 0.0f ? 0.0f : (seconds > PARTICLE_MAX_STEP ? PARTICLE_MAX_STEP : seconds);
+	system.time += seconds;
+
+	//Steady state holds about the capacity: the emission rate replaces what dies. The first update fills the buffer
+	//with particles already part way through their lives.
+	GLuint emitCount = system.capacity;
+	float ageSpread = 1.0f;
+	if (system.filled) {
+		system.emitOwed += (double)system.capacity / PARTICLE_MEAN_LIFETIME * seconds;
+		emitCount = (GLuint)system.emitOwed;
+		system.emitOwed -= emitCount;
+		ageSpread = 0.0f;
+	}
+	system.filled = true;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_SOURCE_BINDING, system.buffers[system.current]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_DESTINATION_BINDING, system.buffers[1 - system.current]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNTER_BINDING, system.counters);
+
+	//Survivors, with as many groups as the last update left alive
+	glUseProgram(system.simulateProgram);
+	glUniform1f(system.deltaTimeLocation, seconds);
+	glUniform1f(system.timeLocation, system.time);
+	glUniform3fv(system.simulateLightLocation, 1, glm::value_ptr(lightPosition));
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, system.counters);
+	glDispatchComputeIndirect(PARTICLE_DISPATCH_OFFSET);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	if (emitCount) {
+		system.seed = system.seed * 1664525u + 1013904223u;
+		glUseProgram(system.emitProgram);
+		glUniform1ui(system.emitCountLocation, emitCount);
+		glUniform1ui(system.seedLocation, system.seed);
+		glUniform3fv(system.emitLightLocation, 1, glm::value_ptr(lightPosition));
+		glUniform1f(system.radiusLocation, system.emitRadius);
+		glUniform1f(system.ageSpreadLocation, ageSpread);
+		glDispatchCompute((emitCount + PARTICLE_EMIT_GROUP - 1) / PARTICLE_EMIT_GROUP, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	glUseProgram(system.finalizeProgram);
+	glDispatchCompute(1, 1, 1);
+
+	//The counters are read next as draw and dispatch arguments, the particles by the billboards and the next update
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	system.current = 1 - system.current;
+}
+
+//Draws the live particles as additive billboards into the bound framebuffer; the frame block must be bound.
+//They are depth tested against the scene but do not write depth, so their order does not matter.
+void UDrawParticles(const ParticleSystem& system) {
+	if (!system.capacity)
+		return;
+
+	glUseProgram(system.drawProgram);
+	glUniform1f(system.particleSizeLocation, system.particleSize);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_SOURCE_BINDING, system.buffers[system.current]);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, system.counters);
+	glBindVertexArray(system.vao);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glDepthMask(GL_FALSE);
+	glDrawArraysIndirect(GL_TRIANGLE_STRIP, 0);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+//Live particle count; waits for the GPU, so only for tools
+GLuint UReadParticleCount(const ParticleSystem& system) {
+	if (!system.capacity)
+		return 0;
+	ParticleCounters counters = {};
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.counters);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), &counters);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return counters.liveCount;
+}
+
+#endif
@@ -0,0 +1,350 @@
+#ifndef RAYQUERY_H
+#define RAYQUERY_H
+
+/*Ray queries against the scene (object picking)
+* Two levels of bounding volume hierarchy:
+*   - BLAS: one per mesh, over its triangles in object space (Bvh.h). It is built once, when the mesh is read back.
+*   - TLAS: over the instances' world space boxes. An instance points at its mesh's BLAS and keeps the inverse of its
+*     model matrix. The TLAS is rebuilt from the current models before a query; with one node per instance or two,
+*     that costs little next to the meshes.
+* A ray descends the TLAS, is moved into each instance it reaches with the inverse model, and continues down that
+* instance's BLAS. The direction is not renormalized in object space, so hit distances stay in the units of the world
+* ray and compare across instances. Of a node's two children the nearer box is visited first, and a box is skipped
+* once the closest hit so far lies in front of it.
+* A hit reports the entity (the id the instance was added with), the mesh triangle, the barycentric coordinates, and
+* the texture coordinate interpolated from the triangle's vertices.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bvh.h"
+
+//Interleaved mesh layout shared with UCreateMesh: position(3) color(4) normal(3) uv(2)
+const int RAY_QUERY_FLOATS_PER_VERTEX = 12;
+const int RAY_QUERY_UV_OFFSET = 10;
+
+const uint32_t TLAS_MAX_LEAF = 2;
+const size_t RAY_QUERY_ARENA_SIZE = 1024 * 1024;		//Jobs for one parallel-for over a batch of rays
+
+//---------------------------------------SCENE---------------------------------------------
+//A mesh's BLAS, with what a hit needs to find its texture coordinate
+struct RayQueryMesh {
+	Bvh blas;								//Triangle ids are triangle indices into 'indices'
+	std::vector<glm::vec2> uvs;				//Per vertex
+	std::vector<uint32_t> indices;			//Three per triangle
+};
+
+struct RayQueryInstance {
+	int entity;
+	int mesh;								//Index into RayQueryScene::meshes
+	glm::mat4 inverseModel;
+	BvhBounds bounds;						//World space
+};
+
+struct RayQueryScene {
+	std::vector<RayQueryMesh> meshes;
+	std::vector<RayQueryInstance> instances;
+	std::vector<BvhNode> tlas;				//A leaf's 'first' indexes 'order'
+	std::vector<uint32_t> order;			//Instance indices in leaf order
+};
+
+struct RayHit {
+	int entity = -1;						//-1 when nothing was hit
+	int triangle = -1;
+	float distance = FLT_MAX;				//Along the ray, in units of its direction
+	glm::vec2 barycentric = glm::vec2(0.0f);	//Weights of the triangle's second and third vertex
+	glm::vec2 uv = glm::vec2(0.0f);
+	glm::vec3 position = glm::vec3(0.0f);	//World space
+};
+
+//Builds a mesh's BLAS from vertices in the interleaved layout and its triangle list
+void UBuildRayQueryMesh(RayQueryMesh& mesh, const std::vector<float>& vertices, const std::vector<uint32_t>& indices) {
+	size_t vertexCount = vertices.size() / RAY_QUERY_FLOATS_PER_VERTEX;
+	mesh.uvs.resize(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		const float* uv = &vertices[v * RAY_QUERY_FLOATS_PER_VERTEX + RAY_QUERY_UV_OFFSET];
+		mesh.uvs[v] = glm::vec2(uv[0], uv[1]);
+	}
+	mesh.indices = indices;
+
+	mesh.blas.triangles.clear();
+	mesh.blas.triangles.reserve(indices.size() / 3);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		glm::vec3 corners[3];
+		for (int corner = 0; corner < 3; ++corner) {
+			const float* position = &vertices[(size_t)indices[t + corner] * RAY_QUERY_FLOATS_PER_VERTEX];
+			corners[corner] = glm::vec3(position[0], position[1], position[2]);
+		}
+
+		BvhTriangle triangle;
+		triangle.v0 = corners[0];
+		triangle.edge1 = corners[1] - corners[0];
+		triangle.edge2 = corners[2] - corners[0];
+		glm::vec3 normal = glm::cross(triangle.edge1, triangle.edge2);
+		float length = glm::length(normal);
+		triangle.normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		triangle.id = (int)(t / 3);
+		mesh.blas.triangles.push_back(triangle);
+	}
+
+	if (mesh.blas.triangles.empty())
+		mesh.blas.nodes.clear();
+	else
+		UBuildBvh(mesh.blas);
+}
+
+//Places a mesh in the scene; its world box is the BLAS root's corners moved by 'model'. Empty meshes are left out.
+void UAddRayQueryInstance(RayQueryScene& scene, int entity, int mesh, const glm::mat4& model) {
+	const RayQueryMesh& source = scene.meshes[mesh];
+	if (source.blas.nodes.empty())
+		return;
+
+	RayQueryInstance instance;
+	instance.entity = entity;
+	instance.mesh = mesh;
+	instance.inverseModel = glm::inverse(model);
+	const BvhNode& root = source.blas.nodes[0];
+	for (int corner = 0; corner < 8; ++corner) {
+		glm::vec3 point((corner & 1) ? root.boundsMax.x : root.boundsMin.x, (corner & 2) ? root.boundsMax.y : root.boundsMin.y,
+			(corner & 4) ? root.boundsMax.z : root.boundsMin.z);
+		UGrowBounds(instance.bounds, glm::vec3(model * glm::vec4(point, 1.0f)));
+	}
+	scene.instances.push_back(instance);
+}
+
+glm::vec3 UBoundsCenter(const BvhBounds& bounds) {
+	return (bounds.minimum + bounds.maximum) * 0.5f;
+}
+
+//Splits TLAS node 'index' at the median instance along its longest axis
+void USubdivideTlas(RayQueryScene& scene, uint32_t index, int depth) {
+	BvhNode node = scene.tlas[index];
+	if (node.count <= TLAS_MAX_LEAF || depth >= BVH_MAX_DEPTH)
+		return;
+
+	glm::vec3 extent = node.boundsMax - node.boundsMin;
+	int axis = extent.y > extent.x ? 1 : 0;
+	if (extent.z > extent[axis])
+		axis = 2;
+	auto first = scene.order.begin() + node.leftFirst;
+	std::nth_element(first, first + node.count / 2, first + node.count, [&](uint32_t a, uint32_t b) {
+		return UBoundsCenter(scene.instances[a].bounds)[axis] < UBoundsCenter(scene.instances[b].bounds)[axis];
+	});
+
+	uint32_t leftIndex = (uint32_t)scene.tlas.size();
+	BvhNode children[2];
+	children[0].leftFirst = node.leftFirst;
+	children[0].count = node.count / 2;
+	children[1].leftFirst = node.leftFirst + node.count / 2;
+	children[1].count = node.count - node.count / 2;
+	for (BvhNode& child : children) {
+		BvhBounds bounds;
+		for (uint32_t i = child.leftFirst; i < child.leftFirst + child.count; ++i)
+			UGrowBounds(bounds, scene.instances[scene.order[i]].bounds);
+		child.boundsMin = bounds.minimum;
+		child.boundsMax = bounds.maximum;
+		scene.tlas.push_back(child);
+	}
+
+	scene.tlas[index].leftFirst = leftIndex;
+	scene.tlas[index].count = 0;
+	USubdivideTlas(scene, leftIndex, depth + 1);
+	USubdivideTlas(scene, leftIndex + 1, depth + 1);
+}
+
+//Rebuilds the TLAS over the instances added since the last UClearRayQueryInstances
+void UBuildTlas(RayQueryScene& scene) {
+	scene.tlas.clear();
+	scene.order.resize(scene.instances.size());
+	if (scene.instances.empty())
+		return;
+	scene.tlas.reserve(scene.instances.size() * 2);
+
+	BvhBounds bounds;
+	for (uint32_t i = 0; i < (uint32_t)scene.instances.size(); ++i) {
+		scene.order[i] = i;
+		UGrowBounds(bounds, scene.instances[i].bounds);
+	}
+
+	BvhNode root;
+	root.boundsMin = bounds.minimum;
+	root.boundsMax = bounds.maximum;
+	root.leftFirst = 0;
+	root.count = (uint32_t)scene.instances.size();
+	scene.tlas.push_back(root);
+	USubdivideTlas(scene, 0, 0);
+}
+
+//Keeps the meshes; the instances are added again with their current models before the next UBuildTlas
+void UClearRayQueryInstances(RayQueryScene& scene) {
+	scene.instances.clear();
+	scene.tlas.clear();
+	scene.order.clear();
+}
+
+//-------------------------------------TRAVERSAL-------------------------------------------
+//Distance at which the ray enters a box, or FLT_MAX if it misses the box or enters it beyond 'maxDistance'
+float URayBoxDistance(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	float maxDistance) {
+
+	glm::vec3 t1 = (boundsMin - origin) * inverseDirection;
+	glm::vec3 t2 = (boundsMax - origin) * inverseDirection;
+	glm::vec3 nearest = glm::min(t1, t2);
+	glm::vec3 farthest = glm::max(t1, t2);
+	float entry = std::max(std::max(nearest.x, nearest.y), nearest.z);
+	float exit = std::min(std::min(farthest.x, farthest.y), farthest.z);
+	if (entry > exit || exit < 0.0f || entry >= maxDistance)
+		return FLT_MAX;
+	return entry;
+}
+
+//Moller-Trumbore; both sides of a triangle count, as a click on either should pick it
+bool UIntersectRay(const BvhTriangle& triangle, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+	float& distance, float& u, float& v) {
+
+	glm::vec3 p = glm::cross(direction, triangle.edge2);
+	float determinant = glm::dot(triangle.edge1, p);
+	if (std::fabs(determinant) < 1e-12f)
+		return false;
+	float inverse = 1.0f / determinant;
+
+	glm::vec3 t = origin - triangle.v0;
+	u = glm::dot(t, p) * inverse;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	glm::vec3 q = glm::cross(t, triangle.edge1);
+	v = glm::dot(direction, q) * inverse;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	distance = glm::dot(triangle.edge2, q) * inverse;
+	return distance > 0.0f && distance < maxDistance;
+}
+
+struct RayQueryStackEntry {
+	uint32_t node;
+	float distance;							//Where the ray enters the node's box
+};
+
+//Pushes a node's children farther box first, so the nearer one is visited next
+void UPushChildren(const std::vector<BvhNode>& nodes, const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection,
+	float maxDistance, RayQueryStackEntry* stack, int& top) {
+
+	const BvhNode& left = nodes[node.leftFirst];
+	const BvhNode& right = nodes[node.leftFirst + 1];
+	RayQueryStackEntry closer = { node.leftFirst, URayBoxDistance(origin, inverseDirection, left.boundsMin, left.boundsMax, maxDistance) };
+	RayQueryStackEntry farther = { node.leftFirst + 1, URayBoxDistance(origin, inverseDirection, right.boundsMin, right.boundsMax, maxDistance) };
+	if (farther.distance < closer.distance)
+		std::swap(closer, farther);
+	if (farther.distance != FLT_MAX)
+		stack[top++] = farther;
+	if (closer.distance != FLT_MAX)
+		stack[top++] = closer;
+}
+
+//Closest hit in one mesh, for a ray in its object space; only hits nearer than hit.distance are taken
+bool UTraceBlas(const RayQueryMesh& mesh, const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) {
+	const Bvh& blas = mesh.blas;
+	glm::vec3 inverseDirection = 1.0f / direction;
+
+	RayQueryStackEntry stack[BVH_MAX_DEPTH * 2 + 2];
+	int top = 0;
+	stack[top++] = { 0, URayBoxDistance(origin, inverseDirection, blas.nodes[0].boundsMin, blas.nodes[0].boundsMax, hit.distance) };
+	bool found = false;
+	while (top > 0) {
+		RayQueryStackEntry entry = stack[--top];
+		if (entry.distance >= hit.distance)
+			continue;
+
+		const BvhNode& node = blas.nodes[entry.node];
+		if (node.count == 0) {
+			UPushChildren(blas.nodes, node, origin, inverseDirection, hit.distance, stack, top);
+			continue;
+		}
+
+		for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+			float distance, u, v;
+			if (UIntersectRay(blas.triangles[i], origin, direction, hit.distance, distance, u, v)) {
+				hit.distance = distance;
+				hit.triangle = blas.triangles[i].id;
+				hit.barycentric = glm::vec2(u, v);
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+//Closest hit along origin + t * direction for 0 < t < maxDistance; returns false (and an entity of -1) on a miss
+bool URayQuery(const RayQueryScene& scene, const glm::vec3& origin, const glm::vec3& direction, RayHit& hit, float maxDistance = FLT_MAX) {
+	hit = RayHit();
+	hit.distance = maxDistance;
+	if (scene.tlas.empty())
+		return false;
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+	const RayQueryInstance* hitInstance = nullptr;
+
+	RayQueryStackEntry stack[BVH_MAX_DEPTH * 2 + 2];
+	int top = 0;
+	stack[top++] = { 0, URayBoxDistance(origin, inverseDirection, scene.tlas[0].boundsMin, scene.tlas[0].boundsMax, hit.distance) };
+	while (top > 0) {
+		RayQueryStackEntry entry = stack[--top];
+		if (entry.distance >= hit.distance)
+			continue;
+
+		const BvhNode& node = scene.tlas[entry.node];
+		if (node.count == 0) {
+			UPushChildren(scene.tlas, node, origin, inverseDirection, hit.distance, stack, top);
+			continue;
+		}
+
+		for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+			const RayQueryInstance& instance = scene.instances[scene.order[i]];
+			if (URayBoxDistance(origin, inverseDirection, instance.bounds.minimum, instance.bounds.maximum, hit.distance) == FLT_MAX)
+				continue;
+
+			glm::vec3 localOrigin = glm::vec3(instance.inverseModel * glm::vec4(origin, 1.0f));
+			glm::vec3 localDirection = glm::vec3(instance.inverseModel * glm::vec4(direction, 0.0f));
+			if (UTraceBlas(scene.meshes[instance.mesh], localOrigin, localDirection, hit))
+				hitInstance = &instance;
+		}
+	}
+
+	if (!hitInstance) {
+		hit.distance = FLT_MAX;
+		return false;
+	}
+
+	const RayQueryMesh& mesh = scene.meshes[hitInstance->mesh];
+	const uint32_t* index = &mesh.indices[(size_t)hit.triangle * 3];
+	hit.entity = hitInstance->entity;
+	hit.uv = mesh.uvs[index[0]] * (1.0f - hit.barycentric.x - hit.barycentric.y) + mesh.uvs[index[1]] * hit.barycentric.x +
+		mesh.uvs[index[2]] * hit.barycentric.y;
+	hit.position = origin + direction * hit.distance;
+	return true;
+}
+
+//------------------------------------UNPROJECTION-----------------------------------------
+//Ray from the near plane through a point of the window, with cursor coordinates as GLFW reports them (origin at the
+//top left, in window units). The direction is unit length, so hit distances are in world units.
+void UUnprojectCursor(double cursorX, double cursorY, int width, int height, const glm::mat4& view, const glm::mat4& projection,
+	glm::vec3& origin, glm::vec3& direction) {
+
+	float x = (float)(2.0 * cursorX / width - 1.0);
+	float y = (float)(1.0 - 2.0 * cursorY / height);
+	glm::mat4 inverse = glm::inverse(projection * view);
+	glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
+
+#endif
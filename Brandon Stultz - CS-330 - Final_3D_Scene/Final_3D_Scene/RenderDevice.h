@@ -0,0 +1,447 @@
+#ifndef RENDERDEVICE_H
+#define RENDERDEVICE_H
+
+/*Render devices
+* The lit objects are submitted through a render device, which owns the pipelines they are drawn with and turns the
+* frame's merged command lists (recorded on the job workers, see DrawLists.h) into GL work. Two devices share the
+* interface:
+*
+*   direct    Binds each draw's buffers, texture, lightmap, and object block, skipping what equals the previous
+*             draw's, then issues one glDrawElements per draw. Sorting keeps most of the binds away.
+*   indirect  Packs the geometry of every source into one arena and binds all material textures and lightmaps once,
+*             as descriptor tables. The whole list is then one glMultiDrawElementsIndirect: each command's base
+*             instance is its draw slot, through which the shader finds the object block the recorders wrote and the
+*             draw's descriptor indices. The GL calls per frame do not grow with the draw count.
+*
+* Pipelines (program and vertex array) are made with the device, so a frame only selects them. The indirect device
+* draws with its compiled-in shader (IndirectShader.h); asset and hot-reloaded scene shaders apply to the direct one.
+* Both devices keep the same stats, so --render-device direct|indirect are compared on the same stats line, and
+* --bench-submit draws one scene through both.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "DrawLists.h"
+#include "FrameArena.h"
+#include "IndirectShader.h"
+#include "Lightmapper.h"
+#include "Logger.h"
+#include "MeshGenerators.h"
+#include "VertexLayout.h"
+
+//Defined in Source.cpp
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programID);
+
+//-----------------------------------VERTEX FORMATS--------------------------------------
+//Mesh vertices are MeshVertex on binding 0; an object's baked lightmap coordinates are a buffer of their own on binding 1
+const GLuint SCENE_VERTEX_BINDING = 0;
+const GLuint SCENE_LIGHTMAP_BINDING = 1;
+using SceneVertexLayout = VertexLayout<
+	VertexAttribute<0, 3>,											//Position
+	VertexAttribute<1, 4>,											//Color, not read by the scene shaders
+	VertexAttribute<3, 3>,											//Normal
+	VertexAttribute<2, 2>,											//UV
+	VertexAttribute<LIGHTMAP_COORDINATE_LOCATION, 2, GL_FLOAT, SCENE_LIGHTMAP_BINDING>>;
+static_assert(ULayoutStride<SceneVertexLayout>(SCENE_VERTEX_BINDING) == sizeof(MeshVertex), "The scene layout must match MeshVertex");
+static_assert(ULayoutOffset<SceneVertexLayout>(3) == offsetof(MeshVertex, normal) && ULayoutOffset<SceneVertexLayout>(2) == offsetof(MeshVertex, uv),
+	"The scene layout must match MeshVertex");
+
+//The scene layout and the draw slot, read once per instance from a buffer of 0, 1, 2, ... so that an indirect
+//command's base instance arrives in the shader
+const GLuint INDIRECT_SLOT_BINDING = 2;
+const GLuint INDIRECT_SLOT_LOCATION = 5;
+using IndirectVertexLayout = VertexLayout<
+	VertexAttribute<0, 3>,
+	VertexAttribute<1, 4>,
+	VertexAttribute<3, 3>,
+	VertexAttribute<2, 2>,
+	VertexAttribute<LIGHTMAP_COORDINATE_LOCATION, 2, GL_FLOAT, SCENE_LIGHTMAP_BINDING>,
+	VertexAttribute<INDIRECT_SLOT_LOCATION, 1, GL_UNSIGNED_INT, INDIRECT_SLOT_BINDING>>;
+static_assert(ULayoutStride<IndirectVertexLayout>(SCENE_VERTEX_BINDING) == sizeof(MeshVertex), "The indirect layout must match MeshVertex");
+
+//Points a scene layout vertex array at a mesh's vertex and index buffers (two names, as in GLMesh::vbos)
+void UBindMeshBuffers(GLuint vao, const GLuint* buffers) {
+	UBindLayoutBuffer<SceneVertexLayout>(vao, SCENE_VERTEX_BINDING, buffers[0]);
+	glVertexArrayElementBuffer(vao, buffers[1]);
+}
+
+//Points the lightmap binding at an object's baked coordinates, or at the neutral coordinate for 0
+void UBindLightmapCoordinates(GLuint vao, GLuint coordinates, GLuint neutralCoordinates) {
+	if (coordinates)
+		UBindLayoutBuffer<SceneVertexLayout>(vao, SCENE_LIGHTMAP_BINDING, coordinates);
+	else
+		UBindConstantBuffer(vao, SCENE_LIGHTMAP_BINDING, neutralCoordinates);
+}
+
+//----------------------------------------DEVICE------------------------------------------
+enum RenderDeviceKind {
+	RENDER_DEVICE_DIRECT,
+	RENDER_DEVICE_INDIRECT,
+};
+const char* RENDER_DEVICE_NAMES[] = { "direct", "indirect" };
+
+//Descriptor tables of the indirect shader: materials[] and lightmaps[], on consecutive texture units
+const GLuint DEVICE_MATERIAL_SLOTS = 4;			//Indexed by DrawSource::material
+const GLuint DEVICE_LIGHTMAP_SLOTS = 8;			//Slot 0 is the neutral lightmap
+const GLuint DEVICE_MATERIAL_UNIT = 3;
+const GLuint DEVICE_LIGHTMAP_UNIT = 7;
+const GLuint DEVICE_OBJECT_STORAGE_BINDING = 3;
+const GLuint DEVICE_DESCRIPTOR_STORAGE_BINDING = 4;
+
+//GL names the devices draw with, read through pointers at submit time as loads and reloads replace them
+struct DeviceResources {
+	const GLuint* litProgram = nullptr;			//Direct device; the indirect device builds its own
+	const GLuint* vao = nullptr;				//In SceneVertexLayout; the direct device rebinds its buffers per mesh
+	const GLuint* materials[DEVICE_MATERIAL_SLOTS] = {};
+	const GLuint* fallbackTexture = nullptr;	//Drawn for a material that is not loaded
+	const GLuint* neutralLightmap = nullptr;
+	const GLuint* neutralCoordinates = nullptr;
+};
+
+//Where the recorders wrote this frame's object blocks: slot i's block is at objectUniforms + i * objectStride
+struct DeviceFrame {
+	GLuint uniformBuffer = 0;
+	GLintptr objectUniforms = 0;
+	size_t objectStride = 0;
+};
+
+//Submission cost since the last reset, kept the same way by both devices
+struct DeviceStats {
+	uint64_t frames = 0;
+	uint64_t draws = 0;
+	uint64_t calls = 0;							//GL calls made by submission, arena repacks and buffer growth included
+	uint64_t submitNanoseconds = 0;				//CPU time in USubmitDraws
+};
+
+//Sources that draw the same mesh with the same lightmap share an entry; 'packed' holds the names it was packed from
+struct DeviceArenaEntry {
+	const GLuint* buffers = nullptr;
+	const GLuint* indexCount = nullptr;
+	const GLuint* lightmap = nullptr;
+	const GLuint* lightmapCoordinates = nullptr;
+	GLuint packed[4] = {};						//Vertex buffer, index buffer, index count, coordinates (0 unbaked)
+	GLuint firstIndex = 0;
+	GLint baseVertex = 0;
+	GLuint lightmapSlot = 0;
+};
+
+//Layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+struct RenderDevice {
+	RenderDeviceKind kind = RENDER_DEVICE_DIRECT;
+	DeviceResources resources;
+	DeviceStats stats;
+
+	//Indirect pipeline
+	GLuint indirectProgram = 0;
+	GLuint indirectVao = 0;
+	GLint objectBaseLocation = -1;
+	GLint objectStrideLocation = -1;
+	GLint storageAlignment = 16;
+
+	//Indirect arena: instanceEntries[i] is the entry of DrawSource i
+	std::vector<DeviceArenaEntry> entries;
+	std::vector<uint32_t> instanceEntries;
+	const GLuint* lightmapTable[DEVICE_LIGHTMAP_SLOTS] = {};
+	GLuint arenaBuffers[3] = {};				//Vertices, indices, lightmap coordinates
+	GLuint slotBuffer = 0;
+	GLuint slotCapacity = 0;
+	GLuint commandBuffer = 0;					//Indirect commands, then descriptor indices by draw slot
+	GLsizeiptr commandCapacity = 0;
+	std::vector<unsigned char> staging;			//Capacity kept between frames
+};
+
+void UDestroyRenderDevice(RenderDevice& device) {
+	glDeleteProgram(device.indirectProgram);
+	glDeleteVertexArrays(1, &device.indirectVao);
+	glDeleteBuffers(3, device.arenaBuffers);
+	glDeleteBuffers(1, &device.slotBuffer);
+	glDeleteBuffers(1, &device.commandBuffer);
+	device = RenderDevice();
+}
+
+//Builds the device's pipelines; false if the indirect shader does not build, in which case the caller keeps direct
+bool UCreateRenderDevice(RenderDevice& device, RenderDeviceKind kind, const DeviceResources& resources) {
+	UDestroyRenderDevice(device);
+	device.kind = kind;
+	device.resources = resources;
+	if (kind == RENDER_DEVICE_DIRECT)
+		return true;
+
+	if (!UCreateShaderProgram(indirectVertexShaderSource, indirectFragmentShaderSource, device.indirectProgram) ||
+		!UCheckVertexLayout<IndirectVertexLayout>(device.indirectProgram, "indirect shader")) {
+		LOG_ERROR("ERROR::RENDER_DEVICE::INDIRECT_PIPELINE_FAILED");
+		UDestroyRenderDevice(device);
+		return false;
+	}
+	device.objectBaseLocation = glGetUniformLocation(device.indirectProgram, "objectBase");
+	device.objectStrideLocation = glGetUniformLocation(device.indirectProgram, "objectStride");
+
+	device.indirectVao = UCreateLayoutVertexArray<IndirectVertexLayout>();
+	glVertexArrayBindingDivisor(device.indirectVao, INDIRECT_SLOT_BINDING, 1);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &device.storageAlignment);
+	glCreateBuffers(1, &device.commandBuffer);
+	return true;
+}
+
+//---------------------------------------DIRECT-------------------------------------------
+void USubmitDirect(RenderDevice& device, const DeviceFrame& frame, const std::vector<DrawRecord>& draws) {
+	const DeviceResources& resources = device.resources;
+	GLuint vao = *resources.vao;
+	glUseProgram(*resources.litProgram);
+	glBindVertexArray(vao);
+	uint64_t calls = 2;
+
+	const GLuint* boundBuffers = nullptr;
+	GLuint boundTexture = 0;
+	bool textureBound = false;
+	GLuint boundLightmap = 0;
+	for (const DrawRecord& draw : draws) {
+		if (draw.buffers != boundBuffers) {
+			boundBuffers = draw.buffers;
+			UBindMeshBuffers(vao, boundBuffers);
+			calls += 2;
+		}
+
+		if (!textureBound || *draw.texture != boundTexture) {
+			boundTexture = *draw.texture;
+			textureBound = true;
+			glBindTexture(GL_TEXTURE_2D, boundTexture ? boundTexture : *resources.fallbackTexture);
+			++calls;
+		}
+
+		//Objects without a baked lightmap get the constant ambient they had before baking
+		GLuint lightmap = draw.lightmap && *draw.lightmap ? *draw.lightmap : *resources.neutralLightmap;
+		if (lightmap != boundLightmap) {
+			boundLightmap = lightmap;
+			glActiveTexture(GL_TEXTURE0 + LIGHTMAP_TEXTURE_UNIT);
+			glBindTexture(GL_TEXTURE_2D, lightmap);
+			glActiveTexture(GL_TEXTURE0);
+			UBindLightmapCoordinates(vao, lightmap != *resources.neutralLightmap ? *draw.lightmapCoordinates : 0, *resources.neutralCoordinates);
+			calls += 4;
+		}
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, frame.uniformBuffer, frame.objectUniforms + draw.uniformSlot * frame.objectStride, sizeof(ObjectUniforms));
+		glDrawElements(GL_TRIANGLES, *draw.indexCount, GL_UNSIGNED_SHORT, NULL);
+		calls += 2;
+	}
+	device.stats.calls += calls;
+}
+
+//--------------------------------------INDIRECT------------------------------------------
+//Groups the sources by what they draw, and gives each distinct lightmap a slot in the table; lightmaps past the
+//table's size keep the neutral one
+void UMapDeviceSources(RenderDevice& device, const DrawSource* sources, size_t count) {
+	AllowFrameAllocations allowMapping;
+	device.entries.clear();
+	device.instanceEntries.assign(count, 0);
+	for (GLuint slot = 0; slot < DEVICE_LIGHTMAP_SLOTS; ++slot)
+		device.lightmapTable[slot] = device.resources.neutralLightmap;
+
+	GLuint nextSlot = 1;
+	for (size_t i = 0; i < count; ++i) {
+		const DrawSource& source = sources[i];
+		size_t e = 0;
+		while (e < device.entries.size() && !(device.entries[e].buffers == source.buffers && device.entries[e].lightmap == source.lightmap &&
+			device.entries[e].lightmapCoordinates == source.lightmapCoordinates))
+			++e;
+
+		if (e == device.entries.size()) {
+			DeviceArenaEntry entry;
+			entry.buffers = source.buffers;
+			entry.indexCount = source.indexCount;
+			entry.lightmap = source.lightmap;
+			entry.lightmapCoordinates = source.lightmapCoordinates;
+			for (GLuint slot = 1; slot < nextSlot && source.lightmap; ++slot) {
+				if (device.lightmapTable[slot] == source.lightmap)
+					entry.lightmapSlot = slot;
+			}
+			if (source.lightmap && !entry.lightmapSlot && nextSlot < DEVICE_LIGHTMAP_SLOTS) {
+				entry.lightmapSlot = nextSlot++;
+				device.lightmapTable[entry.lightmapSlot] = source.lightmap;
+			}
+			device.entries.push_back(entry);
+		}
+		device.instanceEntries[i] = (uint32_t)e;
+	}
+}
+
+//Repacks every entry's mesh and lightmap coordinates into the arena when any of the names changed since the last
+//pack (loads, bakes, hot reloads). Entries without baked coordinates read zeros, which the neutral lightmap ignores.
+void URefreshDeviceArena(RenderDevice& device) {
+	bool changed = false;
+	for (DeviceArenaEntry& entry : device.entries) {
+		bool baked = entry.lightmap && *entry.lightmap && entry.lightmapCoordinates;
+		GLuint current[4] = { entry.buffers[0], entry.buffers[1], *entry.indexCount, baked ? *entry.lightmapCoordinates : 0 };
+		changed = changed || memcmp(current, entry.packed, sizeof(current)) != 0;
+		memcpy(entry.packed, current, sizeof(current));
+	}
+	if (!changed)
+		return;
+
+	AllowFrameAllocations allowPacking;
+	uint64_t calls = 0;
+	const GLuint stride = ULayoutStride<SceneVertexLayout>(SCENE_VERTEX_BINDING);
+	const GLuint coordinateStride = ULayoutStride<SceneVertexLayout>(SCENE_LIGHTMAP_BINDING);
+	std::vector<GLuint> vertexCounts(device.entries.size());
+	GLuint vertexTotal = 0;
+	GLuint indexTotal = 0;
+	for (size_t e = 0; e < device.entries.size(); ++e) {
+		DeviceArenaEntry& entry = device.entries[e];
+		GLint vertexBytes = 0;
+		glGetNamedBufferParameteriv(entry.packed[0], GL_BUFFER_SIZE, &vertexBytes);
+		vertexCounts[e] = (GLuint)vertexBytes / stride;
+		++calls;
+		entry.baseVertex = (GLint)vertexTotal;
+		entry.firstIndex = indexTotal;
+		vertexTotal += vertexCounts[e];
+		indexTotal += entry.packed[2];
+	}
+
+	glDeleteBuffers(3, device.arenaBuffers);
+	glCreateBuffers(3, device.arenaBuffers);
+	glNamedBufferStorage(device.arenaBuffers[0], std::max<GLsizeiptr>((GLsizeiptr)vertexTotal * stride, 1), nullptr, 0);
+	glNamedBufferStorage(device.arenaBuffers[1], std::max<GLsizeiptr>((GLsizeiptr)indexTotal * sizeof(GLushort), 1), nullptr, 0);
+	glNamedBufferStorage(device.arenaBuffers[2], std::max<GLsizeiptr>((GLsizeiptr)vertexTotal * coordinateStride, 1), nullptr, 0);
+	const GLfloat zero = 0.0f;
+	glClearNamedBufferData(device.arenaBuffers[2], GL_R32F, GL_RED, GL_FLOAT, &zero);
+	calls += 6;
+
+	for (size_t e = 0; e < device.entries.size(); ++e) {
+		const DeviceArenaEntry& entry = device.entries[e];
+		glCopyNamedBufferSubData(entry.packed[0], device.arenaBuffers[0], 0, (GLintptr)entry.baseVertex * stride, (GLsizeiptr)vertexCounts[e] * stride);
+		glCopyNamedBufferSubData(entry.packed[1], device.arenaBuffers[1], 0, (GLintptr)entry.firstIndex * sizeof(GLushort), (GLsizeiptr)entry.packed[2] * sizeof(GLushort));
+		calls += 2;
+		if (entry.packed[3]) {
+			GLint coordinateBytes = 0;
+			glGetNamedBufferParameteriv(entry.packed[3], GL_BUFFER_SIZE, &coordinateBytes);
+			glCopyNamedBufferSubData(entry.packed[3], device.arenaBuffers[2], 0, (GLintptr)entry.baseVertex * coordinateStride,
+				std::min<GLsizeiptr>(coordinateBytes, (GLsizeiptr)vertexCounts[e] * coordinateStride));
+			calls += 2;
+		}
+	}
+
+	UBindLayoutBuffer<IndirectVertexLayout>(device.indirectVao, SCENE_VERTEX_BINDING, device.arenaBuffers[0]);
+	UBindLayoutBuffer<IndirectVertexLayout>(device.indirectVao, SCENE_LIGHTMAP_BINDING, device.arenaBuffers[2]);
+	glVertexArrayElementBuffer(device.indirectVao, device.arenaBuffers[1]);
+	device.stats.calls += calls + 3;
+	LOG_INFO("INFO: Render device packed %zu meshes into its arena, %u vertices, %u indices", device.entries.size(), vertexTotal, indexTotal);
+}
+
+//Draw slots are positions in the frame's draw list; the per-instance slot buffer has to reach the highest one
+void UGrowSlotBuffer(RenderDevice& device, GLuint slotCount) {
+	AllowFrameAllocations allowGrowth;
+	GLuint capacity = std::max(device.slotCapacity, 1024u);
+	while (capacity < slotCount)
+		capacity *= 2;
+	std::vector<GLuint> slots(capacity);
+	for (GLuint i = 0; i < capacity; ++i)
+		slots[i] = i;
+
+	glDeleteBuffers(1, &device.slotBuffer);
+	glCreateBuffers(1, &device.slotBuffer);
+	glNamedBufferStorage(device.slotBuffer, (GLsizeiptr)capacity * sizeof(GLuint), slots.data(), 0);
+	UBindLayoutBuffer<IndirectVertexLayout>(device.indirectVao, INDIRECT_SLOT_BINDING, device.slotBuffer);
+	device.stats.calls += 4;
+	device.slotCapacity = capacity;
+}
+
+void USubmitIndirect(RenderDevice& device, const DeviceFrame& frame, const DrawSource* sources, size_t sourceCount, const std::vector<DrawRecord>& draws) {
+	if (device.instanceEntries.size() != sourceCount)
+		UMapDeviceSources(device, sources, sourceCount);
+	URefreshDeviceArena(device);
+	if (draws.empty())
+		return;
+
+	GLuint slotCount = 0;
+	for (const DrawRecord& draw : draws)
+		slotCount = std::max(slotCount, draw.uniformSlot + 1);
+	if (slotCount > device.slotCapacity)
+		UGrowSlotBuffer(device, slotCount);
+
+	//One upload: the commands, then each slot's material and lightmap where a storage binding may start
+	GLsizeiptr commandBytes = (GLsizeiptr)(draws.size() * sizeof(DrawElementsIndirectCommand));
+	GLsizeiptr descriptorOffset = (commandBytes + device.storageAlignment - 1) / device.storageAlignment * device.storageAlignment;
+	GLsizeiptr totalBytes = descriptorOffset + (GLsizeiptr)slotCount * 2 * sizeof(GLuint);
+	if (totalBytes > (GLsizeiptr)device.staging.size()) {
+		AllowFrameAllocations allowGrowth;
+		device.staging.resize((size_t)totalBytes * 2);
+	}
+	DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)device.staging.data();
+	GLuint* descriptors = (GLuint*)(device.staging.data() + descriptorOffset);
+	for (size_t i = 0; i < draws.size(); ++i) {
+		const DrawRecord& draw = draws[i];
+		const DeviceArenaEntry& entry = device.entries[device.instanceEntries[draw.instance]];
+		commands[i] = DrawElementsIndirectCommand{ entry.packed[2], 1, entry.firstIndex, entry.baseVertex, draw.uniformSlot };
+		descriptors[draw.uniformSlot * 2] = std::min<GLuint>(USortKeyMaterial(draw.sortKey), DEVICE_MATERIAL_SLOTS - 1);
+		descriptors[draw.uniformSlot * 2 + 1] = entry.lightmapSlot;
+	}
+
+	uint64_t calls = 0;
+	if (totalBytes > device.commandCapacity) {
+		device.commandCapacity = (GLsizeiptr)device.staging.size();
+		glDeleteBuffers(1, &device.commandBuffer);
+		glCreateBuffers(1, &device.commandBuffer);
+		glNamedBufferStorage(device.commandBuffer, device.commandCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		calls += 3;
+	}
+	glNamedBufferSubData(device.commandBuffer, 0, totalBytes, device.staging.data());
+	++calls;
+
+	GLuint materials[DEVICE_MATERIAL_SLOTS];
+	for (GLuint slot = 0; slot < DEVICE_MATERIAL_SLOTS; ++slot) {
+		const GLuint* texture = device.resources.materials[slot];
+		materials[slot] = texture && *texture ? *texture : *device.resources.fallbackTexture;
+	}
+	GLuint lightmaps[DEVICE_LIGHTMAP_SLOTS];
+	for (GLuint slot = 0; slot < DEVICE_LIGHTMAP_SLOTS; ++slot)
+		lightmaps[slot] = *device.lightmapTable[slot] ? *device.lightmapTable[slot] : *device.resources.neutralLightmap;
+
+	glUseProgram(device.indirectProgram);
+	glBindVertexArray(device.indirectVao);
+	glBindTextures(DEVICE_MATERIAL_UNIT, DEVICE_MATERIAL_SLOTS, materials);
+	glBindTextures(DEVICE_LIGHTMAP_UNIT, DEVICE_LIGHTMAP_SLOTS, lightmaps);
+	calls += 4;
+
+	//The object blocks are read where the recorders wrote them; the storage range starts at an aligned offset before them
+	GLintptr objectStart = frame.objectUniforms / device.storageAlignment * device.storageAlignment;
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DEVICE_OBJECT_STORAGE_BINDING, frame.uniformBuffer, objectStart,
+		(GLsizeiptr)(frame.objectUniforms - objectStart) + (GLsizeiptr)slotCount * frame.objectStride);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DEVICE_DESCRIPTOR_STORAGE_BINDING, device.commandBuffer, descriptorOffset, totalBytes - descriptorOffset);
+	glUniform1ui(device.objectBaseLocation, (GLuint)((frame.objectUniforms - objectStart) / sizeof(glm::vec4)));
+	glUniform1ui(device.objectStrideLocation, (GLuint)(frame.objectStride / sizeof(glm::vec4)));
+	calls += 4;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, device.commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, (GLsizei)draws.size(), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	device.stats.calls += calls + 3;
+}
+
+//----------------------------------------SUBMIT------------------------------------------
+//Draws the merged lists with the device's lit pipeline. Leaves the device's program and vertex array bound and
+//texture unit 0 active; the frame block and the shadow cube (unit 1) must already be bound.
+void USubmitDraws(RenderDevice& device, const DeviceFrame& frame, const DrawSource* sources, size_t sourceCount, const std::vector<DrawRecord>& draws) {
+	auto submitStart = std::chrono::steady_clock::now();
+	if (device.kind == RENDER_DEVICE_INDIRECT)
+		USubmitIndirect(device, frame, sources, sourceCount, draws);
+	else
+		USubmitDirect(device, frame, draws);
+
+	++device.stats.frames;
+	device.stats.draws += draws.size();
+	device.stats.submitNanoseconds += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - submitStart).count();
+}
+
+#endif
@@ -0,0 +1,407 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+/*Render graph
+* A frame is declared as passes that read and write named resources. Resources are either transient render
+* targets, which the graph allocates, or imported (the window's backbuffer, persistent textures such as the shadow
+* cache), which it does not. Passes that write an imported texture bind their own framebuffer. Compiling the graph:
+*   - culls every pass whose writes never reach an output resource,
+*   - orders the remaining passes so each one runs after the earlier writers of what it reads, and before any later
+*     pass overwrites it,
+*   - works out each transient's lifetime (first to last pass using it), and lets transients whose lifetimes do not
+*     overlap share one physical texture when their size and format match,
+*   - creates one framebuffer per pass over the textures it writes.
+* OpenGL cannot place two textures in the same memory, so aliasing shares texture objects instead. A pass that
+* writes an aliased target must not expect its previous contents.
+*
+* Declaring and compiling allocate, so the graph is built once and rebuilt only when the window size or options
+* change; executing it each frame does not allocate.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+
+struct RenderGraph;
+
+//'frame' is whatever was passed to UExecuteRenderGraph
+typedef std::function<void(const RenderGraph& graph, const void* frame)> RenderPassFunction;
+
+struct RenderResource {
+	std::string name;
+	bool imported = false;				//Not allocated by the graph (the backbuffer, persistent textures)
+	bool output = false;				//Kept alive even though no pass reads it
+	GLenum format = GL_RGBA8;
+	int width = 0;
+	int height = 0;
+
+	//Filled in by UCompileRenderGraph
+	bool live = false;
+	int firstUse = -1;					//Positions in the execution order
+	int lastUse = -1;
+	int physical = -1;					//Index into RenderGraph::textures
+};
+
+struct RenderPass {
+	std::string name;
+	std::vector<int> reads;
+	std::vector<int> writes;
+	RenderPassFunction execute;
+
+	bool live = false;
+	GLuint framebuffer = 0;				//0 when the pass draws to the backbuffer or binds its own
+};
+
+//A texture backing one or more transient resources
+struct RenderTexture {
+	GLuint texture = 0;
+	GLenum format = GL_RGBA8;
+	int width = 0;
+	int height = 0;
+	int lastUse = -1;					//Last pass position of the resources placed in it so far
+	size_t bytes = 0;
+};
+
+struct RenderGraph {
+	std::vector<RenderResource> resources;
+	std::vector<RenderPass> passes;
+	std::vector<int> order;				//Live passes in execution order
+	std::vector<RenderTexture> textures;
+	bool compiled = false;
+
+	//Render target memory, reported at compile
+	size_t unaliasedBytes = 0;			//Every transient in its own texture
+	size_t aliasedBytes = 0;			//Textures actually allocated
+	size_t peakLiveBytes = 0;			//Most bytes in use by a single pass; the floor for any aliasing scheme
+};
+
+//------------------------------------DECLARATION--------------------------------------------
+size_t URenderFormatBytes(GLenum format) {
+	switch (format) {
+	case GL_RGBA16F: return 8;
+	case GL_R8: return 1;
+	default: return 4;				//GL_RGBA8, GL_DEPTH24_STENCIL8, GL_DEPTH_COMPONENT32F, GL_R32F
+	}
+}
+
+bool UIsDepthFormat(GLenum format) {
+	return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+}
+
+//A render target allocated (and possibly shared) by the graph; returns its handle for pass declarations
+int UCreateTransient(RenderGraph& graph, const std::string& name, int width, int height, GLenum format) {
+	RenderResource resource;
+	resource.name = name;
+	resource.width = width < 1 ? 1 : width;
+	resource.height = height < 1 ? 1 : height;
+	resource.format = format;
+	graph.resources.push_back(resource);
+	return (int)graph.resources.size() - 1;
+}
+
+//The window's default framebuffer; writing to it makes a pass an output of the frame
+int UImportBackbuffer(RenderGraph& graph, const std::string& name) {
+	RenderResource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.output = true;
+	graph.resources.push_back(resource);
+	return (int)graph.resources.size() - 1;
+}
+
+//A texture that outlives the frame (a cache); only orders the passes that write and read it, and stays live only
+//while a live pass reads it
+int UImportResource(RenderGraph& graph, const std::string& name) {
+	RenderResource resource;
+	resource.name = name;
+	resource.imported = true;
+	graph.resources.push_back(resource);
+	return (int)graph.resources.size() - 1;
+}
+
+int UAddRenderPass(RenderGraph& graph, const std::string& name, std::vector<int> reads, std::vector<int> writes, RenderPassFunction execute) {
+	RenderPass pass;
+	pass.name = name;
+	pass.reads = std::move(reads);
+	pass.writes = std::move(writes);
+	pass.execute = std::move(execute);
+	graph.passes.push_back(std::move(pass));
+	return (int)graph.passes.size() - 1;
+}
+
+//Texture behind a transient resource, for passes that sample it
+GLuint URenderGraphTexture(const RenderGraph& graph, int resource) {
+	int physical = graph.resources[resource].physical;
+	return physical >= 0 ? graph.textures[physical].texture : 0;
+}
+
+//Deletes the GL objects and every declaration, ready to declare the graph again
+void UResetRenderGraph(RenderGraph& graph) {
+	for (RenderTexture& texture : graph.textures)
+		glDeleteTextures(1, &texture.texture);
+	for (RenderPass& pass : graph.passes) {
+		if (pass.framebuffer)
+			glDeleteFramebuffers(1, &pass.framebuffer);
+	}
+	graph.resources.clear();
+	graph.passes.clear();
+	graph.order.clear();
+	graph.textures.clear();
+	graph.compiled = false;
+}
+
+//-------------------------------------COMPILATION-------------------------------------------
+bool UWritesResource(const RenderPass& pass, int resource) {
+	return std::find(pass.writes.begin(), pass.writes.end(), resource) != pass.writes.end();
+}
+
+bool UReadsResource(const RenderPass& pass, int resource) {
+	return std::find(pass.reads.begin(), pass.reads.end(), resource) != pass.reads.end();
+}
+
+//Marks the passes that contribute to an output, working back from the outputs through what each live pass reads
+void UCullRenderPasses(RenderGraph& graph) {
+	for (RenderResource& resource : graph.resources)
+		resource.live = resource.output;
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (RenderPass& pass : graph.passes) {
+			if (pass.live)
+				continue;
+			for (int written : pass.writes) {
+				if (graph.resources[written].live) {
+					pass.live = true;
+					break;
+				}
+			}
+			if (!pass.live)
+				continue;
+
+			changed = true;
+			for (int read : pass.reads)
+				graph.resources[read].live = true;
+			for (int written : pass.writes)
+				graph.resources[written].live = true;
+		}
+	}
+}
+
+//Orders the live passes. A pass runs after the writers declared before it of what it reads (read after write), and
+//after the passes declared before it that read or write what it writes (write after read, write after write), so a
+//later writer never clobbers a resource before an earlier reader has used it. A pass reading a resource that only
+//later passes write sees its contents from before the frame. Among passes that are ready, declaration order wins.
+//Every dependency points forward in declaration order; the cycle check guards against that changing.
+bool UOrderRenderPasses(RenderGraph& graph) {
+	size_t count = graph.passes.size();
+	std::vector<std::vector<int>> dependents(count);
+	std::vector<int> unmet(count, 0);
+
+	for (size_t p = 0; p < count; ++p) {
+		const RenderPass& pass = graph.passes[p];
+		if (!pass.live)
+			continue;
+		for (size_t e = 0; e < p; ++e) {
+			const RenderPass& earlier = graph.passes[e];
+			if (!earlier.live)
+				continue;
+
+			bool depends = false;
+			for (int read : pass.reads)
+				depends = depends || UWritesResource(earlier, read);
+			for (int written : pass.writes)
+				depends = depends || UWritesResource(earlier, written) || UReadsResource(earlier, written);
+			if (depends) {
+				dependents[e].push_back((int)p);
+				++unmet[p];
+			}
+		}
+	}
+
+	graph.order.clear();
+	std::vector<bool> placed(count, false);
+	while (true) {
+		int next = -1;
+		for (size_t p = 0; p < count && next < 0; ++p) {
+			if (graph.passes[p].live && !placed[p] && unmet[p] == 0)
+				next = (int)p;
+		}
+		if (next < 0)
+			break;
+
+		placed[next] = true;
+		graph.order.push_back(next);
+		for (int dependent : dependents[next])
+			--unmet[dependent];
+	}
+
+	for (size_t p = 0; p < count; ++p) {
+		if (graph.passes[p].live && !placed[p]) {
+			LOG_ERROR("ERROR::RENDERGRAPH::CYCLE at pass %s", graph.passes[p].name.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+//Places each transient in the first texture of the same size and format that is free by the time it is first used
+void UAliasTransients(RenderGraph& graph) {
+	std::vector<int> transients;
+	for (size_t i = 0; i < graph.resources.size(); ++i) {
+		RenderResource& resource = graph.resources[i];
+		resource.firstUse = -1;
+		resource.lastUse = -1;
+		resource.physical = -1;
+	}
+
+	for (size_t position = 0; position < graph.order.size(); ++position) {
+		const RenderPass& pass = graph.passes[graph.order[position]];
+		for (const std::vector<int>* uses : { &pass.reads, &pass.writes }) {
+			for (int index : *uses) {
+				RenderResource& resource = graph.resources[index];
+				if (resource.firstUse < 0)
+					resource.firstUse = (int)position;
+				resource.lastUse = (int)position;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < graph.resources.size(); ++i) {
+		if (!graph.resources[i].imported && graph.resources[i].firstUse >= 0)
+			transients.push_back((int)i);
+	}
+	std::stable_sort(transients.begin(), transients.end(), [&graph](int a, int b) {
+		return graph.resources[a].firstUse < graph.resources[b].firstUse;
+	});
+
+	graph.unaliasedBytes = 0;
+	graph.aliasedBytes = 0;
+	for (int index : transients) {
+		RenderResource& resource = graph.resources[index];
+		size_t bytes = (size_t)resource.width * resource.height * URenderFormatBytes(resource.format);
+		graph.unaliasedBytes += bytes;
+
+		for (size_t t = 0; t < graph.textures.size() && resource.physical < 0; ++t) {
+			RenderTexture& texture = graph.textures[t];
+			if (texture.format == resource.format && texture.width == resource.width && texture.height == resource.height && texture.lastUse < resource.firstUse)
+				resource.physical = (int)t;
+		}
+		if (resource.physical < 0) {
+			RenderTexture texture;
+			texture.format = resource.format;
+			texture.width = resource.width;
+			texture.height = resource.height;
+			texture.bytes = bytes;
+			graph.textures.push_back(texture);
+			graph.aliasedBytes += bytes;
+			resource.physical = (int)graph.textures.size() - 1;
+		}
+		graph.textures[resource.physical].lastUse = resource.lastUse;
+	}
+
+	graph.peakLiveBytes = 0;
+	for (size_t position = 0; position < graph.order.size(); ++position) {
+		size_t live = 0;
+		for (int index : transients) {
+			const RenderResource& resource = graph.resources[index];
+			if (resource.firstUse <= (int)position && (int)position <= resource.lastUse)
+				live += (size_t)resource.width * resource.height * URenderFormatBytes(resource.format);
+		}
+		graph.peakLiveBytes = std::max(graph.peakLiveBytes, live);
+	}
+}
+
+//Allocates the textures and builds each pass's framebuffer
+bool UCreateRenderGraphTargets(RenderGraph& graph) {
+	for (RenderTexture& texture : graph.textures) {
+		glGenTextures(1, &texture.texture);
+		glBindTexture(GL_TEXTURE_2D, texture.texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, texture.format, texture.width, texture.height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (int index : graph.order) {
+		RenderPass& pass = graph.passes[index];
+
+		//The backbuffer is framebuffer 0; passes writing other imported textures bind their own
+		bool writesImported = false;
+		for (int written : pass.writes)
+			writesImported = writesImported || graph.resources[written].imported;
+		if (writesImported)
+			continue;
+
+		glGenFramebuffers(1, &pass.framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+		GLenum drawBuffers[8];
+		GLsizei colorCount = 0;
+		for (int written : pass.writes) {
+			const RenderResource& resource = graph.resources[written];
+			GLuint texture = graph.textures[resource.physical].texture;
+			if (UIsDepthFormat(resource.format)) {
+				GLenum attachment = resource.format == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+				glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+			}
+			else if (colorCount < 8) {
+				drawBuffers[colorCount] = GL_COLOR_ATTACHMENT0 + colorCount;
+				glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[colorCount], GL_TEXTURE_2D, texture, 0);
+				++colorCount;
+			}
+		}
+		if (colorCount > 0)
+			glDrawBuffers(colorCount, drawBuffers);
+		else
+			glDrawBuffer(GL_NONE);
+
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("ERROR::RENDERGRAPH::FRAMEBUFFER_INCOMPLETE pass %s (0x%x)", pass.name.c_str(), status);
+			return false;
+		}
+	}
+	return true;
+}
+
+//Culls, orders, aliases, and allocates; the graph runs only if this succeeds
+bool UCompileRenderGraph(RenderGraph& graph) {
+	graph.compiled = false;
+	UCullRenderPasses(graph);
+	if (!UOrderRenderPasses(graph))
+		return false;
+	UAliasTransients(graph);
+	if (!UCreateRenderGraphTargets(graph))
+		return false;
+	graph.compiled = true;
+
+	std::string order;
+	for (int index : graph.order)
+		order += (order.empty() ? "" : " -> ") + graph.passes[index].name;
+	LOG_INFO("INFO: Render graph: %s (%zu of %zu passes, %zu culled)", order.c_str(), graph.order.size(), graph.passes.size(), graph.passes.size() - graph.order.size());
+	LOG_INFO("INFO: Render targets: %.2f MB without aliasing, %.2f MB with (%zu textures for %zu transients), %.2f MB live at peak",
+		graph.unaliasedBytes / 1048576.0, graph.aliasedBytes / 1048576.0, graph.textures.size(),
+		(size_t)std::count_if(graph.resources.begin(), graph.resources.end(), [](const RenderResource& r) { return !r.imported && r.physical >= 0; }),
+		graph.peakLiveBytes / 1048576.0);
+	return true;
+}
+
+//--------------------------------------EXECUTION--------------------------------------------
+//Runs the live passes in order, each with its framebuffer bound; viewports are left to the passes
+void UExecuteRenderGraph(const RenderGraph& graph, const void* frame) {
+	for (int index : graph.order) {
+		const RenderPass& pass = graph.passes[index];
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+		pass.execute(graph, frame);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+#endif
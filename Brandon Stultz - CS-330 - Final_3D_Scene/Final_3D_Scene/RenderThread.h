@@ -0,0 +1,176 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+/*Render packets and the main-thread -> render-thread handoff
+* The main thread runs input and simulation and fills a RenderPacket: an immutable snapshot of everything
+* the GL thread needs for one frame. Two packet slots are used: the main thread fills one while the render
+* thread draws the other. The main thread may be at most one packet ahead; if the render thread has not
+* taken the last published packet yet, UBeginPacket blocks. This bounds input-to-display latency to one frame.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DrawLists.h"
+#include "FramePacing.h"
+#include "Logger.h"
+#include "SoftwareRasterizer.h"
+
+struct RenderPacket {
+	uint64_t frame = 0;				//Also selects the ring buffer segment
+
+	//Camera
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+
+	//This frame's uniform blocks in the ring buffer; recorded draw i uses objectUniforms + i * objectStride
+	bool uniformsReady = false;
+	GLintptr frameUniforms = 0;
+	GLintptr lampUniforms = 0;
+	GLintptr objectUniforms = 0;
+	size_t objectStride = 0;
+
+	//Shadow cube faces to redraw from lightPosition (bit per face). Caster i uses casterUniforms + i * objectStride;
+	//casterCount is 0 on frames that draw no shadows
+	unsigned shadowFaces = 0;
+	glm::vec3 lightPosition;
+	GLintptr casterUniforms = 0;
+	size_t casterCount = 0;
+
+	//Visible lit objects, recorded in parallel; capacity is kept between frames so steady state does not allocate
+	std::vector<CommandList> commandLists;
+
+	//--software: the same frame for the CPU rasterizer; no draws otherwise
+	SoftwareFrame software;
+
+	std::chrono::steady_clock::time_point simulatedAt;
+};
+
+struct PacketExchange {
+	RenderPacket slots[2];
+	int writingSlot = -1;			//Being filled by the main thread
+	int readySlot = -1;				//Published, not yet taken by the render thread
+	int renderingSlot = -1;			//Being drawn by the render thread
+	bool quit = false;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+};
+
+//Main thread: returns the free slot to fill; blocks while the render thread is a full packet behind
+RenderPacket& UBeginPacket(PacketExchange& exchange) {
+	std::unique_lock<std::mutex> lock(exchange.mutex);
+	exchange.changed.wait(lock, [&exchange] { return exchange.readySlot == -1 || exchange.quit; });
+
+	exchange.writingSlot = exchange.renderingSlot == 0 ? 1 : 0;
+	return exchange.slots[exchange.writingSlot];
+}
+
+//Main thread: hands the filled packet to the render thread
+void UPublishPacket(PacketExchange& exchange) {
+	std::lock_guard<std::mutex> lock(exchange.mutex);
+	exchange.readySlot = exchange.writingSlot;
+	exchange.writingSlot = -1;
+	exchange.changed.notify_all();
+}
+
+//Render thread: releases the previous packet and waits for the next one; returns nullptr on shutdown
+const RenderPacket* UAcquirePacket(PacketExchange& exchange) {
+	std::unique_lock<std::mutex> lock(exchange.mutex);
+	exchange.renderingSlot = -1;
+	exchange.changed.notify_all();
+
+	exchange.changed.wait(lock, [&exchange] { return exchange.readySlot != -1 || exchange.quit; });
+	if (exchange.readySlot == -1)
+		return nullptr;
+
+	exchange.renderingSlot = exchange.readySlot;
+	exchange.readySlot = -1;
+	exchange.changed.notify_all();
+	return &exchange.slots[exchange.renderingSlot];
+}
+
+void UQuitPacketExchange(PacketExchange& exchange) {
+	std::lock_guard<std::mutex> lock(exchange.mutex);
+	exchange.quit = true;
+	exchange.changed.notify_all();
+}
+
+//---------------------------------FRAME STATS-------------------------------------------
+//Per-thread costs, so the overlap between simulation and rendering is visible
+struct FrameStats {
+	std::atomic<uint64_t> frames{ 0 };
+	std::atomic<uint64_t> simNanoseconds{ 0 };			//Main thread: input + simulation + packet build
+	std::atomic<uint64_t> renderNanoseconds{ 0 };		//GL thread: uploads + submission + swap
+	std::atomic<uint64_t> latencyNanoseconds{ 0 };		//Packet built -> frame presented
+	std::atomic<uint64_t> fenceWaitNanoseconds{ 0 };	//Main thread: waiting for the GPU to release a ring segment
+	std::atomic<uint64_t> fenceStalls{ 0 };
+	std::atomic<uint64_t> gpuNanoseconds{ 0 };			//Scene pass on the GPU, from timer queries
+	std::atomic<uint64_t> gpuSamples{ 0 };
+	std::atomic<int> renderScalePermille{ 1000 };		//Dynamic resolution: latest scale and scene size
+	std::atomic<int> sceneWidth{ 0 };
+	std::atomic<int> sceneHeight{ 0 };
+	std::atomic<uint64_t> shadowFaces{ 0 };				//Shadow cube faces drawn, static cache and dynamic casters
+	std::atomic<uint64_t> capturedFrames{ 0 };			//--capture: reads queued, and frames dropped instead
+	std::atomic<uint64_t> droppedCaptures{ 0 };
+	const char* deviceName = "direct";				//Render device submitting the lit objects, and its cost
+	std::atomic<uint64_t> submitNanoseconds{ 0 };
+	std::atomic<uint64_t> submitCalls{ 0 };
+	std::atomic<uint64_t> submitDraws{ 0 };
+	std::chrono::steady_clock::time_point windowStart = std::chrono::steady_clock::now();
+};
+
+uint64_t UNanosecondsSince(std::chrono::steady_clock::time_point start) {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Logs throughput once per second; 'serial fps' is what the same per-frame costs would give on one thread.
+//Frame time is measured between presents, so its spread shows how evenly the pacing policy delivers frames.
+void UReportFrameStats(FrameStats& stats, FramePacer& pacer, bool threaded) {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stats.windowStart).count();
+	if (seconds < 1.0)
+		return;
+
+	uint64_t frames = stats.frames.exchange(0);
+	double simMs = stats.simNanoseconds.exchange(0) / 1e6;
+	double renderMs = stats.renderNanoseconds.exchange(0) / 1e6;
+	double latencyMs = stats.latencyNanoseconds.exchange(0) / 1e6;
+	double fenceWaitMs = stats.fenceWaitNanoseconds.exchange(0) / 1e6;
+	uint64_t fenceStalls = stats.fenceStalls.exchange(0);
+	double gpuMs = stats.gpuNanoseconds.exchange(0) / 1e6;
+	uint64_t gpuSamples = stats.gpuSamples.exchange(0);
+	uint64_t shadowFaces = stats.shadowFaces.exchange(0);
+	uint64_t capturedFrames = stats.capturedFrames.exchange(0);
+	uint64_t droppedCaptures = stats.droppedCaptures.exchange(0);
+	double submitMs = stats.submitNanoseconds.exchange(0) / 1e6;
+	uint64_t submitCalls = stats.submitCalls.exchange(0);
+	uint64_t submitDraws = stats.submitDraws.exchange(0);
+	stats.windowStart = std::chrono::steady_clock::now();
+
+	double frameMean, frameDeviation, frameWorst;
+	uint64_t presents;
+	UFrameTimeSpread(pacer.window, true, frameMean, frameDeviation, frameWorst, presents);
+	if (frames == 0)
+		return;
+
+	double avgSim = simMs / frames;
+	double avgRender = renderMs / frames;
+	LOG_INFO("INFO: %s%.1f fps, sim %.3f ms, render %.3f ms, latency %.3f ms, fence wait %.3f ms (%llu stalls), serial estimate %.1f fps",
+		threaded ? "[render thread] " : "[serial] ", frames / seconds, avgSim, avgRender, latencyMs / frames, fenceWaitMs / frames,
+		(unsigned long long)fenceStalls, 1000.0 / (avgSim + avgRender));
+	LOG_INFO("INFO: render scale %.2f (%dx%d), scene gpu %.3f ms, shadow faces %.2f/frame", stats.renderScalePermille / 1000.0, stats.sceneWidth.load(), stats.sceneHeight.load(),
+		gpuSamples ? gpuMs / gpuSamples : 0.0, (double)shadowFaces / frames);
+	LOG_INFO("INFO: pacing %s, frame time %.3f ms, stddev %.3f ms, worst %.3f ms", PACING_NAMES[pacer.policy.load()], frameMean, frameDeviation, frameWorst);
+	LOG_INFO("INFO: %s device, submit %.3f ms, %.1f GL calls, %.1f draws/frame", stats.deviceName, submitMs / frames, (double)submitCalls / frames, (double)submitDraws / frames);
+	if (capturedFrames > 0 || droppedCaptures > 0)
+		LOG_INFO("INFO: capture %.1f fps, %llu frames dropped", capturedFrames / seconds, (unsigned long long)droppedCaptures);
+}
+
+#endif
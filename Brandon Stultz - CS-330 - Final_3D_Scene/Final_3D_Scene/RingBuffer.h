@@ -0,0 +1,131 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+/*Persistently mapped ring buffer for per-frame data
+* One buffer is mapped once with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT and split into RING_FRAMES
+* segments. Each frame suballocates its transient data (uniform blocks, instance data, dynamic vertices) from
+* its own segment and fences the segment once submitted. A segment is reused RING_FRAMES frames later, after its
+* fence has signaled; with three segments the CPU fills one frame while the GPU may still read the two before it,
+* so the wait is normally zero. Time spent waiting is accumulated so CPU-GPU stalls show up in the frame stats.
+*
+* Allocation is lock-free and may be called from job system workers. UBeginRingFrame needs a current context in
+* the render context's share group, because it waits on fences the GL thread created.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "Logger.h"
+
+const int RING_FRAMES = 3;
+
+struct RingAllocation {
+	unsigned char* data = nullptr;		//Mapped, write-only memory; nullptr if the segment is full
+	GLintptr offset = 0;				//Offset into the ring's buffer, for glBindBufferRange or glBindVertexBuffer
+};
+
+struct RingBuffer {
+	GLuint buffer = 0;
+	unsigned char* mapped = nullptr;
+	size_t segmentSize = 0;
+	GLint uniformAlignment = 256;
+
+	int segment = 0;
+	std::atomic<size_t> head{ 0 };		//Bytes used in the current segment
+	GLsync fences[RING_FRAMES] = {};
+
+	std::atomic<uint64_t> waitNanoseconds{ 0 };		//Accumulated until read by the frame stats
+	std::atomic<uint64_t> stalls{ 0 };				//Frames that had to wait for the GPU
+	std::atomic<bool> overflowed{ false };
+};
+
+bool UCreateRingBuffer(RingBuffer& ring, size_t segmentSize) {
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ring.uniformAlignment);
+	ring.segmentSize = (segmentSize + ring.uniformAlignment - 1) / ring.uniformAlignment * ring.uniformAlignment;
+	GLsizeiptr size = (GLsizeiptr)(ring.segmentSize * RING_FRAMES);
+
+	//Bound to the copy target so creating it does not disturb uniform or vertex bindings
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &ring.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+	ring.mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (!ring.mapped) {
+		LOG_ERROR("ERROR::RINGBUFFER::MAP_FAILED");
+		return false;
+	}
+	return true;
+}
+
+//Size of one uniform block when several are packed back to back for glBindBufferRange
+size_t URingUniformStride(const RingBuffer& ring, size_t size) {
+	return (size + ring.uniformAlignment - 1) / ring.uniformAlignment * ring.uniformAlignment;
+}
+
+//Starts the segment for 'frame', first waiting until the GPU has finished the frame that last used it
+void UBeginRingFrame(RingBuffer& ring, uint64_t frame) {
+	ring.segment = (int)(frame % RING_FRAMES);
+
+	GLsync fence = ring.fences[ring.segment];
+	if (fence) {
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			auto waitStart = std::chrono::steady_clock::now();
+			while (glClientWaitSync(fence, 0, 1000000000) == GL_TIMEOUT_EXPIRED) {
+			}
+			ring.waitNanoseconds += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count();
+			++ring.stalls;
+		}
+		glDeleteSync(fence);
+		ring.fences[ring.segment] = 0;
+	}
+	ring.head = 0;
+}
+
+//Thread-safe suballocation from the current segment
+RingAllocation URingAllocate(RingBuffer& ring, size_t size, size_t alignment) {
+	RingAllocation allocation;
+	size_t head = ring.head.load();
+	size_t offset;
+	do {
+		offset = (head + alignment - 1) / alignment * alignment;
+		if (offset + size > ring.segmentSize) {
+			if (!ring.overflowed.exchange(true))
+				LOG_ERROR("ERROR::RINGBUFFER::SEGMENT_FULL %zu bytes", ring.segmentSize);
+			return allocation;
+		}
+	} while (!ring.head.compare_exchange_weak(head, offset + size));
+
+	allocation.offset = (GLintptr)(ring.segment * ring.segmentSize + offset);
+	allocation.data = ring.mapped + allocation.offset;
+	return allocation;
+}
+
+//GL thread, after the frame's draws have been submitted. The flush lets the fence signal for a waiter in another context.
+void UEndRingFrame(RingBuffer& ring, uint64_t frame) {
+	int segment = (int)(frame % RING_FRAMES);
+	if (ring.fences[segment])
+		glDeleteSync(ring.fences[segment]);
+	ring.fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
+
+void UDestroyRingBuffer(RingBuffer& ring) {
+	for (GLsync& fence : ring.fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = 0;
+	}
+	if (ring.buffer) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &ring.buffer);
+	}
+	ring.buffer = 0;
+	ring.mapped = nullptr;
+}
+
+#endif
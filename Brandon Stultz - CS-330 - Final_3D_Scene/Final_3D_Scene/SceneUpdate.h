@@ -0,0 +1,228 @@
+#ifndef SCENEUPDATE_H
+#define SCENEUPDATE_H
+
+/*Per-frame scene update on the job system
+* Instances are stored as parallel arrays so each pass streams through only the data it needs.
+* Three dependent passes run as parallel-for jobs over instance ranges:
+*   1. transforms  - model matrix and world bounding sphere
+*   2. visibility  - sphere vs. view frustum, counting visible instances per chunk
+*   3. draw list   - each chunk writes its visible indices at its prefix-summed offset
+* The draw list keeps instance order regardless of how the chunks were scheduled.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "JobSystem.h"
+
+//Instances per job; scenes smaller than this update inline on the calling thread
+const size_t SCENE_UPDATE_GRAIN = 1024;
+
+//Starting size of a frame arena; it grows at reset if a frame needed more
+const size_t FRAME_ARENA_SIZE = 256 * 1024;
+
+struct SceneInstances {
+	//Authoring data
+	std::vector<glm::vec3> locations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::vec3> rotationAxes;
+	std::vector<float> rotationAngles;		//Radians
+	std::vector<float> radii;				//Local bounding sphere radius
+
+	//Written every frame
+	std::vector<glm::mat4> models;
+	std::vector<glm::vec4> bounds;			//World bounding sphere (center, radius)
+	std::vector<unsigned char> visible;
+	std::vector<size_t> chunkOffsets;		//Visible count per chunk, then its offset into drawList
+	std::vector<int> drawList;				//Visible instance indices
+	size_t drawCount = 0;
+
+	glm::vec4 frustum[6];
+};
+
+int UAddInstance(SceneInstances& scene, glm::vec3 location, glm::vec3 scale, float rotationAngle, glm::vec3 rotationAxis, float radius) {
+	scene.locations.push_back(location);
+	scene.scales.push_back(scale);
+	scene.rotationAxes.push_back(rotationAxis);
+	scene.rotationAngles.push_back(rotationAngle);
+	scene.radii.push_back(radius);
+
+	size_t count = scene.locations.size();
+	scene.models.resize(count);
+	scene.bounds.resize(count);
+	scene.visible.resize(count);
+	scene.drawList.resize(count);
+	scene.chunkOffsets.resize((count + SCENE_UPDATE_GRAIN - 1) / SCENE_UPDATE_GRAIN);
+	return (int)count - 1;
+}
+
+//Frustum planes (normal, distance) from a combined projection * view matrix; normals point inwards
+void UExtractFrustum(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; ++i)
+		row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	planes[0] = row[3] + row[0];		//Left
+	planes[1] = row[3] - row[0];		//Right
+	planes[2] = row[3] + row[1];		//Bottom
+	planes[3] = row[3] - row[1];		//Top
+	planes[4] = row[3] + row[2];		//Near
+	planes[5] = row[3] - row[2];		//Far
+
+	for (int i = 0; i < 6; ++i)
+		planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+}
+
+bool USphereInFrustum(const glm::vec4 planes[6], const glm::vec4& sphere) {
+	for (int i = 0; i < 6; ++i) {
+		if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w)
+			return false;
+	}
+	return true;
+}
+
+void UUpdateTransforms(SceneInstances& scene, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; ++i) {
+		// Model matrix: transformations are applied right-to-left order
+		glm::mat4 model = glm::translate(scene.locations[i]) * glm::rotate(scene.rotationAngles[i], scene.rotationAxes[i]) * glm::scale(scene.scales[i]);
+		scene.models[i] = model;
+
+		glm::vec3 scale = scene.scales[i];
+		float maxScale = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+		scene.bounds[i] = glm::vec4(glm::vec3(model[3]), scene.radii[i] * maxScale);
+	}
+}
+
+//UParallelFor runs an empty scene as one empty range, which has no chunk to write
+void UUpdateVisibility(SceneInstances& scene, size_t begin, size_t end) {
+	if (begin == end)
+		return;
+	size_t visibleCount = 0;
+	for (size_t i = begin; i < end; ++i) {
+		scene.visible[i] = USphereInFrustum(scene.frustum, scene.bounds[i]);
+		visibleCount += scene.visible[i];
+	}
+	scene.chunkOffsets[begin / SCENE_UPDATE_GRAIN] = visibleCount;
+}
+
+void UWriteDrawList(SceneInstances& scene, size_t begin, size_t end) {
+	if (begin == end)
+		return;
+	size_t out = scene.chunkOffsets[begin / SCENE_UPDATE_GRAIN];
+	for (size_t i = begin; i < end; ++i) {
+		if (scene.visible[i])
+			scene.drawList[out++] = (int)i;
+	}
+}
+
+//Schedules the three passes; wait on the returned job before reading models, visible, or drawList
+Job* UScheduleSceneUpdate(JobSystem& system, SceneInstances& scene, const glm::mat4& viewProjection) {
+	UExtractFrustum(viewProjection, scene.frustum);
+	size_t count = scene.locations.size();
+	SceneInstances* instances = &scene;
+
+	Job* transforms = UParallelFor(system, count, SCENE_UPDATE_GRAIN,
+		[instances](size_t begin, size_t end) { UUpdateTransforms(*instances, begin, end); });
+
+	Job* visibility = UParallelFor(system, count, SCENE_UPDATE_GRAIN,
+		[instances](size_t begin, size_t end) { UUpdateVisibility(*instances, begin, end); }, { transforms });
+
+	//Chunk counts -> offsets; one entry per chunk, so this stays serial
+	Job* offsets = UCreateJob(system, [instances] {
+		size_t total = 0;
+		for (size_t& chunk : instances->chunkOffsets) {
+			size_t visibleCount = chunk;
+			chunk = total;
+			total += visibleCount;
+		}
+		instances->drawCount = total;
+	});
+	UAddDependency(system, offsets, visibility);
+	USubmitJob(system, offsets);
+
+	return UParallelFor(system, count, SCENE_UPDATE_GRAIN,
+		[instances](size_t begin, size_t end) { UWriteDrawList(*instances, begin, end); }, { offsets });
+}
+
+//-----------------------------------BENCHMARK-------------------------------------------
+//Random boxes spread through a volume the benchmark camera partly sees
+void UCreateSyntheticScene(SceneInstances& scene, size_t objectCount) {
+	srand(1234);
+	auto random = [](float low, float high) { return low + (high - low) * (float)rand() / (float)RAND_MAX; };
+	for (size_t i = 0; i < objectCount; ++i) {
+		UAddInstance(scene,
+			glm::vec3(random(-100.0f, 100.0f), random(-10.0f, 10.0f), random(-100.0f, 100.0f)),
+			glm::vec3(random(0.25f, 2.0f)), random(0.0f, 6.28f), glm::vec3(random(-1.0f, 1.0f), 1.0f, random(-1.0f, 1.0f)), 1.8f);
+	}
+}
+
+const glm::vec3 SYNTHETIC_EYE(0.0f, 5.0f, 60.0f);
+
+glm::mat4 USyntheticViewProjection() {
+	glm::mat4 view = glm::lookAt(SYNTHETIC_EYE, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	return projection * view;
+}
+
+//--bench-jobs [objects] [frames] [threads]: runs the scene update on a synthetic scene with 1..N threads
+int UBenchJobs(int argc, char* argv[]) {
+	size_t objectCount = argc > 2 ? (size_t)atol(argv[2]) : 100000;
+	int frames = argc > 3 ? atoi(argv[3]) : 100;
+	unsigned maxThreads = argc > 4 ? (unsigned)atoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+
+	SceneInstances scene;
+	UCreateSyntheticScene(scene, objectCount);
+	glm::mat4 viewProjection = USyntheticViewProjection();
+
+	std::cout << "INFO: Scene update, " << objectCount << " objects, " << frames << " frames" << std::endl;
+
+	std::vector<int> reference;
+	double singleThreadMs = 0.0;
+	for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+		FrameArena arena;
+		UCreateFrameArena(arena, FRAME_ARENA_SIZE);
+		JobSystem system;
+		UStartJobSystem(system, threads - 1, arena);
+
+		//Warm up caches and the frame arena
+		for (int i = 0; i < 3; ++i) {
+			UWaitForJob(system, UScheduleSceneUpdate(system, scene, viewProjection));
+			UResetJobs(system);
+			UResetFrameArena(arena);
+		}
+		system.steals = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < frames; ++i) {
+			UWaitForJob(system, UScheduleSceneUpdate(system, scene, viewProjection));
+			UResetJobs(system);
+			UResetFrameArena(arena);
+		}
+		double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+		uint64_t steals = system.steals;
+		UStopJobSystem(system);
+		UDestroyFrameArena(arena);
+
+		//Every thread count has to produce the same draw list
+		std::vector<int> drawList(scene.drawList.begin(), scene.drawList.begin() + scene.drawCount);
+		if (threads == 1) {
+			reference = drawList;
+			singleThreadMs = frameMs;
+		}
+		else if (drawList != reference) {
+			std::cout << "ERROR::JOBS::DRAW_LIST_MISMATCH with " << threads << " threads" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		double speedup = singleThreadMs / frameMs;
+		std::cout << "INFO: " << threads << " threads: " << frameMs << " ms/frame, speedup " << speedup
+			<< "x, efficiency " << 100.0 * speedup / threads << "%, " << scene.drawCount << " visible, "
+			<< (double)steals / frames << " steals/frame" << std::endl;
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif
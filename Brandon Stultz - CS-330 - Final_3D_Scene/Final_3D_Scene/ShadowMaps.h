@@ -0,0 +1,200 @@
+#ifndef SHADOWMAPS_H
+#define SHADOWMAPS_H
+
+/*Cached point light shadows
+* The key light casts into a depth cube map holding each texel's distance from the light over the far plane.
+* Static casters are drawn into a cached cube once per light position, so while the lamp stands still no shadow
+* geometry is drawn at all. Dynamic casters are drawn every frame over a copy of the cache and never invalidate it.
+*
+* While the lamp orbits, only a few stale faces of the cache are redrawn per frame, round-robin. Every face keeps
+* the light position it was drawn from, and the lit shader measures a fragment against the position of the face it
+* falls in, so a face that has not caught up yet gives a slightly late shadow rather than a wrong one.
+*
+* The main thread owns the light, so it schedules the faces and writes their positions into the frame's uniform
+* block; the GL thread draws the faces it is told to. If the GL thread could not draw them (geometry still
+* loading), it flags the cache as lost and the main thread schedules every face again.
+*/
+
+#include <atomic>
+
+#include "Logger.h"
+#include "ShadowShader.h"
+
+//Defined in Source.cpp
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programID);
+
+const int SHADOW_FACES = 6;
+const float SHADOW_NEAR_PLANE = 0.05f;
+
+//Main thread: which light position each face of the cache holds
+struct ShadowSchedule {
+	bool enabled = true;
+	float farPlane = 25.0f;
+	int facesPerFrame = 2;						//Stale faces redrawn per frame while the light moves
+	glm::vec3 faceLights[SHADOW_FACES];
+	bool faceDrawn[SHADOW_FACES] = {};			//False until the face holds anything
+	int nextFace = 0;
+};
+
+//GL thread: the cube maps and the program that draws into them
+struct ShadowMaps {
+	int size = 1024;
+	float farPlane = 25.0f;
+	bool hasDynamic = false;					//Whether any caster is drawn every frame
+
+	GLuint staticMap = 0;						//Cache of the static casters
+	GLuint dynamicMap = 0;						//Cache plus dynamic casters; only created when there are any
+	GLuint framebuffer = 0;
+
+	GLuint program = 0;
+	GLint faceViewProjectionLocation = -1;
+	GLint faceLightLocation = -1;
+	GLint farPlaneLocation = -1;
+
+	glm::vec3 faceLights[SHADOW_FACES];			//Copy of the schedule, for drawing the dynamic casters
+	std::atomic<bool> lost{ false };			//Scheduled faces were not drawn
+};
+
+//Cube face order of GL_TEXTURE_CUBE_MAP_POSITIVE_X onwards, with the up vectors the cube map convention expects
+const glm::vec3 SHADOW_FACE_DIRECTIONS[SHADOW_FACES] = {
+	glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+	glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+};
+const glm::vec3 SHADOW_FACE_UPS[SHADOW_FACES] = {
+	glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+	glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+};
+
+//Forgets what the cache holds, so every face is drawn with the next schedule
+void UInvalidateShadowSchedule(ShadowSchedule& schedule) {
+	for (int face = 0; face < SHADOW_FACES; ++face)
+		schedule.faceDrawn[face] = false;
+}
+
+//Picks the faces to draw for this frame's light position (main thread) and returns them as a bit mask.
+//Faces that were never drawn always are; stale ones are limited to facesPerFrame while the light moves.
+unsigned UScheduleShadowFaces(ShadowSchedule& schedule, const glm::vec3& light, bool moving) {
+	if (!schedule.enabled)
+		return 0;
+
+	unsigned faces = 0;
+	int staleBudget = moving ? schedule.facesPerFrame : SHADOW_FACES;
+	for (int i = 0; i < SHADOW_FACES; ++i) {
+		int face = (schedule.nextFace + i) % SHADOW_FACES;
+		if (schedule.faceDrawn[face]) {
+			if (schedule.faceLights[face] == light || staleBudget <= 0)
+				continue;
+			--staleBudget;
+		}
+
+		faces |= 1u << face;
+		schedule.faceLights[face] = light;
+		schedule.faceDrawn[face] = true;
+	}
+
+	//The next frame starts after the last face redrawn, so every face gets its turn
+	for (int face = SHADOW_FACES - 1; face >= 0; --face) {
+		if (faces & (1u << face)) {
+			schedule.nextFace = (face + 1) % SHADOW_FACES;
+			break;
+		}
+	}
+	return faces;
+}
+
+unsigned UShadowFaceCount(unsigned faces) {
+	unsigned count = 0;
+	for (; faces; faces &= faces - 1)
+		++count;
+	return count;
+}
+
+GLuint UCreateShadowCube(int size) {
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_DEPTH_COMPONENT24, size, size);
+
+	//Sampled as plain distances; the lit shader does the comparison itself
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	return texture;
+}
+
+//Needs the render context current
+bool UCreateShadowMaps(ShadowMaps& shadows, int size, float farPlane, bool hasDynamic) {
+	shadows.size = size < 16 ? 16 : size;
+	shadows.farPlane = farPlane;
+	shadows.hasDynamic = hasDynamic;
+
+	if (!UCreateShaderProgram(shadowVertexShaderSource, shadowFragmentShaderSource, shadows.program))
+		return false;
+	shadows.faceViewProjectionLocation = glGetUniformLocation(shadows.program, "faceViewProjection");
+	shadows.faceLightLocation = glGetUniformLocation(shadows.program, "faceLight");
+	shadows.farPlaneLocation = glGetUniformLocation(shadows.program, "farPlane");
+
+	shadows.staticMap = UCreateShadowCube(shadows.size);
+	if (hasDynamic)
+		shadows.dynamicMap = UCreateShadowCube(shadows.size);
+
+	//Depth only; the face being drawn is attached before each face
+	glGenFramebuffers(1, &shadows.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, shadows.framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	LOG_INFO("INFO: Shadow cube %dx%d, %s", shadows.size, shadows.size, hasDynamic ? "static cache plus dynamic casters" : "static casters only");
+	return true;
+}
+
+//The cube the lit shader samples
+GLuint UShadowTexture(const ShadowMaps& shadows) {
+	return shadows.hasDynamic ? shadows.dynamicMap : shadows.staticMap;
+}
+
+//Binds the shadow framebuffer and program for drawing faces
+void UBeginShadowPass(ShadowMaps& shadows) {
+	glBindFramebuffer(GL_FRAMEBUFFER, shadows.framebuffer);
+	glViewport(0, 0, shadows.size, shadows.size);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(shadows.program);
+	glUniform1f(shadows.farPlaneLocation, shadows.farPlane);
+}
+
+//Attaches one face of a cube and points the program down it from 'light'; clear starts the face over
+void UBeginShadowFace(ShadowMaps& shadows, GLuint cube, int face, const glm::vec3& light, bool clear) {
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cube, 0);
+	if (clear)
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_NEAR_PLANE, shadows.farPlane);
+	glm::mat4 view = glm::lookAt(light, light + SHADOW_FACE_DIRECTIONS[face], SHADOW_FACE_UPS[face]);
+	glm::mat4 viewProjection = projection * view;
+	glUniformMatrix4fv(shadows.faceViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glUniform3fv(shadows.faceLightLocation, 1, glm::value_ptr(light));
+}
+
+//Starts this frame's dynamic cube from the cache; all six faces in one copy
+void UCopyShadowCache(const ShadowMaps& shadows) {
+	glCopyImageSubData(shadows.staticMap, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+		shadows.dynamicMap, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0, shadows.size, shadows.size, SHADOW_FACES);
+}
+
+void UDestroyShadowMaps(ShadowMaps& shadows) {
+	glDeleteFramebuffers(1, &shadows.framebuffer);
+	glDeleteTextures(1, &shadows.staticMap);
+	glDeleteTextures(1, &shadows.dynamicMap);
+	glDeleteProgram(shadows.program);
+	shadows.framebuffer = 0;
+	shadows.staticMap = 0;
+	shadows.dynamicMap = 0;
+	shadows.program = 0;
+}
+
+#endif
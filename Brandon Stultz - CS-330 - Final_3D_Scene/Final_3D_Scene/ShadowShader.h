@@ -0,0 +1,48 @@
+#ifndef SHADOWSHADE_H
+#define SHADOWSHADE_H
+
+//Draws shadow casters into one face of a point light's distance cube map
+
+
+const char* shadowVertexShaderSource = "#version 440 core\n"
+
+"layout (location = 0) in vec3 aPos;\n"					//Vertex Position Data
+
+//Per-caster model matrix, written into the ring buffer by the main thread
+"layout (std140, binding = 0) uniform ObjectBlock\n"
+"{\n"
+"	mat4 model;\n"
+"	mat4 normalMatrix;\n"
+"	vec2 uvScale;\n"
+"};\n"
+
+"uniform mat4 faceViewProjection;\n"					//90 degree view down one cube face
+
+"out vec3 worldPosition;\n"
+
+"void main()\n"
+"{\n"
+
+"	vec4 world = model * vec4(aPos, 1.0f);\n"
+"	worldPosition = world.xyz;\n"
+"	gl_Position = faceViewProjection * world;\n"
+
+"}\0";
+
+
+const char* shadowFragmentShaderSource = "#version 440 core\n"
+
+"in vec3 worldPosition;\n"
+
+"uniform vec3 faceLight;\n"							//Light position the face is drawn from
+"uniform float farPlane;\n"
+
+"void main()\n"
+"{\n"
+
+	//Linear distance, so the lit shader can compare it with its own distance to the light directly
+"	gl_FragDepth = length(worldPosition - faceLight) / farPlane;\n"
+
+"}\0";
+
+#endif
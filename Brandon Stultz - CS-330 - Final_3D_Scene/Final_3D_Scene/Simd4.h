@@ -0,0 +1,77 @@
+#ifndef SIMD4_H
+#define SIMD4_H
+
+//Four-wide float math: SSE where the target has it, otherwise a plain array of the same interface.
+//Used by the lightmap baker's ray packets and the software rasterizer's edge functions.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD4_SSE 1
+#include <emmintrin.h>
+#endif
+
+//Lane masks are all ones or all zeros, as SSE comparisons produce them
+#ifdef SIMD4_SSE
+struct Float4 {
+	__m128 v;
+};
+
+Float4 USplat(float x) { return { _mm_set1_ps(x) }; }
+Float4 ULoad4(const float* values) { return { _mm_loadu_ps(values) }; }
+void UStore4(float* values, Float4 a) { _mm_storeu_ps(values, a.v); }
+Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+Float4 UMin4(Float4 a, Float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+Float4 UMax4(Float4 a, Float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+Float4 ULess4(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+Float4 ULessEqual4(Float4 a, Float4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+Float4 UAnd4(Float4 a, Float4 b) { return { _mm_and_ps(a.v, b.v) }; }
+Float4 UAbs4(Float4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+int UMoveMask4(Float4 mask) { return _mm_movemask_ps(mask.v); }
+Float4 USelect4(Float4 mask, Float4 a, Float4 b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+#else
+struct Float4 {
+	float v[4];
+};
+
+float UMaskLane(bool set) {
+	uint32_t bits = set ? 0xFFFFFFFFu : 0u;
+	float lane;
+	memcpy(&lane, &bits, sizeof(lane));
+	return lane;
+}
+
+uint32_t ULaneBits(float lane) {
+	uint32_t bits;
+	memcpy(&bits, &lane, sizeof(bits));
+	return bits;
+}
+
+Float4 USplat(float x) { return { { x, x, x, x } }; }
+Float4 ULoad4(const float* values) { return { { values[0], values[1], values[2], values[3] } }; }
+void UStore4(float* values, Float4 a) { memcpy(values, a.v, sizeof(a.v)); }
+Float4 operator+(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+Float4 operator-(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+Float4 operator*(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+Float4 operator/(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+Float4 UMin4(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i]; return a; }
+Float4 UMax4(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = b.v[i] > a.v[i] ? b.v[i] : a.v[i]; return a; }
+Float4 ULess4(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = UMaskLane(a.v[i] < b.v[i]); return a; }
+Float4 ULessEqual4(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = UMaskLane(a.v[i] <= b.v[i]); return a; }
+Float4 UAnd4(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = UMaskLane(ULaneBits(a.v[i]) && ULaneBits(b.v[i])); return a; }
+Float4 UAbs4(Float4 a) { for (int i = 0; i < 4; ++i) a.v[i] = std::fabs(a.v[i]); return a; }
+int UMoveMask4(Float4 mask) {
+	int bits = 0;
+	for (int i = 0; i < 4; ++i)
+		bits |= ULaneBits(mask.v[i]) ? 1 << i : 0;
+	return bits;
+}
+Float4 USelect4(Float4 mask, Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = ULaneBits(mask.v[i]) ? a.v[i] : b.v[i]; return a; }
+#endif
+
+#endif
@@ -0,0 +1,642 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+/*Tiled software rasterizer
+* CPU backend for render servers without a GPU (--software). It draws the same meshes, textures, and lighting as the
+* GL path: the meshes are read back once from their buffers, the textures are decoded from the same assets, and the lit
+* shader's Phong model is evaluated in C++ (USoftwareShade mirrors scene.frag). A frame runs in three parallel stages
+* on the rasterizer's own job system, whose participant 0 is the calling thread:
+*   1. Vertices: every draw's vertices are transformed to clip space, along with world position, normal, and
+*      texture coordinate.
+*   2. Setup and binning: triangles are clipped against the near plane, set up as edge and attribute planes, and
+*      binned into SOFTWARE_TILE_SIZE square screen tiles. Each binning job owns its bins, so nothing is locked;
+*      tiles read the jobs' bins in job order, which keeps submission order.
+*   3. Tiles: each tile is cleared and rasterized by one job, so no two threads touch the same pixels. A tile is
+*      walked in 8x8 blocks: a block outside any edge is skipped with one test per edge, and a hierarchical depth
+*      buffer (the farthest depth in each block) skips blocks the triangle is entirely behind. Inside a block the
+*      edge functions and the depth test cover four pixels at a time; covered pixels are shaded with
+*      perspective-correct attributes.
+* The color buffer is RGBA8 with row 0 at the bottom, like a GL framebuffer, so it uploads to a texture as is.
+* Cube shadows and baked lightmaps are not drawn; the ambient is the constant the lit shader uses without a bake.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Simd4.h"
+
+const int SOFTWARE_TILE_SIZE = 64;
+const int SOFTWARE_BLOCK_SIZE = 8;
+const int SOFTWARE_BLOCKS_PER_TILE = SOFTWARE_TILE_SIZE / SOFTWARE_BLOCK_SIZE;
+const size_t SOFTWARE_ARENA_SIZE = 4 * 1024 * 1024;		//Jobs for one frame, a chunk per tile at 4K
+const size_t SOFTWARE_VERTEX_GRAIN = 256;
+const int SOFTWARE_HIGHLIGHT_SQUARINGS = 4;				//scene.frag's highlightSize of 16 is 2^4
+const float SOFTWARE_AMBIENT = 0.1f;					//The unbaked lightmap's constant ambient
+
+//Interleaved mesh layout shared with UCreateMesh: position(3) color(4) normal(3) uv(2)
+const int SOFTWARE_FLOATS_PER_VERTEX = 12;
+const int SOFTWARE_NORMAL_OFFSET = 7;
+const int SOFTWARE_UV_OFFSET = 10;
+
+//--------------------------------------SCENE DATA--------------------------------------------
+struct SoftwareMesh {
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//8-bit texels with row 0 at the bottom, as uploaded to GL
+struct SoftwareTexture {
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::vector<unsigned char> texels;
+};
+
+//One draw: indices into the rasterizer's meshes and textures; texture -1 draws unlit white, like the lamp shader
+struct SoftwareDraw {
+	int mesh;
+	int texture;
+	glm::mat4 model;
+	glm::vec2 uvScale;
+};
+
+//Everything that changes per frame; the counterpart of the FrameBlock and the recorded draws
+struct SoftwareFrame {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	glm::vec3 lightPosition;
+	glm::vec3 lightColor;
+	float specIntensity = 1.0f;
+	std::vector<SoftwareDraw> draws;
+};
+
+//------------------------------------PIPELINE DATA-------------------------------------------
+struct SoftwareVertex {
+	glm::vec4 clip;
+	glm::vec3 world;
+	glm::vec3 normal;
+	glm::vec2 uv;					//Already scaled by the draw's uvScale
+};
+
+const int SOFTWARE_ATTRIBUTES = 8;	//World position, normal, uv; interpolated divided by w
+
+//Planes are a * x + b * y + c in pixels relative to (originX, originY), so they stay precise far from the origin
+struct SoftwareTriangle {
+	float edges[3][3];						//Positive inside
+	float depth[3];
+	float inverseW[3];
+	float attributes[SOFTWARE_ATTRIBUTES][3];
+	float originX;
+	float originY;
+	float minDepth;
+	int minX;								//Pixel bounds, clipped to the screen
+	int minY;
+	int maxX;
+	int maxY;
+	int texture;
+};
+
+//What one binning job produced: its triangles and, per tile, the ones touching it
+struct SoftwareBinner {
+	std::vector<SoftwareTriangle> triangles;
+	std::vector<std::vector<uint32_t>> bins;
+};
+
+struct SoftwareRasterizer {
+	//Scene data, loaded once
+	std::vector<SoftwareMesh> meshes;
+	std::vector<SoftwareTexture> textures;
+
+	//Targets, padded to whole tiles; 'stride' pixels per row
+	int width = 0;
+	int height = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+	int stride = 0;
+	std::vector<uint32_t> color;
+	std::vector<float> depth;
+	std::vector<float> blockDepth;			//Farthest depth in each 8x8 block
+
+	//Per-frame work; capacity is kept between frames so steady frames do not allocate
+	std::vector<glm::mat4> clipFromModel;
+	std::vector<glm::mat3> normalMatrices;
+	std::vector<size_t> firstVertex;		//Per draw, into 'vertices'; one extra entry holds the total
+	std::vector<size_t> firstTriangle;
+	std::vector<SoftwareVertex> vertices;
+	std::vector<SoftwareBinner> binners;
+
+	unsigned threads = 0;
+	FrameArena arena;
+	std::unique_ptr<JobSystem> system;
+
+	//Counters since UReadSoftwareStats
+	std::atomic<uint64_t> triangles{ 0 };
+	std::atomic<uint64_t> blocks{ 0 };
+	std::atomic<uint64_t> hierarchicalCulls{ 0 };
+	std::atomic<uint64_t> pixels{ 0 };
+};
+
+//-------------------------------------SETUP----------------------------------------------
+//threads 0: every hardware thread
+void UStartSoftwareRasterizer(SoftwareRasterizer& rasterizer, unsigned threads) {
+	rasterizer.threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	UCreateFrameArena(rasterizer.arena, SOFTWARE_ARENA_SIZE);
+	rasterizer.system.reset(new JobSystem());
+	UStartJobSystem(*rasterizer.system, rasterizer.threads - 1, rasterizer.arena);
+
+	//One binning job per participant
+	rasterizer.binners.resize(rasterizer.threads);
+	for (SoftwareBinner& binner : rasterizer.binners)
+		binner.bins.resize((size_t)rasterizer.tilesX * rasterizer.tilesY);
+}
+
+void UStopSoftwareRasterizer(SoftwareRasterizer& rasterizer) {
+	if (!rasterizer.system)
+		return;
+	UStopJobSystem(*rasterizer.system);
+	rasterizer.system.reset();
+	UDestroyFrameArena(rasterizer.arena);
+}
+
+//Reallocates the targets only when the size changes
+void USetSoftwareTarget(SoftwareRasterizer& rasterizer, int width, int height) {
+	width = width < 1 ? 1 : width;
+	height = height < 1 ? 1 : height;
+	if (width == rasterizer.width && height == rasterizer.height)
+		return;
+
+	rasterizer.width = width;
+	rasterizer.height = height;
+	rasterizer.tilesX = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+	rasterizer.tilesY = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+	rasterizer.stride = rasterizer.tilesX * SOFTWARE_TILE_SIZE;
+
+	size_t pixels = (size_t)rasterizer.stride * rasterizer.tilesY * SOFTWARE_TILE_SIZE;
+	rasterizer.color.assign(pixels, 0);
+	rasterizer.depth.assign(pixels, 1.0f);
+	rasterizer.blockDepth.assign(pixels / (SOFTWARE_BLOCK_SIZE * SOFTWARE_BLOCK_SIZE), 1.0f);
+	for (SoftwareBinner& binner : rasterizer.binners)
+		binner.bins.resize((size_t)rasterizer.tilesX * rasterizer.tilesY);
+}
+
+//------------------------------------VERTICES---------------------------------------------
+void UTransformVertices(SoftwareRasterizer& rasterizer, const SoftwareFrame& frame, size_t begin, size_t end) {
+	size_t draw = std::upper_bound(rasterizer.firstVertex.begin(), rasterizer.firstVertex.end(), begin) - rasterizer.firstVertex.begin() - 1;
+	for (size_t v = begin; v < end; ++v) {
+		while (v >= rasterizer.firstVertex[draw + 1])
+			++draw;
+
+		const SoftwareDraw& source = frame.draws[draw];
+		const float* in = &rasterizer.meshes[source.mesh].vertices[(v - rasterizer.firstVertex[draw]) * SOFTWARE_FLOATS_PER_VERTEX];
+		glm::vec4 position(in[0], in[1], in[2], 1.0f);
+
+		SoftwareVertex& out = rasterizer.vertices[v];
+		out.clip = rasterizer.clipFromModel[draw] * position;
+		out.world = glm::vec3(source.model * position);
+		out.normal = rasterizer.normalMatrices[draw] * glm::vec3(in[SOFTWARE_NORMAL_OFFSET], in[SOFTWARE_NORMAL_OFFSET + 1], in[SOFTWARE_NORMAL_OFFSET + 2]);
+		out.uv = glm::vec2(in[SOFTWARE_UV_OFFSET], in[SOFTWARE_UV_OFFSET + 1]) * source.uvScale;
+	}
+}
+
+//----------------------------------SETUP AND BINNING---------------------------------------
+SoftwareVertex ULerpVertex(const SoftwareVertex& a, const SoftwareVertex& b, float t) {
+	SoftwareVertex v;
+	v.clip = a.clip + (b.clip - a.clip) * t;
+	v.world = a.world + (b.world - a.world) * t;
+	v.normal = a.normal + (b.normal - a.normal) * t;
+	v.uv = a.uv + (b.uv - a.uv) * t;
+	return v;
+}
+
+//Clips against the near plane (z >= -w); the result is a convex polygon of up to four vertices
+int UClipNear(const SoftwareVertex* in, SoftwareVertex* out) {
+	int count = 0;
+	for (int i = 0; i < 3; ++i) {
+		const SoftwareVertex& a = in[i];
+		const SoftwareVertex& b = in[(i + 1) % 3];
+		float da = a.clip.z + a.clip.w;
+		float db = b.clip.z + b.clip.w;
+		if (da >= 0.0f)
+			out[count++] = a;
+		if ((da >= 0.0f) != (db >= 0.0f))
+			out[count++] = ULerpVertex(a, b, da / (da - db));
+	}
+	return count;
+}
+
+//Plane through three per-vertex values: the barycentric weights are the edge functions over twice the area
+void USetPlane(float* plane, const double edges[3][3], double area, float v0, float v1, float v2) {
+	plane[0] = (float)((edges[0][0] * v0 + edges[1][0] * v1 + edges[2][0] * v2) / area);
+	plane[1] = (float)((edges[0][1] * v0 + edges[1][1] * v1 + edges[2][1] * v2) / area);
+	plane[2] = (float)((edges[0][2] * v0 + edges[1][2] * v1 + edges[2][2] * v2) / area);
+}
+
+//Sets up one screen triangle and bins it; false if it covers no pixel centers
+bool USetupTriangle(SoftwareRasterizer& rasterizer, SoftwareBinner& binner, const SoftwareVertex* v, int texture) {
+	double x[3], y[3];
+	float z[3], inverseW[3];
+	for (int i = 0; i < 3; ++i) {
+		inverseW[i] = 1.0f / v[i].clip.w;
+		x[i] = ((double)v[i].clip.x * inverseW[i] * 0.5 + 0.5) * rasterizer.width;
+		y[i] = ((double)v[i].clip.y * inverseW[i] * 0.5 + 0.5) * rasterizer.height;
+		z[i] = v[i].clip.z * inverseW[i] * 0.5f + 0.5f;
+	}
+
+	//Pixel centers (px + 0.5) inside the bounds, clipped to the screen
+	int minX = std::max(0, (int)std::ceil(std::min(x[0], std::min(x[1], x[2])) - 0.5));
+	int minY = std::max(0, (int)std::ceil(std::min(y[0], std::min(y[1], y[2])) - 0.5));
+	int maxX = std::min(rasterizer.width - 1, (int)std::floor(std::max(x[0], std::max(x[1], x[2])) - 0.5));
+	int maxY = std::min(rasterizer.height - 1, (int)std::floor(std::max(y[0], std::max(y[1], y[2])) - 0.5));
+	if (minX > maxX || minY > maxY)
+		return false;
+
+	SoftwareTriangle triangle;
+	triangle.originX = (float)minX + 0.5f;
+	triangle.originY = (float)minY + 0.5f;
+
+	//Edge i is opposite vertex i; its constant is taken at the origin in double precision
+	double edges[3][3];
+	for (int i = 0; i < 3; ++i) {
+		int j = (i + 1) % 3;
+		int k = (i + 2) % 3;
+		edges[i][0] = y[j] - y[k];
+		edges[i][1] = x[k] - x[j];
+		edges[i][2] = edges[i][0] * (triangle.originX - x[j]) + edges[i][1] * (triangle.originY - y[j]);
+	}
+	double area = edges[0][0] * (x[0] - x[1]) + edges[0][1] * (y[0] - y[1]);
+	if (std::fabs(area) < 1e-9)
+		return false;
+
+	//Nothing is culled by facing (the GL path draws both sides); clockwise triangles have their edges flipped
+	if (area < 0.0) {
+		for (int i = 0; i < 3; ++i)
+			for (int c = 0; c < 3; ++c)
+				edges[i][c] = -edges[i][c];
+		area = -area;
+	}
+
+	for (int i = 0; i < 3; ++i)
+		for (int c = 0; c < 3; ++c)
+			triangle.edges[i][c] = (float)edges[i][c];
+	USetPlane(triangle.depth, edges, area, z[0], z[1], z[2]);
+	USetPlane(triangle.inverseW, edges, area, inverseW[0], inverseW[1], inverseW[2]);
+	for (int a = 0; a < SOFTWARE_ATTRIBUTES; ++a) {
+		float values[3];
+		for (int i = 0; i < 3; ++i) {
+			const float* attributes[3] = { &v[i].world.x, &v[i].normal.x, &v[i].uv.x };
+			values[i] = (a < 3 ? attributes[0][a] : (a < 6 ? attributes[1][a - 3] : attributes[2][a - 6])) * inverseW[i];
+		}
+		USetPlane(triangle.attributes[a], edges, area, values[0], values[1], values[2]);
+	}
+	triangle.minDepth = std::min(z[0], std::min(z[1], z[2]));
+	triangle.minX = minX;
+	triangle.minY = minY;
+	triangle.maxX = maxX;
+	triangle.maxY = maxY;
+	triangle.texture = texture;
+
+	uint32_t index = (uint32_t)binner.triangles.size();
+	binner.triangles.push_back(triangle);
+	for (int ty = minY / SOFTWARE_TILE_SIZE; ty <= maxY / SOFTWARE_TILE_SIZE; ++ty)
+		for (int tx = minX / SOFTWARE_TILE_SIZE; tx <= maxX / SOFTWARE_TILE_SIZE; ++tx)
+			binner.bins[(size_t)ty * rasterizer.tilesX + tx].push_back(index);
+	return true;
+}
+
+//Binning job 'job' takes its share of every draw's triangles, in draw order
+void UBinTriangles(SoftwareRasterizer& rasterizer, const SoftwareFrame& frame, size_t job) {
+	SoftwareBinner& binner = rasterizer.binners[job];
+	binner.triangles.clear();
+	for (std::vector<uint32_t>& bin : binner.bins)
+		bin.clear();
+
+	size_t total = rasterizer.firstTriangle.back();
+	size_t begin = total * job / rasterizer.binners.size();
+	size_t end = total * (job + 1) / rasterizer.binners.size();
+	if (begin == end)
+		return;
+
+	uint64_t binned = 0;
+	size_t draw = std::upper_bound(rasterizer.firstTriangle.begin(), rasterizer.firstTriangle.end(), begin) - rasterizer.firstTriangle.begin() - 1;
+	for (size_t t = begin; t < end; ++t) {
+		while (t >= rasterizer.firstTriangle[draw + 1])
+			++draw;
+
+		const SoftwareDraw& source = frame.draws[draw];
+		const uint32_t* indices = &rasterizer.meshes[source.mesh].indices[(t - rasterizer.firstTriangle[draw]) * 3];
+		SoftwareVertex corners[3];
+		for (int i = 0; i < 3; ++i)
+			corners[i] = rasterizer.vertices[rasterizer.firstVertex[draw] + indices[i]];
+
+		//Entirely outside one side of the frustum
+		bool outside = false;
+		for (int axis = 0; axis < 3 && !outside; ++axis) {
+			outside = (corners[0].clip[axis] > corners[0].clip.w && corners[1].clip[axis] > corners[1].clip.w && corners[2].clip[axis] > corners[2].clip.w) ||
+				(corners[0].clip[axis] < -corners[0].clip.w && corners[1].clip[axis] < -corners[1].clip.w && corners[2].clip[axis] < -corners[2].clip.w);
+		}
+		if (outside)
+			continue;
+
+		SoftwareVertex polygon[4];
+		int count = UClipNear(corners, polygon);
+		for (int i = 1; i + 1 < count; ++i) {
+			SoftwareVertex fan[3] = { polygon[0], polygon[i], polygon[i + 1] };
+			binned += USetupTriangle(rasterizer, binner, fan, source.texture) ? 1 : 0;
+		}
+	}
+	rasterizer.triangles += binned;
+}
+
+//---------------------------------------SHADING--------------------------------------------
+//Bilinear with repeat wrapping, as the scene textures are sampled
+glm::vec3 USampleTexture(const SoftwareTexture& texture, glm::vec2 uv) {
+	//Wrapping the coordinate first leaves at most one texel to wrap on each side, without integer division
+	float u = (uv.x - std::floor(uv.x)) * texture.width - 0.5f;
+	float v = (uv.y - std::floor(uv.y)) * texture.height - 0.5f;
+	float fu = std::floor(u);
+	float fv = std::floor(v);
+	float tu = u - fu;
+	float tv = v - fv;
+
+	int x0 = (int)fu < 0 ? texture.width - 1 : std::min((int)fu, texture.width - 1);
+	int y0 = (int)fv < 0 ? texture.height - 1 : std::min((int)fv, texture.height - 1);
+	int x1 = x0 + 1 == texture.width ? 0 : x0 + 1;
+	int y1 = y0 + 1 == texture.height ? 0 : y0 + 1;
+
+	const unsigned char* texels = texture.texels.data();
+	int channels = texture.channels;
+	glm::vec3 result(0.0f);
+	const int xs[2] = { x0, x1 };
+	const int ys[2] = { y0, y1 };
+	for (int j = 0; j < 2; ++j) {
+		for (int i = 0; i < 2; ++i) {
+			const unsigned char* texel = texels + ((size_t)ys[j] * texture.width + xs[i]) * channels;
+			float weight = (i ? tu : 1.0f - tu) * (j ? tv : 1.0f - tv);
+			result += glm::vec3(texel[0], texel[channels > 1 ? 1 : 0], texel[channels > 2 ? 2 : 0]) * weight;
+		}
+	}
+	return result / 255.0f;
+}
+
+//scene.frag's Phong model with the unbaked ambient and no shadow
+glm::vec3 USoftwareShade(const SoftwareRasterizer& rasterizer, const SoftwareFrame& frame, int texture, const glm::vec3& world, const glm::vec3& normal, const glm::vec2& uv) {
+	if (texture < 0)
+		return glm::vec3(1.0f);
+
+	glm::vec3 ambient = SOFTWARE_AMBIENT * frame.lightColor;
+
+	glm::vec3 norm = glm::normalize(normal);
+	glm::vec3 lightDirection = glm::normalize(frame.lightPosition - world);
+	float impact = std::max(glm::dot(norm, lightDirection), 0.0f);
+	glm::vec3 diffuse = impact * frame.lightColor;
+
+	glm::vec3 viewDir = glm::normalize(frame.viewPosition - world);
+	glm::vec3 reflectDir = glm::reflect(-lightDirection, norm);
+	float specularComponent = std::max(glm::dot(viewDir, reflectDir), 0.0f);
+	for (int i = 0; i < SOFTWARE_HIGHLIGHT_SQUARINGS; ++i)
+		specularComponent *= specularComponent;
+	glm::vec3 specular = frame.specIntensity * specularComponent * frame.lightColor;
+
+	const SoftwareTexture& source = rasterizer.textures[texture];
+	glm::vec3 textureColor = source.texels.empty() ? glm::vec3(1.0f) : USampleTexture(source, uv);
+	return (ambient + diffuse + specular) * textureColor;
+}
+
+uint32_t UPackColor(const glm::vec3& color) {
+	uint32_t r = (uint32_t)(std::min(std::max(color.r, 0.0f), 1.0f) * 255.0f + 0.5f);
+	uint32_t g = (uint32_t)(std::min(std::max(color.g, 0.0f), 1.0f) * 255.0f + 0.5f);
+	uint32_t b = (uint32_t)(std::min(std::max(color.b, 0.0f), 1.0f) * 255.0f + 0.5f);
+	return r | (g << 8) | (b << 16) | 0xFF000000u;
+}
+
+//-----------------------------------------TILES--------------------------------------------
+//Farthest depth left in a block after it was drawn into
+float UBlockFarthestDepth(const float* depth, int stride) {
+	Float4 farthest = USplat(0.0f);
+	for (int row = 0; row < SOFTWARE_BLOCK_SIZE; ++row, depth += stride)
+		for (int x = 0; x < SOFTWARE_BLOCK_SIZE; x += 4)
+			farthest = UMax4(farthest, ULoad4(depth + x));
+
+	float lanes[4];
+	UStore4(lanes, farthest);
+	return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+//Draws the part of a triangle inside one tile; returns the pixels shaded
+uint64_t URasterizeTriangle(SoftwareRasterizer& rasterizer, const SoftwareFrame& frame, const SoftwareTriangle& triangle, int tileX, int tileY,
+	uint64_t& blocks, uint64_t& hierarchicalCulls) {
+
+	int x0 = std::max(triangle.minX, tileX);
+	int y0 = std::max(triangle.minY, tileY);
+	int x1 = std::min(triangle.maxX, tileX + SOFTWARE_TILE_SIZE - 1);
+	int y1 = std::min(triangle.maxY, tileY + SOFTWARE_TILE_SIZE - 1);
+	if (x0 > x1 || y0 > y1)
+		return 0;
+
+	static const float RAMP[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	const Float4 ramp = ULoad4(RAMP);
+	const Float4 zero = USplat(0.0f);
+	uint64_t shaded = 0;
+
+	int blockX0 = (x0 - tileX) / SOFTWARE_BLOCK_SIZE;
+	int blockX1 = (x1 - tileX) / SOFTWARE_BLOCK_SIZE;
+	int blockY0 = (y0 - tileY) / SOFTWARE_BLOCK_SIZE;
+	int blockY1 = (y1 - tileY) / SOFTWARE_BLOCK_SIZE;
+	for (int by = blockY0; by <= blockY1; ++by) {
+		for (int bx = blockX0; bx <= blockX1; ++bx) {
+			int px = tileX + bx * SOFTWARE_BLOCK_SIZE;
+			int py = tileY + by * SOFTWARE_BLOCK_SIZE;
+			float dx = px + 0.5f - triangle.originX;
+			float dy = py + 0.5f - triangle.originY;
+
+			//Coarse test: each edge at the block's pixel center where it is largest
+			bool outside = false;
+			for (int e = 0; e < 3 && !outside; ++e) {
+				const float* edge = triangle.edges[e];
+				float largest = edge[0] * dx + edge[1] * dy + edge[2] +
+					std::max(edge[0], 0.0f) * (SOFTWARE_BLOCK_SIZE - 1) + std::max(edge[1], 0.0f) * (SOFTWARE_BLOCK_SIZE - 1);
+				outside = largest < 0.0f;
+			}
+			if (outside)
+				continue;
+
+			//Hierarchical depth: the whole triangle is behind everything already in the block
+			++blocks;
+			size_t block = (size_t)(py / SOFTWARE_BLOCK_SIZE) * (rasterizer.stride / SOFTWARE_BLOCK_SIZE) + px / SOFTWARE_BLOCK_SIZE;
+			if (triangle.minDepth >= rasterizer.blockDepth[block]) {
+				++hierarchicalCulls;
+				continue;
+			}
+
+			bool written = false;
+			for (int row = 0; row < SOFTWARE_BLOCK_SIZE; ++row) {
+				int y = py + row;
+				float ly = dy + row;
+				for (int column = 0; column < SOFTWARE_BLOCK_SIZE; column += 4) {
+					int x = px + column;
+					Float4 lx = USplat(dx + column) + ramp;
+					Float4 fy = USplat(ly);
+
+					Float4 e0 = USplat(triangle.edges[0][0]) * lx + USplat(triangle.edges[0][1]) * fy + USplat(triangle.edges[0][2]);
+					Float4 e1 = USplat(triangle.edges[1][0]) * lx + USplat(triangle.edges[1][1]) * fy + USplat(triangle.edges[1][2]);
+					Float4 e2 = USplat(triangle.edges[2][0]) * lx + USplat(triangle.edges[2][1]) * fy + USplat(triangle.edges[2][2]);
+					Float4 covered = UAnd4(UAnd4(ULessEqual4(zero, e0), ULessEqual4(zero, e1)), ULessEqual4(zero, e2));
+					if (!UMoveMask4(covered))
+						continue;
+
+					//Depth is linear in screen space; GL_LESS against the cleared 1.0
+					float* depthRow = &rasterizer.depth[(size_t)y * rasterizer.stride + x];
+					Float4 stored = ULoad4(depthRow);
+					Float4 z = USplat(triangle.depth[0]) * lx + USplat(triangle.depth[1]) * fy + USplat(triangle.depth[2]);
+					Float4 passed = UAnd4(covered, ULess4(z, stored));
+					int lanes = UMoveMask4(passed);
+					if (!lanes)
+						continue;
+					UStore4(depthRow, USelect4(passed, z, stored));
+					written = true;
+
+					float laneX[4];
+					UStore4(laneX, lx);
+					uint32_t* colorRow = &rasterizer.color[(size_t)y * rasterizer.stride + x];
+					for (int lane = 0; lane < 4; ++lane) {
+						if (!(lanes & (1 << lane)))
+							continue;
+
+						//Perspective-correct: attributes over w are linear in screen space
+						float w = 1.0f / (triangle.inverseW[0] * laneX[lane] + triangle.inverseW[1] * ly + triangle.inverseW[2]);
+						float values[SOFTWARE_ATTRIBUTES];
+						for (int a = 0; a < SOFTWARE_ATTRIBUTES; ++a)
+							values[a] = (triangle.attributes[a][0] * laneX[lane] + triangle.attributes[a][1] * ly + triangle.attributes[a][2]) * w;
+
+						glm::vec3 color = USoftwareShade(rasterizer, frame, triangle.texture, glm::vec3(values[0], values[1], values[2]),
+							glm::vec3(values[3], values[4], values[5]), glm::vec2(values[6], values[7]));
+						colorRow[lane] = UPackColor(color);
+						++shaded;
+					}
+				}
+			}
+
+			if (written)
+				rasterizer.blockDepth[block] = UBlockFarthestDepth(&rasterizer.depth[(size_t)py * rasterizer.stride + px], rasterizer.stride);
+		}
+	}
+	return shaded;
+}
+
+//Clears one tile and draws every binned triangle into it, in submission order
+void URasterizeTile(SoftwareRasterizer& rasterizer, const SoftwareFrame& frame, size_t tile) {
+	int tileX = (int)(tile % rasterizer.tilesX) * SOFTWARE_TILE_SIZE;
+	int tileY = (int)(tile / rasterizer.tilesX) * SOFTWARE_TILE_SIZE;
+
+	//Padding outside the screen gets a depth nothing passes, so edge blocks need no bounds checks
+	for (int y = tileY; y < tileY + SOFTWARE_TILE_SIZE; ++y) {
+		uint32_t* colorRow = &rasterizer.color[(size_t)y * rasterizer.stride + tileX];
+		float* depthRow = &rasterizer.depth[(size_t)y * rasterizer.stride + tileX];
+		std::fill(colorRow, colorRow + SOFTWARE_TILE_SIZE, 0xFF000000u);
+		for (int x = 0; x < SOFTWARE_TILE_SIZE; ++x)
+			depthRow[x] = tileX + x < rasterizer.width && y < rasterizer.height ? 1.0f : -1.0f;
+	}
+	size_t blockStride = rasterizer.stride / SOFTWARE_BLOCK_SIZE;
+	for (int by = 0; by < SOFTWARE_BLOCKS_PER_TILE; ++by) {
+		float* blockRow = &rasterizer.blockDepth[(tileY / SOFTWARE_BLOCK_SIZE + by) * blockStride + tileX / SOFTWARE_BLOCK_SIZE];
+		std::fill(blockRow, blockRow + SOFTWARE_BLOCKS_PER_TILE, 1.0f);
+	}
+
+	uint64_t shaded = 0;
+	uint64_t blocks = 0;
+	uint64_t hierarchicalCulls = 0;
+	for (const SoftwareBinner& binner : rasterizer.binners) {
+		for (uint32_t index : binner.bins[tile])
+			shaded += URasterizeTriangle(rasterizer, frame, binner.triangles[index], tileX, tileY, blocks, hierarchicalCulls);
+	}
+	rasterizer.pixels += shaded;
+	rasterizer.blocks += blocks;
+	rasterizer.hierarchicalCulls += hierarchicalCulls;
+}
+
+//------------------------------------------FRAME-------------------------------------------
+//Draws a frame into the color buffer at the target size, on the calling thread and the rasterizer's workers
+void URasterizeFrame(SoftwareRasterizer& rasterizer, const SoftwareFrame& frame) {
+	size_t drawCount = frame.draws.size();
+	rasterizer.clipFromModel.resize(drawCount);
+	rasterizer.normalMatrices.resize(drawCount);
+	rasterizer.firstVertex.resize(drawCount + 1);
+	rasterizer.firstTriangle.resize(drawCount + 1);
+	rasterizer.firstVertex[0] = 0;
+	rasterizer.firstTriangle[0] = 0;
+
+	glm::mat4 clipFromWorld = frame.projection * frame.view;
+	for (size_t d = 0; d < drawCount; ++d) {
+		const SoftwareDraw& draw = frame.draws[d];
+		const SoftwareMesh& mesh = rasterizer.meshes[draw.mesh];
+		rasterizer.clipFromModel[d] = clipFromWorld * draw.model;
+		rasterizer.normalMatrices[d] = glm::mat3(glm::transpose(glm::inverse(draw.model)));
+		rasterizer.firstVertex[d + 1] = rasterizer.firstVertex[d] + mesh.vertices.size() / SOFTWARE_FLOATS_PER_VERTEX;
+		rasterizer.firstTriangle[d + 1] = rasterizer.firstTriangle[d] + mesh.indices.size() / 3;
+	}
+	rasterizer.vertices.resize(rasterizer.firstVertex.back());
+
+	SoftwareRasterizer* target = &rasterizer;
+	const SoftwareFrame* source = &frame;
+	JobSystem& system = *rasterizer.system;
+
+	Job* vertices = UParallelFor(system, rasterizer.vertices.size(), SOFTWARE_VERTEX_GRAIN,
+		[target, source](size_t begin, size_t end) { UTransformVertices(*target, *source, begin, end); });
+	Job* binning = UParallelFor(system, rasterizer.binners.size(), 1,
+		[target, source](size_t begin, size_t end) {
+			for (size_t job = begin; job < end; ++job)
+				UBinTriangles(*target, *source, job);
+		}, { vertices });
+	Job* tiles = UParallelFor(system, (size_t)rasterizer.tilesX * rasterizer.tilesY, 1,
+		[target, source](size_t begin, size_t end) {
+			for (size_t tile = begin; tile < end; ++tile)
+				URasterizeTile(*target, *source, tile);
+		}, { binning });
+
+	UWaitForJob(system, tiles);
+	UResetJobs(system);
+	UResetFrameArena(rasterizer.arena);
+}
+
+//Counters since the last read; hierarchical culls are a share of the blocks the coarse test kept
+void UReadSoftwareStats(SoftwareRasterizer& rasterizer, uint64_t& triangles, uint64_t& blocks, uint64_t& hierarchicalCulls, uint64_t& pixels) {
+	triangles = rasterizer.triangles.exchange(0);
+	blocks = rasterizer.blocks.exchange(0);
+	hierarchicalCulls = rasterizer.hierarchicalCulls.exchange(0);
+	pixels = rasterizer.pixels.exchange(0);
+}
+
+//Binary PPM, top row first
+bool UWriteSoftwareImage(const SoftwareRasterizer& rasterizer, const std::string& path) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file) {
+		LOG_ERROR("ERROR::SOFTWARE::WRITE_FAILED %s", path.c_str());
+		return false;
+	}
+
+	fprintf(file, "P6\n%d %d\n255\n", rasterizer.width, rasterizer.height);
+	std::vector<unsigned char> row((size_t)rasterizer.width * 3);
+	for (int y = rasterizer.height - 1; y >= 0; --y) {
+		const uint32_t* pixels = &rasterizer.color[(size_t)y * rasterizer.stride];
+		for (int x = 0; x < rasterizer.width; ++x) {
+			row[x * 3] = (unsigned char)(pixels[x] & 0xFF);
+			row[x * 3 + 1] = (unsigned char)((pixels[x] >> 8) & 0xFF);
+			row[x * 3 + 2] = (unsigned char)((pixels[x] >> 16) & 0xFF);
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+	return true;
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include <iostream>			//cout,cerr
 #include <cstdlib>			//EXIT_FAILURE
+#include <cstring>			//strcmp, memcpy
 #include <GL/glew.h>		//GLEW library
 #include <GLFW/glfw3.h>		//GLFW library
 
@@ -13,6 +14,24 @@
 #include "lampFragmentShader.h"
 #include "lampVertexShader.h"
 
+//Asynchronous, frame-stamped logging
+#include "Logger.h"
+
+//Asset pack and unified asset lookup
+#include "AssetPack.h"
+
+//Box, prism, cylinder, and sphere geometry generated at compile time or straight into mapped buffers
+#include "MeshGenerators.h"
+
+//Vertex formats derived from attribute lists, one shared vertex array per format
+#include "VertexLayout.h"
+
+//Concurrent startup loading
+#include "LoadGraph.h"
+
+//Live shader, texture, and mesh reloading
+#include "HotReload.h"
+
 //GLM Math Header Inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -21,6 +40,46 @@
 //Camera class
 #include <learnOpengl/camera.h>
 
+//Timestamped input events and action mapping
+#include "Input.h"
+
+//Fixed-step simulation clock and frame pacing policies
+#include "FramePacing.h"
+
+//Main-thread simulation handing frames to the render thread
+#include "RenderThread.h"
+
+//Job system and the parallel per-frame scene update
+#include "SceneUpdate.h"
+
+//Persistently mapped per-frame data
+#include "RingBuffer.h"
+
+//Offscreen scene target with a GPU-time-driven resolution
+#include "DynamicResolution.h"
+
+//Passes and render targets of a frame
+#include "RenderGraph.h"
+#include "AntialiasShader.h"
+
+//Cached shadow cube for the key light
+#include "ShadowMaps.h"
+
+//Offline lightmap baker and baked ambient lighting
+#include "Lightmapper.h"
+
+//Tiled CPU rasterizer for machines without a GPU
+#include "SoftwareRasterizer.h"
+#include "RayQuery.h"
+#include "FrameCapture.h"
+#include "FrameServer.h"
+
+//Dust around the lamp, simulated and drawn entirely on the GPU
+#include "ParticleSystem.h"
+
+//Direct and multi-draw-indirect submission of the lit objects
+#include "RenderDevice.h"
+
 
 
 using namespace std; // Uses the standard namespace
@@ -35,8 +94,9 @@ namespace {
 
 	//Stores the GL data telative to a given mesh
 	struct GLMesh {
-		GLuint vaos[5];				//handles vertex array objects
+		GLuint vao;					//Shared by every mesh; a mesh's buffers are bound to it before it is drawn
 		GLuint vbos[10];			//handles vertex buffer objects
+		GLuint neutralCoordinates;	//Lightmap coordinate read by every vertex of an object without a bake
 
 		GLuint ex_vaos[1];				//handles vertex array objects
 		GLuint ex_vbos[2];			//handles vertex buffer objects
@@ -54,25 +114,31 @@ namespace {
 	//Main GLFW window
 	GLFWwindow* window = nullptr;
 
-	//Texture
+	//Texture (0 until loaded; gFallbackTexture is bound in the meantime or after a failed load)
 	GLuint texture1;
 	GLuint texture2;
 	GLuint texture3;
 	GLuint texture4;
+	GLuint gFallbackTexture;
 
-	//Shader Program
+	//Shader Program (0 until linked)
 	GLuint programID;
 	GLuint lampID;
 
+	//Set on the context thread once UCreateMesh has uploaded the geometry. Packets carry pointers into 'mesh'
+	//(DrawSource::buffers, indexCount) and only the GL thread reads through them, after checking this.
+	std::atomic<bool> gMeshReady{ false };
+
 	//camera
 	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
-	float lastX = WINDOW_WIDTH / 2.0f;
-	float lastY = WINDOW_HEIGHT / 2.0f;
-	bool firstMouse = true;
 
-	//timing
-	float deltaTime = 0.0f;  //timing between current frame and last frame
-	float lastFrame = 0.0f;
+	//Filled by the GLFW callbacks, consumed once per simulation step
+	InputSystem gInput;
+
+	//timing: the simulation advances in fixed steps; frames render a blend of the last two
+	SimulationClock gSimulationClock;
+	const double SIMULATION_RATE = 120.0;		//Steps per second
+	FramePacer gFramePacer;
 
 	//------------------KEY LIGHT-----------------------
 	// key light color
@@ -83,20 +149,118 @@ namespace {
 	float keyLightIntensity(1.0f);
 
 	// key Light position and scale
-	glm::vec3 keyLightPosition(1.5f, 0.5f, 3.0f);
+	const glm::vec3 KEY_LIGHT_START(1.5f, 0.5f, 3.0f);
+	glm::vec3 keyLightPosition = KEY_LIGHT_START;
 	glm::vec3 keyLightScale(0.3f);
 
-	// Lamp animation
+	// Lamp animation; the position is derived from the orbit angle
 	bool gIsLampOrbiting = true;
+	float gLampOrbitAngle = 0.0f;
+
+	//Simulated state that is interpolated for rendering
+	struct SimulationState {
+		glm::vec3 cameraPosition;
+		float lampOrbitAngle;
+		glm::vec3 cameraFront;			//Orientation and zoom are not interpolated
+		float cameraZoom;
+	};
+	SimulationState gPreviousState;			//Before the most recent step
+	SimulationState gCurrentState;			//After it
+
+	//------------------THREADS-----------------------
+	//Framebuffer size as reported on the main thread; the render thread applies it to the viewport
+	std::atomic<int> gFramebufferWidth{ WINDOW_WIDTH };
+	std::atomic<int> gFramebufferHeight{ WINDOW_HEIGHT };
+	std::atomic<bool> gFramebufferResized{ false };
+
+	//Startup loads and hot reload are pumped from whichever thread owns the GL context
+	LoadGraph gLoadGraph;
+	HotReloader gReloader;
+
+	const char* const TEXTURE_FILE_NAMES[4] = { "Eraser_Texture.jpg", "Table_Texture.jpg", "Pad_Texture.jpg", "Index_Texture.jpg" };
+	GLuint* const gTextureTargets[4] = { &texture1, &texture2, &texture3, &texture4 };
+
+	PacketExchange gPacketExchange;
+	FrameStats gFrameStats;
+
+	//Per-frame CPU work (transforms, culling, draw lists) on the main thread plus workers
+	FrameArena gFrameArena;				//Reset at the top of every main loop iteration
+	JobSystem gJobSystem;
+	SceneInstances gSceneInstances;
+	std::vector<DrawSource> gDrawSources;		//Indexed like gSceneInstances
+
+	//Per-frame uniform blocks (and any other transient GPU data), written by the main thread and recorders
+	RingBuffer gRingBuffer;
+	const size_t RING_SEGMENT_SIZE = 2 * 1024 * 1024;
+
+	//The scene is drawn at a scale of the window size that keeps the GPU within budget (GL thread)
+	DynamicResolution gDynamicResolution;
+
+	//Scene, post-processing, and upscale passes; rebuilt when the framebuffer is resized (GL thread)
+	RenderGraph gRenderGraph;
+
+	//FXAA at render resolution; 0 when turned off with --no-antialias
+	GLuint gAntialiasID = 0;
+	GLint gAntialiasRegionLocation = -1;
+	GLint gAntialiasTexelLocation = -1;
+
+	//Key light shadows: the main thread schedules cube faces, the GL thread draws them; off with --no-shadows
+	ShadowSchedule gShadowSchedule;
+	ShadowMaps gShadowMaps;
+
+	//Dust motes around the lamp (GL thread); --particles N sets the count, 0 turns them off. The capacity is set
+	//before the render thread starts, so the main thread reads it to keep frames coming while they drift.
+	ParticleSystem gParticles;
+	std::chrono::steady_clock::time_point gParticlesUpdatedAt;
+
+	//Baked ambient per scene object, indexed like gSceneObjects; 0 until loaded, when gNeutralLightmap is bound
+	GLuint gLightmaps[4] = {};
+	GLuint gLightmapCoordinateBuffers[4] = {};
+	GLuint gNeutralLightmap = 0;
+
+	//--software: the CPU rasterizer draws the scene and GL only presents it. Its meshes and textures are ready once
+	//the "software scene" load job has read them back (GL thread from then on).
+	bool gSoftwareRendering = false;
+	SoftwareRasterizer gSoftwareRasterizer;
+	std::atomic<bool> gSoftwareSceneReady{ false };
+	GLuint gSoftwareTexture = 0;
+	GLuint gSoftwareFramebuffer = 0;
+	int gSoftwareTextureWidth = 0;
+	int gSoftwareTextureHeight = 0;
+
+	//Object picking: the "ray query scene" load job builds a BLAS per mesh; the main thread rebuilds the TLAS for
+	//each click and traces the cursor's ray through it
+	RayQueryScene gRayQueryScene;
+	std::atomic<bool> gRayQuerySceneReady{ false };
+
+	//--capture: presented frames are read back through a ring of pack buffers and encoded on worker threads (GL thread)
+	FrameCapture gFrameCapture;
+
+	//Shares the render context's objects so the main thread can wait on the ring's fences
+	GLFWwindow* gSyncContext = nullptr;
+
+	//GL thread: merged, sorted command lists for the frame being submitted
+	std::vector<DrawRecord> gSubmitDraws;
+	RenderDevice gRenderDevice;				//Draws them; --render-device direct|indirect
 
 }
 
 //---------------------------------- - WINDOW------------------------------------------
 // glfw: function is called when ever window size changes
+// (called on the main thread while polling events, so only the size is recorded here)
 void UResizeWindow(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+	gFramebufferResized = true;
+	UInvalidateFrame(gFramePacer);
+}
+
+// glfw: the window was exposed and its contents need to be drawn again
+void URefreshWindow(GLFWwindow*) {
+	UInvalidateFrame(gFramePacer);
 }
 
+void KeyCallback(GLFWwindow*, int key, int scancode, int action, int mods);
 void MousePositionCallback(GLFWwindow*, double xpos, double ypos);
 void MouseScrollCallback(GLFWwindow*, double xoffset, double yoffset);
 void MouseButtonCallback(GLFWwindow*, int button, int action, int mods);
@@ -107,7 +271,7 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
 	//GLFW: intitialize and configure
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	//---------------------Initialzation and configuration for APPLE devices-------------
@@ -121,7 +285,7 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
 
 	//window terminating logic 
 	if (*window == NULL) {
-		std::cout << "Failed to create GLFW window" << std::endl;
+		LOG_ERROR("Failed to create GLFW window");
 		glfwTerminate();
 		return false;
 	}
@@ -129,8 +293,10 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
 	//sets window as current context
 	glfwMakeContextCurrent(*window);
 	glfwSetFramebufferSizeCallback(*window, UResizeWindow);
+	glfwSetWindowRefreshCallback(*window, URefreshWindow);
 
-	//Mouse call back function initialization
+	//Keyboard and mouse call back function initialization
+	glfwSetKeyCallback(*window, KeyCallback);
 	glfwSetCursorPosCallback(*window, MousePositionCallback);
 	glfwSetScrollCallback(*window, MouseScrollCallback);
 	glfwSetMouseButtonCallback(*window, MouseButtonCallback);
@@ -144,12 +310,12 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
 
 	//logic check to ensure GLEW was initialized successfully
 	if (GLEW_OK != GlewInitResult) {
-		std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
+		LOG_ERROR("%s", (const char*)glewGetErrorString(GlewInitResult));
 		return false;
 	}
 
 	//Display GPU OpenGL version
-	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+	LOG_INFO("INFO: OpenGL Version: %s", (const char*)glGetString(GL_VERSION));
 
 	return true;
 }
@@ -157,343 +323,174 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
 //------------------------------------------------------------------------------------
 //************************************************************************************
 //--------------------------------------INPUT-----------------------------------------
-void KeyBoardInput(GLFWwindow* window) {
+//Applies one simulation step of mapped input to the camera; movement is scaled by how long each action was held
+void UUpdateCamera(const InputSystem& input) {
 
-	static float cameraSpeed = 0.15f;
-
-	//Checks if escape key is pressed; if it is terminates window
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	//Escape terminates the window (the frame server has none)
+	if (input.pressed[ACTION_QUIT] && window)
 		glfwSetWindowShouldClose(window, true);
 
-	float cameraOffset = cameraSpeed * deltaTime;
-
-	//Checks if the 'w' key is pressed; moves camera up
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-		camera.ProcessKeyboard(FORWARD, deltaTime);
-	}
-
-	//checks if the 'S' key is pressed; moves camera down
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-		camera.ProcessKeyboard(BACKWARD, deltaTime);
-	}
-
-	//checks if the 'A' key is pressed; moves camera left
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-		camera.ProcessKeyboard(LEFT, deltaTime);
-	}
-
-	//checks if 'D' key is pressed; moves camera right
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-		camera.ProcessKeyboard(RIGHT, deltaTime);
-	}
-
-	//Checks if 'Q' key is pressed; Moves camera up
-	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-		camera.Position += cameraSpeed * camera.WorldUp;
-	}
-
-	//Checks if 'E' key is pressed; Moves camera down
-	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-		camera.Position -= cameraSpeed * camera.WorldUp;
-	}
+	//'W' and 'S' move the camera forward and back, 'A' and 'D' left and right
+	if (input.heldSeconds[ACTION_MOVE_FORWARD] > 0.0f)
+		camera.ProcessKeyboard(FORWARD, input.heldSeconds[ACTION_MOVE_FORWARD]);
+	if (input.heldSeconds[ACTION_MOVE_BACKWARD] > 0.0f)
+		camera.ProcessKeyboard(BACKWARD, input.heldSeconds[ACTION_MOVE_BACKWARD]);
+	if (input.heldSeconds[ACTION_MOVE_LEFT] > 0.0f)
+		camera.ProcessKeyboard(LEFT, input.heldSeconds[ACTION_MOVE_LEFT]);
+	if (input.heldSeconds[ACTION_MOVE_RIGHT] > 0.0f)
+		camera.ProcessKeyboard(RIGHT, input.heldSeconds[ACTION_MOVE_RIGHT]);
+
+	//'Q' and 'E' move the camera up and down at the same speed
+	float vertical = input.heldSeconds[ACTION_MOVE_UP] - input.heldSeconds[ACTION_MOVE_DOWN];
+	camera.Position += camera.WorldUp * camera.MovementSpeed * vertical;
+
+	if (input.lookX != 0.0f || input.lookY != 0.0f)
+		camera.ProcessMouseMovement(input.lookX, input.lookY);
+	if (input.scroll != 0.0f)
+		camera.ProcessMouseScroll(input.scroll);
+}
 
+//glfw: Whenever a key is pressed, repeated, or released, this callback is called
+void KeyCallback(GLFWwindow*, int key, int, int action, int) {
+	UPushKeyEvent(gInput, glfwGetTime(), key, action);
+	UInvalidateFrame(gFramePacer);
 }
 
 //glfw: Whenever the mouse moves, this callback is called
 void MousePositionCallback(GLFWwindow*, double xpos, double ypos) {
-
-	if (firstMouse) {
-		lastX = xpos;
-		lastY = ypos;
-		firstMouse = false;
-	}
-
-	float xoffset = xpos - lastX;
-	float yoffset = lastY - ypos; // Reversed since y-coordinate goes from bottom to top
-
-	lastX = xpos;
-	lastY = ypos;
-
-	camera.ProcessMouseMovement(xoffset, yoffset);
+	UPushCursorEvent(gInput, glfwGetTime(), xpos, ypos);
+	UInvalidateFrame(gFramePacer);
 }
 
 //glfw: Whenever the mouse scroll moves, this callback is called
 void MouseScrollCallback(GLFWwindow*, double xoffset, double yoffset) {
-	camera.ProcessMouseScroll(yoffset);
+	UPushScrollEvent(gInput, glfwGetTime(), xoffset, yoffset);
+	UInvalidateFrame(gFramePacer);
 }
 
 //glfw: Whenever the mouse buttons are pressed, this callback is called
 void MouseButtonCallback(GLFWwindow*, int button, int action, int mods) {
 
+	//A click is resolved against the scene in the next simulation step (UPickObject)
+	double cursorX, cursorY;
+	glfwGetCursorPos(window, &cursorX, &cursorY);
+	UPushButtonEvent(gInput, glfwGetTime(), button, action, cursorX, cursorY);
+	UInvalidateFrame(gFramePacer);
+
 	switch (button) {
 
 	case GLFW_MOUSE_BUTTON_MIDDLE: {
 
 		if (action == GLFW_PRESS)
-			std::cout << "Middle mouse button pressed" << std::endl;
+			LOG_DEBUG("Middle mouse button pressed");
 		else
-			std::cout << "Middle mouse button released" << std::endl;
+			LOG_DEBUG("Middle mouse button released");
 	}
 								 break;
 
 	case GLFW_MOUSE_BUTTON_LEFT: {
 
 		if (action == GLFW_PRESS)
-			std::cout << "Left mouse button pressed" << std::endl;
+			LOG_DEBUG("Left mouse button pressed");
 		else
-			std::cout << "Left mouse button released" << std::endl;
+			LOG_DEBUG("Left mouse button released");
 	}
 							   break;
 
 	case GLFW_MOUSE_BUTTON_RIGHT: {
 
 		if (action == GLFW_PRESS)
-			std::cout << "Right mouse button pressed" << std::endl;
+			LOG_DEBUG("Right mouse button pressed");
 		else
-			std::cout << "Right button released" << std::endl;
+			LOG_DEBUG("Right button released");
 	}
 								break;
 
 	default:
-		std::cout << "Unhandled mouse button event" << std::endl;
+		LOG_DEBUG("Unhandled mouse button event");
 		break;
 	}
 }
 //***********************************************************************************
 //-------------------------------------MESH------------------------------------------
+//Replaces the bound vertex and index buffers with a packed mesh of the same layout, if the assets provide one
+void UBufferPackedMesh(const char* name, GLuint& nIndices) {
+
+	AssetView asset;
+	if (!UFindAsset(name, asset) || asset.kind != ASSET_MESH || asset.size < sizeof(MeshBlobHeader))
+		return;
+
+	MeshBlobHeader header;
+	memcpy(&header, asset.data, sizeof(header));
+
+	size_t vertexBytes = (size_t)header.vertexCount * header.floatsPerVertex * sizeof(float);
+	size_t indexBytes = (size_t)header.indexCount * header.indexSize;
+
+	//Draw calls use GL_UNSIGNED_SHORT indices and the 12 float layout below
+	if (header.floatsPerVertex != 12 || header.indexSize != sizeof(GLushort) || sizeof(header) + vertexBytes + indexBytes > asset.size) {
+		LOG_ERROR("ERROR::MESH::LAYOUT_MISMATCH %s", name);
+		return;
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, asset.data + sizeof(header), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, asset.data + sizeof(header) + vertexBytes, GL_STATIC_DRAW);
+	nIndices = header.indexCount;
+}
+
+//Index count slot for the mesh in mesh.vbos[meshIndex * 2] onward
+GLuint* UMeshIndexCount(GLMesh& mesh, int meshIndex) {
+	GLuint* indexCounts[5] = { &mesh.eraser_N_indices, &mesh.plane_N_indices, &mesh.lamp_N_indices, &mesh.pad_N_indices, &mesh.book_N_indices };
+	return indexCounts[meshIndex];
+}
+
+//Built-in geometry, generated at compile time; changing a shape is a change of its parameters. The eraser is wider
+//at the bottom on the right and at the top on the left, so its slanted ends get their true normals.
+constexpr auto ERASER_MESH = UMakePrism(PrismShape{ -0.75f, 1.0f, -1.0f, 0.75f, 0.3f, 1.0f });
+constexpr auto LAMP_MESH = UMakePrism(UBoxShape(1.0f, 1.0f, 1.0f));
+constexpr auto PAD_MESH = UMakePrism(UBoxShape(2.0f, 0.5f, 2.0f));
+constexpr auto BOOK_MESH = UMakePrism(UBoxShape(2.0f, 0.5f, 3.0f));
+static_assert(ERASER_MESH.vertices[0].normal[2] > 0.99f && ERASER_MESH.vertices[3].normal[2] > 0.99f, "The eraser's front face must face +z");
+
 //Implements UCreateMesh Functiongbvbvbv                                                                     
 void UCreateMesh(GLMesh& mesh) {
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	// 
 //_______________________________BUFFER CREATION & SETUP________________________________________
-	//Creates vertex attribute pointer
-	const GLuint floatsPerVertex = 3; //Number of cooridinates per float
-	const GLuint floatsPerColor = 4; //(R, G, B, a)
-	const GLuint floatsPerUV = 2;
-	const GLuint floatsPerNormal = 3;
-
-	//Stride between vertex cooridinates and color is 6 (x, y, z, R, G, B, a)
-	GLuint stride = sizeof(float) * (floatsPerVertex + floatsPerColor + floatsPerUV + floatsPerNormal); //space between each vertexs elements
-
-	//creates and binds array objects
-	glGenVertexArrays(5, mesh.vaos); //Generates one vertex array object, storing it in 'vao'
+	//One vertex array in the scene layout serves every mesh
+	mesh.vao = UCreateLayoutVertexArray<SceneVertexLayout>();
 	glGenVertexArrays(1, mesh.ex_vaos);
 
 	//Creates two buffers: 1.) eraser data : 2.) eraser indices : 3.) plane Data : 4.) Plane indices : 5.) Lamp data : 6.) Lamp indices : 7.) Pad data : 8.) Pad indices : 9.) book data : 10.) book indices
 	glGenBuffers(10, mesh.vbos); //creates eight buffers
 	glGenBuffers(2, mesh.ex_vbos);
 
+	const GLfloat neutralCoordinate[2] = { 0.0f, 0.0f };
+	glCreateBuffers(1, &mesh.neutralCoordinates);
+	glNamedBufferStorage(mesh.neutralCoordinates, sizeof(neutralCoordinate), neutralCoordinate, 0);
+	UBindConstantBuffer(mesh.vao, SCENE_LIGHTMAP_BINDING, mesh.neutralCoordinates);
+
+	//The element array binding belongs to the bound vertex array, so the uploads below go through the shared one
+	glBindVertexArray(mesh.vao);
+
 //----------------------------------------------------------------------------------------------
 // =============================================================================================
 //----------------------------------------------------------------------------------------------
 //_____________________________________ERASER VERTICES__________________________________________ 
-	//Binds to first of two VAO buffers(will hold eraser data and indices)
-	glBindVertexArray(mesh.vaos[0]);
-	//Binds VBO buffer that will store eraser vertex data
+	//Binds the buffers that will store eraser vertex and index data
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // activates buffer
-
-	//Specifies normalized device coordinates and RGB for eraser vertices
-	GLfloat eraserVerts[] = {
-		//index 0 - V:0
-		-1.0f, 0.15f, 0.5f,			//0.)Top-Left-Front vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 0.0f, 1.0f,			//Normal :: Front face
-		0.0f, 1.0f,					//Texture Coord :: Front Face
-
-	//index 1 - V:0
-		-1.0f, 0.15f, 0.5f,			//0.)Top-Left-Front vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, 1.0f, 0.0f,			//Normal :: Top Face
-		0.0f, 0.0f,					//Texture Coord :: Top Face
-
-	//index 2 - V:0
-		-1.0f, 0.15f, 0.5f,			//0.)Top-Left-Front vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		-1.0f, 0.0f, 0.0f,			//Normal :: Left Face
-		1.0f, 1.0f,					//Texture Coord :: Left Face
-//------------------------------------------------------------------------------------
-	//index 3 - V:1
-		0.75f, 0.15f, 0.5f,			//1.)Top-Right-Front vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 1.0f, 0.0f,			//Normal :: Front face
-		1.0f, 1.0f,					//Texture Coord :: Front Face
-
-	//index 4 - V:1
-		0.75f, 0.15f, 0.5f,			//1.)Top-Right-Front vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, 1.0f, 0.0f,			//Normal :: Top Face
-		1.0f, 0.0f,					//Texture Coord :: Top Face
-
-	//index 5 - V:1
-		0.75f, 0.15f, 0.5f,			//1.)Top-Right-Front vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		1.0f, 0.0f, 0.0f,			//Normal :: Right Face
-		0.0f, 1.0f,					//Texture Coord :: Right Face
-//------------------------------------------------------------------------------------
-	 //index 6 - V:2
-		-0.75f, -0.15f, 0.5f,		//2.)Front-Bottom-left vertex 
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 0.0f, 1.0f,			//Normal :: Front face
-		0.0f, 0.0f,					//Texture Coord :: Front Face
-
-	//index 7 - V:2
-		-0.75f, -0.15f, 0.5f,		//2.)Front-Bottom-left vertex 
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, -1.0f, 0.0f,			//Normal :: Bottom Face 
-		0.0f, 1.0f,					//Texture Coord :: Bottom Face
-
-	//index 8 - V:2
-		-0.75f, -0.15f, 0.5f,		//2.)Front-Bottom-left vertex 
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		-1.0f, 0.0f, 0.0f,			//Normal :: Left Face
-		1.0f, 0.0f,					//Texture Coord :: Left Face
-//------------------------------------------------------------------------------------
-	//index 9 - V:3
-		1.0f, -0.15f, 0.5f,			//3.)Front-Bottom-right Vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 0.0f, 1.0f,			//Normal :: Front face
-		1.0f, 0.0f,					//Texture Coord :: Front Face
-
-	//index 10 - V:3
-		1.0f, -0.15f, 0.5f,			//3.)Front-Bottom-right Vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, -1.0f, 0.0f,			//Normal :: Bottom Face
-		1.0f, 1.0f,					//Texture Coord :: Bottom Face
-
-	//index 11 - V:3
-		1.0f, -0.15f, 0.5f,			//3.)Front-Bottom-right Vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		1.0f, 0.0f, 0.0f,			//Normal :: Right Face
-		0.0f, 0.0f,					//Texture Coord :: Right Face
-//------------------------------------------------------------------------------------
-	//index 12 - V:4
-		-1.0f, 0.15f, -0.5f,		 //4.)Back-Top-Left vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 0.0f, -1.0f,			//Normal :: back Face
-		1.0f, 1.0f,					//Texture Coord :: Back Face
-
-	//index 13 - V:4
-		-1.0f, 0.15f, -0.5f,		//4.)Back-Top-Left vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, 1.0f, 0.0f,			//Normal :: Top Face
-		1.0f, 0.0f,					//Texture Coord :: Top face
-
-	//index 14 - V:4
-		-1.0f, 0.15f, -0.5f,		//4.)Back-Top-Left vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		-1.0f, 0.0f, 0.0f,			//Normal :: Left Face
-		0.0f, 1.0f,					//Texture Coord :: Left Face
-//------------------------------------------------------------------------------------
-	//index 15 - V:5
-		0.75f, 0.15f, -0.5f,		 //5.)Back-Top-Right vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 0.0f, -1.0f,			//Normal :: back Face
-		0.0f, 1.0f,					//Texture Coord :: Back Face
-
-	//index 16 - V:5
-		0.75f, 0.15f, -0.5f,		//5.)Back-Top-Right vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, 1.0f, 0.0f,			//Normal :: Top Face
-		1.0f, 1.0f,					//Texture Coord :: Top Face
-
-	//index 17 - V:5
-		0.75f, 0.15f, -0.5f,		 //5.)Back-Top-Right vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		 //blue
-		1.0f, 0.0f, 0.0f,			//Normal :: Right Face
-		1.0f, 1.0f,					//Texture Coord:: Right Face
-//------------------------------------------------------------------------------------
-	//index 18 - V:6
-		-0.75f, -0.15, -0.5f,		//6.)Back-Bottom-Left vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		0.0f, 0.0f, -1.0f,			//Normal :: back Face
-		1.0, 0.0f,					//Texture Coord :: Back Face
-
-	//index 19 - V:6
-		-0.75f, -0.15, -0.5f,		//6.)Back-Bottom-Left vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, -1.0f, 0.0f,			//Normal :: Bottom Face
-		0.0f, 0.0f,					//Texture Coord :: Bottom Face
-
-	//index 20 - V:6 
-		-0.75f, -0.15, -0.5f,		//6.)Back-Bottom-Left vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		-1.0f, 0.0f, 0.0f,			//Normal :: left Face
-		0.0f, 0.0f,					//Texture Coord :: Left Face
-//------------------------------------------------------------------------------------
-	//index 21 - V:7
-		1.0f, -0.15f, -0.5f,		//7.)Back-Bottom-Right Vertex
-		1.0f, 0.0f, 0.0f, 1.0f,		//red
-		-1.0f, 0.0f, 0.0f,			//Normal :: Left Face
-		0.0f, 0.0f,					//Texture Coord :: Back Face
-
-	//index 22 - V:7
-		1.0f, -0.15f, -0.5f,		//7.)Back-Bottom-Right Vertex
-		0.0f, 1.0f, 0.0f, 1.0f,		//green
-		0.0f, -1.0f, 0.0f,			//Normal :: Bottom Face
-		1.0f, 0.0f,					//Texture Coord :: Bottom face
-
-	//index 23 - V:7
-		1.0f, -0.15f, -0.5f,		//7.)Back-Bottom-Right Vertex
-		0.0f, 0.0f, 1.0f, 1.0f,		//blue
-		1.0f, 0.0f, 0.0f,			//Normal :: Right Face
-		1.0f, 0.0f				    //Texture Coord :: Right Face
-	};
-
-
-	//Populates buffer with eraser vertex data
-	glBufferData(GL_ARRAY_BUFFER, sizeof(eraserVerts), eraserVerts, GL_STATIC_DRAW); // sends vertex data to GPU and informs how to draw
-
-//_____________________________________ERASER INDICES___________________________________________
-	//Binds to second buffer(Populated with index data)
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
 
-	//Creates buffer object for eraser indices
-	GLushort eraserIndices[] = {
-						  0, 3, 6,			//Triangle :: (Front Face)
-						  6, 3, 9,			//Triangle :: (Front Face)
-
-						  11, 5, 23,		//Triangle :: (Right Face)
-						  23, 17, 5,		//Triangle :: (Right Face)
-
-						  4, 1, 16,			//Triangle :: (Top Face)
-						  16, 13, 1,		//Triangle :: (Top Face)
-
-						  2, 8, 20,			//Triangle :: (Left Face)
-						  20, 2, 14,		//Triangle :: (Left Face)
-
-						  12, 15, 21,		//Triangle :: (Back Face)
-						  21, 12, 18,		//Triangle :: (Back Face)
-
-						  19, 22, 10,		//Triangle :: (Bottom Face)
-						  10, 7, 19,		//Triangle :: (Bottom Face)
-	};
-	mesh.eraser_N_indices = sizeof(eraserIndices) / sizeof(eraserIndices[0]); //Specifies number of indices in memory buffer
-
-	//Populates buffer with eraser index data
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(eraserIndices), eraserIndices, GL_STATIC_DRAW);
-
-	//______________________________________ERASER ATTRIBUTE________________________________________
-		//Instructs GPU how to handle 'vbo'
-		//// Parameters: attribPointerPosition | coordinates per vertex is 2, i.e., x and y |   data type | deactivate normalization |  0 strides | 0 offset
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
+	//Populates the buffers with the generated eraser vertices and indices
+	UBufferMeshData(ERASER_MESH, mesh.eraser_N_indices);
 
-	// Parameters: attribPointerPosition 1 | floats per color is 4, i.e., rgba | data type | deactivate normalization | 6 strides until the next color, i.e., rgbaxy | 2 floats until the beginning of each color, i.e,. xy
-	//glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
-	//glEnableVertexAttribArray(1);
+	//Packed mesh data replaces the built-in geometry when present
+	UBufferPackedMesh("eraser.mesh", mesh.eraser_N_indices);
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * (floatsPerVertex + floatsPerColor + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribPointer(3, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(3);
 	//----------------------------------------------------------------------------------------------
 	//==============================================================================================
 	//----------------------------------------------------------------------------------------------	
 	//______________________________________PLANE VERTICES__________________________________________
-		//Binds to first of two VAO buffers(will hold eraser data and indices)
-	glBindVertexArray(mesh.vaos[1]);
 	//Binds VBO buffer that will store eraser vertex data
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[2]); // activates buffer
 
@@ -541,570 +538,60 @@ void UCreateMesh(GLMesh& mesh) {
 	//Populates buffer with plane index data
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(planeIndices), planeIndices, GL_STATIC_DRAW);
 
-	//______________________________________PLANE ATTRIBUTE________________________________________
-	//Instructs GPU how to handle 'vbo'
-	//// Parameters: attribPointerPosition | coordinates per vertex is 2, i.e., x and y |   data type | deactivate normalization |  0 strides | 0 offset
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	// Parameters: attribPointerPosition 1 | floats per color is 4, i.e., rgba | data type | deactivate normalization | 6 strides until the next color, i.e., rgbaxy | 2 floats until the beginning of each color, i.e,. xy
-	glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribPointer(3, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(3);
+	//Packed mesh data replaces the built-in geometry when present
+	UBufferPackedMesh("plane.mesh", mesh.plane_N_indices);
 
 	//-------------------------------------------------------------------------------------
 	//=====================================================================================
 	//-------------------------------------------------------------------------------------
 	//________________________________LAMP VERTICES________________________________________
 	
-	glBindVertexArray(mesh.vaos[2]);
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[4]);
-
-	GLfloat lampVerts[] = {
-
-		//Index 0
-			-0.5f, -0.5f, 0.5f,				//Front-Bottom-Left vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 1
-			0.5f, -0.5f, 0.5f,				//Front-Bottom-right vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			1.0f, 0.0f, 0.0f,				//Normal :: Left face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 2
-			-0.5f, 0.5f, 0.5f,				//Front-top-Left vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 3
-			0.5f, 0.5f, 0.5f,				//Front-Top-Right vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 4
-			-0.5f, -0.5f, -0.5f,			//Back-Bottom-Left vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 5
-			0.5f, -0.5f, -0.5f,				//Back-Bottom-Right vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 6
-			-0.5f, 0.5f, -0.5f,				//back-Top-Left vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-		//Index 7
-			0.5f, 0.5f, -0.5f,				//Back-Top-Right vertex
-			1.0f, 1.0f, 1.0f, 1.0f,			//White
-			0.0f, 0.0f, 1.0f,				//Normal :: Front face
-			0.0f, 0.0f,						//texture Coord
-
-	};
-
-	//Populates buffer with lamp vertex data
-	glBufferData(GL_ARRAY_BUFFER, sizeof(lampVerts), lampVerts, GL_STATIC_DRAW);
-
-	//______________________________________LAMP INDICES_______________________________________
-
-	//Binds to fourth buffer(Populated with index data)
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[5]);
 
-	//Creates buffer object for lamp
-	GLushort lampIndices[] = {
-
-		1, 0, 2,		//Front face
-		2, 3, 1,		//Front face
-
-		1, 5, 3,		//Right Face
-		3, 7, 5,		//Right face
-
-		5, 4, 7,		//Back Face
-		7, 6, 4,		//back Face
-
-		4, 6, 2,		//left Face
-		2, 4, 1,		//Left Face	
-
-		2, 6, 7,		//Top Face
-		7, 2, 3,		//Top Face
-
-		0, 4, 5,		//Bottom Face
-		5, 0, 1			//Bottom Face
-
-	};
-
-	mesh.lamp_N_indices = sizeof(lampIndices) / sizeof(lampIndices[0]); //Specifies number of indices in memory buffer
-
-	//Populates buffer with plane index data
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(lampIndices), lampIndices, GL_STATIC_DRAW);
-
-	//______________________________________LAMP ATTRIBUTE________________________________________
-	//Instructs GPU how to handle 'vbo'
-	//// Parameters: attribPointerPosition | coordinates per vertex is 2, i.e., x and y |   data type | deactivate normalization |  0 strides | 0 offset
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
+	//Populates the buffers with the generated lamp vertices and indices
+	UBufferMeshData(LAMP_MESH, mesh.lamp_N_indices);
 
-	// Parameters: attribPointerPosition 1 | floats per color is 4, i.e., rgba | data type | deactivate normalization | 6 strides until the next color, i.e., rgbaxy | 2 floats until the beginning of each color, i.e,. xy
-	glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribPointer(3, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(3);
+	//Packed mesh data replaces the built-in geometry when present
+	UBufferPackedMesh("lamp.mesh", mesh.lamp_N_indices);
 
 	//-------------------------------------------------------------------------------------
 	//=====================================================================================
 	//-------------------------------------------------------------------------------------
 	//________________________________PAD VERTICES________________________________________
 
-	glBindVertexArray(mesh.vaos[3]);
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[6]);
-
-	GLfloat padVerts[] = {
-
-		//Left-Top-Front Vertex
-			//index 0
-				-1.0f, 0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,           //Normal :: FRONT FACE
-				0.0f, 1.0f,					//Texture :: FRONT FACE - TOP-LEFT
-
-			//index 1
-				-1.0f, 0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				0.0f, 1.0f,					//Texture :: TOP FACE - BOTTOM-LEFT
-
-			//index 2
-				-1.0f, 0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				1.0f, 1.0f,					//Texture :: LEFT FACE - TOP-RIGHT
-	//----------------------------------------------------------------------------------------
-		//Left-bottom-Front Vertex 
-			//index 3
-				-1.0f, -0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,			//Normal :: FRONT FACE
-				0.0f, 0.0f,					//Texture :: FRONT FACE - BOTTOM-LEFT
-
-			//index 4
-				-1.0f, -0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				0.0f, 1.0f,					//Texture :: BOTTOM FACE - TOP-LEFT
-
-			//index 5
-				-1.0f, -0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				1.0f, 0.0f,					//Texture :: LEFT FACE - BOTTOM-RIGHT
-	//----------------------------------------------------------------------------------------
-		//Right-bottom-Front Vertex 
-			//index 6
-				1.0f, -0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,			//Normal :: FRONT FACE
-				1.0f, 0.0f,					//Texture :: FRONT FACE - BOTTOM-RIGHT
-
-			//index 7
-				1.0f, -0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				1.0f, 1.0f,					//Texture :: BOTTOM FACE - TOP-RIGHT
-
-			//index 8
-				1.0f, -0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				0.0f, 0.0f,					//Texture :: RIGHT FACE - BOTTOM-LEFT
-	//----------------------------------------------------------------------------------------
-		//Right-Top-Front Vertex 
-			//index 9
-				1.0f, 0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,			//Normal :: FRONT FACE
-				1.0f, 1.0f,					//Texture :: FRONT FACE - TOP-RIGHT
-
-			//index 10
-				1.0f, 0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				1.0f, 0.0f,					//Texture :: TOP FACE - BOTTOM-RIGHT
-
-			//index 11
-				1.0f, 0.25f, 1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				0.0f, 1.0f,					//Texture :: RIGHT FACE - TOP-LEFT
-	//----------------------------------------------------------------------------------------
-		//Left-Top-Back Vertex 
-			//index 12
-				-1.0f, 0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				1.0f, 1.0f,					//Texture :: BACK FACE - TOP-RIGHT
-
-			//index 13
-				-1.0f, 0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				0.0f, 1.0f,					//Texture :: TOP FACE - TOP-LEFT
-
-			//index 14
-				-1.0f, 0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				0.0f, 1.0f,					//Texture :: LEFT FACE - TOP-LEFT
-	//----------------------------------------------------------------------------------------
-		//Left-Bottom-Back Vertex 
-			//index 15
-				-1.0f, -0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				1.0f, 0.0f,					//Texture :: BACK FACE - BOTTOM-RIGHT
-
-			//index 16
-				-1.0f, -0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				0.0f, 0.0f,					//Texture :: BOTTOM FACE - BOTTOM-LEFT
-
-			//index 17
-				-1.0f, -0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				0.0f, 0.0f,					//Texture :: LEFT FACE - BOTTOM-LEFT
-	//----------------------------------------------------------------------------------------
-		//Right-Bottom-Back Vertex 
-			//index 18
-				1.0f, -0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				0.0f, 0.0f,					//Texture :: BACK FACE - BOTTOM-LEFT
-
-			//index 19
-				1.0f, -0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				1.0f, 0.0f,					//Texture :: BOTTOM FACE - BOTTOM-RIGHT
-
-			//index 20
-				1.0f, -0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				1.0f, 0.0f,					//Texture :: RIGHT FACE - BOTTOM-RIGHT
-	//----------------------------------------------------------------------------------------
-		//Right-Top-Back Vertex 
-			//index 21
-				1.0f, 0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				0.0f, 1.0f,					//Texture :: BACK FACE - TOP-LEFT
-
-			//index 22
-				1.0f, 0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				1.0f, 1.0f,					//Texture :: TOP FACE - TOP-RIGHT
-
-			//index 23
-				1.0f, 0.25f, -1.0f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				1.0f, 1.0f					//Texture :: RIGHT FACE - TOP-RIGHT
-
-	};
-
-	//Populates buffer with pad vertex data
-	glBufferData(GL_ARRAY_BUFFER, sizeof(padVerts), padVerts, GL_STATIC_DRAW);
-
-	//______________________________________PAD INDICES_______________________________________
-
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[7]);
 
-	GLushort padIndices[] = {
-
-		0, 3, 6,		//Front 
-		6, 9, 0,		//Front
-
-		11, 8, 20,		//Right
-		20, 23, 11,		//Right
-
-		12, 15, 18,		//Back
-		18, 21, 12,		//Back
-
-		14, 17, 5,		//Left
-		5, 2, 14,		//Left
-
-		13, 1, 10,		//Top
-		10, 22, 13,		//Top
-
-		16, 4, 7,		//Bottom
-		7, 19, 16		//Bottom
-	};
-
-	mesh.pad_N_indices = sizeof(padIndices) / sizeof(padIndices[0]); //Specifies number of indices in memory buffer
+	//Populates the buffers with the generated pad vertices and indices
+	UBufferMeshData(PAD_MESH, mesh.pad_N_indices);
 
-	//Populates buffer with pad index data
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(padIndices), padIndices, GL_STATIC_DRAW);
-
-	//______________________________________PAD ATTRIBUTE________________________________________
-
-	//Instructs GPU how to handle 'vbo'
-	//// Parameters: attribPointerPosition | coordinates per vertex is 2, i.e., x and y |   data type | deactivate normalization |  0 strides | 0 offset
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	// Parameters: attribPointerPosition 1 | floats per color is 4, i.e., rgba | data type | deactivate normalization | 6 strides until the next color, i.e., rgbaxy | 2 floats until the beginning of each color, i.e,. xy
-	glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribPointer(3, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(3);
+	//Packed mesh data replaces the built-in geometry when present
+	UBufferPackedMesh("pad.mesh", mesh.pad_N_indices);
 
 	//-------------------------------------------------------------------------------------
 	//=====================================================================================
 	//-------------------------------------------------------------------------------------
 	//________________________________BOOK VERTICES________________________________________
 
-	glBindVertexArray(mesh.vaos[4]);
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[8]);
-
-	GLfloat bookVerts[] = {
-
-		//Left-Top-Front Vertex
-			//index 0
-				-1.0f, 0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,           //Normal :: FRONT FACE
-				0.0f, 1.0f,					//Texture :: FRONT FACE - TOP-LEFT
-
-			//index 1
-				-1.0f, 0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				0.0f, 1.0f,					//Texture :: TOP FACE - BOTTOM-LEFT
-
-			//index 2
-				-1.0f, 0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				1.0f, 1.0f,					//Texture :: LEFT FACE - TOP-RIGHT
-	//----------------------------------------------------------------------------------------
-		//Left-bottom-Front Vertex 
-			//index 3
-				-1.0f, -0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,			//Normal :: FRONT FACE
-				0.0f, 0.0f,					//Texture :: FRONT FACE - BOTTOM-LEFT
-
-			//index 4
-				-1.0f, -0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				0.0f, 1.0f,					//Texture :: BOTTOM FACE - TOP-LEFT
-
-			//index 5
-				-1.0f, -0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				1.0f, 0.0f,					//Texture :: LEFT FACE - BOTTOM-RIGHT
-	//----------------------------------------------------------------------------------------
-		//Right-bottom-Front Vertex 
-			//index 6
-				1.0f, -0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,			//Normal :: FRONT FACE
-				1.0f, 0.0f,					//Texture :: FRONT FACE - BOTTOM-RIGHT
-
-			//index 7
-				1.0f, -0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				1.0f, 1.0f,					//Texture :: BOTTOM FACE - TOP-RIGHT
-
-			//index 8
-				1.0f, -0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				0.0f, 0.0f,					//Texture :: RIGHT FACE - BOTTOM-LEFT
-	//----------------------------------------------------------------------------------------
-		//Right-Top-Front Vertex 
-			//index 9
-				1.0f, 0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, 1.0f,			//Normal :: FRONT FACE
-				1.0f, 1.0f,					//Texture :: FRONT FACE - TOP-RIGHT
-
-			//index 10
-				1.0f, 0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				1.0f, 0.0f,					//Texture :: TOP FACE - BOTTOM-RIGHT
-
-			//index 11
-				1.0f, 0.25f, 1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				0.0f, 1.0f,					//Texture :: RIGHT FACE - TOP-LEFT
-	//----------------------------------------------------------------------------------------
-		//Left-Top-Back Vertex 
-			//index 12
-				-1.0f, 0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				1.0f, 1.0f,					//Texture :: BACK FACE - TOP-RIGHT
-
-			//index 13
-				-1.0f, 0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				0.0f, 1.0f,					//Texture :: TOP FACE - TOP-LEFT
-
-			//index 14
-				-1.0f, 0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				0.0f, 1.0f,					//Texture :: LEFT FACE - TOP-LEFT
-	//----------------------------------------------------------------------------------------
-		//Left-Bottom-Back Vertex 
-			//index 15
-				-1.0f, -0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				1.0f, 0.0f,					//Texture :: BACK FACE - BOTTOM-RIGHT
-
-			//index 16
-				-1.0f, -0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				0.0f, 0.0f,					//Texture :: BOTTOM FACE - BOTTOM-LEFT
-
-			//index 17
-				-1.0f, -0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				-1.0f, 0.0f, 0.0f,			//Normal :: LEFT FACE
-				0.0f, 0.0f,					//Texture :: LEFT FACE - BOTTOM-LEFT
-	//----------------------------------------------------------------------------------------
-		//Right-Bottom-Back Vertex 
-			//index 18
-				1.0f, -0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				0.0f, 0.0f,					//Texture :: BACK FACE - BOTTOM-LEFT
-
-			//index 19
-				1.0f, -0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, -1.0f, 0.0f,			//Normal :: BOTTOM FACE
-				1.0f, 0.0f,					//Texture :: BOTTOM FACE - BOTTOM-RIGHT
-
-			//index 20
-				1.0f, -0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				1.0f, 0.0f,					//Texture :: RIGHT FACE - BOTTOM-RIGHT
-	//----------------------------------------------------------------------------------------
-		//Right-Top-Back Vertex 
-			//index 21
-				1.0f, 0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 0.0f, -1.0f,			//Normal :: BACK FACE
-				0.0f, 1.0f,					//Texture :: BACK FACE - TOP-LEFT
-
-			//index 22
-				1.0f, 0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				0.0f, 1.0f, 0.0f,			//Normal :: TOP FACE
-				1.0f, 1.0f,					//Texture :: TOP FACE - TOP-RIGHT
-
-			//index 23
-				1.0f, 0.25f, -1.5f,
-				1.0f, 1.0f, 1.0f, 1.0f,		//Color :: White
-				1.0f, 0.0f, 0.0f,			//Normal :: RIGHT FACE
-				1.0f, 1.0f					//Texture :: RIGHT FACE - TOP-RIGHT//Left-Top-Front Vertex
-			
-	};
-
-	//Populates buffer with book vertex data
-	glBufferData(GL_ARRAY_BUFFER, sizeof(bookVerts), bookVerts, GL_STATIC_DRAW);
-
-	//______________________________________BOOK INDICES_______________________________________
-
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[9]);
 
-	GLushort bookIndices[] = {
-
-		0, 3, 6,		//Front 
-		6, 9, 0,		//Front
-
-		11, 8, 20,		//Right
-		20, 23, 11,		//Right
-
-		12, 15, 18,		//Back
-		18, 21, 12,		//Back
-
-		14, 17, 5,		//Left
-		5, 2, 14,		//Left
-
-		13, 1, 10,		//Top
-		10, 22, 13,		//Top
-
-		16, 4, 7,		//Bottom
-		7, 19, 16		//Bottom
-	};
-
-	mesh.book_N_indices = sizeof(bookIndices) / sizeof(bookIndices[0]); //Specifies number of indices in memory buffer
-
-	//Populates buffer with plane index data
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(bookIndices), bookIndices, GL_STATIC_DRAW);
-
-	//______________________________________BOOK ATTRIBUTE________________________________________
-
-	//Instructs GPU how to handle 'vbo'
-	//// Parameters: attribPointerPosition | coordinates per vertex is 2, i.e., x and y |   data type | deactivate normalization |  0 strides | 0 offset
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	// Parameters: attribPointerPosition 1 | floats per color is 4, i.e., rgba | data type | deactivate normalization | 6 strides until the next color, i.e., rgbaxy | 2 floats until the beginning of each color, i.e,. xy
-	glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	//Populates the buffers with the generated book vertices and indices
+	UBufferMeshData(BOOK_MESH, mesh.book_N_indices);
 
-	glVertexAttribPointer(3, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(3);
+	//Packed mesh data replaces the built-in geometry when present
+	UBufferPackedMesh("book.mesh", mesh.book_N_indices);
 
-	
+	glBindVertexArray(0);
 };	
 	
 
 //Deletes buffers and vertex arrays
 void UDestroyMesh(GLMesh& mesh) {
-	glDeleteVertexArrays(5, mesh.vaos);  //deletes two vertex arrays in specified memory location
+	glDeleteVertexArrays(1, &mesh.vao);
 	glDeleteBuffers(10, mesh.vbos);  //deletes four buffers in specified memory location
+	glDeleteBuffers(1, &mesh.neutralCoordinates);
 }
 
 //-------------------------------------------------------------------------------------
@@ -1127,277 +614,728 @@ void flipImageVertically(unsigned char* image, int width, int height, int channe
 	}
 }
 
-/*Generate and load the texture*/
-bool CreateTexture(const char* filename, GLuint& textureId)
+//Uploads texels to a new texture object
+bool UUploadTexture(const unsigned char* image, int width, int height, int channels, GLuint& textureId)
 {
-	int width, height, channels;
-	unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-	if (image)
+	GLenum internalFormat;
+	GLenum format;
+	if (channels == 3) {
+		internalFormat = GL_RGB8;
+		format = GL_RGB;
+	}
+	else if (channels == 4) {
+		internalFormat = GL_RGBA8;
+		format = GL_RGBA;
+	}
+	else
 	{
-		flipImageVertically(image, width, height, channels);
-
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		else if (channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			cout << "Not implemented to handle image with " << channels << " channels" << endl;
-			return false;
-		}
+		LOG_ERROR("Not implemented to handle image with %d channels", channels);
+		return false;
+	}
 
-		glGenerateMipmap(GL_TEXTURE_2D);
+	glGenTextures(1, &textureId);
+	glBindTexture(GL_TEXTURE_2D, textureId);
 
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		return true;
-	}
+	//Packed rows are tightly aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, image);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-	// Error loading the image
-	return false;
-}
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-void DestroyTexture(GLuint textureID) {
-	glGenTextures(1, &textureID);
+	return true;
 }
 
-//----------------------------------------------------------------------------------------------
-//**********************************************************************************************
-//------------------------------------SHADER PROGRAM--------------------------------------------
-//Function called to render a frame
-void URender() {
+//Texture load state handed from a loader thread to the context thread
+struct TextureLoad {
+	const char* fileName = nullptr;
+	GLuint* texture = nullptr;
+	AssetView asset;
+	unsigned char* image = nullptr;		//Decoded loose image (packed textures are uploaded straight from the mapping)
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+
+	//A decode that is never uploaded (shutdown, a failed upload) still releases its image
+	TextureLoad() = default;
+	TextureLoad(const TextureLoad&) = delete;
+	TextureLoad& operator=(const TextureLoad&) = delete;
+	~TextureLoad() { stbi_image_free(image); }
+};
 
-	// Lamp orbits around the origin
-	const float angularVelocity = glm::radians(45.0f);
-	if (gIsLampOrbiting)
-	{
-		glm::vec4 newPosition = glm::rotate(angularVelocity * deltaTime, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(keyLightPosition, 1.0f);
-		keyLightPosition.x = newPosition.x;
-		keyLightPosition.y = newPosition.y;
-		keyLightPosition.z = newPosition.z;
+//Loader thread: resolves the asset and decodes it if it is not already in texel form
+bool UDecodeTexture(TextureLoad& load)
+{
+	if (!UFindAsset(load.fileName, load.asset))
+		return false;
+
+	if (load.asset.kind == ASSET_TEXTURE) {
+		//Uploaded straight from the asset, so the texels must cover exactly its dimensions
+		uint64_t pixels = (uint64_t)load.asset.width * load.asset.height;
+		if (load.asset.channels < 1 || load.asset.channels > 4 || pixels > load.asset.size || pixels * load.asset.channels != load.asset.size) {
+			LOG_ERROR("ERROR::TEXTURE::SIZE_MISMATCH %s", load.fileName);
+			return false;
+		}
+		load.width = load.asset.width;
+		load.height = load.asset.height;
+		load.channels = load.asset.channels;
+		return true;
 	}
 
-	//Enable z-depth
-	glEnable(GL_DEPTH_TEST);
+	load.image = stbi_load_from_memory(load.asset.data, (int)load.asset.size, &load.width, &load.height, &load.channels, 0);
+	if (!load.image)
+		return false;
 
-	//clear the background
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f); //sets background as black
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	flipImageVertically(load.image, load.width, load.height, load.channels);
+	return true;
+}
 
-	//View Matrix: Transforms the camera
-	glm::mat4 view = camera.GetViewMatrix();
-
-	//Creates a persepctive projection
-	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-	//glm::mat4 projection = glm::ortho(glm::radians(camera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 1.0f, 100.0f);
-
-	//set the shader to use
-	glUseProgram(programID);
-
-	//Retrives and passes transformation to the shader program
-	GLint eraserModelLocation = glGetUniformLocation(programID, "model");
-	GLint eraserViewMatrixLocation = glGetUniformLocation(programID, "view");
-	GLint eraserProjectionMatrixLocation = glGetUniformLocation(programID, "projection");
-	GLint eraserUVScaleLocation = glGetUniformLocation(programID, "uvScale");
-
-	//Retrives and passes transformation to the shader program
-	GLint planeModelLocation = glGetUniformLocation(programID, "model");
-	GLint planeViewMatrixLocation = glGetUniformLocation(programID, "view");
-	GLint planeProjectionMatrixLocation = glGetUniformLocation(programID, "projection");
-	GLint planeUVScaleLocation = glGetUniformLocation(programID, "uvScale");
-
-	//Retrives and passes transformation to the shader program
-	GLint padModelLocation = glGetUniformLocation(programID, "model");
-	GLint padViewMatrixLocation = glGetUniformLocation(programID, "view");
-	GLint padProjectionMatrixLocation = glGetUniformLocation(programID, "projection");
-	GLint padUVScaleLocation = glGetUniformLocation(programID, "uvScale");
-
-	//Retrives and passes transformation to the shader program
-	GLint bookModelLocation = glGetUniformLocation(programID, "model");
-	GLint bookViewMatrixLocation = glGetUniformLocation(programID, "view");
-	GLint bookProjectionMatrixLocation = glGetUniformLocation(programID, "projection");
-	GLint bookUVScaleLocation = glGetUniformLocation(programID, "uvScale");
-
-	// Reference matrix uniforms from the Lamp Shader program
-	GLint lampModelLocation = glGetUniformLocation(lampID, "model");
-	GLuint lampViewMatrixLocation = glGetUniformLocation(lampID, "view");
-	GLuint lampProjectionMatrixLocation = glGetUniformLocation(lampID, "projection");
-
-	// Reference matrix uniforms from the Cube Shader program for the cub color, light color, light position, and camera position
-	GLint objectColorLoc = glGetUniformLocation(programID, "objectColor");
-	GLint lightColorLoc = glGetUniformLocation(programID, "lightColor");
-	GLint lightPositionLoc = glGetUniformLocation(programID, "lightPos");
-	GLint lightIntesnity = glGetUniformLocation(programID, "specIntensity");
-	GLint viewPositionLoc = glGetUniformLocation(programID, "viewPosition");
+//Context thread: uploads the decoded texels
+bool UUploadDecodedTexture(TextureLoad& load)
+{
+	const unsigned char* texels = load.image ? load.image : load.asset.data;
+	bool uploaded = UUploadTexture(texels, load.width, load.height, load.channels, *load.texture);
 
-//-------------------------------------------------------------------------------------
-//******************************ERASER RENDER*******************************************
-//-------------------------------------------------------------------------------------
+	stbi_image_free(load.image);
+	load.image = nullptr;
 
-		//Activate the VBO contained within the mesh VAO
-	glBindVertexArray(mesh.vaos[0]);
-
-	glm::vec2 eraserUVScale(1.0f, 1.0f);
-
-	// 1. Scales the object by 'n'
-	glm::mat4 E_scale = glm::scale(glm::vec3(0.5f, 0.5f, 0.5f));
-	// 2. Rotates shape by 'n' degrees in the x axis
-	glm::mat4 E_rotation = glm::rotate(0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Place object at the 'n'
-	glm::vec3 E_location = glm::vec3(-1.0f, -0.39f, 2.0f);
-	// 4. Translates object to location
-	glm::mat4 E_translation = glm::translate(E_location);
-	// Model matrix: transformations are applied right-to-left order
-	glm::mat4 E_model = E_translation * E_rotation * E_scale;
-
-	glUniformMatrix4fv(eraserModelLocation, 1, GL_FALSE, glm::value_ptr(E_model));
-	glUniformMatrix4fv(eraserViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(eraserProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform2fv(eraserUVScaleLocation, 1, glm::value_ptr(eraserUVScale));
-
-	// Pass color, light, and camera data to the Cube Shader program's corresponding uniforms
-	glUniform3f(objectColorLoc, keyObjectColor.r, keyObjectColor.g, keyObjectColor.b);
-	glUniform3f(lightColorLoc, keyLightColor.r, keyLightColor.g, keyLightColor.b);
-	glUniform3f(lightPositionLoc, keyLightPosition.x, keyLightPosition.y, keyLightPosition.z);
-	glUniform1f(lightIntesnity, keyLightIntensity);
+	return uploaded;
+}
 
-	//bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture1);
+/*Generate and load the texture*/
+//Resolves through the asset lookup: packed textures are uploaded straight from the mapping, loose images are decoded first
+bool CreateTexture(const char* filename, GLuint& textureId)
+{
+	TextureLoad load;
+	load.fileName = filename;
+	load.texture = &textureId;
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, mesh.eraser_N_indices, GL_UNSIGNED_SHORT, NULL);
+	// Error loading the image
+	if (!UDecodeTexture(load))
+		return false;
 
-	//-------------------------------------------------------------------------------------
-	//******************************PLANE RENDER*******************************************
-	//-------------------------------------------------------------------------------------
+	return UUploadDecodedTexture(load);
+}
 
-		//Activate the VBO containing the Plane Data
-	glBindVertexArray(mesh.vaos[1]);
+//2x2 magenta/black checker bound while a texture is loading or when it failed to load
+void UCreateFallbackTexture(GLuint& textureId) {
+	const unsigned char checker[] = {
+		255, 0, 255,	0, 0, 0,
+		0, 0, 0,		255, 0, 255
+	};
+	UUploadTexture(checker, 2, 2, 3, textureId);
 
-	glm::vec2 planeUVScale(1.0f, 1.0f);
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-	// 1. Scales the object by 'n'
-	glm::mat4 P_scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	// 2. Rotates shape by 'n' degrees in the x axis
-	glm::mat4 P_rotation = glm::rotate(0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Place object at the 'n'
-	glm::vec3 P_location = glm::vec3(0.0f, -1.0f, 0.0f);
-	// 4. Translates object to location
-	glm::mat4 P_translation = glm::translate(P_location);
-	// Model matrix: transformations are applied right-to-left order
-	glm::mat4 P_model = P_translation * P_rotation * P_scale;
+//Binds a texture, or the fallback while it is not available
+void UBindTextureOrFallback(GLuint textureId) {
+	glBindTexture(GL_TEXTURE_2D, textureId ? textureId : gFallbackTexture);
+}
 
-	glUniformMatrix4fv(planeModelLocation, 1, GL_FALSE, glm::value_ptr(P_model));
-	glUniformMatrix4fv(planeViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(planeProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform2fv(planeUVScaleLocation, 1, glm::value_ptr(planeUVScale));
+void DestroyTexture(GLuint textureID) {
+	glDeleteTextures(1, &textureID);
+}
 
-	//bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture2);
+//----------------------------------------------------------------------------------------------
+//**********************************************************************************************
+//---------------------------------------SCENE--------------------------------------------------
+//Placement of each lit object; transformations are applied scale, rotation, then translation
+struct SceneObject {
+	const char* name;
+	int meshIndex;				//Mesh in mesh.vbos[meshIndex * 2] onward
+	GLuint* texture;
+	glm::vec3 scale;
+	float rotationAngle;		//Radians
+	glm::vec3 rotationAxis;
+	glm::vec3 location;
+	glm::vec2 uvScale;
+	float boundingRadius;		//Local space, from the mesh vertices
+	bool dynamic;				//Drawn into the shadow cube every frame rather than cached
+};
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, mesh.plane_N_indices, GL_UNSIGNED_SHORT, NULL);
+const SceneObject gSceneObjects[] = {
+	{ "eraser", 0, &texture1, glm::vec3(0.5f, 0.5f, 0.5f), 0.0f, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, -0.39f, 2.0f), glm::vec2(1.0f, 1.0f), 1.13f, false },
+	{ "plane", 1, &texture2, glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(1.0f, 1.0f), 7.08f, false },
+	{ "pad", 3, &texture3, glm::vec3(0.75f, 0.75f, 0.75f), 0.0f, glm::vec3(1.0f, -1.92f, 0.0f), glm::vec3(2.0f, -0.80f, -2.0f), glm::vec2(1.0f, 1.0f), 1.44f, false },
+	{ "book", 4, &texture4, glm::vec3(1.0f, 1.0f, 1.0f), 45.0f, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(-1.0f, -0.72f, 2.0f), glm::vec2(1.0f, 1.0f), 1.83f, false },
+};
 
-//-------------------------------------------------------------------------------------
-//******************************PAD RENDER*********************************************
-//-------------------------------------------------------------------------------------
+//Whether the shadow cube needs a per-frame copy for dynamic casters
+bool UHasDynamicCasters() {
+	for (const SceneObject& sceneObject : gSceneObjects) {
+		if (sceneObject.dynamic)
+			return true;
+	}
+	return false;
+}
 
-	//Activate the VBO containing the Pad Data
-	glBindVertexArray(mesh.vaos[3]);
+//Object to world, as the scene update composes it
+glm::mat4 USceneObjectModel(const SceneObject& sceneObject) {
+	return glm::translate(sceneObject.location) * glm::rotate(sceneObject.rotationAngle, sceneObject.rotationAxis) * glm::scale(sceneObject.scale);
+}
 
-	glm::vec2 padUVScale(1.0f, 1.0f);
+//Copies the placement table into the arrays the job system updates; instance i is gSceneObjects[i]
+void UInitializeScene(SceneInstances& scene, std::vector<DrawSource>& sources) {
+	for (size_t i = 0; i < sizeof(gSceneObjects) / sizeof(gSceneObjects[0]); ++i) {
+		const SceneObject& sceneObject = gSceneObjects[i];
+		UAddInstance(scene, sceneObject.location, sceneObject.scale, sceneObject.rotationAngle, sceneObject.rotationAxis, sceneObject.boundingRadius);
+
+		DrawSource source;
+		source.buffers = &mesh.vbos[sceneObject.meshIndex * 2];
+		source.indexCount = UMeshIndexCount(mesh, sceneObject.meshIndex);
+		source.texture = sceneObject.texture;
+		source.lightmap = &gLightmaps[i];
+		source.lightmapCoordinates = &gLightmapCoordinateBuffers[i];
+		source.material = 0;
+		for (uint16_t t = 0; t < 4; ++t) {
+			if (gTextureTargets[t] == sceneObject.texture)
+				source.material = t;
+		}
+		source.mesh = (uint16_t)sceneObject.meshIndex;
+		source.uvScale = sceneObject.uvScale;
+		sources.push_back(source);
+	}
+}
 
-	// 1. Scales the object by 'n'
-	glm::mat4 Pad_scale = glm::scale(glm::vec3(0.75f, 0.75f, 0.75f));
-	// 2. Rotates shape by 'n' degrees in the x axis
-	glm::mat4 Pad_rotation = glm::rotate(0.0f, glm::vec3(1.0, -1.92f, 0.0f));
-	// 3. Place object at the 'n'
-	glm::vec3 Pad_location = glm::vec3(2.0f, -0.80f, -2.0f);
-	// 4. Translates object to location
-	glm::mat4 Pad_translation = glm::translate(Pad_location);
-	// Model matrix: transformations are applied right-to-left order
-	glm::mat4 Pad_model = Pad_translation * Pad_rotation * Pad_scale;
+//Lamp position at a point of its orbit around the origin
+glm::vec3 ULampPosition(float orbitAngle) {
+	return glm::vec3(glm::rotate(orbitAngle, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(KEY_LIGHT_START, 1.0f));
+}
 
-	glUniformMatrix4fv(padModelLocation, 1, GL_FALSE, glm::value_ptr(Pad_model));
-	glUniformMatrix4fv(padViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(padProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform2fv(padUVScaleLocation, 1, glm::value_ptr(padUVScale));
+//Advances the animated parts of the scene by one fixed step (main thread)
+void UUpdateScene(const InputSystem& input, double step) {
 
-	//bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture3);
+	//'L' starts and stops the lamp orbit
+	if (input.pressed[ACTION_TOGGLE_LAMP_ORBIT])
+		gIsLampOrbiting = !gIsLampOrbiting;
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, mesh.pad_N_indices, GL_UNSIGNED_SHORT, NULL);
+	// Lamp orbits around the origin. The angle is advanced and wrapped, rather than rotating the last
+	// position again, so rounding cannot drift the orbit radius over a long session.
+	const float angularVelocity = glm::radians(45.0f);
+	if (gIsLampOrbiting)
+		gLampOrbitAngle = fmod(gLampOrbitAngle + angularVelocity * (float)step, glm::radians(360.0f));
+	keyLightPosition = ULampPosition(gLampOrbitAngle);
+}
 
-//-------------------------------------------------------------------------------------
-//******************************BOOK RENDER*********************************************
-//-------------------------------------------------------------------------------------
+SimulationState UCaptureSimulationState() {
+	SimulationState state;
+	state.cameraPosition = camera.Position;
+	state.lampOrbitAngle = gLampOrbitAngle;
+	state.cameraFront = camera.Front;
+	state.cameraZoom = camera.Zoom;
+	return state;
+}
 
-	//Activate the VBO containing the book Data
-	glBindVertexArray(mesh.vaos[4]);
+//Whether a step changed anything that is drawn
+bool UStateChanged(const SimulationState& previous, const SimulationState& current) {
+	return previous.cameraPosition != current.cameraPosition || previous.lampOrbitAngle != current.lampOrbitAngle ||
+		previous.cameraFront != current.cameraFront || previous.cameraZoom != current.cameraZoom;
+}
 
-	glm::vec2 bookUVScale(1.0f, 1.0f);
+//Blends two simulation steps; alpha is how far real time has moved past 'previous'
+SimulationState UInterpolateState(const SimulationState& previous, const SimulationState& current, float alpha) {
+	SimulationState state;
+	state.cameraPosition = glm::mix(previous.cameraPosition, current.cameraPosition, alpha);
 
-	// 1. Scales the object by 'n'
-	glm::mat4 book_scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	// 2. Rotates shape by 'n' degrees in the x axis
-	glm::mat4 book_rotation = glm::rotate(45.0f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. Place object at the 'n'
-	glm::vec3 book_location = glm::vec3(-1.0f, -0.72f, 2.0f);
-	// 4. Translates object to location
-	glm::mat4 book_translation = glm::translate(book_location);
-	// Model matrix: transformations are applied right-to-left order
-	glm::mat4 book_model = book_translation * book_rotation * book_scale;
+	//The orbit angle wraps at a full turn; blend across the wrap rather than back around the circle
+	float turn = current.lampOrbitAngle - previous.lampOrbitAngle;
+	if (turn < -glm::radians(180.0f))
+		turn += glm::radians(360.0f);
+	state.lampOrbitAngle = previous.lampOrbitAngle + turn * alpha;
 
-	glUniformMatrix4fv(bookModelLocation, 1, GL_FALSE, glm::value_ptr(book_model));
-	glUniformMatrix4fv(bookViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(bookProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform2fv(bookUVScaleLocation, 1, glm::value_ptr(bookUVScale));
+	state.cameraFront = current.cameraFront;
+	state.cameraZoom = current.cameraZoom;
+	return state;
+}
 
-	//bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture4);
+//Resolves the step's left click to the scene object under the cursor (main thread). The TLAS is rebuilt from the
+//instances' current models, so it follows anything that has moved.
+void UPickObject(const InputSystem& input) {
+	const size_t objectCount = sizeof(gSceneObjects) / sizeof(gSceneObjects[0]);
+	if (!input.clicked || !gRayQuerySceneReady || gSceneInstances.models.size() != objectCount)
+		return;
+
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+	if (width <= 0 || height <= 0)
+		return;
+
+	UClearRayQueryInstances(gRayQueryScene);
+	for (size_t i = 0; i < objectCount; ++i)
+		UAddRayQueryInstance(gRayQueryScene, (int)i, gSceneObjects[i].meshIndex, gSceneInstances.models[i]);
+	UBuildTlas(gRayQueryScene);
+
+	//The view and projection UBuildRenderPacket draws with; the window has the framebuffer's proportions
+	glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.WorldUp);
+	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+	glm::vec3 origin, direction;
+	UUnprojectCursor(input.clickX, input.clickY, width, height, view, projection, origin, direction);
+
+	RayHit hit;
+	if (URayQuery(gRayQueryScene, origin, direction, hit))
+		LOG_INFO("INFO: Picked %s (triangle %d, uv %.3f %.3f) at %.2f units", gSceneObjects[hit.entity].name, hit.triangle, hit.uv.x, hit.uv.y, hit.distance);
+	else
+		LOG_INFO("INFO: Picked nothing");
+}
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, mesh.book_N_indices, GL_UNSIGNED_SHORT, NULL);
+//The software backend's copy of a frame: the given instances with their models, then the lamp
+void UBuildSoftwareFrame(SoftwareFrame& frame, const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPosition, glm::vec3 lightPosition,
+	const int* instances, size_t count, const glm::mat4* models) {
+
+	frame.view = view;
+	frame.projection = projection;
+	frame.viewPosition = viewPosition;
+	frame.lightPosition = lightPosition;
+	frame.lightColor = keyLightColor;
+	frame.specIntensity = keyLightIntensity;
+
+	//Texture indices follow TEXTURE_FILE_NAMES, as the draw sources' materials do
+	frame.draws.clear();
+	for (size_t i = 0; i < count; ++i) {
+		const SceneObject& sceneObject = gSceneObjects[instances[i]];
+		frame.draws.push_back(SoftwareDraw{ sceneObject.meshIndex, (int)gDrawSources[instances[i]].material, models[instances[i]], sceneObject.uvScale });
+	}
+	frame.draws.push_back(SoftwareDraw{ 2, -1, glm::translate(lightPosition) * glm::scale(keyLightScale), glm::vec2(1.0f, 1.0f) });
+}
 
-	//---------------------------------LAMP RENDER-----------------------------------------
-	
-	glUseProgram(lampID);
+//Snapshots the camera, light, and object transforms for one frame (main thread).
+//Positions come from the interpolated state; orientation and zoom are taken from the latest step.
+void UBuildRenderPacket(RenderPacket& packet, const SimulationState& state) {
 
-	glBindVertexArray(mesh.vaos[2]);
+	//View Matrix: Transforms the camera
+	packet.view = glm::lookAt(state.cameraPosition, state.cameraPosition + state.cameraFront, camera.WorldUp);
+
+	//Creates a persepctive projection; the aspect follows the framebuffer (the scene target keeps its proportions)
+	int framebufferWidth = gFramebufferWidth;
+	int framebufferHeight = gFramebufferHeight;
+	GLfloat aspect = framebufferWidth > 0 && framebufferHeight > 0 ? (GLfloat)framebufferWidth / (GLfloat)framebufferHeight : (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
+	packet.projection = glm::perspective(glm::radians(state.cameraZoom), aspect, 0.1f, 100.0f);
+	packet.viewPosition = state.cameraPosition;
+	glm::vec3 lightPosition = ULampPosition(state.lampOrbitAngle);
+
+	//Transforms, frustum culling, and the draw list run on the job system; the main thread helps while it waits
+	UWaitForJob(gJobSystem, UScheduleSceneUpdate(gJobSystem, gSceneInstances, packet.projection * packet.view));
+	UResetJobs(gJobSystem);
+
+	packet.software.draws.clear();
+	if (gSoftwareRendering)
+		UBuildSoftwareFrame(packet.software, packet.view, packet.projection, packet.viewPosition, lightPosition,
+			gSceneInstances.drawList.data(), gSceneInstances.drawCount, gSceneInstances.models.data());
+
+	packet.uniformsReady = false;
+	packet.shadowFaces = 0;
+	packet.casterCount = 0;
+	packet.lightPosition = lightPosition;
+	for (CommandList& list : packet.commandLists)
+		list.draws.clear();
+	if (!gRingBuffer.mapped)
+		return;
+
+	//Waits only if the GPU is still reading this segment from RING_FRAMES frames ago
+	UBeginRingFrame(gRingBuffer, packet.frame);
+
+	//Camera and light are shared by every object in the frame
+	RingAllocation frameBlock = URingAllocate(gRingBuffer, sizeof(FrameUniforms), gRingBuffer.uniformAlignment);
+	RingAllocation lampBlock = URingAllocate(gRingBuffer, sizeof(ObjectUniforms), gRingBuffer.uniformAlignment);
+	packet.objectStride = URingUniformStride(gRingBuffer, sizeof(ObjectUniforms));
+	RingAllocation objectBlocks = URingAllocate(gRingBuffer, packet.objectStride * gSceneInstances.drawCount, gRingBuffer.uniformAlignment);
+	if (!frameBlock.data || !lampBlock.data || !objectBlocks.data)
+		return;
+
+	//Shadow cube faces to redraw; a cache the GL thread could not draw is scheduled again in full
+	if (gShadowMaps.lost.exchange(false))
+		UInvalidateShadowSchedule(gShadowSchedule);
+	unsigned shadowFaces = UScheduleShadowFaces(gShadowSchedule, lightPosition, gIsLampOrbiting);
+
+	//Every instance casts; their blocks are only written on frames that draw into the cube
+	if (shadowFaces || gShadowMaps.hasDynamic) {
+		size_t casterCount = gSceneInstances.models.size();
+		RingAllocation casterBlocks = URingAllocate(gRingBuffer, packet.objectStride * casterCount, gRingBuffer.uniformAlignment);
+		if (casterBlocks.data) {
+			for (size_t i = 0; i < casterCount; ++i) {
+				ObjectUniforms casterUniforms;
+				casterUniforms.model = gSceneInstances.models[i];
+				casterUniforms.normalMatrix = glm::mat4(1.0f);
+				casterUniforms.uvScale = glm::vec2(1.0f, 1.0f);
+				memcpy(casterBlocks.data + i * packet.objectStride, &casterUniforms, sizeof(casterUniforms));
+			}
+			packet.casterUniforms = casterBlocks.offset;
+			packet.casterCount = casterCount;
+		}
+	}
+	packet.shadowFaces = shadowFaces;
+
+	FrameUniforms frameUniforms;
+	frameUniforms.view = packet.view;
+	frameUniforms.projection = packet.projection;
+	frameUniforms.objectColor = keyObjectColor;
+	frameUniforms.specIntensity = keyLightIntensity;
+	frameUniforms.lightColor = keyLightColor;
+	frameUniforms.lightPosition = lightPosition;
+	frameUniforms.viewPosition = packet.viewPosition;
+	frameUniforms.shadowFarPlane = gShadowSchedule.enabled ? gShadowSchedule.farPlane : 0.0f;
+	for (int face = 0; face < SHADOW_FACES; ++face)
+		frameUniforms.shadowFaceLights[face] = glm::vec4(gShadowSchedule.faceLights[face], 1.0f);
+	memcpy(frameBlock.data, &frameUniforms, sizeof(frameUniforms));
 
 	//Transform the smaller cube used as a visual que for the light source
-	glm::mat4 L_model = glm::translate(keyLightPosition) * glm::scale(keyLightScale);
+	ObjectUniforms lampUniforms;
+	lampUniforms.model = glm::translate(lightPosition) * glm::scale(keyLightScale);
+	lampUniforms.normalMatrix = glm::mat4(1.0f);
+	lampUniforms.uvScale = glm::vec2(1.0f, 1.0f);
+	memcpy(lampBlock.data, &lampUniforms, sizeof(lampUniforms));
+
+	packet.frameUniforms = frameBlock.offset;
+	packet.lampUniforms = lampBlock.offset;
+	packet.objectUniforms = objectBlocks.offset;
+	packet.uniformsReady = true;
+
+	//Workers record draws into per-thread lists and write their uniform blocks straight into the ring
+	UWaitForJob(gJobSystem, UScheduleDrawRecording(gJobSystem, gSceneInstances, gDrawSources.data(), packet.viewPosition,
+		objectBlocks.data, packet.objectStride, gSceneInstances.drawCount, packet.commandLists));
+	UResetJobs(gJobSystem);
+}
 
-	glUniformMatrix4fv(lampModelLocation, 1, GL_FALSE, glm::value_ptr(L_model));
-	glUniformMatrix4fv(lampViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(lampProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
+//----------------------------------------------------------------------------------------------
+//**********************************************************************************************
+//-----------------------------------SOFTWARE BACKEND-------------------------------------------
+//Loader thread: decodes the scene textures again as CPU copies, indexed like TEXTURE_FILE_NAMES.
+//A texture that cannot be found is drawn white.
+bool ULoadSoftwareTextures(SoftwareRasterizer& rasterizer) {
+	rasterizer.textures.resize(4);
+	bool loaded = true;
+	for (int i = 0; i < 4; ++i) {
+		TextureLoad load;
+		load.fileName = TEXTURE_FILE_NAMES[i];
+		if (!UDecodeTexture(load)) {
+			LOG_ERROR("ERROR::SOFTWARE::TEXTURE_NOT_FOUND %s", TEXTURE_FILE_NAMES[i]);
+			loaded = false;
+			continue;
+		}
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, mesh.lamp_N_indices, GL_UNSIGNED_SHORT, NULL);
+		const unsigned char* texels = load.image ? load.image : load.asset.data;
+		SoftwareTexture& texture = rasterizer.textures[i];
+		texture.width = load.width;
+		texture.height = load.height;
+		texture.channels = load.channels;
+		texture.texels.assign(texels, texels + (size_t)load.width * load.height * load.channels);
+	}
+	return loaded;
+}
 
-	//Deactivate the VAO;
+//Context thread: copies every mesh back from its buffers, indexed like meshIndex
+bool UReadBackSoftwareMeshes(SoftwareRasterizer& rasterizer) {
+	rasterizer.meshes.resize(5);
+	bool readBack = true;
+	for (int i = 0; i < 5; ++i)
+		readBack = UReadBackMesh(mesh.vbos[i * 2], mesh.vbos[i * 2 + 1], *UMeshIndexCount(mesh, i), rasterizer.meshes[i].vertices, rasterizer.meshes[i].indices) && readBack;
+	return readBack;
+}
+
+//Rasterizes the packet's frame on the CPU and copies it to the window's framebuffer (GL thread)
+void URenderSoftware(const RenderPacket& packet, int width, int height) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	//The cleared frame is presented until the meshes and textures have been read back
+	if (!gSoftwareSceneReady || packet.software.draws.empty())
+		return;
+
+	USetSoftwareTarget(gSoftwareRasterizer, width, height);
+	URasterizeFrame(gSoftwareRasterizer, packet.software);
+
+	//The presentation texture follows the window size
+	if (width != gSoftwareTextureWidth || height != gSoftwareTextureHeight) {
+		if (!gSoftwareTexture) {
+			glGenTextures(1, &gSoftwareTexture);
+			glGenFramebuffers(1, &gSoftwareFramebuffer);
+		}
+		glBindTexture(GL_TEXTURE_2D, gSoftwareTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, gSoftwareFramebuffer);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gSoftwareTexture, 0);
+		gSoftwareTextureWidth = width;
+		gSoftwareTextureHeight = height;
+	}
+
+	//The color buffer's rows are padded to whole tiles
+	glBindTexture(GL_TEXTURE_2D, gSoftwareTexture);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, gSoftwareRasterizer.stride);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, gSoftwareRasterizer.color.data());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, gSoftwareFramebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+//----------------------------------------------------------------------------------------------
+//**********************************************************************************************
+//------------------------------------SHADER PROGRAM--------------------------------------------
+//Draws the lit objects and the lamp into the bound framebuffer and viewport
+void UDrawScene(const RenderPacket& packet) {
+
+	//Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	//clear the background
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f); //sets background as black
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//Nothing to draw until the geometry and lit shader are ready; the cleared frame is still presented
+	if (!gMeshReady || !programID || !packet.uniformsReady)
+		return;
+
+	//Key light shadow cube on unit 1, where the lit shader's sampler is bound
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, UShadowTexture(gShadowMaps));
+
+	//Camera, color, and light for every program come from the frame's block in the ring buffer
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, gRingBuffer.buffer, packet.frameUniforms, sizeof(FrameUniforms));
+
+	//bind textures on corresponding texture units
+	glActiveTexture(GL_TEXTURE0);
+
+	//Merge the recorders' lists; sorted draws share state with their neighbours, so most binds are skipped
+	UMergeCommandLists(packet.commandLists, gSubmitDraws);
+
+	//The render device draws them with its lit pipeline
+	DeviceStats before = gRenderDevice.stats;
+	USubmitDraws(gRenderDevice, DeviceFrame{ gRingBuffer.buffer, packet.objectUniforms, packet.objectStride }, gDrawSources.data(), gDrawSources.size(), gSubmitDraws);
+	gFrameStats.submitNanoseconds += gRenderDevice.stats.submitNanoseconds - before.submitNanoseconds;
+	gFrameStats.submitCalls += gRenderDevice.stats.calls - before.calls;
+	gFrameStats.submitDraws += gRenderDevice.stats.draws - before.draws;
+
+	//---------------------------------LAMP RENDER-----------------------------------------
+
+	if (lampID) {
+		glUseProgram(lampID);
+
+		glBindVertexArray(mesh.vao);
+		UBindMeshBuffers(mesh.vao, &mesh.vbos[4]);
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, gRingBuffer.buffer, packet.lampUniforms, sizeof(ObjectUniforms));
+
+		// Draws the triangles
+		glDrawElements(GL_TRIANGLES, mesh.lamp_N_indices, GL_UNSIGNED_SHORT, NULL);
+	}
+
+	//Dust last, over the depth of everything else
+	UDrawParticles(gParticles);
+
+	//Deactivate the VAO;
 	glBindVertexArray(0);
+}
+
+//Draws the casters from the packet's blocks into the attached cube face; instance i is gSceneObjects[i]
+void UDrawShadowCasters(const RenderPacket& packet, bool dynamic) {
+	glBindVertexArray(mesh.vao);
+	for (size_t i = 0; i < packet.casterCount; ++i) {
+		if (gSceneObjects[i].dynamic != dynamic)
+			continue;
+
+		UBindMeshBuffers(mesh.vao, gDrawSources[i].buffers);
+		glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, gRingBuffer.buffer, packet.casterUniforms + i * packet.objectStride, sizeof(ObjectUniforms));
+		glDrawElements(GL_TRIANGLES, *gDrawSources[i].indexCount, GL_UNSIGNED_SHORT, NULL);
+	}
+}
+
+//Shadow pass: redraws the scheduled faces of the static cache, then the dynamic casters over a copy of it
+void URenderShadowPass(const RenderPacket& packet) {
+	if (!gShadowMaps.program || (packet.shadowFaces == 0 && !gShadowMaps.hasDynamic))
+		return;
+
+	//Faces that cannot be drawn yet are scheduled again once the main thread hears about it
+	if (!gMeshReady || packet.casterCount == 0) {
+		if (packet.shadowFaces) {
+			gShadowMaps.lost = true;
+			glfwPostEmptyEvent();
+		}
+		return;
+	}
+
+	UBeginShadowPass(gShadowMaps);
+	uint64_t facesDrawn = 0;
+	for (int face = 0; face < SHADOW_FACES; ++face) {
+		if (!(packet.shadowFaces & (1u << face)))
+			continue;
+		gShadowMaps.faceLights[face] = packet.lightPosition;
+		UBeginShadowFace(gShadowMaps, gShadowMaps.staticMap, face, packet.lightPosition, true);
+		UDrawShadowCasters(packet, false);
+		++facesDrawn;
+	}
 
-	//glfw: swap buffers and poll IO
+	//Dynamic casters are drawn from the same position as the cached face they land on
+	if (gShadowMaps.hasDynamic) {
+		UCopyShadowCache(gShadowMaps);
+		for (int face = 0; face < SHADOW_FACES; ++face) {
+			UBeginShadowFace(gShadowMaps, gShadowMaps.dynamicMap, face, gShadowMaps.faceLights[face], false);
+			UDrawShadowCasters(packet, true);
+			++facesDrawn;
+		}
+	}
+
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	gFrameStats.shadowFaces += facesDrawn;
+}
+
+//Particle pass: moves the dust by the time between this packet and the last one, around this frame's lamp position
+void URenderParticlePass(const RenderPacket& packet) {
+	if (!gParticles.capacity)
+		return;
+	float seconds = gParticles.filled ? std::chrono::duration<float>(packet.simulatedAt - gParticlesUpdatedAt).count() : 0.0f;
+	gParticlesUpdatedAt = packet.simulatedAt;
+	UUpdateParticles(gParticles, seconds, packet.lightPosition);
+}
+
+//Scene pass: the scene at this frame's resolution scale, timed for the resolution controller
+void URenderScenePass(const RenderPacket& packet) {
+	glViewport(0, 0, gDynamicResolution.sceneWidth, gDynamicResolution.sceneHeight);
+	UBeginSceneTiming(gDynamicResolution);
+	UDrawScene(packet);
+	UEndSceneTiming(gDynamicResolution);
+}
+
+//Antialias pass: FXAA over the scene region, at render resolution
+void URenderAntialiasPass(GLuint sceneTexture) {
+	glViewport(0, 0, gDynamicResolution.sceneWidth, gDynamicResolution.sceneHeight);
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(gAntialiasID);
+	glUniform2f(gAntialiasRegionLocation, (float)gDynamicResolution.sceneWidth / gDynamicResolution.targetWidth, (float)gDynamicResolution.sceneHeight / gDynamicResolution.targetHeight);
+	glUniform2f(gAntialiasTexelLocation, 1.0f / gDynamicResolution.targetWidth, 1.0f / gDynamicResolution.targetHeight);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, sceneTexture);
+	glBindVertexArray(gDynamicResolution.vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
+
+//Declares the frame for a framebuffer size (GL thread). Every pass is declared; the ones whose output is not
+//used with the current options are culled when the graph is compiled.
+void UBuildRenderGraph(RenderGraph& graph, int width, int height) {
+	UResetRenderGraph(graph);
+
+	int sceneColor = UCreateTransient(graph, "scene color", width, height, GL_RGBA8);
+	int sceneDepth = UCreateTransient(graph, "scene depth", width, height, GL_DEPTH24_STENCIL8);
+	int antialiased = UCreateTransient(graph, "antialiased", width, height, GL_RGBA8);
+	int sharpened = UCreateTransient(graph, "sharpened", width, height, GL_RGBA8);
+	int backbuffer = UImportBackbuffer(graph, "backbuffer");
+
+	//The shadow cube is kept across frames, so it is imported rather than transient
+	int shadowCube = UImportResource(graph, "shadow cube");
+	UAddRenderPass(graph, "shadows", {}, { shadowCube },
+		[](const RenderGraph&, const void* frame) { URenderShadowPass(*(const RenderPacket*)frame); });
+
+	//Particles also persist; the simulation writes them and the scene pass draws them
+	int particles = UImportResource(graph, "particles");
+	UAddRenderPass(graph, "particles", {}, { particles },
+		[](const RenderGraph&, const void* frame) { URenderParticlePass(*(const RenderPacket*)frame); });
+
+	std::vector<int> sceneReads;
+	if (gShadowMaps.program)
+		sceneReads.push_back(shadowCube);
+	if (gParticles.capacity)
+		sceneReads.push_back(particles);
+	UAddRenderPass(graph, "scene", sceneReads, { sceneColor, sceneDepth },
+		[](const RenderGraph&, const void* frame) { URenderScenePass(*(const RenderPacket*)frame); });
+
+	UAddRenderPass(graph, "antialias", { sceneColor }, { antialiased },
+		[sceneColor](const RenderGraph& graph, const void*) { URenderAntialiasPass(URenderGraphTexture(graph, sceneColor)); });
+
+	//Sharpening runs before the upscale, at render resolution, so it costs less as the scale drops
+	int sharpenInput = gAntialiasID ? antialiased : sceneColor;
+	UAddRenderPass(graph, "sharpen", { sharpenInput }, { sharpened },
+		[sharpenInput](const RenderGraph& graph, const void*) {
+			glViewport(0, 0, gDynamicResolution.sceneWidth, gDynamicResolution.sceneHeight);
+			UDrawSceneRegion(gDynamicResolution, URenderGraphTexture(graph, sharpenInput), USceneSharpness(gDynamicResolution));
+		});
+
+	int upscaleInput = gDynamicResolution.filter == UPSCALE_SHARPEN ? sharpened : sharpenInput;
+	UAddRenderPass(graph, "upscale", { upscaleInput }, { backbuffer },
+		[upscaleInput, width, height](const RenderGraph& graph, const void*) {
+			glViewport(0, 0, width, height);
+			UDrawSceneRegion(gDynamicResolution, URenderGraphTexture(graph, upscaleInput), 0.0f);
+		});
+
+	UCompileRenderGraph(graph);
+}
+
+//Captures the finished frame when --capture is on, then swaps it to the window
+void UPresentFrame(int width, int height) {
+	if (gFrameCapture.active) {
+		if (UCaptureFrame(gFrameCapture, width, height))
+			++gFrameStats.capturedFrames;
+		else
+			++gFrameStats.droppedCaptures;
+	}
 	glfwSwapBuffers(window);
+}
+
+//Function called to render a frame
+//Runs on the thread that owns the GL context; everything that changes per frame comes from the packet
+void URender(const RenderPacket& packet) {
+
+	int windowWidth = gFramebufferWidth;
+	int windowHeight = gFramebufferHeight;
+
+	//--software: the CPU rasterizer replaces the render graph; GL only presents its image
+	if (gSoftwareRendering) {
+		URenderSoftware(packet, windowWidth, windowHeight);
+		UPresentFrame(windowWidth, windowHeight);
+		return;
+	}
+
+	//The graph's targets follow the framebuffer size; rebuilding allocates, but only happens on a resize
+	if (gFramebufferResized.exchange(false)) {
+		AllowFrameAllocations allowResize;
+		UBuildRenderGraph(gRenderGraph, windowWidth, windowHeight);
+	}
+
+	UChooseSceneSize(gDynamicResolution, windowWidth, windowHeight);
+
+	if (gRenderGraph.compiled) {
+		UExecuteRenderGraph(gRenderGraph, &packet);
+	}
+	else {
+		//Without a graph the scene goes straight to the window at full resolution
+		URenderShadowPass(packet);
+		URenderParticlePass(packet);
+		glViewport(0, 0, windowWidth, windowHeight);
+		UDrawScene(packet);
+	}
+
+	//glfw: swap buffers
+	UPresentFrame(windowWidth, windowHeight);
 };
 
+//Releases a partially built program so a failed build leaves programID at 0
+void UDeleteFailedProgram(GLuint& programID, GLuint vertexShaderID, GLuint fragmentShaderID) {
+	glDeleteShader(vertexShaderID);
+	glDeleteShader(fragmentShaderID);
+	glDeleteProgram(programID);
+	programID = 0;
+}
+
 //Implements UCreateShader
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programID) {
 
@@ -1421,8 +1359,9 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	glGetShaderiv(vertexShaderID, GL_COMPILE_STATUS, &success);  //vertex shader error check logic
 	if (!success) {
 		glGetShaderInfoLog(vertexShaderID, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		LOG_ERROR("ERROR::SHADER::VERTEX::COMPILATION_FAILED\n%s", infoLog);
 
+		UDeleteFailedProgram(programID, vertexShaderID, fragmentShaderID);
 		return false;
 	}
 
@@ -1431,8 +1370,9 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	glGetShaderiv(fragmentShaderID, GL_COMPILE_STATUS, &success);  //fragment shader error check logic
 	if (!success) {
 		glGetShaderInfoLog(fragmentShaderID, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		LOG_ERROR("ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n%s", infoLog);
 
+		UDeleteFailedProgram(programID, vertexShaderID, fragmentShaderID);
 		return false;
 	}
 	//Attach compiled shaders to the shader program
@@ -1444,8 +1384,9 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	glGetProgramiv(programID, GL_LINK_STATUS, &success);
 	if (!success) {
 		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED" << infoLog << std::endl;
+		LOG_ERROR("ERROR::SHADER::PROGRAM::LINKING_FAILED%s", infoLog);
 
+		UDeleteFailedProgram(programID, vertexShaderID, fragmentShaderID);
 		return false;
 	}
 
@@ -1468,111 +1409,2274 @@ void UDestroyShaderProgram(GLuint programID) {
 */
 bool UInitialize(int, char* [], GLFWwindow** window);
 void UResizeWindow(GLFWwindow* window, int width, int height);
-void KeyBoardInput(GLFWwindow* window);
+void UUpdateCamera(const InputSystem& input);
 
+void KeyCallback(GLFWwindow*, int key, int scancode, int action, int mods);
 void MousePositionCallback(GLFWwindow*, double xpos, double ypos);
 void MouseScrollCallback(GLFWwindow*, double xoffset, double yoffset);
 void MouseButtonCallback(GLFWwindow*, int button, int action, int mods);
 
 void UCreateMesh(GLMesh& mesh);
 void UDestroyMesh(GLMesh& mesh);
-void URender();
+void URender(const RenderPacket& packet);
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragmentShaderSource, GLuint& programID);
 void UDestroyShaderProgram(GLuint programID);
 
-//main function. Entry point to the OpenGL program
-int main(int argc, char* argv[]) {
+//-----------------------------------------------------------------------------------
+//-------------------------------------STARTUP---------------------------------------
+//Shader program load state handed from a loader thread to the context thread
+struct ShaderLoad {
+	const char* vertexName;			//Asset names
+	const char* fragmentName;
+	const char* vertexFallback;		//Compiled-in sources
+	const char* fragmentFallback;
+	GLuint* program;
+	const char* vertexSource = nullptr;
+	const char* fragmentSource = nullptr;
+};
+
+//Sources are resolved on a loader thread; compiling and linking happen on the context thread.
+//If the asset sources fail to build or read inputs the mesh layout does not have, the compiled-in sources are used instead.
+int UAddShaderJob(LoadGraph& graph, const char* name, std::vector<int> dependencies, ShaderLoad& load) {
+	return UAddLoadJob(graph, name, dependencies,
+		[&load] {
+			load.vertexSource = UFindShaderSource(load.vertexName, load.vertexFallback);
+			load.fragmentSource = UFindShaderSource(load.fragmentName, load.fragmentFallback);
+			return true;
+		},
+		//Asset sources that do not build give way to the compiled-in ones; the job fails only if those fail too
+		[&load, name] {
+			if (UCreateShaderProgram(load.vertexSource, load.fragmentSource, *load.program) &&
+				UCheckVertexLayout<SceneVertexLayout>(*load.program, name))
+				return true;
+			if (load.vertexSource == load.vertexFallback && load.fragmentSource == load.fragmentFallback)
+				return false;
+
+			LOG_WARN("WARN: %s did not build from its asset files, using the compiled-in shader", name);
+			UDestroyShaderProgram(*load.program);
+			*load.program = 0;
+			return UCreateShaderProgram(load.vertexFallback, load.fragmentFallback, *load.program) &&
+				UCheckVertexLayout<SceneVertexLayout>(*load.program, name);
+		});
+}
+
+//Decoding runs on a loader thread; a failed texture keeps the fallback checker bound
+int UAddTextureJob(LoadGraph& graph, std::vector<int> dependencies, TextureLoad& load) {
+	return UAddLoadJob(graph, load.fileName, dependencies,
+		[&load] { return UDecodeTexture(load); },
+		[&load] { return UUploadDecodedTexture(load); },
+		[&load] { LOG_ERROR("Failed to load texture %s, using fallback", load.fileName); });
+}
+
+//Returns true if 'flag' was passed on the command line
+bool UHasArg(int argc, char* argv[], const char* flag) {
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], flag) == 0)
+			return true;
+	}
+	return false;
+}
+
+//Returns the number following 'flag', or 'fallback' if it was not passed
+double UArgValue(int argc, char* argv[], const char* flag, double fallback) {
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (strcmp(argv[i], flag) == 0)
+			return atof(argv[i + 1]);
+	}
+	return fallback;
+}
 
-	if (!UInitialize(argc, argv, &window))
+//Returns the argument following 'flag', or nullptr if it was not passed
+const char* UArgString(int argc, char* argv[], const char* flag) {
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (strcmp(argv[i], flag) == 0)
+			return argv[i + 1];
+	}
+	return nullptr;
+}
+
+//Stands in for heavier game logic so the simulation/render overlap can be measured
+void USimulateWork(double milliseconds) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(milliseconds);
+	while (std::chrono::steady_clock::now() < deadline) {
+	}
+}
+
+//Registers the loaded resources with the watcher once startup loading has finished (GL thread)
+void UOnFullyLoaded() {
+
+	//Loose file copies are no longer needed once uploaded
+	UReleaseLooseAssets();
+	LOG_INFO("INFO: Time to fully loaded: %.1f ms (%d failed)", ULoadGraphElapsedMs(gLoadGraph), (int)gLoadGraph.failed);
+
+	UWatchShader(gReloader, "scene shader", "shaders/scene.vert", "shaders/scene.frag", programID);
+	UWatchShader(gReloader, "lamp shader", "shaders/lamp.vert", "shaders/lamp.frag", lampID);
+	for (int i = 0; i < 4; ++i)
+		UWatchTexture(gReloader, TEXTURE_FILE_NAMES[i], *gTextureTargets[i]);
+
+	const char* meshNames[5] = { "eraser", "plane", "lamp", "pad", "book" };
+	for (int i = 0; i < 5; ++i)
+		UWatchMesh(gReloader, meshNames[i], mesh.vbos[i * 2], mesh.vbos[i * 2 + 1], *UMeshIndexCount(mesh, i));
+
+	UStartHotReload(gReloader);
+}
+
+//Everything the GL thread does for one packet
+void URenderFrame(const RenderPacket& packet) {
+
+	static bool fullyLoaded = false;
+	static bool firstFrame = true;
+
+	auto renderStart = std::chrono::steady_clock::now();
+
+	FrameScope frameScope;
+
+	{
+		//Uploads and resource swaps allocate by nature; they are rare and excluded from the frame allocation check
+		AllowFrameAllocations allowUploads;
+
+		//Run GL uploads queued by the loader threads, within a small per-frame budget
+		if (!fullyLoaded && UPumpLoadGraph(gLoadGraph, 4.0)) {
+			fullyLoaded = true;
+			UOnFullyLoaded();
+		}
+
+		//Swap in any resources the watcher has rebuilt
+		UApplyHotReloads(gReloader);
+	}
+
+	//The swap interval follows the pacing policy; it has to be set on the context's thread
+	UApplySwapInterval(gFramePacer);
+
+	//render this frame
+	URender(packet);
+	UNotePresent(gFramePacer);
+
+	gFrameStats.gpuNanoseconds += gDynamicResolution.gpuNanoseconds;
+	gFrameStats.gpuSamples += gDynamicResolution.gpuSamples;
+	gDynamicResolution.gpuNanoseconds = 0;
+	gDynamicResolution.gpuSamples = 0;
+	gFrameStats.renderScalePermille = (int)(gDynamicResolution.scale * 1000.0f + 0.5f);
+	gFrameStats.sceneWidth = gDynamicResolution.sceneWidth;
+	gFrameStats.sceneHeight = gDynamicResolution.sceneHeight;
+
+	//The segment is rewritten RING_FRAMES frames from now, once this fence has signaled
+	if (gRingBuffer.mapped)
+		UEndRingFrame(gRingBuffer, packet.frame);
+
+	gFrameStats.renderNanoseconds += UNanosecondsSince(renderStart);
+	gFrameStats.latencyNanoseconds += UNanosecondsSince(packet.simulatedAt);
+	++gFrameStats.frames;
+
+	if (firstFrame) {
+		firstFrame = false;
+		LOG_INFO("INFO: Time to first frame: %.1f ms", ULoadGraphElapsedMs(gLoadGraph));
+	}
+
+	AllowFrameAllocations allowReports;
+	UReportHotReloadLatency(gReloader);
+}
+
+//Tools that need GL but no visible window: a hidden window whose 4.5 core context is current on the calling thread
+GLFWwindow* UCreateToolContext() {
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* toolWindow = glfwCreateWindow(64, 64, WINDOW_TITLE, NULL, NULL);
+	if (!toolWindow) {
+		LOG_ERROR("Failed to create GLFW window");
+		glfwTerminate();
+		return nullptr;
+	}
+	glfwMakeContextCurrent(toolWindow);
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		glfwTerminate();
+		return nullptr;
+	}
+	return toolWindow;
+}
+
+//--bake-lightmaps [--texels-per-unit N] [--samples N] [--bounces N] [--threads N] [--key-light] [--out dir]
+//Bakes a lightmap per scene object from the meshes UCreateMesh uploads, on a hidden window's context.
+//--key-light adds the lamp's bounce light at its starting position; it is only right while the lamp stays there.
+int UBakeSceneLightmaps(int argc, char* argv[]) {
+	GLFWwindow* bakeWindow = UCreateToolContext();
+	if (!bakeWindow)
 		return EXIT_FAILURE;
 
-	//Create the mesh
-	UCreateMesh(mesh);  //calls function to create vertex buffer object
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+
+	std::vector<BakeObject> objects;
+	bool readBack = true;
+	for (const SceneObject& sceneObject : gSceneObjects) {
+		BakeObject object;
+		object.name = sceneObject.name;
+		object.model = USceneObjectModel(sceneObject);
+		readBack = UReadBackMesh(mesh.vbos[sceneObject.meshIndex * 2], mesh.vbos[sceneObject.meshIndex * 2 + 1], *UMeshIndexCount(mesh, sceneObject.meshIndex), object.vertices, object.indices) && readBack;
+
+		//Bounce light takes the average color of the surface's texture
+		object.albedo = glm::vec3(0.5f);
+		for (int i = 0; i < 4; ++i) {
+			TextureLoad texture;
+			texture.fileName = TEXTURE_FILE_NAMES[i];
+			if (gTextureTargets[i] != sceneObject.texture || !UDecodeTexture(texture))
+				continue;
+
+			const unsigned char* texels = texture.image ? texture.image : texture.asset.data;
+			glm::dvec3 sum(0.0);
+			size_t pixels = (size_t)texture.width * texture.height;
+			for (size_t p = 0; p < pixels; ++p) {
+				const unsigned char* texel = texels + p * texture.channels;
+				sum += texture.channels >= 3 ? glm::dvec3(texel[0], texel[1], texel[2]) : glm::dvec3(texel[0]);
+			}
+			if (pixels)
+				object.albedo = glm::vec3(sum / (255.0 * pixels));
+		}
+		objects.push_back(object);
+	}
 
-	//create the shader program
-	if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, programID))
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(bakeWindow);
+	glfwTerminate();
+	if (!readBack) {
+		LOG_ERROR("ERROR::LIGHTMAP::MESH_READBACK_FAILED");
 		return EXIT_FAILURE;
+	}
+
+	BakeSettings settings;
+	settings.texelsPerUnit = (float)UArgValue(argc, argv, "--texels-per-unit", settings.texelsPerUnit);
+	settings.samples = (int)UArgValue(argc, argv, "--samples", settings.samples);
+	settings.maxBounces = (int)UArgValue(argc, argv, "--bounces", settings.maxBounces);
+	settings.threads = (unsigned)UArgValue(argc, argv, "--threads", 0.0);
+	if (const char* outputDir = UArgString(argc, argv, "--out"))
+		settings.outputDir = outputDir;
+	if (UHasArg(argc, argv, "--key-light"))
+		settings.lights.push_back(BakeLight{ KEY_LIGHT_START, glm::vec3(1.0f) });
+
+	return UBakeLightmaps(objects, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//Programs, textures, and uniforms for drawing the scene offscreen in the tools, with a constant ambient
+struct ToolScene {
+	GLuint litProgram = 0;
+	GLuint lampProgram = 0;
+	GLuint textures[4] = {};
+	GLuint lightmap = 0;
+	GLuint uniformBuffer = 0;
+	GLsizeiptr objectStride = 0;
+	std::vector<unsigned char> uniforms;		//Staged here, then uploaded whole
+	GLuint vao = 0;								//In the scene layout; one per context, as vertex arrays are not shared
+};
+
+//A color and depth target of one size
+struct ToolTarget {
+	GLuint framebuffer = 0;
+	GLuint renderbuffers[2] = {};
+	int width = 0;
+	int height = 0;
+};
 
-	if (!UCreateShaderProgram(lampVertexShaderSource, lampFragmentShaderSource, lampID))
+//The same programs and textures the window draws with; the mesh must have been created
+void UCreateToolScene(ToolScene& scene) {
+	UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, scene.litProgram);
+	glUniform1i(glGetUniformLocation(scene.litProgram, "Texture"), 0);
+	UCreateShaderProgram(lampVertexShaderSource, lampFragmentShaderSource, scene.lampProgram);
+	for (int i = 0; i < 4; ++i) {
+		if (!CreateTexture(TEXTURE_FILE_NAMES[i], scene.textures[i]))
+			UCreateFallbackTexture(scene.textures[i]);
+	}
+	UCreateNeutralLightmap(scene.lightmap);
+	scene.vao = mesh.vao;
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	scene.objectStride = (GLsizeiptr)((std::max(sizeof(FrameUniforms), sizeof(ObjectUniforms)) + alignment - 1) / alignment * alignment);
+	const size_t objectCount = sizeof(gSceneObjects) / sizeof(gSceneObjects[0]);
+	scene.uniforms.resize((size_t)scene.objectStride * (objectCount + 2));
+	glGenBuffers(1, &scene.uniformBuffer);
+}
+
+void UDestroyToolScene(ToolScene& scene) {
+	glDeleteBuffers(1, &scene.uniformBuffer);
+	for (int i = 0; i < 4; ++i)
+		DestroyTexture(scene.textures[i]);
+	DestroyTexture(scene.lightmap);
+	UDestroyShaderProgram(scene.litProgram);
+	UDestroyShaderProgram(scene.lampProgram);
+}
+
+//A worker context's view of a scene created on another context of its share group. Programs, textures, and buffers
+//are shared; vertex arrays are not, so the worker makes its own in the scene layout.
+void UCreateSharedToolScene(const ToolScene& source, ToolScene& scene) {
+	scene = source;
+	glGenBuffers(1, &scene.uniformBuffer);
+	scene.vao = UCreateLayoutVertexArray<SceneVertexLayout>();
+}
+
+void UDestroySharedToolScene(ToolScene& scene) {
+	glDeleteBuffers(1, &scene.uniformBuffer);
+	glDeleteVertexArrays(1, &scene.vao);
+}
+
+//The frame block comes first in the buffer, then one object block per scene object and the lamp's
+void UWriteToolSceneUniforms(ToolScene& scene, const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPosition, glm::vec3 lightPosition,
+	glm::vec3 lightColor, float lightIntensity) {
+	FrameUniforms frameUniforms;
+	frameUniforms.view = view;
+	frameUniforms.projection = projection;
+	frameUniforms.objectColor = keyObjectColor;
+	frameUniforms.specIntensity = lightIntensity;
+	frameUniforms.lightColor = lightColor;
+	frameUniforms.lightPosition = lightPosition;
+	frameUniforms.viewPosition = viewPosition;
+	frameUniforms.shadowFarPlane = 0.0f;
+	memcpy(scene.uniforms.data(), &frameUniforms, sizeof(frameUniforms));
+
+	const size_t objectCount = sizeof(gSceneObjects) / sizeof(gSceneObjects[0]);
+	for (size_t i = 0; i < objectCount; ++i) {
+		const SceneObject& sceneObject = gSceneObjects[i];
+		ObjectUniforms objectUniforms;
+		objectUniforms.model = USceneObjectModel(sceneObject);
+		objectUniforms.normalMatrix = glm::transpose(glm::inverse(objectUniforms.model));
+		objectUniforms.uvScale = sceneObject.uvScale;
+		memcpy(scene.uniforms.data() + scene.objectStride * (i + 1), &objectUniforms, sizeof(objectUniforms));
+	}
+	ObjectUniforms lampUniforms;
+	lampUniforms.model = glm::translate(lightPosition) * glm::scale(keyLightScale);
+	lampUniforms.normalMatrix = glm::mat4(1.0f);
+	lampUniforms.uvScale = glm::vec2(1.0f, 1.0f);
+	memcpy(scene.uniforms.data() + scene.objectStride * (objectCount + 1), &lampUniforms, sizeof(lampUniforms));
+
+	glBindBuffer(GL_UNIFORM_BUFFER, scene.uniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)scene.uniforms.size(), scene.uniforms.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+//Recreates the target's storage when the size changes
+void UResizeToolTarget(ToolTarget& target, int width, int height) {
+	if (target.framebuffer && target.width == width && target.height == height)
+		return;
+	if (!target.framebuffer) {
+		glGenFramebuffers(1, &target.framebuffer);
+		glGenRenderbuffers(2, target.renderbuffers);
+	}
+	target.width = width;
+	target.height = height;
+	glBindRenderbuffer(GL_RENDERBUFFER, target.renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.renderbuffers[1]);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void UDestroyToolTarget(ToolTarget& target) {
+	glDeleteFramebuffers(1, &target.framebuffer);
+	glDeleteRenderbuffers(2, target.renderbuffers);
+	target = ToolTarget();
+}
+
+//Draws the scene into an offscreen target with the lit and lamp programs, the way UDrawScene does
+void UDrawToolScene(const ToolScene& scene, const ToolTarget& target) {
+
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glViewport(0, 0, target.width, target.height);
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, scene.uniformBuffer, 0, sizeof(FrameUniforms));
+	glUseProgram(scene.litProgram);
+	glActiveTexture(GL_TEXTURE0 + LIGHTMAP_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, scene.lightmap);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindVertexArray(scene.vao);
+	UBindLightmapCoordinates(scene.vao, 0, mesh.neutralCoordinates);
+	const size_t objectCount = sizeof(gSceneObjects) / sizeof(gSceneObjects[0]);
+	for (size_t i = 0; i < objectCount; ++i) {
+		UBindMeshBuffers(scene.vao, gDrawSources[i].buffers);
+		glBindTexture(GL_TEXTURE_2D, scene.textures[gDrawSources[i].material]);
+		glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, scene.uniformBuffer, scene.objectStride * (i + 1), sizeof(ObjectUniforms));
+		glDrawElements(GL_TRIANGLES, *UMeshIndexCount(mesh, gSceneObjects[i].meshIndex), GL_UNSIGNED_SHORT, NULL);
+	}
+
+	glUseProgram(scene.lampProgram);
+	UBindMeshBuffers(scene.vao, &mesh.vbos[4]);
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, scene.uniformBuffer, scene.objectStride * (objectCount + 1), sizeof(ObjectUniforms));
+	glDrawElements(GL_TRIANGLES, mesh.lamp_N_indices, GL_UNSIGNED_SHORT, NULL);
+	glBindVertexArray(0);
+}
+
+//--bench-raster [--frames N] [--max-threads N] [--out dir]
+//Draws the opening view at 800x600 and 3840x2160 with the GL driver (llvmpipe on a server without a GPU) and with
+//the software rasterizer on 1, 2, 4, ... threads, and compares the two images. --out writes the software frames.
+int UBenchSoftwareRaster(int argc, char* argv[]) {
+	int frames = (int)UArgValue(argc, argv, "--frames", 20.0);
+	unsigned maxThreads = (unsigned)std::max(1.0, UArgValue(argc, argv, "--max-threads", (double)std::max(1u, std::thread::hardware_concurrency())));
+	const char* outputDir = UArgString(argc, argv, "--out");
+
+	GLFWwindow* benchWindow = UCreateToolContext();
+	if (!benchWindow)
 		return EXIT_FAILURE;
-	
 
-	//Load texture
-	const char* brickTexFileName = "../../Final_3D_Scene/Eraser_Texture.jpg";
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+	UInitializeScene(gSceneInstances, gDrawSources);
+
+	SoftwareRasterizer rasterizer;
+	ULoadSoftwareTextures(rasterizer);
+	if (!UReadBackSoftwareMeshes(rasterizer)) {
+		LOG_ERROR("ERROR::SOFTWARE::MESH_READBACK_FAILED");
+		UDestroyMesh(mesh);
+		glfwDestroyWindow(benchWindow);
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	//The GL side: the same programs, textures, and constant ambient the window draws with
+	ToolScene scene;
+	UCreateToolScene(scene);
+	ToolTarget target;
+	const size_t objectCount = sizeof(gSceneObjects) / sizeof(gSceneObjects[0]);
+
+	std::cout << "INFO: Software rasterizer vs " << (const char*)glGetString(GL_RENDERER) << ", " << frames << " frames per run" << std::endl;
+
+	const int sizes[2][2] = { { 800, 600 }, { 3840, 2160 } };
+	for (const int* size : sizes) {
+		int width = size[0];
+		int height = size[1];
+
+		//Opening view: the camera's starting pose and the lamp at the start of its orbit
+		glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.WorldUp);
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+
+		UWriteToolSceneUniforms(scene, view, projection, camera.Position, KEY_LIGHT_START, keyLightColor, keyLightIntensity);
+
+		std::vector<int> instances;
+		std::vector<glm::mat4> models;
+		for (size_t i = 0; i < objectCount; ++i) {
+			instances.push_back((int)i);
+			models.push_back(USceneObjectModel(gSceneObjects[i]));
+		}
+
+		SoftwareFrame frame;
+		UBuildSoftwareFrame(frame, view, projection, camera.Position, KEY_LIGHT_START, instances.data(), instances.size(), models.data());
+
+		//GL: an offscreen target of the same size; glFinish brackets the frames so the driver's work is counted
+		UResizeToolTarget(target, width, height);
+		for (int i = 0; i < 2; ++i)
+			UDrawToolScene(scene, target);
+		glFinish();
+		auto glStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < frames; ++i)
+			UDrawToolScene(scene, target);
+		glFinish();
+		double glMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - glStart).count() / frames;
+
+		std::vector<uint32_t> glImage((size_t)width * height);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, glImage.data());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		std::cout << "INFO: " << width << "x" << height << " GL: " << glMs << " ms/frame (" << 1000.0 / glMs << " fps)" << std::endl;
+
+		//Software: 1, 2, 4, ... threads, and every thread last
+		double singleThreadMs = 0.0;
+		for (unsigned threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ? maxThreads : threads * 2) {
+			UStartSoftwareRasterizer(rasterizer, threads);
+			USetSoftwareTarget(rasterizer, width, height);
+			for (int i = 0; i < 2; ++i)
+				URasterizeFrame(rasterizer, frame);
+
+			uint64_t triangles, blocks, hierarchicalCulls, pixels;
+			UReadSoftwareStats(rasterizer, triangles, blocks, hierarchicalCulls, pixels);
+			auto softwareStart = std::chrono::steady_clock::now();
+			for (int i = 0; i < frames; ++i)
+				URasterizeFrame(rasterizer, frame);
+			double softwareMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - softwareStart).count() / frames;
+			UReadSoftwareStats(rasterizer, triangles, blocks, hierarchicalCulls, pixels);
+			UStopSoftwareRasterizer(rasterizer);
+
+			if (threads == 1)
+				singleThreadMs = softwareMs;
+			std::cout << "INFO:   software " << threads << " threads: " << softwareMs << " ms/frame (" << 1000.0 / softwareMs << " fps), "
+				<< singleThreadMs / softwareMs << "x one thread, " << glMs / softwareMs << "x GL; " << triangles / frames << " triangles, "
+				<< pixels / frames << " pixels shaded, " << (blocks ? 100.0 * hierarchicalCulls / blocks : 0.0) << "% blocks depth culled" << std::endl;
+		}
+
+		//Same picture: mean channel difference and the share of pixels that differ visibly
+		double difference = 0.0;
+		size_t differing = 0;
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				uint32_t a = glImage[(size_t)y * width + x];
+				uint32_t b = rasterizer.color[(size_t)y * rasterizer.stride + x];
+				int largest = 0;
+				for (int c = 0; c < 3; ++c) {
+					int channel = std::abs((int)((a >> (c * 8)) & 0xFF) - (int)((b >> (c * 8)) & 0xFF));
+					difference += channel;
+					largest = std::max(largest, channel);
+				}
+				differing += largest > 8 ? 1 : 0;
+			}
+		}
+		std::cout << "INFO:   software vs GL: mean channel difference " << difference / ((double)width * height * 3) << ", "
+			<< 100.0 * differing / ((double)width * height) << "% pixels off by more than 8" << std::endl;
+
+		if (outputDir)
+			UWriteSoftwareImage(rasterizer, std::string(outputDir) + "/software_" + std::to_string(width) + "x" + std::to_string(height) + ".ppm");
+	}
+
+	UDestroyToolTarget(target);
+	UDestroyToolScene(scene);
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(benchWindow);
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
+
+//--bench-pick [--mesh file.obj|file.mesh] [--copies N] [--rays N] [--threads N]
+//Ray query throughput over a copies x copies grid of the scene, or of an imported mesh with --mesh (an OBJ is converted
+//the way --pack converts it). Rays are unprojected from the pixels of an 800x600 view over the grid, then traced on one
+//thread and on --threads (every core by default) through the job system.
+int UBenchRayQueries(int argc, char* argv[]) {
+	int copies = std::max(1, (int)UArgValue(argc, argv, "--copies", 32.0));
+	size_t rayCount = (size_t)std::max(1.0, UArgValue(argc, argv, "--rays", 1000000.0));
+	unsigned threads = std::max(1u, (unsigned)UArgValue(argc, argv, "--threads", (double)std::max(1u, std::thread::hardware_concurrency())));
+	const char* meshPath = UArgString(argc, argv, "--mesh");
+
+	//The meshes, and where one copy places them
+	std::vector<std::vector<float>> vertices;
+	std::vector<std::vector<uint32_t>> indices;
+	std::vector<std::pair<int, glm::mat4>> placements;
+	if (meshPath) {
+		std::vector<unsigned char> bytes, blob;
+		vertices.resize(1);
+		indices.resize(1);
+		bool loaded = UReadFile(meshPath, bytes);
+		if (loaded && UEndsWith(UNormalizeAssetName(meshPath), ".obj"))
+			loaded = UImportObj(bytes, blob);
+		else
+			blob.swap(bytes);
+		if (!loaded || !UDecodeMeshBlob(blob.data(), blob.size(), vertices[0], indices[0])) {
+			LOG_ERROR("ERROR::RAYQUERY::MESH_LOAD_FAILED %s", meshPath);
+			return EXIT_FAILURE;
+		}
+		placements.push_back(std::make_pair(0, glm::mat4(1.0f)));
+	}
+	else {
+		GLFWwindow* benchWindow = UCreateToolContext();
+		if (!benchWindow)
+			return EXIT_FAILURE;
+
+		UOpenAssets(argv[0]);
+		UCreateMesh(mesh);
+		vertices.resize(5);
+		indices.resize(5);
+		bool readBack = true;
+		for (int i = 0; i < 5; ++i)
+			readBack = UReadBackMesh(mesh.vbos[i * 2], mesh.vbos[i * 2 + 1], *UMeshIndexCount(mesh, i), vertices[i], indices[i]) && readBack;
+		UDestroyMesh(mesh);
+		glfwDestroyWindow(benchWindow);
+		glfwTerminate();
+		if (!readBack) {
+			LOG_ERROR("ERROR::RAYQUERY::MESH_READBACK_FAILED");
+			return EXIT_FAILURE;
+		}
 
-	if (!CreateTexture(brickTexFileName, texture1)) {
+		for (const SceneObject& sceneObject : gSceneObjects) {
+			placements.push_back(std::make_pair(sceneObject.meshIndex, USceneObjectModel(sceneObject)));
+		}
+	}
 
-		cout << "Failed to load texture " << brickTexFileName << endl;
+	RayQueryScene scene;
+	scene.meshes.resize(vertices.size());
+	size_t meshTriangles = 0;
+	auto blasStart = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		UBuildRayQueryMesh(scene.meshes[i], vertices[i], indices[i]);
+		meshTriangles += scene.meshes[i].blas.triangles.size();
+	}
+	double blasMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - blasStart).count();
+
+	//Copies are spaced by the footprint of one
+	BvhBounds copyBounds;
+	for (const auto& placement : placements)
+		UAddRayQueryInstance(scene, 0, placement.first, placement.second);
+	for (const RayQueryInstance& instance : scene.instances)
+		UGrowBounds(copyBounds, instance.bounds);
+	UClearRayQueryInstances(scene);
+	glm::vec3 copyExtent = copyBounds.maximum - copyBounds.minimum;
+	float spacing = std::max(std::max(copyExtent.x, copyExtent.z) * 1.25f, 1e-3f);
+
+	size_t instancedTriangles = 0;
+	for (int z = 0; z < copies; ++z) {
+		for (int x = 0; x < copies; ++x) {
+			glm::mat4 offset = glm::translate(glm::vec3(x * spacing, 0.0f, z * spacing));
+			for (size_t p = 0; p < placements.size(); ++p) {
+				UAddRayQueryInstance(scene, (int)((z * copies + x) * placements.size() + p), placements[p].first, offset * placements[p].second);
+				instancedTriangles += scene.meshes[placements[p].first].blas.triangles.size();
+			}
+		}
+	}
+	auto tlasStart = std::chrono::steady_clock::now();
+	UBuildTlas(scene);
+	double tlasMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tlasStart).count();
+	if (scene.tlas.empty()) {
+		LOG_ERROR("ERROR::RAYQUERY::EMPTY_SCENE");
 		return EXIT_FAILURE;
 	}
 
-	//Load texture
-	const char* tableTexFileName = "../../Final_3D_Scene/Table_Texture.jpg";
+	//A view from above and in front of the grid, covering all of it
+	const int width = 800;
+	const int height = 600;
+	glm::vec3 gridMin = scene.tlas[0].boundsMin, gridMax = scene.tlas[0].boundsMax;
+	glm::vec3 center = (gridMin + gridMax) * 0.5f;
+	float size = glm::length(gridMax - gridMin);
+	glm::mat4 view = glm::lookAt(center + glm::vec3(0.0f, 0.6f, 0.8f) * size, center, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, size * 4.0f);
+	std::vector<glm::vec3> origins(rayCount), directions(rayCount);
+	for (size_t i = 0; i < rayCount; ++i) {
+		size_t pixel = i % ((size_t)width * height);
+		UUnprojectCursor(pixel % width + 0.5, pixel / width + 0.5, width, height, view, projection, origins[i], directions[i]);
+	}
+
+	std::cout << "INFO: Ray queries: " << vertices.size() << " meshes, " << meshTriangles << " triangles in BLASes; " << scene.instances.size()
+		<< " instances, " << instancedTriangles << " instanced triangles" << std::endl;
+	std::cout << "INFO:   BLAS build " << blasMs << " ms, TLAS build " << tlasMs << " ms" << std::endl;
 
-	if (!CreateTexture(tableTexFileName, texture2)) {
+	uint64_t hits = 0;
+	auto singleStart = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < rayCount; ++i) {
+		RayHit hit;
+		hits += URayQuery(scene, origins[i], directions[i], hit) ? 1 : 0;
+	}
+	double singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - singleStart).count();
+	std::cout << "INFO:   1 thread: " << rayCount / singleSeconds << " rays/s (" << 1e6 * singleSeconds / rayCount << " us/ray), "
+		<< 100.0 * hits / rayCount << "% hit" << std::endl;
+
+	if (threads > 1) {
+		FrameArena arena;
+		UCreateFrameArena(arena, RAY_QUERY_ARENA_SIZE);
+		JobSystem system;
+		UStartJobSystem(system, threads - 1, arena);
+
+		std::atomic<uint64_t> parallelHits{ 0 };
+		auto parallelStart = std::chrono::steady_clock::now();
+		UWaitForJob(system, UParallelFor(system, rayCount, 1024,
+			[&](size_t begin, size_t end) {
+				uint64_t jobHits = 0;
+				for (size_t i = begin; i < end; ++i) {
+					RayHit hit;
+					jobHits += URayQuery(scene, origins[i], directions[i], hit) ? 1 : 0;
+				}
+				parallelHits += jobHits;
+			}));
+		UResetJobs(system);
+		double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parallelStart).count();
+		UStopJobSystem(system);
+		UDestroyFrameArena(arena);
+
+		std::cout << "INFO:   " << threads << " threads: " << rayCount / parallelSeconds << " rays/s, " << singleSeconds / parallelSeconds
+			<< "x one thread" << (parallelHits == hits ? "" : " (HIT COUNT DIFFERS)") << std::endl;
+	}
+	return EXIT_SUCCESS;
+}
 
-		cout << "Failed to load texture " << tableTexFileName << endl;
+//-------------------------------------FRAME SERVER------------------------------------------
+//One connected viewer of --serve
+struct ServerClient {
+	FrameSocket socket = INVALID_FRAME_SOCKET;
+	TileEncoder encoder;				//What the viewer has on screen
+	bool pending = false;				//A view request is waiting for its frame
+	ViewRequest request;
+	MessageReader reader;				//Commands, read without blocking
+	std::vector<unsigned char> payload;
+	std::vector<unsigned char> message;
+};
+
+//A view rendered at one state of the scene, kept for any viewer that asks for the same one
+struct ServerRender {
+	glm::vec3 position;
+	glm::vec3 front;
+	float zoom = 0.0f;
+	int width = 0;
+	int height = 0;
+	float lampOrbitAngle = 0.0f;
+	uint64_t renderNanoseconds = 0;
+	std::vector<unsigned char> pixels;		//RGBA, bottom row first
+};
+
+const double SERVER_STEP = 1.0 / 60.0;		//Scene steps per second while serving
+const size_t SERVER_RENDER_CACHE = 8;
+
+//The camera a request asks for: its own pose, or the camera the viewers' input moves
+void UResolveView(const ViewRequest& request, glm::vec3& position, glm::vec3& front, float& zoom) {
+	if (!(request.flags & VIEW_POSE)) {
+		position = camera.Position;
+		front = camera.Front;
+		zoom = camera.Zoom;
+		return;
+	}
+	position = glm::vec3(request.position[0], request.position[1], request.position[2]);
+	front = glm::normalize(glm::vec3(cos(glm::radians(request.yaw)) * cos(glm::radians(request.pitch)), sin(glm::radians(request.pitch)),
+		sin(glm::radians(request.yaw)) * cos(glm::radians(request.pitch))));
+	zoom = request.zoom;
+}
+
+//--serve [address] [--exit-when-idle]
+//Headless renderer for thin clients (FrameServer.h). The scene advances in fixed steps; between steps the server waits
+//for commands and answers every pending view request. Requests for the same view at the same step share one render,
+//and a view that has not changed since it was last rendered is not drawn again. --exit-when-idle stops the server
+//once its last client has disconnected.
+int UServeFrames(int argc, char* argv[]) {
+	const char* address = argc > 2 && argv[2][0] != '-' ? argv[2] : FRAME_SERVER_ADDRESS;
+	bool exitWhenIdle = UHasArg(argc, argv, "--exit-when-idle");
+
+	GLFWwindow* serverWindow = UCreateToolContext();
+	if (!serverWindow)
+		return EXIT_FAILURE;
+	if (!UStartSockets()) {
+		glfwDestroyWindow(serverWindow);
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	FrameSocket listener = UOpenSocket(address, true);
+	if (listener == INVALID_FRAME_SOCKET) {
+		UStopSockets();
+		glfwDestroyWindow(serverWindow);
+		glfwTerminate();
 		return EXIT_FAILURE;
 	}
 
-	//Load texture
-	const char* padTexFileName = "../../Final_3D_Scene/Pad_Texture.jpg";
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+	UInitializeScene(gSceneInstances, gDrawSources);
+	ToolScene scene;
+	UCreateToolScene(scene);
+	ToolTarget target;
+	UCreateInput(gInput, glfwGetTime());
+	keyLightPosition = ULampPosition(gLampOrbitAngle);
+	LOG_INFO("INFO: Frame server on %s, rendering with %s", address, (const char*)glGetString(GL_RENDERER));
+
+	std::vector<ServerClient> clients;
+	std::vector<ServerRender> renders(SERVER_RENDER_CACHE);
+	size_t nextRender = 0;
+	double sceneTime = glfwGetTime();
+	bool served = false;
+
+	//Reported every few seconds while there are requests
+	uint64_t requests = 0;
+	uint64_t rendered = 0;
+	uint64_t superseded = 0;
+	uint64_t bytesSent = 0;
+	uint64_t rawBytes = 0;
+	uint64_t tilesSent = 0;
+	uint64_t tilesTotal = 0;
+	uint64_t renderNanoseconds = 0;
+	uint64_t encodeNanoseconds = 0;
+	double reportTime = sceneTime;
+
+	while (!(exitWhenIdle && served && clients.empty())) {
+
+		//Wait for commands until the next scene step is due
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(listener, &readable);
+		int highest = (int)listener;
+		for (const ServerClient& client : clients) {
+			FD_SET(client.socket, &readable);
+			highest = std::max(highest, (int)client.socket);
+		}
+		double wait = std::max(0.0, sceneTime + SERVER_STEP - glfwGetTime());
+		timeval timeout = { 0, (long)(wait * 1e6) };
+		if (select(highest + 1, &readable, NULL, NULL, &timeout) < 0)
+			break;
+
+		if (FD_ISSET(listener, &readable)) {
+			FrameSocket accepted = accept(listener, NULL, NULL);
+			if (accepted != INVALID_FRAME_SOCKET && clients.size() + 1 >= FD_SETSIZE) {
+				LOG_WARN("WARN: Frame server full, refusing a client");
+				UCloseSocket(accepted);
+			}
+			else if (accepted != INVALID_FRAME_SOCKET) {
+				USetNoDelay(accepted);
+				USetNonBlocking(accepted);
+				clients.emplace_back();
+				clients.back().socket = accepted;
+				served = true;
+				LOG_INFO("INFO: Frame server: client connected (%zu)", clients.size());
+			}
+		}
+
+		//Every whole message a client has sent so far; a message still arriving waits in its reader, and one stuck for
+		//FRAME_STALL_SECONDS drops the client instead of holding up the others
+		auto commandTime = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < clients.size(); ++i) {
+			ServerClient& client = clients[i];
+			bool valid = !FD_ISSET(client.socket, &readable) || UFillMessageReader(client.socket, client.reader);
+
+			FrameMessageHeader header;
+			bool broken = false;
+			while (valid && UTakeMessage(client.reader, header, client.payload, broken)) {
+				if (header.type == MESSAGE_VIEW && header.size == sizeof(ViewRequest)) {
+					superseded += client.pending ? 1 : 0;
+					memcpy(&client.request, client.payload.data(), sizeof(ViewRequest));
+					client.pending = client.request.width > 0 && client.request.height > 0 &&
+						client.request.width <= (uint32_t)FRAME_MAX_SIZE && client.request.height <= (uint32_t)FRAME_MAX_SIZE;
+				}
+				else if (header.type == MESSAGE_INPUT && header.size == sizeof(InputCommand)) {
+					InputCommand command;
+					memcpy(&command, client.payload.data(), sizeof(command));
+					InputEvent event = { (InputEventType)command.type, glfwGetTime(), command.key, command.action, command.x, command.y };
+					if (command.type >= INPUT_KEY && command.type <= INPUT_BUTTON)
+						UPushInputEvent(gInput, event);
+				}
+				else {
+					valid = false;
+				}
+			}
+			if (valid && !broken && UMessageStalled(client.reader, commandTime)) {
+				LOG_WARN("WARN: Frame server: dropping a client stuck mid-message");
+				valid = false;
+			}
+
+			if (!valid || broken) {
+				UCloseSocket(client.socket);
+				clients.erase(clients.begin() + i--);
+				LOG_INFO("INFO: Frame server: client disconnected (%zu)", clients.size());
+			}
+		}
+
+		//Advance the scene in fixed steps up to now, as the window's simulation does
+		double now = glfwGetTime();
+		for (int steps = 0; sceneTime + SERVER_STEP <= now; ++steps) {
+			if (steps == (int)(1.0 / SERVER_STEP)) {
+				sceneTime = now;
+				break;
+			}
+			sceneTime += SERVER_STEP;
+			UConsumeInput(gInput, sceneTime);
+			UUpdateCamera(gInput);
+			UUpdateScene(gInput, SERVER_STEP);
+		}
+
+		//Answer the pending requests
+		for (size_t i = 0; i < clients.size(); ++i) {
+			ServerClient& client = clients[i];
+			if (!client.pending)
+				continue;
+			client.pending = false;
+			++requests;
+
+			glm::vec3 position, front;
+			float zoom;
+			UResolveView(client.request, position, front, zoom);
+			int width = (int)client.request.width;
+			int height = (int)client.request.height;
+
+			ServerRender* render = nullptr;
+			for (ServerRender& candidate : renders) {
+				if (candidate.width == width && candidate.height == height && candidate.position == position && candidate.front == front &&
+					candidate.zoom == zoom && candidate.lampOrbitAngle == gLampOrbitAngle) {
+					render = &candidate;
+					break;
+				}
+			}
+
+			bool shared = render != nullptr;
+			if (!shared) {
+				render = &renders[nextRender];
+				nextRender = (nextRender + 1) % renders.size();
+				render->position = position;
+				render->front = front;
+				render->zoom = zoom;
+				render->width = width;
+				render->height = height;
+				render->lampOrbitAngle = gLampOrbitAngle;
+				render->pixels.resize((size_t)width * height * CAPTURE_READ_CHANNELS);
+
+				auto renderStart = std::chrono::steady_clock::now();
+				glm::mat4 view = glm::lookAt(position, position + front, camera.WorldUp);
+				glm::mat4 projection = glm::perspective(glm::radians(zoom), (float)width / (float)height, 0.1f, 100.0f);
+				UResizeToolTarget(target, width, height);
+				UWriteToolSceneUniforms(scene, view, projection, position, keyLightPosition, keyLightColor, keyLightIntensity);
+				UDrawToolScene(scene, target);
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, render->pixels.data());
+				glPixelStorei(GL_PACK_ALIGNMENT, 4);
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				render->renderNanoseconds = UNanosecondsSince(renderStart);
+				renderNanoseconds += render->renderNanoseconds;
+				++rendered;
+			}
+
+			auto encodeStart = std::chrono::steady_clock::now();
+			FrameHeader frame = {};
+			frame.sequence = client.request.sequence;
+			frame.width = (uint32_t)width;
+			frame.height = (uint32_t)height;
+			frame.tileSize = FRAME_TILE_SIZE;
+			frame.sentAt = client.request.sentAt;
+			frame.renderNanoseconds = shared ? 0 : render->renderNanoseconds;
+			bool keyframe = (client.request.flags & VIEW_KEYFRAME) || client.encoder.width != width || client.encoder.height != height;
+			frame.flags = (shared ? FRAME_SHARED : 0) | (keyframe ? FRAME_KEYFRAME : 0);
+
+			UBeginMessage(client.message, MESSAGE_FRAME);
+			client.message.resize(sizeof(FrameMessageHeader) + sizeof(FrameHeader));
+			frame.changedTiles = UEncodeTileDiff(client.encoder, render->pixels.data(), width, height, keyframe, client.message);
+			frame.encodeNanoseconds = UNanosecondsSince(encodeStart);
+			memcpy(client.message.data() + sizeof(FrameMessageHeader), &frame, sizeof(frame));
+			encodeNanoseconds += frame.encodeNanoseconds;
+
+			if (!USendMessage(client.socket, client.message)) {
+				UCloseSocket(client.socket);
+				clients.erase(clients.begin() + i--);
+				LOG_INFO("INFO: Frame server: client disconnected (%zu)", clients.size());
+				continue;
+			}
+			bytesSent += client.message.size();
+			rawBytes += (uint64_t)width * height * 3;
+			tilesSent += frame.changedTiles;
+			tilesTotal += (uint64_t)((width + FRAME_TILE_SIZE - 1) / FRAME_TILE_SIZE) * ((height + FRAME_TILE_SIZE - 1) / FRAME_TILE_SIZE);
+		}
+
+		if (requests > 0 && (now - reportTime >= 5.0 || (exitWhenIdle && served && clients.empty()))) {
+			LOG_INFO("INFO: Frame server: %llu frames (%llu rendered, %llu shared, %llu requests superseded), %.1f%% of tiles sent, "
+				"%.2f MB (%.1f%% of raw RGB), render %.2f ms, encode %.2f ms", (unsigned long long)requests, (unsigned long long)rendered,
+				(unsigned long long)(requests - rendered), (unsigned long long)superseded, 100.0 * tilesSent / std::max<uint64_t>(1, tilesTotal),
+				bytesSent / 1e6, 100.0 * bytesSent / std::max<uint64_t>(1, rawBytes), renderNanoseconds / 1e6 / std::max<uint64_t>(1, rendered),
+				encodeNanoseconds / 1e6 / requests);
+			requests = rendered = superseded = bytesSent = rawBytes = tilesSent = tilesTotal = renderNanoseconds = encodeNanoseconds = 0;
+			reportTime = now;
+		}
+	}
+
+	for (ServerClient& client : clients)
+		UCloseSocket(client.socket);
+	UCloseSocket(listener);
+	UStopSockets();
+	UStopInput(gInput);
+	UDestroyToolTarget(target);
+	UDestroyToolScene(scene);
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(serverWindow);
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
 
-	if (!CreateTexture(padTexFileName, texture3)) {
+//What one --frame-client viewer measured
+struct ViewerResults {
+	std::vector<double> latencies;		//Milliseconds from sending a request to having its frame decoded
+	double seconds = 0.0;
+	uint64_t bytes = 0;
+	uint64_t rawBytes = 0;
+	uint64_t tiles = 0;
+	uint64_t tilesTotal = 0;
+	uint64_t shared = 0;
+	double renderMs = 0.0;
+	double encodeMs = 0.0;
+	bool failed = false;
+	TileDecoder decoder;
+};
 
-		cout << "Failed to load texture " << padTexFileName << endl;
+//One viewer: requests 'frames' frames one at a time along a camera path and decodes them. 'path' offsets the path;
+//viewers with the same offset ask for the same views.
+void URunViewer(const char* address, int viewer, int frames, int width, int height, bool still, float path, ViewerResults& results) {
+	FrameSocket socket = UOpenSocket(address, false);
+	if (socket == INVALID_FRAME_SOCKET) {
+		results.failed = true;
+		return;
+	}
+
+	std::vector<unsigned char> message;
+	std::vector<unsigned char> payload;
+	results.latencies.reserve(frames);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames && !results.failed; ++i) {
+
+		//Halfway through, the first viewer presses 'L' to stop (or restart) the lamp
+		if (viewer == 0 && i == frames / 2) {
+			for (int action : { GLFW_PRESS, GLFW_RELEASE }) {
+				InputCommand command = { INPUT_KEY, GLFW_KEY_L, action, 0, 0.0, 0.0 };
+				UBeginMessage(message, MESSAGE_INPUT);
+				UAppendMessage(message, &command, sizeof(command));
+				results.failed = !USendMessage(socket, message) || results.failed;
+			}
+		}
+
+		//The window camera's starting pose, panning slowly across the desk unless --still
+		float t = still ? 0.0f : i * 0.01f + path;
+		ViewRequest request = {};
+		request.sequence = (uint32_t)i;
+		request.flags = VIEW_POSE;
+		request.width = (uint32_t)width;
+		request.height = (uint32_t)height;
+		request.position[0] = 0.5f * sin(t);
+		request.position[1] = 0.0f;
+		request.position[2] = 3.0f;
+		request.yaw = -90.0f + 15.0f * sin(t);
+		request.pitch = -5.0f * (1.0f - cos(t));
+		request.zoom = 45.0f;
+		request.sentAt = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		UBeginMessage(message, MESSAGE_VIEW);
+		UAppendMessage(message, &request, sizeof(request));
+		if (!USendMessage(socket, message)) {
+			results.failed = true;
+			break;
+		}
+
+		FrameMessageHeader header;
+		FrameHeader frame;
+		do {
+			if (!UReceiveMessage(socket, header, payload) || (header.type == MESSAGE_FRAME && header.size < sizeof(FrameHeader))) {
+				results.failed = true;
+				break;
+			}
+		} while (header.type != MESSAGE_FRAME);
+		if (results.failed)
+			break;
+		memcpy(&frame, payload.data(), sizeof(frame));
+		if (frame.sequence != request.sequence || !UDecodeTileDiff(results.decoder, frame, payload.data() + sizeof(frame), payload.size() - sizeof(frame))) {
+			LOG_ERROR("ERROR::CLIENT::BAD_FRAME %u", frame.sequence);
+			results.failed = true;
+			break;
+		}
+
+		uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		results.latencies.push_back((now - frame.sentAt) / 1e6);
+		results.bytes += sizeof(header) + header.size;
+		results.rawBytes += (uint64_t)width * height * 3;
+		results.tiles += frame.changedTiles;
+		results.tilesTotal += (uint64_t)((width + frame.tileSize - 1) / frame.tileSize) * ((height + frame.tileSize - 1) / frame.tileSize);
+		results.shared += (frame.flags & FRAME_SHARED) ? 1 : 0;
+		results.renderMs += frame.renderNanoseconds / 1e6;
+		results.encodeMs += frame.encodeNanoseconds / 1e6;
+	}
+	results.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	UCloseSocket(socket);
+}
+
+//--frame-client [address] [--viewers N] [--frames N] [--width N] [--height N] [--still] [--spread] [--out file.ppm]
+//Local test client for --serve: every viewer is a thread with its own connection that requests --frames frames, one at
+//a time, along the same camera path, so the server can share renders between them (--spread gives each its own path).
+//Reports the round trip from request to decoded frame, frame rate, and bandwidth; --out writes the first viewer's
+//last frame. --still keeps the camera still, so only the lamp changes tiles, until it is stopped halfway.
+int UFrameClient(int argc, char* argv[]) {
+	const char* address = argc > 2 && argv[2][0] != '-' ? argv[2] : FRAME_SERVER_ADDRESS;
+	int viewers = std::max(1, (int)UArgValue(argc, argv, "--viewers", 1.0));
+	int frames = std::max(1, (int)UArgValue(argc, argv, "--frames", 300.0));
+	int width = std::min(FRAME_MAX_SIZE, std::max(1, (int)UArgValue(argc, argv, "--width", (double)WINDOW_WIDTH)));
+	int height = std::min(FRAME_MAX_SIZE, std::max(1, (int)UArgValue(argc, argv, "--height", (double)WINDOW_HEIGHT)));
+	bool still = UHasArg(argc, argv, "--still");
+	bool spread = UHasArg(argc, argv, "--spread");
+	const char* outputPath = UArgString(argc, argv, "--out");
+
+	if (!UStartSockets())
 		return EXIT_FAILURE;
+
+	std::cout << "INFO: " << viewers << " viewers of " << address << ", " << frames << " frames of " << width << "x" << height
+		<< (still ? ", still camera" : "") << (spread ? ", separate paths" : "") << std::endl;
+
+	std::vector<ViewerResults> results(viewers);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < viewers; ++i)
+		threads.emplace_back(URunViewer, address, i, frames, width, height, still, spread ? i * 0.7f : 0.0f, std::ref(results[i]));
+	for (std::thread& thread : threads)
+		thread.join();
+	UStopSockets();
+
+	std::vector<double> latencies;
+	double seconds = 0.0;
+	uint64_t bytes = 0, rawBytes = 0, tiles = 0, tilesTotal = 0, shared = 0;
+	for (int i = 0; i < viewers; ++i) {
+		const ViewerResults& viewer = results[i];
+		if (viewer.failed || viewer.latencies.empty()) {
+			std::cout << "ERROR: viewer " << i << " failed after " << viewer.latencies.size() << " frames" << std::endl;
+			return EXIT_FAILURE;
+		}
+		size_t count = viewer.latencies.size();
+		std::cout << "INFO:   viewer " << i << ": " << count / viewer.seconds << " fps, " << viewer.bytes / 1024.0 / count << " KB/frame, "
+			<< viewer.bytes / 1e6 / viewer.seconds << " MB/s, server render " << viewer.renderMs / std::max<uint64_t>(1, count - viewer.shared)
+			<< " ms, encode " << viewer.encodeMs / count << " ms" << std::endl;
+		latencies.insert(latencies.end(), viewer.latencies.begin(), viewer.latencies.end());
+		seconds = std::max(seconds, viewer.seconds);
+		bytes += viewer.bytes;
+		rawBytes += viewer.rawBytes;
+		tiles += viewer.tiles;
+		tilesTotal += viewer.tilesTotal;
+		shared += viewer.shared;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	double mean = 0.0;
+	for (double latency : latencies)
+		mean += latency;
+	mean /= latencies.size();
+	std::cout << "INFO: Latency mean " << mean << " ms, median " << latencies[latencies.size() / 2] << " ms, 99th percentile "
+		<< latencies[latencies.size() * 99 / 100] << " ms, worst " << latencies.back() << " ms" << std::endl;
+	std::cout << "INFO: Bandwidth " << bytes / 1e6 / seconds << " MB/s for all viewers, " << 100.0 * bytes / rawBytes << "% of raw RGB, "
+		<< 100.0 * tiles / tilesTotal << "% of tiles sent, " << 100.0 * shared / latencies.size() << "% of frames shared" << std::endl;
+
+	if (outputPath) {
+		const TileDecoder& decoder = results[0].decoder;
+		FILE* file = fopen(outputPath, "wb");
+		if (!file) {
+			LOG_ERROR("ERROR::CLIENT::CANNOT_WRITE %s", outputPath);
+			return EXIT_FAILURE;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", decoder.width, decoder.height);
+		fwrite(decoder.image.data(), 1, decoder.image.size(), file);
+		fclose(file);
+	}
+	return EXIT_SUCCESS;
+}
+
+//-------------------------------------BATCH RENDER------------------------------------------
+//One --batch-render image: a camera pose as the window's camera keeps it, and the key light
+struct BatchShot {
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+	float zoom;
+	glm::vec3 lightPosition;
+	glm::vec3 lightColor;
+	float lightIntensity;
+};
+
+//One line per shot: x y z yaw pitch zoom [lightX lightY lightZ [red green blue [intensity]]]; '#' starts a comment.
+//The light defaults to the key light at its starting position.
+bool ULoadBatchShots(const char* path, std::vector<BatchShot>& shots) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		LOG_ERROR("ERROR::BATCH::CANNOT_OPEN %s", path);
+		return false;
+	}
+	char line[512];
+	int lineNumber = 0;
+	bool valid = true;
+	while (fgets(line, sizeof(line), file)) {
+		++lineNumber;
+		if (char* comment = strchr(line, '#'))
+			*comment = '\0';
+
+		BatchShot shot;
+		shot.lightPosition = KEY_LIGHT_START;
+		shot.lightColor = keyLightColor;
+		shot.lightIntensity = keyLightIntensity;
+		int fields = sscanf(line, "%f %f %f %f %f %f %f %f %f %f %f %f %f", &shot.position.x, &shot.position.y, &shot.position.z,
+			&shot.yaw, &shot.pitch, &shot.zoom, &shot.lightPosition.x, &shot.lightPosition.y, &shot.lightPosition.z,
+			&shot.lightColor.x, &shot.lightColor.y, &shot.lightColor.z, &shot.lightIntensity);
+		if (fields == EOF)
+			continue;
+		if (fields != 6 && fields != 9 && fields != 12 && fields != 13) {
+			LOG_ERROR("ERROR::BATCH::BAD_SHOT %s:%d", path, lineNumber);
+			valid = false;
+			continue;
+		}
+		shots.push_back(shot);
 	}
+	fclose(file);
+	return valid;
+}
 
-	//Load texture
-	const char* indexTexFileName = "../../Final_3D_Scene/Index_Texture.jpg";
+//--sweep N: a turntable around the desk, the lamp circling the other way
+void UBuildBatchSweep(size_t count, std::vector<BatchShot>& shots) {
+	const glm::vec3 target(0.0f, -0.7f, 0.5f);
+	for (size_t i = 0; i < count; ++i) {
+		float angle = glm::radians(360.0f) * (float)i / (float)count;
+		BatchShot shot;
+		shot.position = target + glm::vec3(4.0f * sin(angle), 1.5f + 0.5f * sin(3.0f * angle), 4.0f * cos(angle));
+		glm::vec3 front = glm::normalize(target - shot.position);
+		shot.yaw = glm::degrees(atan2(front.z, front.x));
+		shot.pitch = glm::degrees(asin(front.y));
+		shot.zoom = 45.0f;
+		shot.lightPosition = ULampPosition(-angle);
+		shot.lightColor = keyLightColor;
+		shot.lightIntensity = keyLightIntensity;
+		shots.push_back(shot);
+	}
+}
 
-	if (!CreateTexture(indexTexFileName, texture4)) {
+//What one worker context did in a run
+struct BatchWorker {
+	GLFWwindow* context = nullptr;
+	size_t images = 0;
+	double waitSeconds = 0.0;			//Blocked on a readback fence
+	double encodeSeconds = 0.0;
+	bool failed = false;
+};
+
+//Worker thread: takes the next shot until none are left. Each shot is read back into one of two pack buffers, so the
+//previous shot is encoded and written while the context renders this one.
+void UBatchRenderWorker(BatchWorker& worker, const ToolScene& shared, const std::vector<BatchShot>& shots, std::atomic<size_t>& nextShot,
+	int width, int height, bool png, const char* outputDir) {
+
+	glfwMakeContextCurrent(worker.context);
+	ToolScene scene;
+	UCreateSharedToolScene(shared, scene);
+	ToolTarget target;
+	UResizeToolTarget(target, width, height);
+
+	const GLsizeiptr imageBytes = (GLsizeiptr)width * height * CAPTURE_READ_CHANNELS;
+	GLuint packBuffers[2] = {};
+	GLsync fences[2] = {};
+	size_t inFlight[2] = { SIZE_MAX, SIZE_MAX };
+	glGenBuffers(2, packBuffers);
+	for (GLuint buffer : packBuffers) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, imageBytes, NULL, GL_STREAM_READ);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	PngScratch scratch;
+	std::vector<unsigned char> encoded;
+	char path[1024];
+	for (int slot = 0; ; slot ^= 1) {
+		size_t shotIndex = nextShot.fetch_add(1);
+		if (shotIndex < shots.size()) {
+			const BatchShot& shot = shots[shotIndex];
+			glm::vec3 front = glm::normalize(glm::vec3(cos(glm::radians(shot.yaw)) * cos(glm::radians(shot.pitch)), sin(glm::radians(shot.pitch)),
+				sin(glm::radians(shot.yaw)) * cos(glm::radians(shot.pitch))));
+			glm::mat4 view = glm::lookAt(shot.position, shot.position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 projection = glm::perspective(glm::radians(shot.zoom), (float)width / (float)height, 0.1f, 100.0f);
+			UWriteToolSceneUniforms(scene, view, projection, shot.position, shot.lightPosition, shot.lightColor, shot.lightIntensity);
+			UDrawToolScene(scene, target);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[slot]);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+			inFlight[slot] = shotIndex;
+		}
 
-		cout << "Failed to load texture " << indexTexFileName << endl;
+		//Finish the shot started last time round
+		int previous = slot ^ 1;
+		if (inFlight[previous] != SIZE_MAX) {
+			auto waitStart = std::chrono::steady_clock::now();
+			glClientWaitSync(fences[previous], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(fences[previous]);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[previous]);
+			const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, imageBytes, GL_MAP_READ_BIT);
+			auto encodeStart = std::chrono::steady_clock::now();
+			worker.waitSeconds += std::chrono::duration<double>(encodeStart - waitStart).count();
+
+			if (!pixels) {
+				worker.failed = true;
+			}
+			else {
+				if (png)
+					UEncodePng(pixels, width, height, scratch, encoded);
+				else
+					UEncodeQoi(pixels, width, height, encoded);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				if (outputDir) {
+					snprintf(path, sizeof(path), "%s/shot_%06zu.%s", outputDir, inFlight[previous], png ? "png" : "qoi");
+					worker.failed = !UWriteCaptureFile(path, encoded) || worker.failed;
+				}
+				++worker.images;
+			}
+			worker.encodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count();
+			inFlight[previous] = SIZE_MAX;
+		}
+		if (inFlight[slot] == SIZE_MAX && shotIndex >= shots.size())
+			break;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glDeleteBuffers(2, packBuffers);
+	UDestroyToolTarget(target);
+	UDestroySharedToolScene(scene);
+	glFinish();
+	glfwMakeContextCurrent(NULL);
+}
+
+//--batch-render <shots.txt> | --sweep N  [--out dir] [--format qoi|png] [--width N] [--height N] [--workers N] [--scaling]
+//Renders a list of shots (ULoadBatchShots) to numbered images. The meshes, textures, and programs are loaded once on
+//this thread's context; each worker is a thread with a hidden context in its share group that takes the next shot as
+//soon as it is free, so no context idles while shots are left. Without --out the images are encoded but not written.
+//--scaling renders the whole list with 1, 2, 4, ... workers up to --workers (every core by default) and compares.
+int UBatchRender(int argc, char* argv[]) {
+	const char* shotsPath = argc > 2 && argv[2][0] != '-' ? argv[2] : nullptr;
+	size_t sweep = (size_t)std::max(0.0, UArgValue(argc, argv, "--sweep", 0.0));
+	const char* outputDir = UArgString(argc, argv, "--out");
+	const char* format = UArgString(argc, argv, "--format");
+	bool png = format && strcmp(format, "png") == 0;
+	int width = std::min(FRAME_MAX_SIZE, std::max(1, (int)UArgValue(argc, argv, "--width", (double)WINDOW_WIDTH)));
+	int height = std::min(FRAME_MAX_SIZE, std::max(1, (int)UArgValue(argc, argv, "--height", (double)WINDOW_HEIGHT)));
+	int maxWorkers = std::max(1, (int)UArgValue(argc, argv, "--workers", (double)std::max(1u, std::thread::hardware_concurrency())));
+	bool scaling = UHasArg(argc, argv, "--scaling");
+
+	std::vector<BatchShot> shots;
+	if (shotsPath && !ULoadBatchShots(shotsPath, shots))
+		return EXIT_FAILURE;
+	UBuildBatchSweep(sweep, shots);
+	if (shots.empty()) {
+		std::cout << "ERROR: no shots; pass a shot list or --sweep N" << std::endl;
 		return EXIT_FAILURE;
 	}
 
-	//Tells OpenGL which sampler texture unit it belongs to(need only be done once)
-	glUseProgram(programID);
+	//Load once: the meshes, textures, and programs live in the share group of this context
+	auto loadStart = std::chrono::steady_clock::now();
+	GLFWwindow* loadWindow = UCreateToolContext();
+	if (!loadWindow)
+		return EXIT_FAILURE;
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+	UInitializeScene(gSceneInstances, gDrawSources);
+	ToolScene scene;
+	UCreateToolScene(scene);
+	glFinish();
+	double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+	//GLFW creates windows on the main thread only; the workers make them current on theirs
+	std::vector<BatchWorker> workers(maxWorkers);
+	for (BatchWorker& worker : workers) {
+		worker.context = glfwCreateWindow(64, 64, WINDOW_TITLE, NULL, loadWindow);
+		if (!worker.context) {
+			LOG_ERROR("ERROR::BATCH::SHARED_CONTEXT_FAILED");
+			maxWorkers = (int)(&worker - workers.data());
+			break;
+		}
+	}
+	workers.resize(std::max(1, maxWorkers));
+
+	std::cout << "INFO: Batch render of " << shots.size() << " shots at " << width << "x" << height << " (" << (png ? "PNG" : "QOI") << ") with "
+		<< (const char*)glGetString(GL_RENDERER) << "; scene loaded once in " << loadMs << " ms" << std::endl;
+
+	bool failed = !workers[0].context;
+	double oneWorkerRate = 0.0;
+	for (int count = scaling ? 1 : maxWorkers; count <= maxWorkers && !failed; count = count * 2 > maxWorkers && count < maxWorkers ? maxWorkers : count * 2) {
+		std::atomic<size_t> nextShot{ 0 };
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (int i = 0; i < count; ++i) {
+			workers[i].images = 0;
+			workers[i].waitSeconds = 0.0;
+			workers[i].encodeSeconds = 0.0;
+			threads.emplace_back(UBatchRenderWorker, std::ref(workers[i]), std::cref(scene), std::cref(shots), std::ref(nextShot), width, height, png, outputDir);
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		size_t images = 0;
+		double waitSeconds = 0.0;
+		double encodeSeconds = 0.0;
+		for (int i = 0; i < count; ++i) {
+			images += workers[i].images;
+			waitSeconds += workers[i].waitSeconds;
+			encodeSeconds += workers[i].encodeSeconds;
+			failed = workers[i].failed || failed;
+		}
+		double rate = images / seconds;
+		if (oneWorkerRate == 0.0)
+			oneWorkerRate = rate;
+		std::cout << "INFO:   " << count << " workers: " << images << " images in " << seconds << " s, " << rate << " images/s, "
+			<< rate / oneWorkerRate << "x the first run; per image " << 1000.0 * encodeSeconds / std::max<size_t>(1, images) << " ms encoding, "
+			<< 1000.0 * waitSeconds / std::max<size_t>(1, images) << " ms waiting on readback" << std::endl;
+	}
 
-	//Sets the exture as texture unit 0
-	glUniform1i(glGetUniformLocation(programID, "Texture"), 0);
+	for (BatchWorker& worker : workers) {
+		if (worker.context)
+			glfwDestroyWindow(worker.context);
+	}
+	UDestroyToolScene(scene);
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(loadWindow);
+	glfwTerminate();
+	if (failed)
+		LOG_ERROR("ERROR::BATCH::RENDER_FAILED");
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-	//sets background color of window to black
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+//--bench-particles [--max N] [--frames N] [--width N] [--height N] [--out dir]
+//Runs the dust at 1K, 10K, 100K, ... particles up to --max (1M by default) in the opening view of the scene at
+//60 updates a second. The update and the billboards are timed apart with GL queries; the CPU time is what it takes
+//to issue them. The live count is read back once per run, after the timing. --out writes each run's last frame as PNG.
+int UBenchParticles(int argc, char* argv[]) {
+	GLuint maxCount = (GLuint)std::min(UArgValue(argc, argv, "--max", 1000000.0), (double)PARTICLE_MAX_CAPACITY);
+	int frames = std::max(1, (int)UArgValue(argc, argv, "--frames", 120.0));
+	int width = (int)UArgValue(argc, argv, "--width", 1280.0);
+	int height = (int)UArgValue(argc, argv, "--height", 720.0);
+	const char* outputDir = UArgString(argc, argv, "--out");
+
+	GLFWwindow* benchWindow = UCreateToolContext();
+	if (!benchWindow)
+		return EXIT_FAILURE;
 
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+	UInitializeScene(gSceneInstances, gDrawSources);
+
+	ToolScene scene;
+	UCreateToolScene(scene);
+	ToolTarget target;
+	UResizeToolTarget(target, width, height);
+
+	glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.WorldUp);
+	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+	//The lamp half way round its orbit, where the dust is in view
+	glm::vec3 light = ULampPosition(glm::radians(180.0f));
+	UWriteToolSceneUniforms(scene, view, projection, camera.Position, light, keyLightColor, keyLightIntensity);
+
+	GLuint queries[2];
+	glGenQueries(2, queries);
+	std::cout << "INFO: Particles on " << (const char*)glGetString(GL_RENDERER) << ", " << width << "x" << height << ", " << frames << " frames per run" << std::endl;
+
+	bool failed = false;
+	const float step = 1.0f / 60.0f;
+	for (GLuint count = 1000; count <= maxCount && !failed; count = count * 10 > maxCount && count < maxCount ? maxCount : count * 10) {
+		ParticleSystem particles;
+		if (!UCreateParticleSystem(particles, count)) {
+			failed = true;
+			break;
+		}
 
-	//render loop
-	while (!glfwWindowShouldClose(window)) {
+		//A second of warm-up past the initial fill, so emission and deaths are in balance
+		for (int i = 0; i < 60; ++i)
+			UUpdateParticles(particles, step, light);
+		glFinish();
+
+		double updateMs = 0.0;
+		double drawMs = 0.0;
+		double cpuMs = 0.0;
+		for (int i = 0; i < frames; ++i) {
+			UDrawToolScene(scene, target);
+
+			auto cpuStart = std::chrono::steady_clock::now();
+			glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+			UUpdateParticles(particles, step, light);
+			glEndQuery(GL_TIME_ELAPSED);
+			glBeginQuery(GL_TIME_ELAPSED, queries[1]);
+			UDrawParticles(particles);
+			glEndQuery(GL_TIME_ELAPSED);
+			cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+
+			GLuint64 updateNanoseconds = 0;
+			GLuint64 drawNanoseconds = 0;
+			glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &updateNanoseconds);
+			glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &drawNanoseconds);
+			updateMs += updateNanoseconds / 1e6;
+			drawMs += drawNanoseconds / 1e6;
+		}
 
-		//per-frame timing
-		//-----------------------
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+		GLuint live = UReadParticleCount(particles);
+		std::cout << "INFO:   " << count << " particles: update " << updateMs / frames << " ms, draw " << drawMs / frames << " ms, CPU "
+			<< cpuMs / frames << " ms per frame; " << live << " alive (" << 100.0 * live / count << "%)" << std::endl;
+		if (live > count) {
+			LOG_ERROR("ERROR::PARTICLES::COUNT_PAST_CAPACITY %u", live);
+			failed = true;
+		}
+
+		if (outputDir) {
+			std::vector<unsigned char> pixels((size_t)width * height * CAPTURE_READ_CHANNELS);
+			std::vector<unsigned char> png;
+			PngScratch scratch;
+			glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			UEncodePng(pixels.data(), width, height, scratch, png);
+			UWriteCaptureFile((std::string(outputDir) + "/particles_" + std::to_string(count) + ".png").c_str(), png);
+		}
+		UDestroyParticleSystem(particles);
+	}
+
+	glDeleteQueries(2, queries);
+	UDestroyToolTarget(target);
+	UDestroyToolScene(scene);
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(benchWindow);
+	glfwTerminate();
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//--bench-draws [objects] [frames] [threads]
+//Records, merges, and submits the synthetic scene's visible draws with 1..N job threads, as a frame does: the
+//recorders write the object blocks into the ring buffer and the merged list goes through the direct render device
+//on a hidden window's context. The synthetic boxes are drawn with the scene's meshes and textures in turn. Per
+//thread count the bench reports recording, merge+sort, the device's CPU submit time and GL calls, the time spent
+//waiting for a ring segment, and the whole frame; the speedup is of record + merge + submit over one thread.
+int UBenchDraws(int argc, char* argv[]) {
+	size_t objectCount = argc > 2 ? (size_t)atol(argv[2]) : 100000;
+	int frames = std::max(1, argc > 3 ? atoi(argv[3]) : 100);
+	unsigned maxThreads = argc > 4 ? (unsigned)std::max(1, atoi(argv[4])) : std::max(1u, std::thread::hardware_concurrency());
+	const int width = 800;
+	const int height = 600;
+
+	GLFWwindow* benchWindow = UCreateToolContext();
+	if (!benchWindow)
+		return EXIT_FAILURE;
+
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+	ToolScene scene;
+	UCreateToolScene(scene);
+	ToolTarget target;
+	UResizeToolTarget(target, width, height);
+
+	SceneInstances instances;
+	UCreateSyntheticScene(instances, objectCount);
+	glm::mat4 view = glm::lookAt(SYNTHETIC_EYE, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+	glm::mat4 viewProjection = USyntheticViewProjection();
+	UWriteToolSceneUniforms(scene, view, projection, SYNTHETIC_EYE, ULampPosition(0.0f), keyLightColor, keyLightIntensity);
+
+	SceneInstances layout;
+	std::vector<DrawSource> layoutSources;
+	UInitializeScene(layout, layoutSources);
+	std::vector<DrawSource> sources(objectCount);
+	for (size_t i = 0; i < objectCount; ++i) {
+		sources[i] = layoutSources[i % layoutSources.size()];
+		sources[i].texture = &scene.textures[sources[i].material];
+		sources[i].lightmap = nullptr;
+		sources[i].lightmapCoordinates = nullptr;
+	}
+
+	//Room for every object's block in each segment, whatever the camera sees
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	RingBuffer ring;
+	if (!UCreateRingBuffer(ring, (std::max<size_t>(objectCount, 1) + 1) * ((sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment))) {
+		UDestroyToolTarget(target);
+		UDestroyToolScene(scene);
+		UDestroyMesh(mesh);
+		glfwDestroyWindow(benchWindow);
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	const size_t stride = URingUniformStride(ring, sizeof(ObjectUniforms));
+
+	DeviceResources resources;
+	resources.litProgram = &scene.litProgram;
+	resources.vao = &scene.vao;
+	for (GLuint t = 0; t < DEVICE_MATERIAL_SLOTS; ++t)
+		resources.materials[t] = &scene.textures[t];
+	resources.fallbackTexture = &scene.textures[0];
+	resources.neutralLightmap = &scene.lightmap;
+	resources.neutralCoordinates = &mesh.neutralCoordinates;
+	RenderDevice device;
+	bool failed = !UCreateRenderDevice(device, RENDER_DEVICE_DIRECT, resources);
+
+	std::vector<CommandList> lists;
+	std::vector<DrawRecord> merged;
+	std::cout << "INFO: Draw recording and submission on " << (const char*)glGetString(GL_RENDERER) << ", " << objectCount << " objects, "
+		<< frames << " frames" << std::endl;
+
+	uint64_t frame = 0;
+	double singleThreadMs = 0.0;
+	for (unsigned threads = 1; threads <= maxThreads && !failed; ++threads) {
+		FrameArena arena;
+		UCreateFrameArena(arena, FRAME_ARENA_SIZE);
+		JobSystem system;
+		UStartJobSystem(system, threads - 1, arena);
+
+		double recordMs = 0.0;
+		double mergeMs = 0.0;
+		double frameMs = 0.0;
+		for (int i = -3; i < frames && !failed; ++i) {
+			auto frameStart = std::chrono::steady_clock::now();
+			UBeginRingFrame(ring, ++frame);
+			UWaitForJob(system, UScheduleSceneUpdate(system, instances, viewProjection));
+			UResetJobs(system);
+
+			RingAllocation objectBlocks = URingAllocate(ring, stride * instances.drawCount, (size_t)ring.uniformAlignment);
+			if (!objectBlocks.data) {
+				failed = true;
+				break;
+			}
+			auto recordStart = std::chrono::steady_clock::now();
+			UWaitForJob(system, UScheduleDrawRecording(system, instances, sources.data(), SYNTHETIC_EYE, objectBlocks.data, stride, instances.drawCount, lists));
+			UResetJobs(system);
+			auto mergeStart = std::chrono::steady_clock::now();
+			UMergeCommandLists(lists, merged);
+			auto mergeEnd = std::chrono::steady_clock::now();
+			UResetFrameArena(arena);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+			glViewport(0, 0, width, height);
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, scene.uniformBuffer, 0, sizeof(FrameUniforms));
+			glActiveTexture(GL_TEXTURE0 + LIGHTMAP_TEXTURE_UNIT);
+			glBindTexture(GL_TEXTURE_2D, scene.lightmap);
+			glActiveTexture(GL_TEXTURE0);
+			UBindLightmapCoordinates(scene.vao, 0, mesh.neutralCoordinates);
+
+			//The first three frames warm up caches, the frame arena, and the driver; the stats start after them
+			if (i == 0) {
+				device.stats = DeviceStats();
+				ring.waitNanoseconds = 0;
+			}
+			USubmitDraws(device, DeviceFrame{ ring.buffer, objectBlocks.offset, stride }, sources.data(), sources.size(), merged);
+			glBindVertexArray(0);
+			UEndRingFrame(ring, frame);
+
+			if (i < 0)
+				continue;
+			recordMs += std::chrono::duration<double, std::milli>(mergeStart - recordStart).count();
+			mergeMs += std::chrono::duration<double, std::milli>(mergeEnd - mergeStart).count();
+			frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		}
+		uint64_t waitNanoseconds = ring.waitNanoseconds.exchange(0);
+		UStopJobSystem(system);
+		UDestroyFrameArena(arena);
+		if (failed)
+			break;
+
+		const DeviceStats& stats = device.stats;
+		recordMs /= frames;
+		mergeMs /= frames;
+		double submitMs = stats.submitNanoseconds / 1e6 / stats.frames;
+		if (threads == 1)
+			singleThreadMs = recordMs + mergeMs + submitMs;
+
+		std::cout << "INFO: " << threads << " threads: record " << recordMs << " ms, merge+sort " << mergeMs << " ms, submit " << submitMs
+			<< " ms CPU, " << (double)stats.calls / stats.frames << " GL calls, ring wait " << waitNanoseconds / 1e6 / frames << " ms, frame "
+			<< frameMs / frames << " ms, speedup " << singleThreadMs / (recordMs + mergeMs + submitMs) << "x, " << merged.size() << " draws" << std::endl;
+	}
+
+	glFinish();
+	UDestroyRenderDevice(device);
+	UDestroyRingBuffer(ring);
+	UDestroyToolTarget(target);
+	UDestroyToolScene(scene);
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(benchWindow);
+	glfwTerminate();
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-		//Input
-		KeyBoardInput(window);
+//--bench-submit [--copies N] [--frames N] [--threads N] [--width N] [--height N] [--out dir]
+//Lays N copies of the scene's objects (256 by default) out on a grid and draws the same frames with the direct and
+//the indirect render device. Draws are recorded on --threads job threads either way; per frame the bench reports
+//recording, the device's CPU submit time and GL calls, the GPU time from a timer query, and the whole frame. The two
+//devices' last frames are compared, and the bench fails if any pixel of the indirect one is off by more than 8 in a
+//channel, so it doubles as the indirect device's check; --out writes them as PNG.
+int UBenchSubmit(int argc, char* argv[]) {
+	int copies = std::max(1, (int)UArgValue(argc, argv, "--copies", 256.0));
+	int frames = std::max(1, (int)UArgValue(argc, argv, "--frames", 60.0));
+	unsigned threads = (unsigned)std::max(1.0, UArgValue(argc, argv, "--threads", (double)std::max(1u, std::thread::hardware_concurrency())));
+	int width = (int)UArgValue(argc, argv, "--width", 1280.0);
+	int height = (int)UArgValue(argc, argv, "--height", 720.0);
+	const char* outputDir = UArgString(argc, argv, "--out");
+
+	GLFWwindow* benchWindow = UCreateToolContext();
+	if (!benchWindow)
+		return EXIT_FAILURE;
 
-		//render this frame
-		URender();
+	UOpenAssets(argv[0]);
+	UCreateMesh(mesh);
+	ToolScene scene;
+	UCreateToolScene(scene);
+	ToolTarget target;
+	UResizeToolTarget(target, width, height);
+
+	//Copies of the scene objects 12 units apart, drawn with the tool scene's textures and no lightmaps
+	SceneInstances layout;
+	std::vector<DrawSource> layoutSources;
+	UInitializeScene(layout, layoutSources);
+	const int side = (int)std::ceil(std::sqrt((double)copies));
+	const float spacing = 12.0f;
+	SceneInstances instances;
+	std::vector<DrawSource> sources;
+	for (int c = 0; c < copies; ++c) {
+		glm::vec3 offset((c % side - (side - 1) * 0.5f) * spacing, 0.0f, (c / side - (side - 1) * 0.5f) * spacing);
+		for (size_t i = 0; i < layoutSources.size(); ++i) {
+			UAddInstance(instances, layout.locations[i] + offset, layout.scales[i], layout.rotationAngles[i], layout.rotationAxes[i], layout.radii[i]);
+			DrawSource source = layoutSources[i];
+			source.texture = &scene.textures[source.material];
+			source.lightmap = nullptr;
+			source.lightmapCoordinates = nullptr;
+			sources.push_back(source);
+		}
+	}
+
+	glm::vec3 eye(0.0f, side * spacing * 0.9f + 4.0f, side * spacing * 0.9f + 8.0f);
+	glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, side * spacing * 3.0f + 50.0f);
+	UWriteToolSceneUniforms(scene, view, projection, eye, ULampPosition(0.0f), keyLightColor, keyLightIntensity);
+
+	//Object blocks, recorded into memory by the jobs and uploaded whole each frame
+	std::vector<unsigned char> uniforms((size_t)scene.objectStride * sources.size());
+	GLuint objectBuffer = 0;
+	glCreateBuffers(1, &objectBuffer);
+	glNamedBufferStorage(objectBuffer, (GLsizeiptr)uniforms.size(), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	FrameArena arena;
+	UCreateFrameArena(arena, FRAME_ARENA_SIZE);
+	JobSystem system;
+	UStartJobSystem(system, threads - 1, arena);
+	std::vector<CommandList> lists;
+	std::vector<DrawRecord> merged;
+
+	DeviceResources resources;
+	resources.litProgram = &scene.litProgram;
+	resources.vao = &scene.vao;
+	for (GLuint t = 0; t < DEVICE_MATERIAL_SLOTS; ++t)
+		resources.materials[t] = &scene.textures[t];
+	resources.fallbackTexture = &scene.textures[0];
+	resources.neutralLightmap = &scene.lightmap;
+	resources.neutralCoordinates = &mesh.neutralCoordinates;
+
+	GLuint query;
+	glGenQueries(1, &query);
+	std::cout << "INFO: Submission on " << (const char*)glGetString(GL_RENDERER) << ", " << sources.size() << " objects, " << width << "x" << height
+		<< ", " << threads << " recording threads, " << frames << " frames per device" << std::endl;
+
+	bool failed = false;
+	std::vector<unsigned char> images[2];
+	for (int kind = RENDER_DEVICE_DIRECT; kind <= RENDER_DEVICE_INDIRECT && !failed; ++kind) {
+		RenderDevice device;
+		if (!UCreateRenderDevice(device, (RenderDeviceKind)kind, resources)) {
+			failed = true;
+			break;
+		}
 
-		glfwPollEvents();
+		double recordMs = 0.0;
+		double gpuMs = 0.0;
+		double frameMs = 0.0;
+		size_t drawn = 0;
+		for (int i = -3; i < frames; ++i) {
+			auto frameStart = std::chrono::steady_clock::now();
+			UWaitForJob(system, UScheduleSceneUpdate(system, instances, projection * view));
+			UResetJobs(system);
+			UWaitForJob(system, UScheduleDrawRecording(system, instances, sources.data(), eye, uniforms.data(), (size_t)scene.objectStride, instances.drawCount, lists));
+			UResetJobs(system);
+			UResetFrameArena(arena);
+			auto recordEnd = std::chrono::steady_clock::now();
+
+			glNamedBufferSubData(objectBuffer, 0, (GLsizeiptr)(instances.drawCount * scene.objectStride), uniforms.data());
+			UMergeCommandLists(lists, merged);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+			glViewport(0, 0, width, height);
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, scene.uniformBuffer, 0, sizeof(FrameUniforms));
+			glActiveTexture(GL_TEXTURE0 + LIGHTMAP_TEXTURE_UNIT);
+			glBindTexture(GL_TEXTURE_2D, scene.lightmap);
+			glActiveTexture(GL_TEXTURE0);
+			UBindLightmapCoordinates(scene.vao, 0, mesh.neutralCoordinates);
+
+			//The first three frames pack the arena and warm the driver; the stats start after them
+			if (i == 0)
+				device.stats = DeviceStats();
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			USubmitDraws(device, DeviceFrame{ objectBuffer, 0, (size_t)scene.objectStride }, sources.data(), sources.size(), merged);
+			glEndQuery(GL_TIME_ELAPSED);
+			glBindVertexArray(0);
+			GLuint64 gpuNanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuNanoseconds);
+
+			if (i < 0)
+				continue;
+			recordMs += std::chrono::duration<double, std::milli>(recordEnd - frameStart).count();
+			gpuMs += gpuNanoseconds / 1e6;
+			frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			drawn = merged.size();
+		}
+
+		const DeviceStats& stats = device.stats;
+		std::cout << "INFO:   " << RENDER_DEVICE_NAMES[kind] << ": " << drawn << " draws, record " << recordMs / frames << " ms, submit "
+			<< stats.submitNanoseconds / 1e6 / stats.frames << " ms CPU, " << (double)stats.calls / stats.frames << " GL calls, GPU "
+			<< gpuMs / frames << " ms, frame " << frameMs / frames << " ms" << std::endl;
+
+		images[kind].resize((size_t)width * height * CAPTURE_READ_CHANNELS);
+		glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, images[kind].data());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (outputDir) {
+			std::vector<unsigned char> png;
+			PngScratch scratch;
+			UEncodePng(images[kind].data(), width, height, scratch, png);
+			UWriteCaptureFile((std::string(outputDir) + "/submit_" + RENDER_DEVICE_NAMES[kind] + ".png").c_str(), png);
+		}
+		UDestroyRenderDevice(device);
+	}
+
+	//Same picture: mean channel difference and the share of pixels that differ visibly, none of which may
+	if (!failed) {
+		double difference = 0.0;
+		size_t differing = 0;
+		for (size_t p = 0; p < (size_t)width * height; ++p) {
+			int largest = 0;
+			for (int c = 0; c < 3; ++c) {
+				int channel = std::abs((int)images[0][p * CAPTURE_READ_CHANNELS + c] - (int)images[1][p * CAPTURE_READ_CHANNELS + c]);
+				difference += channel;
+				largest = std::max(largest, channel);
+			}
+			differing += largest > 8 ? 1 : 0;
+		}
+		std::cout << "INFO:   indirect vs direct: mean channel difference " << difference / ((double)width * height * 3) << ", "
+			<< 100.0 * differing / ((double)width * height) << "% pixels off by more than 8" << std::endl;
+		if (differing) {
+			LOG_ERROR("ERROR::SUBMIT::IMAGES_DIFFER %zu", differing);
+			failed = true;
+		}
 	}
 
+	glDeleteQueries(1, &query);
+	UStopJobSystem(system);
+	UDestroyFrameArena(arena);
+	glDeleteBuffers(1, &objectBuffer);
+	UDestroyToolTarget(target);
+	UDestroyToolScene(scene);
+	UDestroyMesh(mesh);
+	glfwDestroyWindow(benchWindow);
+	glfwTerminate();
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//Releases everything created on the GL context, on the thread that owns it
+void UReleaseGLResources() {
+
+	//Abandon loads that have not started; in-flight work finishes before the workers join
+	UStopLoadGraph(gLoadGraph);
+	UStopHotReload(gReloader);
+
 	//Release mesh data
 	UDestroyMesh(mesh);
+	UDestroyRingBuffer(gRingBuffer);
+	UStopFrameCapture(gFrameCapture);
+	UResetRenderGraph(gRenderGraph);
+	UDestroyDynamicResolution(gDynamicResolution);
+	UDestroyShaderProgram(gAntialiasID);
+	UDestroyShadowMaps(gShadowMaps);
+	UDestroyParticleSystem(gParticles);
+	UDestroyRenderDevice(gRenderDevice);
 
 	//Release Texture
 	DestroyTexture(texture1);
 	DestroyTexture(texture2);
 	DestroyTexture(texture3);
 	DestroyTexture(texture4);
+	DestroyTexture(gFallbackTexture);
+	for (int i = 0; i < 4; ++i) {
+		DestroyTexture(gLightmaps[i]);
+		glDeleteBuffers(1, &gLightmapCoordinateBuffers[i]);
+	}
+	DestroyTexture(gNeutralLightmap);
+	DestroyTexture(gSoftwareTexture);
+	glDeleteFramebuffers(1, &gSoftwareFramebuffer);
 
 	//release shader program
 	UDestroyShaderProgram(programID);
 	UDestroyShaderProgram(lampID);
+}
+
+//Render thread: owns the GL context from startup until shutdown
+void URenderThread() {
+	glfwMakeContextCurrent(window);
+
+	while (const RenderPacket* packet = UAcquirePacket(gPacketExchange))
+		URenderFrame(*packet);
+
+	UReleaseGLResources();
+	glfwMakeContextCurrent(NULL);
+}
+
+//main function. Entry point to the OpenGL program
+int main(int argc, char* argv[]) {
+
+	auto processStart = std::chrono::steady_clock::now();
+
+	//Asset pack tooling runs without a window
+	if (argc > 1 && strcmp(argv[1], "--pack") == 0)
+		return UPackAssets(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-io") == 0)
+		return UBenchAssetIO(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-jobs") == 0)
+		return UBenchJobs(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-draws") == 0)
+		return UBenchDraws(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bake-lightmaps") == 0)
+		return UBakeSceneLightmaps(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-raster") == 0)
+		return UBenchSoftwareRaster(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-pick") == 0)
+		return UBenchRayQueries(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+		return UServeFrames(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--frame-client") == 0)
+		return UFrameClient(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--batch-render") == 0)
+		return UBatchRender(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-particles") == 0)
+		return UBenchParticles(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-submit") == 0)
+		return UBenchSubmit(argc, argv);
+
+	//Console output from here on goes through the logger's writer thread
+	UStartLogger();
+
+	//--serial keeps simulation and rendering on the main thread (for comparison)
+	bool threaded = !UHasArg(argc, argv, "--serial");
+	double simCostMs = UArgValue(argc, argv, "--sim-cost-ms", 0.0);
+
+	//Stage 1: window and context (GLFW requires the main thread)
+	if (!UInitialize(argc, argv, &window)) {
+		UStopLogger();
+		return EXIT_FAILURE;
+	}
+
+	LOG_INFO("INFO: Window/context ready at %.1f ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count());
+
+	int framebufferWidth, framebufferHeight;
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	gFramebufferWidth = framebufferWidth;
+	gFramebufferHeight = framebufferHeight;
+
+	//Bound for any texture that is still loading or failed to load
+	UCreateFallbackTexture(gFallbackTexture);
+	UCreateNeutralLightmap(gNeutralLightmap);
+
+	//Triple-buffered, persistently mapped storage for per-frame uniforms
+	UCreateRingBuffer(gRingBuffer, RING_SEGMENT_SIZE);
+
+	//Dynamic resolution: --gpu-budget-ms for the scene pass, --render-scale to fix the scale, --upscale bilinear|sharpen
+	const char* upscaleName = UArgString(argc, argv, "--upscale");
+	UpscaleFilter upscale = upscaleName && strcmp(upscaleName, "bilinear") == 0 ? UPSCALE_BILINEAR : UPSCALE_SHARPEN;
+	UCreateDynamicResolution(gDynamicResolution, upscale, UArgValue(argc, argv, "--gpu-budget-ms", 12.0), (float)UArgValue(argc, argv, "--render-scale", 0.0));
+
+	//FXAA at render resolution unless --no-antialias; a failed build just leaves the pass out of the graph
+	if (!UHasArg(argc, argv, "--no-antialias") && UCreateShaderProgram(upscaleVertexShaderSource, antialiasFragmentShaderSource, gAntialiasID)) {
+		glUniform1i(glGetUniformLocation(gAntialiasID, "sceneTexture"), 0);
+		gAntialiasRegionLocation = glGetUniformLocation(gAntialiasID, "regionScale");
+		gAntialiasTexelLocation = glGetUniformLocation(gAntialiasID, "texelSize");
+	}
+
+	//--software: the CPU rasterizer draws the scene on --software-threads threads (default: every hardware thread)
+	gSoftwareRendering = UHasArg(argc, argv, "--software");
+	if (gSoftwareRendering) {
+		UStartSoftwareRasterizer(gSoftwareRasterizer, (unsigned)UArgValue(argc, argv, "--software-threads", 0.0));
+		LOG_INFO("INFO: Software rasterizer on %u threads", gSoftwareRasterizer.threads);
+	}
+
+	//--capture dir records the presented frames as numbered QOI or PNG files (--capture-format qoi|png), --capture file.y4m
+	//as one Y4M stream; --capture-fps goes in the Y4M header, --capture-threads sets the encoder count
+	if (const char* capturePath = UArgString(argc, argv, "--capture")) {
+		const char* formatName = UArgString(argc, argv, "--capture-format");
+		CaptureFormat format = UEndsWith(UNormalizeAssetName(capturePath), ".y4m") ? CAPTURE_Y4M : CAPTURE_QOI;
+		for (int i = 0; formatName && i < 3; ++i) {
+			if (strcmp(formatName, CAPTURE_FORMAT_NAMES[i]) == 0)
+				format = (CaptureFormat)i;
+		}
+		UStartFrameCapture(gFrameCapture, capturePath, format, (int)UArgValue(argc, argv, "--capture-fps", 60.0), (unsigned)UArgValue(argc, argv, "--capture-threads", 0.0));
+	}
+
+	//Key light shadows unless --no-shadows (or --software, which does not draw them); --shadow-size per cube face, --shadow-faces redrawn per frame while the lamp orbits
+	int shadowSize = (int)UArgValue(argc, argv, "--shadow-size", 1024.0);
+	int shadowFaces = (int)UArgValue(argc, argv, "--shadow-faces", 2.0);
+	gShadowSchedule.facesPerFrame = shadowFaces < 1 ? 1 : (shadowFaces > SHADOW_FACES ? SHADOW_FACES : shadowFaces);
+	gShadowSchedule.enabled = !gSoftwareRendering && !UHasArg(argc, argv, "--no-shadows") && UCreateShadowMaps(gShadowMaps, shadowSize, gShadowSchedule.farPlane, UHasDynamicCasters());
+	if (gShadowSchedule.enabled)
+		UCheckVertexLayout<SceneVertexLayout>(gShadowMaps.program, "shadow shader");
+
+	//--particles N dust motes around the lamp (0 for none); not drawn by the software rasterizer
+	double particleCount = UArgValue(argc, argv, "--particles", 16384.0);
+	if (!gSoftwareRendering && particleCount >= 1.0)
+		UCreateParticleSystem(gParticles, (GLuint)std::min(particleCount, (double)PARTICLE_MAX_CAPACITY));
+
+	//--render-device direct|indirect submits the lit objects; the indirect device falls back to direct if its pipeline does not build
+	const char* deviceName = UArgString(argc, argv, "--render-device");
+	RenderDeviceKind deviceKind = deviceName && strcmp(deviceName, RENDER_DEVICE_NAMES[RENDER_DEVICE_INDIRECT]) == 0 ? RENDER_DEVICE_INDIRECT : RENDER_DEVICE_DIRECT;
+	DeviceResources deviceResources;
+	deviceResources.litProgram = &programID;
+	deviceResources.vao = &mesh.vao;
+	for (GLuint t = 0; t < DEVICE_MATERIAL_SLOTS; ++t)
+		deviceResources.materials[t] = gTextureTargets[t];
+	deviceResources.fallbackTexture = &gFallbackTexture;
+	deviceResources.neutralLightmap = &gNeutralLightmap;
+	deviceResources.neutralCoordinates = &mesh.neutralCoordinates;
+	if (!UCreateRenderDevice(gRenderDevice, deviceKind, deviceResources)) {
+		LOG_WARN("WARN: The %s render device is unavailable, drawing with the direct device", RENDER_DEVICE_NAMES[deviceKind]);
+		UCreateRenderDevice(gRenderDevice, RENDER_DEVICE_DIRECT, deviceResources);
+	}
+	gFrameStats.deviceName = RENDER_DEVICE_NAMES[gRenderDevice.kind];
+
+	//Declare the frame's passes and allocate their render targets
+	UBuildRenderGraph(gRenderGraph, framebufferWidth, framebufferHeight);
+
+	//sets background color of window to black
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	//Stage 2: asset index, then shaders, meshes, and textures concurrently
+	ShaderLoad sceneShader = { "shaders/scene.vert", "shaders/scene.frag", vertexShaderSource, fragmentShaderSource, &programID };
+	ShaderLoad lampShader = { "shaders/lamp.vert", "shaders/lamp.frag", lampVertexShaderSource, lampFragmentShaderSource, &lampID };
+
+	TextureLoad textureLoads[4];
+	LightmapLoad lightmapLoads[4];
+	std::vector<float> rayQueryVertices[5];
+	std::vector<uint32_t> rayQueryIndices[5];
+
+	gLoadGraph.start = processStart;
+
+	//Map the asset pack (or find the loose asset directory) relative to the executable
+	int assetsJob = UAddLoadJob(gLoadGraph, "asset index", {},
+		[argv] { UOpenAssets(argv[0]); return true; },
+		nullptr);
+
+	//Create the mesh
+	int meshJob = UAddLoadJob(gLoadGraph, "meshes", { assetsJob },
+		nullptr,
+		[] { UCreateMesh(mesh); gMeshReady = true; return true; });
+
+	//create the shader programs; the lit program also needs its sampler bound to texture unit 0
+	int sceneShaderJob = UAddShaderJob(gLoadGraph, "scene shader", { assetsJob }, sceneShader);
+	UAddShaderJob(gLoadGraph, "lamp shader", { assetsJob }, lampShader);
+
+	UAddLoadJob(gLoadGraph, "scene sampler", { sceneShaderJob },
+		nullptr,
+		[] {
+			if (!programID)
+				return false;
+			glUseProgram(programID);
+			glUniform1i(glGetUniformLocation(programID, "Texture"), 0);
+			return true;
+		});
+
+	//Load textures
+	for (int i = 0; i < 4; ++i) {
+		textureLoads[i].fileName = TEXTURE_FILE_NAMES[i];
+		textureLoads[i].texture = gTextureTargets[i];
+		UAddTextureJob(gLoadGraph, { assetsJob }, textureLoads[i]);
+	}
+
+	//Baked lightmaps: each object's coordinates go in a buffer of their own, which the render device binds to
+	//SCENE_LIGHTMAP_BINDING of the shared vertex array per draw. A scene that was never baked keeps the constant ambient.
+	for (int i = 0; i < 4; ++i) {
+		LightmapLoad* load = &lightmapLoads[i];
+		load->objectName = gSceneObjects[i].name;
+		UAddLoadJob(gLoadGraph, std::string("lightmap ") + gSceneObjects[i].name, { assetsJob, meshJob },
+			[load] {
+				load->found = UReadLightmap(*load);
+				if (!load->found)
+					LOG_INFO("INFO: No baked lightmap for %s, using constant ambient", load->objectName);
+				return true;
+			},
+			[load, i] {
+				if (load->found)
+					UUploadLightmap(*load, mesh.vbos[gSceneObjects[i].meshIndex * 2], gLightmapCoordinateBuffers[i], gLightmaps[i]);
+				return true;
+			});
+	}
+
+	//The software backend decodes its own copy of the textures and reads the meshes back once they are uploaded
+	if (gSoftwareRendering) {
+		UAddLoadJob(gLoadGraph, "software scene", { assetsJob, meshJob },
+			[] { ULoadSoftwareTextures(gSoftwareRasterizer); return true; },
+			[] {
+				gSoftwareSceneReady = UReadBackSoftwareMeshes(gSoftwareRasterizer);
+				return gSoftwareSceneReady.load();
+			});
+	}
+
+	//Picking reads the meshes back once they are uploaded, then builds their BLASes on a loader thread
+	int rayQueryMeshesJob = UAddLoadJob(gLoadGraph, "ray query meshes", { assetsJob, meshJob },
+		nullptr,
+		[&rayQueryVertices, &rayQueryIndices] {
+			bool readBack = true;
+			for (int i = 0; i < 5; ++i)
+				readBack = UReadBackMesh(mesh.vbos[i * 2], mesh.vbos[i * 2 + 1], *UMeshIndexCount(mesh, i), rayQueryVertices[i], rayQueryIndices[i]) && readBack;
+			return readBack;
+		});
+	UAddLoadJob(gLoadGraph, "ray query scene", { rayQueryMeshesJob },
+		[&rayQueryVertices, &rayQueryIndices] {
+			gRayQueryScene.meshes.resize(5);
+			for (int i = 0; i < 5; ++i) {
+				UBuildRayQueryMesh(gRayQueryScene.meshes[i], rayQueryVertices[i], rayQueryIndices[i]);
+				std::vector<float>().swap(rayQueryVertices[i]);
+				std::vector<uint32_t>().swap(rayQueryIndices[i]);
+			}
+			gRayQuerySceneReady = true;
+			return true;
+		},
+		nullptr);
+
+	unsigned hardwareThreads = std::thread::hardware_concurrency();
+	UStartLoadGraph(gLoadGraph, std::min(4u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u));
+
+	//The main thread is job system participant 0; leave a core for the render thread
+	UCreateFrameArena(gFrameArena, FRAME_ARENA_SIZE);
+	UStartJobSystem(gJobSystem, hardwareThreads > 2 ? hardwareThreads - 2 : 1u, gFrameArena);
+	UInitializeScene(gSceneInstances, gDrawSources);
+
+	//The watcher's shared context has to be created here; it starts watching once everything has loaded
+	UCreateHotReloadContext(gReloader, window);
+
+	//Hand the GL context to the render thread; the main thread keeps a hidden shared context to wait on ring fences
+	std::thread renderThread;
+	if (threaded) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		gSyncContext = glfwCreateWindow(1, 1, "sync", NULL, window);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+		if (!gSyncContext) {
+			LOG_ERROR("ERROR::RINGBUFFER::SYNC_CONTEXT_CREATION_FAILED");
+			UDestroyRingBuffer(gRingBuffer);
+		}
+
+		glfwMakeContextCurrent(gSyncContext);
+		renderThread = std::thread(URenderThread);
+	}
+
+	uint64_t frame = 0;
+
+	//Frame pacing: --pacing vsync|adaptive|limit|uncapped, --fps-cap for the limiter, --pacing-sweep to compare all four
+	int pacing = PACING_VSYNC;
+	if (const char* pacingName = UArgString(argc, argv, "--pacing")) {
+		pacing = UParsePacingPolicy(pacingName);
+		if (pacing < 0) {
+			LOG_ERROR("ERROR::PACING::UNKNOWN_POLICY %s", pacingName);
+			pacing = PACING_VSYNC;
+		}
+	}
+	UStartPacing(gFramePacer, pacing, UArgValue(argc, argv, "--fps-cap", 60.0));
+	if (UHasArg(argc, argv, "--pacing-sweep"))
+		UStartPacingSweep(gFramePacer, UArgValue(argc, argv, "--pacing-sweep", 5.0));
+
+	//--on-demand: only redraw when something changed (kiosks, remote viewing); a sweep needs every frame
+	gFramePacer.onDemand = UHasArg(argc, argv, "--on-demand") && !gFramePacer.sweeping;
+	if (gFramePacer.onDemand)
+		LOG_INFO("INFO: Rendering on demand");
+
+	//Input times are relative to the start of the loop, so recordings replay the same way regardless of load time
+	double loopStart = glfwGetTime();
+	UCreateInput(gInput, loopStart);
+	UStartSimulationClock(gSimulationClock, loopStart, SIMULATION_RATE);
+	keyLightPosition = ULampPosition(gLampOrbitAngle);
+	gCurrentState = gPreviousState = UCaptureSimulationState();
+	if (const char* recordPath = UArgString(argc, argv, "--record-input"))
+		UStartInputRecording(gInput, recordPath);
+	if (const char* replayPath = UArgString(argc, argv, "--replay-input"))
+		ULoadInputReplay(gInput, replayPath);
+
+	//Frames after loading finishes before in-frame heap traffic counts as a regression (containers reach steady size)
+	const int ALLOCATION_WARMUP_FRAMES = 8;
+	int warmupFrames = 0;
+
+	//simulation loop
+	while (!glfwWindowShouldClose(window)) {
+
+		//Everything from the previous iteration's jobs has been waited on and destroyed
+		UResetFrameArena(gFrameArena);
+		FrameScope frameScope;
+		UBeginLogFrame(frame + 1);
+
+		auto simStart = std::chrono::steady_clock::now();
+
+		//Input: the callbacks only queue events. Under render on demand with nothing to redraw, this blocks instead.
+		bool waited = UWaitForFrameWork(gFramePacer);
+
+		//per-frame timing (after polling, so every event delivered so far is queued)
+		//-----------------------
+		double now = glfwGetTime();
+		if (waited)
+			UResyncSimulationClock(gSimulationClock, now);
+
+		//A replay benchmark ends with its recording
+		if (gInput.replaying && !UPumpInputReplay(gInput, now)) {
+			LOG_INFO("INFO: Input replay finished");
+			glfwSetWindowShouldClose(window, true);
+		}
+
+		//Simulation: as many fixed steps as real time allows; each consumes the input up to its own end
+		int steps = UAdvanceSimulationClock(gSimulationClock, now);
+		for (int step = 0; step < steps; ++step) {
+			gPreviousState = gCurrentState;
+			UConsumeInput(gInput, UStepEndTime(gSimulationClock));
+			UUpdateCamera(gInput);
+			UUpdateScene(gInput, gSimulationClock.step);
+			UPickObject(gInput);
+			UFinishStep(gSimulationClock);
+			gCurrentState = UCaptureSimulationState();
+		}
+		if (simCostMs > 0.0)
+			USimulateWork(simCostMs);
+
+		//Render on demand: anything that may change the picture keeps frames coming; otherwise the last one stays up.
+		//The dust does not count: it is simulated on the frames drawn anyway and holds still while the window idles
+		//(the first step after a pause is capped at PARTICLE_MAX_STEP).
+		if (UStateChanged(gPreviousState, gCurrentState) || UInputActive(gInput) || !ULoadGraphFinished(gLoadGraph) || UHotReloadPending(gReloader) || gShadowMaps.lost)
+			UInvalidateFrame(gFramePacer);
+		if (!UTakeFrame(gFramePacer))
+			continue;
+
+		uint64_t simNanoseconds = UNanosecondsSince(simStart);
+
+		//Waits here if the render thread is still a full packet behind
+		RenderPacket& packet = threaded ? UBeginPacket(gPacketExchange) : gPacketExchange.slots[0];
+
+		auto buildStart = std::chrono::steady_clock::now();
+		packet.frame = ++frame;
+		UBuildRenderPacket(packet, UInterpolateState(gPreviousState, gCurrentState, UInterpolationAlpha(gSimulationClock)));
+		packet.simulatedAt = std::chrono::steady_clock::now();
+
+		//Fence waits are reported on their own rather than as simulation time
+		uint64_t fenceWait = gRingBuffer.waitNanoseconds.exchange(0);
+		uint64_t buildNanoseconds = UNanosecondsSince(buildStart);
+		gFrameStats.simNanoseconds += simNanoseconds + (buildNanoseconds > fenceWait ? buildNanoseconds - fenceWait : 0);
+		gFrameStats.fenceWaitNanoseconds += fenceWait;
+		gFrameStats.fenceStalls += gRingBuffer.stalls.exchange(0);
+
+		if (threaded)
+			UPublishPacket(gPacketExchange);
+		else
+			URenderFrame(packet);
+
+		UReportFrameStats(gFrameStats, gFramePacer, threaded);
+
+		//A pacing sweep closes the window once every policy has had its turn
+		if (!UAdvancePacingSweep(gFramePacer))
+			glfwSetWindowShouldClose(window, true);
+
+		//Under the CPU limiter, wait out the rest of this frame's interval
+		UPaceFrame(gFramePacer);
+
+		if (!gFrameAllocationCheckArmed && ULoadGraphFinished(gLoadGraph) && ++warmupFrames == ALLOCATION_WARMUP_FRAMES)
+			gFrameAllocationCheckArmed = true;
+	}
+	gFrameAllocationCheckArmed = false;
+
+	if (threaded) {
+		UQuitPacketExchange(gPacketExchange);
+		renderThread.join();
+		glfwMakeContextCurrent(NULL);
+		if (gSyncContext)
+			glfwDestroyWindow(gSyncContext);
+	}
+	else {
+		UReleaseGLResources();
+	}
+
+	UStopInput(gInput);
+	UStopPacing(gFramePacer);
+	UStopJobSystem(gJobSystem);
+	UDestroyFrameArena(gFrameArena);
+	UStopSoftwareRasterizer(gSoftwareRasterizer);
+	UDestroyHotReloadContext(gReloader);
+
+#if FRAME_ALLOCATION_CHECK
+	LOG_INFO("INFO: %llu heap allocations or frees inside frames, frame arena peak %zu KB", (unsigned long long)gFrameAllocationCount, gFrameArena.peak / 1024);
+#endif
+
+	//Unmap the asset pack
+	UCloseAssets();
+	UStopLogger();
 
 	exit(EXIT_SUCCESS); //Terminates the program sucessfully 
-}
\ No newline at end of file
+}
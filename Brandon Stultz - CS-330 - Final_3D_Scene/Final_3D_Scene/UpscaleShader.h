@@ -0,0 +1,57 @@
+#ifndef UPSCALESHADE_H
+#define UPSCALESHADE_H
+
+//Draws the scene region of a dynamic resolution target over the viewport (upscale and render-resolution sharpen)
+
+
+//One triangle covering the screen, generated from gl_VertexID; no vertex buffer is needed
+const char* upscaleVertexShaderSource = "#version 440 core\n"
+
+"out vec2 screenCoordinate;\n"
+
+"void main()\n"
+"{\n"
+
+"	screenCoordinate = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"	gl_Position = vec4(screenCoordinate * 2.0f - 1.0f, 0.0f, 1.0f);\n"
+
+"}\0";
+
+
+const char* upscaleFragmentShaderSource = "#version 440 core\n"
+
+"in vec2 screenCoordinate;\n"
+
+"out vec4 fragmentColor;\n"
+
+"uniform sampler2D sceneTexture;\n"
+"uniform vec2 regionScale;\n"			//Part of the target the scene was drawn into
+"uniform vec2 texelSize;\n"
+"uniform float sharpness;\n"			//0 = plain bilinear
+
+"void main()\n"
+"{\n"
+
+	//Stay half a texel inside the drawn region, so filtering never picks up the unused part of the target
+"	vec2 coordinate = clamp(screenCoordinate * regionScale, 0.5f * texelSize, regionScale - 0.5f * texelSize);\n"
+"	vec3 center = texture(sceneTexture, coordinate).rgb;\n"
+
+"	if (sharpness > 0.0f) {\n"
+"		vec3 north = texture(sceneTexture, coordinate + vec2(0.0f, texelSize.y)).rgb;\n"
+"		vec3 south = texture(sceneTexture, coordinate - vec2(0.0f, texelSize.y)).rgb;\n"
+"		vec3 east = texture(sceneTexture, coordinate + vec2(texelSize.x, 0.0f)).rgb;\n"
+"		vec3 west = texture(sceneTexture, coordinate - vec2(texelSize.x, 0.0f)).rgb;\n"
+
+		//Sharpen less where local contrast is already high, so edges do not ring
+"		vec3 minimum = min(center, min(min(north, south), min(east, west)));\n"
+"		vec3 maximum = max(center, max(max(north, south), max(east, west)));\n"
+"		vec3 headroom = clamp(min(minimum, 1.0f - maximum) / max(maximum, vec3(0.0001f)), 0.0f, 1.0f);\n"
+"		vec3 amount = sharpness * sqrt(headroom);\n"
+"		center = clamp(center + amount * (4.0f * center - north - south - east - west) * 0.25f, 0.0f, 1.0f);\n"
+"	}\n"
+
+"	fragmentColor = vec4(center, 1.0f);\n"
+
+"}\0";
+
+#endif
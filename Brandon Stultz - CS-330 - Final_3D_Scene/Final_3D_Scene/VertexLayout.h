@@ -0,0 +1,195 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+/*Compile-time vertex layouts
+* A layout is a list of attributes: shader location, component count and type, and the buffer binding the attribute
+* is read from. Offsets within a binding and the stride of each binding are derived from the list at compile time,
+* so no byte offset is typed by hand.
+*
+* The format of a layout lives in one VAO, set up with the separate attribute format calls. Every mesh in that layout
+* is drawn through the same VAO by pointing its bindings at the mesh's buffers, rather than keeping a VAO per mesh.
+*
+* UCheckVertexLayout compares a linked program's active inputs with a layout, so a shader whose layout(location = N)
+* inputs the layout does not provide is reported when it is built instead of drawing with garbage.
+*/
+
+#include <array>
+#include <cstddef>
+
+#include "Logger.h"
+
+const GLuint MAX_LAYOUT_BINDINGS = 4;
+
+constexpr GLuint UVertexTypeSize(GLenum type) {
+	return type == GL_DOUBLE ? 8 :
+		(type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT) ? 4 :
+		(type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT) ? 2 : 1;
+}
+
+constexpr bool UIntegerVertexType(GLenum type) {
+	return type == GL_BYTE || type == GL_UNSIGNED_BYTE || type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_INT || type == GL_UNSIGNED_INT;
+}
+
+//One attribute. Floats and normalized integers (mapped to [0, 1] or [-1, 1]) feed float shader inputs; integer
+//types that are not normalized feed int and uint inputs unconverted.
+template <GLuint Location, GLint Components, GLenum Type = GL_FLOAT, GLuint Binding = 0, bool Normalized = false>
+struct VertexAttribute {
+	static_assert(Components >= 1 && Components <= 4, "Vertex attributes have 1 to 4 components");
+	static_assert(Binding < MAX_LAYOUT_BINDINGS, "Vertex attribute binding out of range");
+	static constexpr GLuint LOCATION = Location;
+	static constexpr GLint COMPONENTS = Components;
+	static constexpr GLenum TYPE = Type;
+	static constexpr GLuint BINDING = Binding;
+	static constexpr bool NORMALIZED = Normalized;
+};
+
+struct VertexAttributeFormat {
+	GLuint location;
+	GLint components;
+	GLenum type;
+	GLuint binding;
+	bool normalized;
+	GLuint offset;				//Bytes from the start of the vertex in its binding
+};
+
+//Each attribute follows the previous one read from the same binding
+template <size_t Count>
+constexpr std::array<VertexAttributeFormat, Count> ULayoutOffsets(std::array<VertexAttributeFormat, Count> formats) {
+	GLuint next[MAX_LAYOUT_BINDINGS] = {};
+	for (size_t i = 0; i < Count; ++i) {
+		formats[i].offset = next[formats[i].binding];
+		next[formats[i].binding] += formats[i].components * UVertexTypeSize(formats[i].type);
+	}
+	return formats;
+}
+
+template <size_t Count>
+constexpr bool UUniqueLocations(const std::array<VertexAttributeFormat, Count>& formats) {
+	for (size_t i = 0; i < Count; ++i) {
+		for (size_t j = i + 1; j < Count; ++j) {
+			if (formats[i].location == formats[j].location)
+				return false;
+		}
+	}
+	return true;
+}
+
+template <typename... Attributes>
+struct VertexLayout {
+	static constexpr std::array<VertexAttributeFormat, sizeof...(Attributes)> FORMATS = ULayoutOffsets(std::array<VertexAttributeFormat, sizeof...(Attributes)>{ {
+		VertexAttributeFormat{ Attributes::LOCATION, Attributes::COMPONENTS, Attributes::TYPE, Attributes::BINDING, Attributes::NORMALIZED, 0 }... } });
+	static_assert(UUniqueLocations(FORMATS), "Two vertex attributes share a location");
+};
+
+//Bytes per vertex in a binding; 0 if nothing is read from it
+template <typename Layout>
+constexpr GLuint ULayoutStride(GLuint binding) {
+	GLuint stride = 0;
+	for (const VertexAttributeFormat& format : Layout::FORMATS) {
+		if (format.binding == binding)
+			stride += format.components * UVertexTypeSize(format.type);
+	}
+	return stride;
+}
+
+//Offset of the attribute at 'location' within its binding's vertex
+template <typename Layout>
+constexpr GLuint ULayoutOffset(GLuint location) {
+	for (const VertexAttributeFormat& format : Layout::FORMATS) {
+		if (format.location == location)
+			return format.offset;
+	}
+	return 0;
+}
+
+//A VAO holding the layout's format with every attribute enabled; no buffers are bound yet
+template <typename Layout>
+GLuint UCreateLayoutVertexArray() {
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+	for (const VertexAttributeFormat& format : Layout::FORMATS) {
+		if (UIntegerVertexType(format.type) && !format.normalized)
+			glVertexArrayAttribIFormat(vao, format.location, format.components, format.type, format.offset);
+		else
+			glVertexArrayAttribFormat(vao, format.location, format.components, format.type, format.normalized ? GL_TRUE : GL_FALSE, format.offset);
+		glVertexArrayAttribBinding(vao, format.location, format.binding);
+		glEnableVertexArrayAttrib(vao, format.location);
+	}
+	return vao;
+}
+
+//Points one of the VAO's bindings at a buffer of vertices in the layout
+template <typename Layout>
+void UBindLayoutBuffer(GLuint vao, GLuint binding, GLuint buffer) {
+	glVertexArrayVertexBuffer(vao, binding, buffer, 0, (GLsizei)ULayoutStride<Layout>(binding));
+}
+
+//Points a binding at a single element that every vertex reads (a stride of 0 does not advance)
+void UBindConstantBuffer(GLuint vao, GLuint binding, GLuint buffer) {
+	glVertexArrayVertexBuffer(vao, binding, buffer, 0, 0);
+}
+
+//Components of a GLSL vertex input type a layout can feed, and whether it reads integers; 0 for the types it cannot
+//(doubles, matrices)
+GLint UShaderInputComponents(GLenum type, bool& integer) {
+	integer = true;
+	switch (type) {
+	case GL_INT: case GL_UNSIGNED_INT: return 1;
+	case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: return 2;
+	case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: return 3;
+	case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: return 4;
+	}
+	integer = false;
+	switch (type) {
+	case GL_FLOAT: return 1;
+	case GL_FLOAT_VEC2: return 2;
+	case GL_FLOAT_VEC3: return 3;
+	case GL_FLOAT_VEC4: return 4;
+	default: return 0;
+	}
+}
+
+//Reports every active input of a linked program that the layout does not provide at its location with the same
+//component count and kind (float or integer). Built-in inputs such as gl_VertexID have no location and are skipped.
+template <typename Layout>
+bool UCheckVertexLayout(GLuint program, const char* programName) {
+	GLint inputCount = 0;
+	glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &inputCount);
+
+	bool matches = true;
+	for (GLint i = 0; i < inputCount; ++i) {
+		const GLenum properties[2] = { GL_LOCATION, GL_TYPE };
+		GLint values[2] = { -1, 0 };
+		glGetProgramResourceiv(program, GL_PROGRAM_INPUT, (GLuint)i, 2, properties, 2, NULL, values);
+		if (values[0] < 0)
+			continue;
+
+		char name[64] = {};
+		glGetProgramResourceName(program, GL_PROGRAM_INPUT, (GLuint)i, sizeof(name), NULL, name);
+
+		const VertexAttributeFormat* match = nullptr;
+		for (const VertexAttributeFormat& format : Layout::FORMATS) {
+			if (format.location == (GLuint)values[0])
+				match = &format;
+		}
+		bool integer = false;
+		GLint components = UShaderInputComponents((GLenum)values[1], integer);
+		if (!match) {
+			LOG_ERROR("ERROR::SHADER::VERTEX_LAYOUT_MISMATCH %s: input '%s' at location %d is not in the vertex layout", programName, name, values[0]);
+			matches = false;
+		}
+		else if (components != match->components) {
+			LOG_ERROR("ERROR::SHADER::VERTEX_LAYOUT_MISMATCH %s: input '%s' at location %d takes %d components, the vertex layout gives %d",
+				programName, name, values[0], components, match->components);
+			matches = false;
+		}
+		else if (integer != (UIntegerVertexType(match->type) && !match->normalized)) {
+			LOG_ERROR("ERROR::SHADER::VERTEX_LAYOUT_MISMATCH %s: input '%s' at location %d reads %s, the vertex layout gives %s",
+				programName, name, values[0], integer ? "integers" : "floats", integer ? "floats" : "integers");
+			matches = false;
+		}
+	}
+	return matches;
+}
+
+#endif
@@ -1,20 +1,42 @@
 #ifndef VERTSHADE_H
 #define VERTSHADE_H
 
+//Compiled-in fallback for shaders/scene.vert, which is loaded (and hot-reloaded) at runtime when present
+
 // vertex shader program source code
 const char* vertexShaderSource = "#version 440 core\n"
 
 "layout (location = 0) in vec3 aPos;\n"						//Vertex Position Data
 "layout (location = 2) in vec2 textureCoordinate;\n"		//Texture Position Data
 "layout (location = 3) in vec3 normal;\n"					//Normals Position Data
+"layout (location = 4) in vec2 lightmapCoordinate;\n"		//Baked lightmap position (0 without a bake)
 
 "out vec3 vertexNormal;\n"									//Outgoing normals to fragment shader
 "out vec3 vertexFragmentPos;\n"								//Outgoing color pixels to fragment shader
 "out vec2 vertexTextureCoordinate;\n"						//Outgoing texture pixel coordinate to fragment shader 
+"out vec2 vertexLightmapCoordinate;\n"
+
+//Per-draw data, written by the draw recorders into the ring buffer
+"layout (std140, binding = 0) uniform ObjectBlock\n"
+"{\n"
+"	mat4 model;\n"
+"	mat4 normalMatrix;\n"									//transpose(inverse(model)), computed once per draw
+"	vec2 uvScale;\n"
+"};\n"
 
-"uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+//Per-frame camera and light, written once per frame into the ring buffer
+"layout (std140, binding = 1) uniform FrameBlock\n"
+"{\n"
+"	mat4 view;\n"
+"	mat4 projection;\n"
+"	vec3 objectColor;\n"
+"	float specIntensity;\n"
+"	vec3 lightColor;\n"
+"	vec3 lightPos;\n"
+"	vec3 viewPosition;\n"
+"	float shadowFarPlane;\n"								//0 when shadows are off
+"	vec4 shadowFaceLights[6];\n"							//Light position each shadow cube face was drawn from
+"};\n"
 
 "void main()\n"
 "{\n"
@@ -26,9 +48,10 @@ const char* vertexShaderSource = "#version 440 core\n"
 "	vertexFragmentPos = vec3(model * vec4(aPos, 1.0f));\n"
 
 //Get normal vectors in world space only and exclude normal translation properties
-"	vertexNormal = mat3(transpose(inverse(model))) * normal;\n"
+"	vertexNormal = mat3(normalMatrix) * normal;\n"
 
 "   vertexTextureCoordinate = textureCoordinate;\n"
+"	vertexLightmapCoordinate = lightmapCoordinate;\n"
 "}\0";
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
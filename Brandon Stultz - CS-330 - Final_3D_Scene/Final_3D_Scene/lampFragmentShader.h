@@ -1,6 +1,8 @@
 #ifndef LAMPFRAGSHADE_H
 #define LAMPFRAGSHADE_H
 
+//Compiled-in fallback for shaders/lamp.frag, which is loaded (and hot-reloaded) at runtime when present
+
 const char* lampFragmentShaderSource = "#version 440 core\n"
 
 "out vec4 fragmentColor;\n"
@@ -1,15 +1,32 @@
 #ifndef LAMPVERTSHADE_H
 #define LAMPVERTSHADE_H
 
+//Compiled-in fallback for shaders/lamp.vert, which is loaded (and hot-reloaded) at runtime when present
+
 
 const char* lampVertexShaderSource = "#version 440 core\n"
 
 "layout (location = 0) in vec3 aPos;\n"		//Lamp position data
 
-//Uniform for Transformation matrices
-"uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+//Transformation matrices; the same uniform blocks as the scene shader
+"layout (std140, binding = 0) uniform ObjectBlock\n"
+"{\n"
+"	mat4 model;\n"
+"	mat4 normalMatrix;\n"									//transpose(inverse(model)), computed once per draw
+"	vec2 uvScale;\n"
+"};\n"
+
+//Per-frame camera and light, written once per frame into the ring buffer
+"layout (std140, binding = 1) uniform FrameBlock\n"
+"{\n"
+"	mat4 view;\n"
+"	mat4 projection;\n"
+"	vec3 objectColor;\n"
+"	float specIntensity;\n"
+"	vec3 lightColor;\n"
+"	vec3 lightPos;\n"
+"	vec3 viewPosition;\n"
+"};\n"
 
 "void main()\n"
 "{\n"
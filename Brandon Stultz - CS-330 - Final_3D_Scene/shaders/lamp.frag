@@ -0,0 +1,8 @@
+#version 440 core
+
+out vec4 fragmentColor;
+
+void main()
+{
+	fragmentColor = vec4(1.0f);
+}
@@ -0,0 +1,28 @@
+#version 440 core
+
+layout (location = 0) in vec3 aPos;		//Lamp position data
+
+//Transformation matrices; the same uniform blocks as the scene shader
+layout (std140, binding = 0) uniform ObjectBlock
+{
+	mat4 model;
+	mat4 normalMatrix;									//transpose(inverse(model)), computed once per draw
+	vec2 uvScale;
+};
+
+//Per-frame camera and light, written once per frame into the ring buffer
+layout (std140, binding = 1) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec3 objectColor;
+	float specIntensity;
+	vec3 lightColor;
+	vec3 lightPos;
+	vec3 viewPosition;
+};
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+}
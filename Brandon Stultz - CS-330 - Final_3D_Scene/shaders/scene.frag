@@ -0,0 +1,85 @@
+#version 440 core
+
+in vec3 vertexNormal;				// For incoming normals
+in vec3 vertexFragmentPos;			// For incoming fragment position
+in vec2 vertexTextureCoordinate;
+in vec2 vertexLightmapCoordinate;
+
+out vec4 FragColor;
+
+uniform sampler2D Texture;
+layout (binding = 2) uniform sampler2D lightmap;		// Baked ambient, or the old constant ambient when not baked
+layout (binding = 1) uniform samplerCube shadowMap;		// Key light distances over shadowFarPlane
+
+//Per-draw data, written by the draw recorders into the ring buffer
+layout (std140, binding = 0) uniform ObjectBlock
+{
+	mat4 model;
+	mat4 normalMatrix;									//transpose(inverse(model)), computed once per draw
+	vec2 uvScale;
+};
+
+//Per-frame camera and light, written once per frame into the ring buffer
+layout (std140, binding = 1) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec3 objectColor;
+	float specIntensity;
+	vec3 lightColor;
+	vec3 lightPos;
+	vec3 viewPosition;
+	float shadowFarPlane;								//0 when shadows are off
+	vec4 shadowFaceLights[6];							//Light position each shadow cube face was drawn from
+};
+
+// Key light shadow: 0 in shadow, 1 lit. Each cube face may have been drawn from a slightly older light position,
+// so the fragment is measured against the position of the face it falls in.
+float keyLightShadow(vec3 norm, vec3 lightDirection)
+{
+	if (shadowFarPlane <= 0.0f)
+		return 1.0f;
+	vec3 fromLight = vertexFragmentPos - lightPos;
+	vec3 axis = abs(fromLight);
+	int face = axis.x >= axis.y && axis.x >= axis.z ? (fromLight.x > 0.0f ? 0 : 1) : (axis.y >= axis.z ? (fromLight.y > 0.0f ? 2 : 3) : (fromLight.z > 0.0f ? 4 : 5));
+	vec3 toFragment = vertexFragmentPos - shadowFaceLights[face].xyz;
+	float distance = length(toFragment);
+	if (distance >= shadowFarPlane)
+		return 1.0f;
+	float closest = texture(shadowMap, toFragment).r * shadowFarPlane;
+	float bias = 0.02f + 0.05f * (1.0f - max(dot(norm, lightDirection), 0.0f));	// Grazing surfaces need more
+	return distance - bias > closest ? 0.0f : 1.0f;
+}
+
+void main()
+{
+	/*Phong lighting model calculations to generate ambient, diffuse, and specular components*/
+
+	//Calculate Ambient lighting: sky light with occlusion and bounce light, baked by --bake-lightmaps
+	vec3 ambient = texture(lightmap, vertexLightmapCoordinate).rgb * lightColor;	// Generate ambient light color
+
+	//Calculate Diffuse lighting
+	vec3 norm = normalize(vertexNormal);							// Normalize vectors to 1 unit
+	vec3 lightDirection = normalize(lightPos - vertexFragmentPos);	// Calculate distance (light direction) between light source and fragments/pixels on cube
+	float impact = max(dot(norm, lightDirection), 0.0);				// Calculate diffuse impact by generating dot product of normal and light
+	vec3 diffuse = impact * lightColor;								// Generate diffuse light color
+
+	//Calculate Specular lighting
+	float specularIntensity = specIntensity;						// Set specular light strength
+	float highlightSize = 16.0f;									// Set specular highlight size
+	vec3 viewDir = normalize(viewPosition - vertexFragmentPos);		// Calculate view direction
+	vec3 reflectDir = reflect(-lightDirection, norm);				// Calculate reflection vector
+
+	//Calculate specular component
+	float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
+	vec3 specular = specularIntensity * specularComponent * lightColor;
+
+	// Texture holds the color to be used for all three components
+	vec4 textureColor = texture(Texture, vertexTextureCoordinate * uvScale);
+
+	// Calculate phong result; the key light's shadow removes its diffuse and specular parts
+	float shadow = keyLightShadow(norm, lightDirection);
+	vec3 phong = (ambient + shadow * (diffuse + specular)) * textureColor.xyz;
+
+	FragColor = vec4(phong, 1.0);									// Send lighting results to GPU
+}
@@ -0,0 +1,48 @@
+#version 440 core
+
+layout (location = 0) in vec3 aPos;						//Vertex Position Data
+layout (location = 2) in vec2 textureCoordinate;		//Texture Position Data
+layout (location = 3) in vec3 normal;					//Normals Position Data
+layout (location = 4) in vec2 lightmapCoordinate;		//Baked lightmap position (0 without a bake)
+
+out vec3 vertexNormal;									//Outgoing normals to fragment shader
+out vec3 vertexFragmentPos;								//Outgoing color pixels to fragment shader
+out vec2 vertexTextureCoordinate;						//Outgoing texture pixel coordinate to fragment shader
+out vec2 vertexLightmapCoordinate;
+
+//Per-draw data, written by the draw recorders into the ring buffer
+layout (std140, binding = 0) uniform ObjectBlock
+{
+	mat4 model;
+	mat4 normalMatrix;									//transpose(inverse(model)), computed once per draw
+	vec2 uvScale;
+};
+
+//Per-frame camera and light, written once per frame into the ring buffer
+layout (std140, binding = 1) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec3 objectColor;
+	float specIntensity;
+	vec3 lightColor;
+	vec3 lightPos;
+	vec3 viewPosition;
+	float shadowFarPlane;								//0 when shadows are off
+	vec4 shadowFaceLights[6];							//Light position each shadow cube face was drawn from
+};
+
+void main()
+{
+	//transforms vertices into clip coordinates
+	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+
+	//Gets fragment pixel position in world space only (excludes view and projection)
+	vertexFragmentPos = vec3(model * vec4(aPos, 1.0f));
+
+	//Get normal vectors in world space only and exclude normal translation properties
+	vertexNormal = mat3(normalMatrix) * normal;
+
+	vertexTextureCoordinate = textureCoordinate;
+	vertexLightmapCoordinate = lightmapCoordinate;
+}